@@ -9,9 +9,21 @@
 // =============================================================================
 // DEVICE CONFIGURATION
 // =============================================================================
-#define DEVICE_ID               "smartwaste_001"
+// Per-unit values are read from the "prov" NVS namespace at boot (see
+// provisioning.h); the defaults below apply to keys that are not provisioned.
+#define DEVICE_ID               ""      // Fixed ID for development, "" = derive
+#define DEVICE_ID_PREFIX        "smartwaste_"
 #define FIRMWARE_VERSION        "1.0.0"
 
+// Identity source when neither NVS nor DEVICE_ID provide one
+#define PROV_ID_IMEI            0       // Modem IMEI (falls back to MAC)
+#define PROV_ID_EFUSE_MAC       1       // ESP32 factory MAC
+#define PROV_ID_SOURCE          PROV_ID_IMEI
+
+#define PROV_SCHEMA_VERSION     1       // Provisioning record version
+#define PROV_ID_MAX             40      // Device ID buffer (prefix + IMEI)
+#define PROV_STR_MAX            64      // APN/broker/credential buffers
+
 // =============================================================================
 // MODEM PIN CONFIGURATION (T-SIM7000G)
 // =============================================================================
@@ -21,12 +33,29 @@
 #define MODEM_DTR_PIN           25
 #define MODEM_RING_PIN          33
 #define MODEM_BAUDRATE          115200
+#define MODEM_UART_NUM          1
+#define MODEM_STATUS_PIN        -1      // Modem STATUS output if wired (-1 = not wired)
+
+// Modem sleep: with AT+CSCLK=1 the modem enters slow clock while DTR is high.
+// DTR is raised once the UART has been idle for MODEM_SLEEP_IDLE_MS and
+// lowered MODEM_SLEEP_GUARD_MS before the next command. With AT+CFGRI=1, RI
+// pulses on URCs and incoming data and wakes the ESP32.
+#define MODEM_SLEEP_ENABLED     1
+#define MODEM_SLEEP_IDLE_MS     100     // Quiet UART time before raising DTR
+#define MODEM_SLEEP_GUARD_MS    50      // DTR low to first AT byte (SIM7000: 50 ms)
 
 // LED Configuration
 #define BOARD_LED_PIN           12
 #define LED_ON                  LOW
 #define LED_OFF                 HIGH
 
+// Status patterns are generated by LEDC and sequenced by an esp_timer, so
+// the main loop never waits on the LED.
+#define LED_LEDC_CHANNEL        7
+#define LED_LEDC_TIMER          3
+#define LED_QUEUE_DEPTH         4       // Patterns waiting behind the current one
+#define LED_LOW_BATTERY_PERCENT 20      // Show LOW_BATTERY at or below this level
+
 // =============================================================================
 // ULTRASONIC SENSOR CONFIGURATION (US-100 GPIO Mode)
 // =============================================================================
@@ -42,6 +71,17 @@
 #define US100_TIMEOUT_US        30000   // 30ms timeout for echo
 #define US100_NUM_SAMPLES       5       // Number of samples for averaging
 
+// Multi-sensor array for large containers (up to 6 sensors, MCPWM capture).
+// Entries are { trigger, echo, slot }: sensors in the same slot fire together
+// and must not see each other's beam; slots fire US_ARRAY_STAGGER_US apart.
+// When enabled the array replaces the single sensor above (list it first).
+#define US_ARRAY_ENABLED        0
+#define US_ARRAY_SENSORS        { US100_TRIGGER_PIN, US100_ECHO_PIN, 0 }, \
+                                { 13, 34, 1 }, \
+                                { 14, 36, 0 }, \
+                                { 15, 39, 1 }
+#define US_ARRAY_STAGGER_US     3000    // Gap between firing slots
+
 // =============================================================================
 // GPS CONFIGURATION
 // =============================================================================
@@ -69,26 +109,198 @@
 // SIM PIN (leave empty if not required)
 #define SIM_PIN                 ""
 
+// Radio access technology selection: attach time and success per RAT are
+// learned and the cheapest RAT is searched first, with a multi-RAT fallback.
+#define RAT_MASK_CATM           0x01
+#define RAT_MASK_NBIOT          0x02
+#define RAT_MASK_GSM            0x04
+#define RAT_SELECT_ENABLED      1
+#define RAT_ALLOWED             (RAT_MASK_CATM | RAT_MASK_NBIOT | RAT_MASK_GSM)
+#define RAT_PINNED_TIMEOUT_MS   60000   // Search on the learned RAT before falling back
+#define RAT_MAX_FAIL_STREAK     2       // Skip a RAT after this many failures in a row
+#define RAT_REEVALUATE_EVERY    20      // Attaches between trying another RAT
+
+// Last-good cell: try the cached operator/band before a full scan
+#define REG_CACHE_ENABLED       1
+#define REG_TARGETED_TIMEOUT_MS 30000   // Budget for the targeted attempt
+#define REG_MAX_FAIL_STREAK     2       // Drop the cache after this many misses
+#define REG_BANDS_CATM          "1,2,3,4,5,8,12,13,18,19,20,26,28,39"
+#define REG_BANDS_NBIOT         "1,2,3,4,5,8,12,13,18,19,20,26,28"
+
+// =============================================================================
+// WI-FI BACKHAUL CONFIGURATION
+// =============================================================================
+// When a known SSID is in range, Wi-Fi carries MQTT and the modem stays off.
+// List entries as { "ssid", "password" }, comma separated.
+#define WIFI_ENABLED            0
+#define WIFI_KNOWN_NETWORKS     { "SmartWaste-Depot", "changeme" }
+#define WIFI_CONNECT_TIMEOUT_MS 8000
+#define WIFI_SCAN_MS_PER_CHAN   120     // Active scan dwell per channel
+#define WIFI_MAX_CONNECT_MS     6000    // Prefer cellular if Wi-Fi is slower on average
+#define LINK_MAX_FAIL_STREAK    3       // Skip a link after this many consecutive failures
+#define LINK_WIFI_REPROBE_EVERY 10      // Re-try Wi-Fi after this many cellular connects
+
 // =============================================================================
 // MQTT CONFIGURATION
 // =============================================================================
 #define MQTT_BROKER             "test.mosquitto.org"
 #define MQTT_PORT               1883
-#define MQTT_CLIENT_ID          DEVICE_ID
 #define MQTT_USER               ""
 #define MQTT_PASS               ""
 
+// Broker list: the broker above (or the provisioned one) comes first, then
+// these fallbacks, as { "host", port, "user", "pass" } comma separated ("" =
+// anonymous). A fallback must be a mirror of the primary or bridged to the
+// same backend, or readings sent to it are lost; its credentials travel in
+// plaintext like the primary's. The primary is used while it is healthy;
+// after MQTT_BROKER_MAX_FAIL_STREAK failures the healthiest fallback takes
+// over and the primary is probed now and then for fail-back. While every
+// broker fails, reconnects back off. Empty: primary only.
+#define MQTT_BROKER_FALLBACKS
+#define MQTT_BROKER_MAX_FAIL_STREAK 2   // Skip a broker after this many failures in a row
+#define MQTT_BROKER_FAILOVER_TRIES  2   // Brokers tried per connect attempt
+#define MQTT_BROKER_PROBE_EVERY 20      // Connects to a fallback between fail-back probes
+#define MQTT_BROKER_BACKOFF_MAX_MS 900000 // Longest reconnect delay during an outage (15 min)
+
+// Persistent session: broker keeps subscriptions and queued QoS 1 downlink
+// while the device sleeps; resubscription is skipped when it survived.
+#define MQTT_CLEAN_SESSION      0
+
+// Client framing buffers (static, no heap after boot)
+#define MQTT_TX_BUFFER_SIZE     512     // Largest outbound packet (JSON telemetry)
+#define MQTT_RX_BUFFER_SIZE     256     // Larger inbound messages are dropped
+#define MQTT_MAX_SUBSCRIPTIONS  8       // Also the number of routed topic filters
+
+// Inbound topic router (trie over filter levels, fixed pools)
+#define MQTT_ROUTER_MAX_NODES   32      // Distinct filter levels
+#define MQTT_ROUTER_POOL_SIZE   256     // Bytes of level text
+#define MQTT_ROUTER_MAX_WILDCARDS 4     // '+'/'#' captures passed to handlers
+
+// MQTT 5 (opt-in): topic aliases shrink repeated PUBLISH headers to 3 bytes,
+// the broker drops the session after MQTT_SESSION_EXPIRY_S without a connect.
+// Falls back to 3.1.1 for the rest of the boot if the broker refuses it.
+#define MQTT_USE_V5             0
+#define MQTT_SESSION_EXPIRY_S   86400   // 24 hours, longer than any sleep
+
+// Adaptive keepalive: the ping interval is stretched until the carrier NAT
+// drops the idle flow, then settles just below; learned per operator/SSID.
+// The broker sees MQTT_KEEPALIVE_MAX_S, so the will fires up to 1.5x later.
+#define MQTT_KEEPALIVE_ADAPTIVE 1
+#define MQTT_KEEPALIVE_MIN_S    60      // Starting (known safe) interval
+#define MQTT_KEEPALIVE_MAX_S    1800    // Longest interval tried, advertised in CONNECT
+#define MQTT_KEEPALIVE_STEP_S   60      // Stop searching when bounds are this close
+#define MQTT_KEEPALIVE_CONFIRMS 2       // Idle pings answered before an interval is safe
+#define MQTT_KEEPALIVE_PING_TIMEOUT_MS 30000 // PINGRESP deadline before the flow is dropped
+
+// Last will: retained "offline" on the status topic if the device drops off
+#define MQTT_STATUS_TOPIC_SUFFIX "status"
+#define MQTT_WILL_QOS           1
+#define MQTT_WILL_RETAIN        1
+#define MQTT_WILL_MESSAGE       "offline"
+#define MQTT_ONLINE_MESSAGE     "online"
+
 // Topic format: smartwaste/{device_id}/data
 #define MQTT_TOPIC_PREFIX       "smartwaste"
 #define MQTT_TOPIC_SUFFIX       "data"
+#define MQTT_DIAG_TOPIC_SUFFIX  "diag"
+#define MQTT_SUMMARY_TOPIC_SUFFIX "summary"
+#define MQTT_EVENT_TOPIC_SUFFIX "event"
+
+// =============================================================================
+// OUTBOUND QUEUE CONFIGURATION
+// =============================================================================
+// Alerts (full bin, sensor failure) are sent at once; telemetry and
+// diagnostics are held and flushed together in batch windows.
+#define OUTBOUND_QUEUE_SIZE     8       // Messages held across all classes
+#define OUTBOUND_TOPIC_MAX      64
+#define OUTBOUND_PAYLOAD_MAX    384
+#define OUTBOUND_BATCH_WINDOW_MS 900000 // Routine flush period (15 min)
+#define OUTBOUND_BATCH_SIZE     4       // Flush early once this many are queued
+#define OUTBOUND_MAX_DEFER_MS   1800000 // Never hold routine traffic longer
+#define OUTBOUND_AGING_MS       600000  // Waiting this long promotes one class
+#define OUTBOUND_MAX_PER_SERVICE 4      // Routine messages sent per loop pass
+#define OUTBOUND_STATS_INTERVAL_MS 3600000 // Queue latency report period
+
+// =============================================================================
+// SIGNAL-AWARE SCHEDULING
+// =============================================================================
+// Routine traffic (batches, backlog, diagnostics, log upload) waits while
+// the cellular signal is poor; alerts are never held. RSRP (AT+CESQ) is used
+// on LTE, CSQ otherwise. Energy per byte is tracked per signal bucket.
+#define SIGNAL_AWARE_ENABLED    1
+#define SIGNAL_SAMPLE_INTERVAL_MS 60000 // Min time between CSQ/CESQ queries
+#define SIGNAL_GOOD_RSRP_DBM    -100    // At or above: good
+#define SIGNAL_POOR_RSRP_DBM    -112    // At or below: poor (hold routine traffic)
+#define SIGNAL_GOOD_CSQ         15      // CSQ thresholds when no RSRP is reported
+#define SIGNAL_POOR_CSQ         7
+#define SIGNAL_MAX_DEFER_MS     3600000 // Routine traffic never waits longer (1 h)
+#define SIGNAL_TX_POWER_MW      600     // Mean modem power while publishing (estimate)
 
 // =============================================================================
 // TIMING CONFIGURATION
 // =============================================================================
 #define PUBLISH_INTERVAL_MS     1000
 #define MQTT_RECONNECT_DELAY_MS 10000   // 10 seconds
+#define ERROR_RETRY_DELAY_MS    10000   // Between error recovery attempts
 #define NETWORK_TIMEOUT_MS      180000  // 3 minutes
-#define MODEM_INIT_DELAY_MS     3000    // 3 seconds
+
+// Modem boot sequencing (readiness is detected, not waited out)
+#define MODEM_PWRKEY_PULSE_MS   1000    // SIM7000 PWRKEY on-pulse (datasheet min 1 s)
+#define MODEM_BOOT_TIMEOUT_MS   10000   // Max wait for STATUS / RDY / AT after power on
+#define MODEM_AT_PROBE_MS       250     // AT probe interval while booting
+#define MODEM_MAX_POWER_CYCLES  3       // Power cycles before init gives up
+#define MODEM_PERSIST_PROFILE   1       // Store config in modem NVRAM (AT&W)
+
+// =============================================================================
+// AGGREGATION CONFIGURATION
+// =============================================================================
+// Readings are folded into per-window summaries (min/max/mean/last, sample
+// and invalid counts, battery trend) published on {prefix}/{device}/summary.
+// Raw readings go out only on anomalies: the first reading after boot, a
+// fill jump, or entering/leaving the full or sensor-failed state.
+#define AGG_ENABLED             1
+#define AGG_WINDOW_SAMPLES      60      // Close a window after this many readings
+#define AGG_WINDOW_MS           900000  // ...or after this long (15 min)
+#define AGG_ANOMALY_DELTA       15      // Fill change (%) between readings sent raw
+
+// =============================================================================
+// EVENT DETECTION CONFIGURATION
+// =============================================================================
+// Step changes in the fill level are confirmed on the device and sent at
+// once as alerts on {prefix}/{device}/event: a large drop is a collection,
+// a large rise a bulk dump or an obstruction.
+#define EVENT_ENABLED           1
+#define EVENT_EMPTIED_DELTA     30      // Fill drop (%) that opens an emptied candidate
+#define EVENT_FILL_DELTA        25      // Fill rise (%) that opens a sudden-fill candidate
+#define EVENT_HYSTERESIS        10      // Confirming readings may fall short by this much
+#define EVENT_CONFIRM_SAMPLES   3       // Readings (incl. the first) to confirm a step
+#define EVENT_FAST_INTERVAL_MS  10000   // Sampling while confirming and after an event
+#define EVENT_FAST_WINDOW_MS    120000  // Fast sampling kept this long after an event
+
+// =============================================================================
+// FILL FORECAST CONFIGURATION
+// =============================================================================
+// Learns the bin's fill rate (exponential smoothing + weekday/hour profile)
+// and schedules the next sample from the estimated time to threshold.
+// When enabled it replaces PUBLISH_INTERVAL_MS: the interval becomes
+// FORECAST_LEARN_WAKE_S (30 min) while learning, then 15 min to 6 h, so an
+// AGG_WINDOW_SAMPLES window spans days - lower AGG_WINDOW_SAMPLES with it.
+#define FORECAST_ENABLED        0
+#define FILL_FULL_THRESHOLD     80      // Fill level (%) reported as full
+#define FORECAST_RATE_ALPHA     0.2f    // Base rate smoothing factor
+#define FORECAST_SEASON_GAMMA   0.1f    // Seasonal profile smoothing factor
+#define FORECAST_MIN_SAMPLES    3       // Samples before forecasting
+#define FORECAST_MIN_SAMPLE_GAP_S 300   // Ignore samples closer than this
+#define FORECAST_EMPTIED_DROP   20.0f   // Fill drop (%) treated as emptied
+#define FORECAST_HORIZON_H      336     // Max ETA look-ahead (14 days)
+#define FORECAST_WAKE_FRACTION  0.5f    // Sleep this share of the ETA
+#define FORECAST_MIN_WAKE_S     900     // Densest sampling near threshold
+#define FORECAST_MAX_WAKE_S     21600   // Sparsest sampling (6 h)
+#define FORECAST_LEARN_WAKE_S   1800    // Interval while the model is learning
+#define FORECAST_FULL_WAKE_S    3600    // Interval once above threshold
+#define FORECAST_SAVE_EVERY     24      // Updates between NVS saves
+#define LOCAL_UTC_OFFSET_MIN    180     // Used when the network gives no time zone
+#define NTP_SERVER              "pool.ntp.org"  // Clock source on Wi-Fi
 
 // =============================================================================
 // BATTERY CONFIGURATION
@@ -100,20 +312,86 @@
 #define BATTERY_MIN_VOLTAGE     3.3f    // Minimum voltage (0%)
 #define BATTERY_MAX_VOLTAGE     4.2f    // Maximum voltage (100%)
 
+// =============================================================================
+// POWER MANAGEMENT CONFIGURATION
+// =============================================================================
+// Dynamic frequency scaling + automatic light sleep between loop iterations.
+// Light sleep requires CONFIG_FREERTOS_USE_TICKLESS_IDLE in the framework
+// sdkconfig; without it the firmware falls back to DFS only.
+#define PM_ENABLED              1
+#define PM_MAX_CPU_FREQ_MHZ     240
+#define PM_MIN_CPU_FREQ_MHZ     40      // XTAL frequency
+#define PM_LIGHT_SLEEP_ENABLED  1
+#define PM_UART_WAKE_THRESHOLD  3       // RX edges needed to wake from light sleep
+#define PM_LOOP_IDLE_MS         50      // Idle time between loop iterations
+#define PM_MQTT_POLL_MS         1000    // MQTT poll period when UART is quiet
+#define PM_UART_IDLE_MS         100     // Quiet modem UART time before UART_RX is released
+#define PM_STATS_INTERVAL_MS    60000   // Residency statistics log interval
+
+// Deep sleep between samples, watched by the ULP coprocessor: every
+// ULP_PERIOD_MS it checks the battery against a band of
+// +/-ULP_BATTERY_BAND_MV around the voltage at sleep and the lid switch
+// against its level at sleep, and wakes the CPU early on a change. The
+// battery pin must be on ADC1 and the lid pin an RTC GPIO. Off by default:
+// the queue and window aggregate live in RAM, so the app only sleeps when
+// both are empty.
+#define DEEP_SLEEP_ENABLED      0
+#define DEEP_SLEEP_MIN_S        120     // Stay awake if the next sample is sooner
+#define ULP_PERIOD_MS           1000    // ULP check period
+#define ULP_BATTERY_BAND_MV     100     // Battery change that wakes the CPU
+#define ULP_LID_PIN             -1      // Lid switch RTC GPIO to GND (-1 = none)
+
 // =============================================================================
 // DEBUG CONFIGURATION
 // =============================================================================
 #define SERIAL_DEBUG            1
-#define DUMP_AT_COMMANDS        0       // Set to 1 to see AT commands
-
-#if SERIAL_DEBUG
-    #define DEBUG_PRINT(x)      Serial.print(x)
-    #define DEBUG_PRINTLN(x)    Serial.println(x)
-    #define DEBUG_PRINTF(...)   Serial.printf(__VA_ARGS__)
-#else
-    #define DEBUG_PRINT(x)
-    #define DEBUG_PRINTLN(x)
-    #define DEBUG_PRINTF(...)
-#endif
+#define DUMP_AT_COMMANDS        0       // Set to 1 to see AT commands (slows the link)
+
+// AT traffic capture: a tap on the modem UART records both directions with
+// microsecond timestamps into a RAM ring. An error trigger keeps
+// AT_CAPTURE_POST_SLOTS more records and holds the ring until it is
+// exported ({"source":"at"} on cmd/logs, or the serial dump).
+#define AT_CAPTURE_ENABLED      1
+#define AT_CAPTURE_SLOTS        1024    // 32-byte records in PSRAM (32 KB)
+#define AT_CAPTURE_SLOTS_SMALL  64      // Records in internal RAM without PSRAM
+#define AT_CAPTURE_GAP_US       2000    // Same-direction bytes closer than this share a record
+#define AT_CAPTURE_POST_SLOTS   32      // Records kept after a trigger
+#define AT_CAPTURE_SETTLE_MS    2000    // Quiet time that also completes a triggered capture
+#define AT_CAPTURE_DUMP_SERIAL  0       // Print a completed capture on the debug port
+
+// Log levels; calls above LOG_LEVEL are compiled out
+#define LOG_LEVEL_NONE          0
+#define LOG_LEVEL_ERROR         1
+#define LOG_LEVEL_WARN          2
+#define LOG_LEVEL_INFO          3
+#define LOG_LEVEL_DEBUG         4
+#define LOG_LEVEL_VERBOSE       5
+#define LOG_LEVEL               LOG_LEVEL_INFO
+
+// Deferred logging: calls capture the format pointer and raw arguments into
+// a RAM ring; a low-priority task formats and prints them. Set LOG_DEFERRED
+// to 0 to print synchronously (e.g. to see the last lines before a crash).
+#define LOG_DEFERRED            1
+#define LOG_BUFFER_SIZE         4096    // Ring size in bytes, power of two
+#define LOG_RECORD_MAX_SIZE     128     // Header + arguments; longer strings are cut
+#define LOG_LINE_MAX_SIZE       256     // Formatted line buffer in the drain task
+#define LOG_HISTORY_SIZE        4096    // Recent printed output kept for upload
+
+// Remote log upload (request on {prefix}/{device}/cmd/logs)
+#define LOG_UPLOAD_CMD_SUFFIX   "cmd/logs"
+#define LOG_UPLOAD_TOPIC_SUFFIX "diag/logs"
+#define LOG_UPLOAD_CHUNK_SIZE   180     // Compressed bytes per message (240 base64 chars)
+#define LOG_UPLOAD_INTERVAL_MS  500     // Minimum gap between chunks
+#define LOG_UPLOAD_ID_MAX       17      // Request id length + 1
+#define LOG_DRAIN_PERIOD_MS     100     // Drain task poll period
+#define LOG_DRAIN_TASK_STACK    3072
+#define LOG_DRAIN_TASK_PRIORITY 1
+
+#include "../src/drivers/log_driver.h"
+
+// Legacy debug macros log at INFO level
+#define DEBUG_PRINT(x)          LOG_I("%s", x)
+#define DEBUG_PRINTLN(x)        LOG_I("%s\n", x)
+#define DEBUG_PRINTF(...)       LOG_I(__VA_ARGS__)
 
 #endif // CONFIG_H
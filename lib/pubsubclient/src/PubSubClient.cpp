@@ -10,10 +10,15 @@
 
 PubSubClient::PubSubClient() {
     this->_state = MQTT_DISCONNECTED;
+    this->_sessionPresent = false;
+    this->nextMsgId = 1;
+    initMqtt5();
     this->_client = NULL;
     this->stream = NULL;
     setCallback(NULL);
     this->bufferSize = 0;
+    this->bufferOwned = true;
+    this->overflowStream = NULL;
     setBufferSize(MQTT_MAX_PACKET_SIZE);
     setKeepAlive(MQTT_KEEPALIVE);
     setSocketTimeout(MQTT_SOCKET_TIMEOUT);
@@ -21,9 +26,14 @@ PubSubClient::PubSubClient() {
 
 PubSubClient::PubSubClient(Client& client) {
     this->_state = MQTT_DISCONNECTED;
+    this->_sessionPresent = false;
+    this->nextMsgId = 1;
+    initMqtt5();
     setClient(client);
     this->stream = NULL;
     this->bufferSize = 0;
+    this->bufferOwned = true;
+    this->overflowStream = NULL;
     setBufferSize(MQTT_MAX_PACKET_SIZE);
     setKeepAlive(MQTT_KEEPALIVE);
     setSocketTimeout(MQTT_SOCKET_TIMEOUT);
@@ -31,42 +41,62 @@ PubSubClient::PubSubClient(Client& client) {
 
 PubSubClient::PubSubClient(IPAddress addr, uint16_t port, Client& client) {
     this->_state = MQTT_DISCONNECTED;
+    this->_sessionPresent = false;
+    this->nextMsgId = 1;
+    initMqtt5();
     setServer(addr, port);
     setClient(client);
     this->stream = NULL;
     this->bufferSize = 0;
+    this->bufferOwned = true;
+    this->overflowStream = NULL;
     setBufferSize(MQTT_MAX_PACKET_SIZE);
     setKeepAlive(MQTT_KEEPALIVE);
     setSocketTimeout(MQTT_SOCKET_TIMEOUT);
 }
 PubSubClient::PubSubClient(IPAddress addr, uint16_t port, Client& client, Stream& stream) {
     this->_state = MQTT_DISCONNECTED;
+    this->_sessionPresent = false;
+    this->nextMsgId = 1;
+    initMqtt5();
     setServer(addr,port);
     setClient(client);
     setStream(stream);
     this->bufferSize = 0;
+    this->bufferOwned = true;
+    this->overflowStream = NULL;
     setBufferSize(MQTT_MAX_PACKET_SIZE);
     setKeepAlive(MQTT_KEEPALIVE);
     setSocketTimeout(MQTT_SOCKET_TIMEOUT);
 }
 PubSubClient::PubSubClient(IPAddress addr, uint16_t port, MQTT_CALLBACK_SIGNATURE, Client& client) {
     this->_state = MQTT_DISCONNECTED;
+    this->_sessionPresent = false;
+    this->nextMsgId = 1;
+    initMqtt5();
     setServer(addr, port);
     setCallback(callback);
     setClient(client);
     this->stream = NULL;
     this->bufferSize = 0;
+    this->bufferOwned = true;
+    this->overflowStream = NULL;
     setBufferSize(MQTT_MAX_PACKET_SIZE);
     setKeepAlive(MQTT_KEEPALIVE);
     setSocketTimeout(MQTT_SOCKET_TIMEOUT);
 }
 PubSubClient::PubSubClient(IPAddress addr, uint16_t port, MQTT_CALLBACK_SIGNATURE, Client& client, Stream& stream) {
     this->_state = MQTT_DISCONNECTED;
+    this->_sessionPresent = false;
+    this->nextMsgId = 1;
+    initMqtt5();
     setServer(addr,port);
     setCallback(callback);
     setClient(client);
     setStream(stream);
     this->bufferSize = 0;
+    this->bufferOwned = true;
+    this->overflowStream = NULL;
     setBufferSize(MQTT_MAX_PACKET_SIZE);
     setKeepAlive(MQTT_KEEPALIVE);
     setSocketTimeout(MQTT_SOCKET_TIMEOUT);
@@ -74,42 +104,62 @@ PubSubClient::PubSubClient(IPAddress addr, uint16_t port, MQTT_CALLBACK_SIGNATUR
 
 PubSubClient::PubSubClient(uint8_t *ip, uint16_t port, Client& client) {
     this->_state = MQTT_DISCONNECTED;
+    this->_sessionPresent = false;
+    this->nextMsgId = 1;
+    initMqtt5();
     setServer(ip, port);
     setClient(client);
     this->stream = NULL;
     this->bufferSize = 0;
+    this->bufferOwned = true;
+    this->overflowStream = NULL;
     setBufferSize(MQTT_MAX_PACKET_SIZE);
     setKeepAlive(MQTT_KEEPALIVE);
     setSocketTimeout(MQTT_SOCKET_TIMEOUT);
 }
 PubSubClient::PubSubClient(uint8_t *ip, uint16_t port, Client& client, Stream& stream) {
     this->_state = MQTT_DISCONNECTED;
+    this->_sessionPresent = false;
+    this->nextMsgId = 1;
+    initMqtt5();
     setServer(ip,port);
     setClient(client);
     setStream(stream);
     this->bufferSize = 0;
+    this->bufferOwned = true;
+    this->overflowStream = NULL;
     setBufferSize(MQTT_MAX_PACKET_SIZE);
     setKeepAlive(MQTT_KEEPALIVE);
     setSocketTimeout(MQTT_SOCKET_TIMEOUT);
 }
 PubSubClient::PubSubClient(uint8_t *ip, uint16_t port, MQTT_CALLBACK_SIGNATURE, Client& client) {
     this->_state = MQTT_DISCONNECTED;
+    this->_sessionPresent = false;
+    this->nextMsgId = 1;
+    initMqtt5();
     setServer(ip, port);
     setCallback(callback);
     setClient(client);
     this->stream = NULL;
     this->bufferSize = 0;
+    this->bufferOwned = true;
+    this->overflowStream = NULL;
     setBufferSize(MQTT_MAX_PACKET_SIZE);
     setKeepAlive(MQTT_KEEPALIVE);
     setSocketTimeout(MQTT_SOCKET_TIMEOUT);
 }
 PubSubClient::PubSubClient(uint8_t *ip, uint16_t port, MQTT_CALLBACK_SIGNATURE, Client& client, Stream& stream) {
     this->_state = MQTT_DISCONNECTED;
+    this->_sessionPresent = false;
+    this->nextMsgId = 1;
+    initMqtt5();
     setServer(ip,port);
     setCallback(callback);
     setClient(client);
     setStream(stream);
     this->bufferSize = 0;
+    this->bufferOwned = true;
+    this->overflowStream = NULL;
     setBufferSize(MQTT_MAX_PACKET_SIZE);
     setKeepAlive(MQTT_KEEPALIVE);
     setSocketTimeout(MQTT_SOCKET_TIMEOUT);
@@ -117,49 +167,93 @@ PubSubClient::PubSubClient(uint8_t *ip, uint16_t port, MQTT_CALLBACK_SIGNATURE,
 
 PubSubClient::PubSubClient(const char* domain, uint16_t port, Client& client) {
     this->_state = MQTT_DISCONNECTED;
+    this->_sessionPresent = false;
+    this->nextMsgId = 1;
+    initMqtt5();
     setServer(domain,port);
     setClient(client);
     this->stream = NULL;
     this->bufferSize = 0;
+    this->bufferOwned = true;
+    this->overflowStream = NULL;
     setBufferSize(MQTT_MAX_PACKET_SIZE);
     setKeepAlive(MQTT_KEEPALIVE);
     setSocketTimeout(MQTT_SOCKET_TIMEOUT);
 }
 PubSubClient::PubSubClient(const char* domain, uint16_t port, Client& client, Stream& stream) {
     this->_state = MQTT_DISCONNECTED;
+    this->_sessionPresent = false;
+    this->nextMsgId = 1;
+    initMqtt5();
     setServer(domain,port);
     setClient(client);
     setStream(stream);
     this->bufferSize = 0;
+    this->bufferOwned = true;
+    this->overflowStream = NULL;
     setBufferSize(MQTT_MAX_PACKET_SIZE);
     setKeepAlive(MQTT_KEEPALIVE);
     setSocketTimeout(MQTT_SOCKET_TIMEOUT);
 }
 PubSubClient::PubSubClient(const char* domain, uint16_t port, MQTT_CALLBACK_SIGNATURE, Client& client) {
     this->_state = MQTT_DISCONNECTED;
+    this->_sessionPresent = false;
+    this->nextMsgId = 1;
+    initMqtt5();
     setServer(domain,port);
     setCallback(callback);
     setClient(client);
     this->stream = NULL;
     this->bufferSize = 0;
+    this->bufferOwned = true;
+    this->overflowStream = NULL;
     setBufferSize(MQTT_MAX_PACKET_SIZE);
     setKeepAlive(MQTT_KEEPALIVE);
     setSocketTimeout(MQTT_SOCKET_TIMEOUT);
 }
 PubSubClient::PubSubClient(const char* domain, uint16_t port, MQTT_CALLBACK_SIGNATURE, Client& client, Stream& stream) {
     this->_state = MQTT_DISCONNECTED;
+    this->_sessionPresent = false;
+    this->nextMsgId = 1;
+    initMqtt5();
     setServer(domain,port);
     setCallback(callback);
     setClient(client);
     setStream(stream);
     this->bufferSize = 0;
+    this->bufferOwned = true;
+    this->overflowStream = NULL;
     setBufferSize(MQTT_MAX_PACKET_SIZE);
     setKeepAlive(MQTT_KEEPALIVE);
     setSocketTimeout(MQTT_SOCKET_TIMEOUT);
 }
 
 PubSubClient::~PubSubClient() {
-  free(this->buffer);
+  if (this->bufferOwned) {
+    free(this->buffer);
+  }
+}
+
+void PubSubClient::initMqtt5() {
+    this->protocolVersion = MQTT_VERSION;
+    this->_reasonCode = 0;
+    this->sessionExpiry = 0;
+    this->grantedSessionExpiry = 0;
+    this->receiveMaximum = 0;
+    this->serverReceiveMaximum = 65535;
+    this->serverTopicAliasMaximum = 0;
+    this->serverMaximumPacketSize = 0;
+    this->serverKeepAlive = 0;
+    clearTopicAliases();
+}
+
+void PubSubClient::clearTopicAliases() {
+#if MQTT5_TOPIC_ALIAS_SLOTS > 0
+    for (uint8_t i = 0; i < MQTT5_TOPIC_ALIAS_SLOTS; i++) {
+        this->topicAliases[i][0] = 0;
+    }
+    this->pendingTopicAlias = 0;
+#endif
 }
 
 boolean PubSubClient::connect(const char *id) {
@@ -194,7 +288,20 @@ boolean PubSubClient::connect(const char *id, const char *user, const char *pass
         }
 
         if (result == 1) {
-            nextMsgId = 1;
+            _sessionPresent = false;
+            if (cleanSession) {
+                // A resumed session keeps its packet identifiers
+                nextMsgId = 1;
+            }
+            // Topic aliases and broker limits only live as long as the connection
+            clearTopicAliases();
+            _reasonCode = 0;
+            grantedSessionExpiry = sessionExpiry;
+            serverReceiveMaximum = 65535;
+            serverTopicAliasMaximum = 0;
+            serverMaximumPacketSize = 0;
+            serverKeepAlive = 0;
+            boolean v5 = (this->protocolVersion == MQTT_VERSION_5);
             // Leave room in the buffer for header and variable length field
             uint16_t length = MQTT_MAX_HEADER_SIZE;
             unsigned int j;
@@ -206,8 +313,15 @@ boolean PubSubClient::connect(const char *id, const char *user, const char *pass
             uint8_t d[7] = {0x00,0x04,'M','Q','T','T',MQTT_VERSION};
 #define MQTT_HEADER_VERSION_LENGTH 7
 #endif
-            for (j = 0;j<MQTT_HEADER_VERSION_LENGTH;j++) {
-                this->buffer[length++] = d[j];
+            if (v5) {
+                const uint8_t d5[7] = {0x00,0x04,'M','Q','T','T',MQTT_VERSION_5};
+                for (j = 0;j<7;j++) {
+                    this->buffer[length++] = d5[j];
+                }
+            } else {
+                for (j = 0;j<MQTT_HEADER_VERSION_LENGTH;j++) {
+                    this->buffer[length++] = d[j];
+                }
             }
 
             uint8_t v;
@@ -232,9 +346,49 @@ boolean PubSubClient::connect(const char *id, const char *user, const char *pass
             this->buffer[length++] = ((this->keepAlive) >> 8);
             this->buffer[length++] = ((this->keepAlive) & 0xFF);
 
+            if (v5) {
+                // CONNECT properties (at most 15 bytes)
+                uint8_t props[15];
+                uint8_t plen = 0;
+                if (this->sessionExpiry > 0) {
+                    props[plen++] = MQTT5_PROP_SESSION_EXPIRY;
+                    props[plen++] = (this->sessionExpiry >> 24);
+                    props[plen++] = (this->sessionExpiry >> 16) & 0xFF;
+                    props[plen++] = (this->sessionExpiry >> 8) & 0xFF;
+                    props[plen++] = (this->sessionExpiry & 0xFF);
+                }
+                if (this->receiveMaximum > 0) {
+                    props[plen++] = MQTT5_PROP_RECEIVE_MAXIMUM;
+                    props[plen++] = (this->receiveMaximum >> 8);
+                    props[plen++] = (this->receiveMaximum & 0xFF);
+                }
+                if (!this->stream && !this->overflowStream) {
+                    // Without a stream larger packets would be dropped anyway;
+                    // with an overflow stream they are accepted and streamed
+                    props[plen++] = MQTT5_PROP_MAXIMUM_PACKET_SIZE;
+                    props[plen++] = 0;
+                    props[plen++] = 0;
+                    props[plen++] = (this->rxBufferSize >> 8);
+                    props[plen++] = (this->rxBufferSize & 0xFF);
+                }
+                if (length + 1 + plen > this->bufferSize) {
+                    _client->stop();
+                    return false;
+                }
+                this->buffer[length++] = plen;
+                for (j = 0;j<plen;j++) {
+                    this->buffer[length++] = props[j];
+                }
+            }
+
             CHECK_STRING_LENGTH(length,id)
             length = writeString(id,this->buffer,length);
             if (willTopic) {
+                if (v5) {
+                    // Will properties: none
+                    CHECK_STRING_LENGTH(length,"")
+                    this->buffer[length++] = 0;
+                }
                 CHECK_STRING_LENGTH(length,willTopic)
                 length = writeString(willTopic,this->buffer,length);
                 CHECK_STRING_LENGTH(length,willMessage)
@@ -265,14 +419,24 @@ boolean PubSubClient::connect(const char *id, const char *user, const char *pass
             uint8_t llen;
             uint32_t len = readPacket(&llen);
 
-            if (len == 4) {
-                if (buffer[3] == 0) {
+            if (len == 4 || (v5 && len > 4 && (rxBuffer[0]&0xF0) == MQTTCONNACK)) {
+                // Flags and return/reason code follow the remaining length
+                uint8_t flags = rxBuffer[llen+1];
+                _reasonCode = rxBuffer[llen+2];
+                if (_reasonCode == 0) {
+                    if (v5 && !parseConnackProperties(llen+3, len)) {
+                        _state = MQTT_CONNECT_FAILED;
+                        _client->stop();
+                        return false;
+                    }
+                    // Session Present (CONNACK flags bit 0) is only valid without cleanSession
+                    _sessionPresent = !cleanSession && (flags & 0x01);
                     lastInActivity = millis();
                     pingOutstanding = false;
                     _state = MQTT_CONNECTED;
                     return true;
                 } else {
-                    _state = buffer[3];
+                    _state = _reasonCode;
                 }
             }
             _client->stop();
@@ -311,13 +475,17 @@ boolean PubSubClient::readByte(uint8_t * result, uint16_t * index){
 
 uint32_t PubSubClient::readPacket(uint8_t* lengthLength) {
     uint16_t len = 0;
-    if(!readByte(this->buffer, &len)) return 0;
-    bool isPublish = (this->buffer[0]&0xF0) == MQTTPUBLISH;
+    if(!readByte(this->rxBuffer, &len)) return 0;
+    bool isPublish = (this->rxBuffer[0]&0xF0) == MQTTPUBLISH;
     uint32_t multiplier = 1;
     uint32_t length = 0;
     uint8_t digit = 0;
-    uint16_t skip = 0;
+    uint32_t skip = 0;
     uint32_t start = 0;
+    // MQTT 5 PUBLISH: property length (and properties) are not payload either
+    bool propsPending = false;
+    uint32_t propsLength = 0;
+    uint32_t propsMultiplier = 1;
 
     do {
         if (len == 5) {
@@ -327,7 +495,7 @@ uint32_t PubSubClient::readPacket(uint8_t* lengthLength) {
             return 0;
         }
         if(!readByte(&digit)) return 0;
-        this->buffer[len++] = digit;
+        this->rxBuffer[len++] = digit;
         length += (digit & 127) * multiplier;
         multiplier <<=7; //multiplier *= 128
     } while ((digit & 128) != 0);
@@ -335,33 +503,54 @@ uint32_t PubSubClient::readPacket(uint8_t* lengthLength) {
 
     if (isPublish) {
         // Read in topic length to calculate bytes to skip over for Stream writing
-        if(!readByte(this->buffer, &len)) return 0;
-        if(!readByte(this->buffer, &len)) return 0;
-        skip = (this->buffer[*lengthLength+1]<<8)+this->buffer[*lengthLength+2];
+        if(!readByte(this->rxBuffer, &len)) return 0;
+        if(!readByte(this->rxBuffer, &len)) return 0;
+        skip = (this->rxBuffer[*lengthLength+1]<<8)+this->rxBuffer[*lengthLength+2];
         start = 2;
-        if (this->buffer[0]&MQTTQOS1) {
+        if (this->rxBuffer[0]&MQTTQOS1) {
             // skip message id
             skip += 2;
         }
+        propsPending = (this->protocolVersion == MQTT_VERSION_5);
     }
     uint32_t idx = len;
 
+    // A PUBLISH that does not fit the receive buffer goes to the overflow
+    // stream; only its header (topic, msgId) is kept in the buffer
+    Stream* sink = this->stream;
+    this->overflowed = false;
+    this->streamedLength = 0;
+    if (!sink && isPublish && this->overflowStream && 1+*lengthLength+length > this->rxBufferSize) {
+        sink = this->overflowStream;
+        this->overflowed = true;
+    }
+
     for (uint32_t i = start;i<length;i++) {
         if(!readByte(&digit)) return 0;
-        if (this->stream) {
+        if (propsPending && idx-*lengthLength-2 == skip+1) {
+            propsLength += (digit & 127) * propsMultiplier;
+            propsMultiplier <<= 7;
+            skip++;
+            if ((digit & 128) == 0) {
+                skip += propsLength;
+                propsPending = false;
+            }
+        }
+        if (sink) {
             if (isPublish && idx-*lengthLength-2>skip) {
-                this->stream->write(digit);
+                sink->write(digit);
+                this->streamedLength++;
             }
         }
 
-        if (len < this->bufferSize) {
-            this->buffer[len] = digit;
+        if (len < this->rxBufferSize) {
+            this->rxBuffer[len] = digit;
             len++;
         }
         idx++;
     }
 
-    if (!this->stream && idx > this->bufferSize) {
+    if (!sink && idx > this->rxBufferSize) {
         len = 0; // This will cause the packet to be ignored.
     }
     return len;
@@ -370,7 +559,8 @@ uint32_t PubSubClient::readPacket(uint8_t* lengthLength) {
 boolean PubSubClient::loop() {
     if (connected()) {
         unsigned long t = millis();
-        if ((t - lastInActivity > this->keepAlive*1000UL) || (t - lastOutActivity > this->keepAlive*1000UL)) {
+        unsigned long keepAliveMs = getKeepAlive()*1000UL;
+        if ((t - lastInActivity > keepAliveMs) || (t - lastOutActivity > keepAliveMs)) {
             if (pingOutstanding) {
                 this->_state = MQTT_CONNECTION_TIMEOUT;
                 _client->stop();
@@ -391,18 +581,35 @@ boolean PubSubClient::loop() {
             uint8_t *payload;
             if (len > 0) {
                 lastInActivity = t;
-                uint8_t type = this->buffer[0]&0xF0;
+                uint8_t type = this->rxBuffer[0]&0xF0;
                 if (type == MQTTPUBLISH) {
-                    if (callback) {
-                        uint16_t tl = (this->buffer[llen+1]<<8)+this->buffer[llen+2]; /* topic length in bytes */
-                        memmove(this->buffer+llen+2,this->buffer+llen+3,tl); /* move topic inside buffer 1 byte to front */
-                        this->buffer[llen+2+tl] = 0; /* end the topic as a 'C' string with \x00 */
-                        char *topic = (char*) this->buffer+llen+2;
+                    uint16_t tl = (this->rxBuffer[llen+1]<<8)+this->rxBuffer[llen+2]; /* topic length in bytes */
+                    uint16_t hdr = llen+3+tl+(((this->rxBuffer[0]&0x06) == MQTTQOS1) ? 2 : 0);
+                    if (callback && hdr <= len) {
+                        memmove(this->rxBuffer+llen+2,this->rxBuffer+llen+3,tl); /* move topic inside buffer 1 byte to front */
+                        this->rxBuffer[llen+2+tl] = 0; /* end the topic as a 'C' string with \x00 */
+                        char *topic = (char*) this->rxBuffer+llen+2;
+                        uint16_t pos = llen+3+tl;
                         // msgId only present for QOS>0
-                        if ((this->buffer[0]&0x06) == MQTTQOS1) {
-                            msgId = (this->buffer[llen+3+tl]<<8)+this->buffer[llen+3+tl+1];
-                            payload = this->buffer+llen+3+tl+2;
-                            callback(topic,payload,len-llen-3-tl-2);
+                        if ((this->rxBuffer[0]&0x06) == MQTTQOS1) {
+                            msgId = (this->rxBuffer[pos]<<8)+this->rxBuffer[pos+1];
+                            pos += 2;
+                        }
+                        if (this->protocolVersion == MQTT_VERSION_5) {
+                            // Skip the PUBLISH properties (inbound aliases are not enabled)
+                            uint32_t propLen = 0;
+                            uint8_t n = readVarInt(this->rxBuffer, pos, len, &propLen);
+                            pos = (n == 0 || pos+n+propLen > len) ? len : pos+n+propLen;
+                        }
+                        payload = this->rxBuffer+pos;
+                        unsigned int plength = len-pos;
+                        if (this->overflowed) {
+                            // Payload went to the overflow stream
+                            payload = NULL;
+                            plength = this->streamedLength;
+                        }
+                        if ((this->rxBuffer[0]&0x06) == MQTTQOS1) {
+                            callback(topic,payload,plength);
 
                             this->buffer[0] = MQTTPUBACK;
                             this->buffer[1] = 2;
@@ -412,10 +619,25 @@ boolean PubSubClient::loop() {
                             lastOutActivity = t;
 
                         } else {
-                            payload = this->buffer+llen+3+tl;
-                            callback(topic,payload,len-llen-3-tl);
+                            callback(topic,payload,plength);
                         }
                     }
+                } else if (type == MQTTSUBACK || type == MQTTUNSUBACK) {
+                    // First reason code follows the msgId (and MQTT 5 properties);
+                    // MQTT 3.1.1 UNSUBACK carries none
+                    uint32_t pos = llen+3;
+                    if (this->protocolVersion == MQTT_VERSION_5) {
+                        uint32_t propLen = 0;
+                        uint8_t n = readVarInt(this->rxBuffer, pos, len, &propLen);
+                        pos = (n == 0) ? len : pos+n+propLen;
+                    }
+                    _reasonCode = (pos < len) ? this->rxBuffer[pos] : 0;
+                } else if (type == MQTTDISCONNECT && this->protocolVersion == MQTT_VERSION_5) {
+                    // Server-initiated disconnect (MQTT 5 only)
+                    _reasonCode = (len > (uint16_t)(llen+1)) ? this->rxBuffer[llen+1] : 0;
+                    _state = MQTT_DISCONNECTED;
+                    _client->stop();
+                    return false;
                 } else if (type == MQTTPINGREQ) {
                     this->buffer[0] = MQTTPINGRESP;
                     this->buffer[1] = 0;
@@ -447,13 +669,15 @@ boolean PubSubClient::publish(const char* topic, const uint8_t* payload, unsigne
 
 boolean PubSubClient::publish(const char* topic, const uint8_t* payload, unsigned int plength, boolean retained) {
     if (connected()) {
-        if (this->bufferSize < MQTT_MAX_HEADER_SIZE + 2+strnlen(topic, this->bufferSize) + plength) {
+        // MQTT 5 adds up to 4 bytes of properties (topic alias)
+        uint8_t propsSize = (this->protocolVersion == MQTT_VERSION_5) ? 4 : 0;
+        if (this->bufferSize < MQTT_MAX_HEADER_SIZE + 2+strnlen(topic, this->bufferSize) + propsSize + plength) {
             // Too long
             return false;
         }
         // Leave room in the buffer for header and variable length field
         uint16_t length = MQTT_MAX_HEADER_SIZE;
-        length = writeString(topic,this->buffer,length);
+        length = writePublishTopic(topic,this->buffer,length);
 
         // Add payload
         uint16_t i;
@@ -466,7 +690,12 @@ boolean PubSubClient::publish(const char* topic, const uint8_t* payload, unsigne
         if (retained) {
             header |= 1;
         }
-        return write(header,this->buffer,length-MQTT_MAX_HEADER_SIZE);
+        if (!write(header,this->buffer,length-MQTT_MAX_HEADER_SIZE)) {
+            // e.g. over the broker's Maximum Packet Size: the alias stays free
+            return false;
+        }
+        bindTopicAlias(topic);
+        return true;
     }
     return false;
 }
@@ -476,41 +705,27 @@ boolean PubSubClient::publish_P(const char* topic, const char* payload, boolean
 }
 
 boolean PubSubClient::publish_P(const char* topic, const uint8_t* payload, unsigned int plength, boolean retained) {
-    uint8_t llen = 0;
-    uint8_t digit;
     unsigned int rc = 0;
-    uint16_t tlen;
-    unsigned int pos = 0;
+    uint16_t length;
     unsigned int i;
     uint8_t header;
-    unsigned int len;
-    int expectedLength;
+    size_t hlen;
+    unsigned int expectedLength;
 
     if (!connected()) {
         return false;
     }
 
-    tlen = strnlen(topic, this->bufferSize);
-
     header = MQTTPUBLISH;
     if (retained) {
         header |= 1;
     }
-    this->buffer[pos++] = header;
-    len = plength + 2 + tlen;
-    do {
-        digit = len  & 127; //digit = len %128
-        len >>= 7; //len = len / 128
-        if (len > 0) {
-            digit |= 0x80;
-        }
-        this->buffer[pos++] = digit;
-        llen++;
-    } while(len>0);
 
-    pos = writeString(topic,this->buffer,pos);
+    // Variable header goes after room for the fixed header, as in publish()
+    length = writePublishTopic(topic,this->buffer,MQTT_MAX_HEADER_SIZE);
+    hlen = buildHeader(header, this->buffer, plength+length-MQTT_MAX_HEADER_SIZE);
 
-    rc += _client->write(this->buffer,pos);
+    rc += _client->write(this->buffer+(MQTT_MAX_HEADER_SIZE-hlen),length-(MQTT_MAX_HEADER_SIZE-hlen));
 
     for (i=0;i<plength;i++) {
         rc += _client->write((char)pgm_read_byte_near(payload + i));
@@ -518,16 +733,20 @@ boolean PubSubClient::publish_P(const char* topic, const uint8_t* payload, unsig
 
     lastOutActivity = millis();
 
-    expectedLength = 1 + llen + 2 + tlen + plength;
+    expectedLength = length-(MQTT_MAX_HEADER_SIZE-hlen) + plength;
 
-    return (rc == expectedLength);
+    if (rc != expectedLength) {
+        return false;
+    }
+    bindTopicAlias(topic);
+    return true;
 }
 
 boolean PubSubClient::beginPublish(const char* topic, unsigned int plength, boolean retained) {
     if (connected()) {
         // Send the header and variable length field
         uint16_t length = MQTT_MAX_HEADER_SIZE;
-        length = writeString(topic,this->buffer,length);
+        length = writePublishTopic(topic,this->buffer,length);
         uint8_t header = MQTTPUBLISH;
         if (retained) {
             header |= 1;
@@ -535,7 +754,11 @@ boolean PubSubClient::beginPublish(const char* topic, unsigned int plength, bool
         size_t hlen = buildHeader(header, this->buffer, plength+length-MQTT_MAX_HEADER_SIZE);
         uint16_t rc = _client->write(this->buffer+(MQTT_MAX_HEADER_SIZE-hlen),length-(MQTT_MAX_HEADER_SIZE-hlen));
         lastOutActivity = millis();
-        return (rc == (length-(MQTT_MAX_HEADER_SIZE-hlen)));
+        if (rc != (length-(MQTT_MAX_HEADER_SIZE-hlen))) {
+            return false;
+        }
+        bindTopicAlias(topic);
+        return true;
     }
     return false;
 }
@@ -582,6 +805,11 @@ boolean PubSubClient::write(uint8_t header, uint8_t* buf, uint16_t length) {
     uint16_t rc;
     uint8_t hlen = buildHeader(header, buf, length);
 
+    if (this->serverMaximumPacketSize > 0 && (uint32_t)length+hlen > this->serverMaximumPacketSize) {
+        // MQTT 5: the broker would treat this as a protocol error
+        return false;
+    }
+
 #ifdef MQTT_MAX_TRANSFER_SIZE
     uint8_t* writeBuf = buf+(MQTT_MAX_HEADER_SIZE-hlen);
     uint16_t bytesRemaining = length+hlen;  //Match the length type
@@ -614,7 +842,7 @@ boolean PubSubClient::subscribe(const char* topic, uint8_t qos) {
     if (qos > 1) {
         return false;
     }
-    if (this->bufferSize < 9 + topicLength) {
+    if (this->bufferSize < 9 + topicLength + (this->protocolVersion == MQTT_VERSION_5 ? 1 : 0)) {
         // Too long
         return false;
     }
@@ -627,6 +855,9 @@ boolean PubSubClient::subscribe(const char* topic, uint8_t qos) {
         }
         this->buffer[length++] = (nextMsgId >> 8);
         this->buffer[length++] = (nextMsgId & 0xFF);
+        if (this->protocolVersion == MQTT_VERSION_5) {
+            this->buffer[length++] = 0; // No properties
+        }
         length = writeString((char*)topic, this->buffer,length);
         this->buffer[length++] = qos;
         return write(MQTTSUBSCRIBE|MQTTQOS1,this->buffer,length-MQTT_MAX_HEADER_SIZE);
@@ -639,7 +870,7 @@ boolean PubSubClient::unsubscribe(const char* topic) {
     if (topic == 0) {
         return false;
     }
-    if (this->bufferSize < 9 + topicLength) {
+    if (this->bufferSize < 9 + topicLength + (this->protocolVersion == MQTT_VERSION_5 ? 1 : 0)) {
         // Too long
         return false;
     }
@@ -651,6 +882,9 @@ boolean PubSubClient::unsubscribe(const char* topic) {
         }
         this->buffer[length++] = (nextMsgId >> 8);
         this->buffer[length++] = (nextMsgId & 0xFF);
+        if (this->protocolVersion == MQTT_VERSION_5) {
+            this->buffer[length++] = 0; // No properties
+        }
         length = writeString(topic, this->buffer,length);
         return write(MQTTUNSUBSCRIBE|MQTTQOS1,this->buffer,length-MQTT_MAX_HEADER_SIZE);
     }
@@ -680,6 +914,159 @@ uint16_t PubSubClient::writeString(const char* string, uint8_t* buf, uint16_t po
     return pos;
 }
 
+uint16_t PubSubClient::writePublishTopic(const char* topic, uint8_t* buf, uint16_t pos) {
+    if (this->protocolVersion != MQTT_VERSION_5) {
+        return writeString(topic,buf,pos);
+    }
+
+    uint16_t alias = 0;
+    boolean known = false;
+#if MQTT5_TOPIC_ALIAS_SLOTS > 0
+    this->pendingTopicAlias = 0;
+    uint16_t slots = this->serverTopicAliasMaximum;
+    if (slots > MQTT5_TOPIC_ALIAS_SLOTS) {
+        slots = MQTT5_TOPIC_ALIAS_SLOTS;
+    }
+    size_t tlen = strlen(topic);
+    for (uint16_t i = 0; i < slots && tlen > 0 && tlen < MQTT5_TOPIC_ALIAS_MAX_LEN; i++) {
+        if (this->topicAliases[i][0] == 0) {
+            if (alias == 0) {
+                alias = i+1;
+            }
+        } else if (strcmp(this->topicAliases[i], topic) == 0) {
+            alias = i+1;
+            known = true;
+            break;
+        }
+    }
+    if (alias != 0 && !known) {
+        // First use: send the full topic with a free alias; the caller binds
+        // it once the packet has actually gone out
+        this->pendingTopicAlias = alias;
+    }
+#endif
+
+    pos = writeString(known ? "" : topic,buf,pos);
+    if (alias != 0) {
+        buf[pos++] = 3;
+        buf[pos++] = MQTT5_PROP_TOPIC_ALIAS;
+        buf[pos++] = (alias >> 8);
+        buf[pos++] = (alias & 0xFF);
+    } else {
+        buf[pos++] = 0;
+    }
+    return pos;
+}
+
+void PubSubClient::bindTopicAlias(const char* topic) {
+#if MQTT5_TOPIC_ALIAS_SLOTS > 0
+    if (this->pendingTopicAlias != 0) {
+        strcpy(this->topicAliases[this->pendingTopicAlias-1], topic);
+        this->pendingTopicAlias = 0;
+    }
+#endif
+}
+
+uint16_t PubSubClient::writeVarInt(uint32_t value, uint8_t* buf, uint16_t pos) {
+    do {
+        uint8_t digit = value & 127;
+        value >>= 7;
+        if (value > 0) {
+            digit |= 0x80;
+        }
+        buf[pos++] = digit;
+    } while (value > 0);
+    return pos;
+}
+
+// Decodes a variable byte integer at buf[pos]; returns the number of bytes
+// used, or 0 if it is malformed or runs past end
+uint8_t PubSubClient::readVarInt(const uint8_t* buf, uint32_t pos, uint32_t end, uint32_t* value) {
+    uint32_t multiplier = 1;
+    uint8_t n = 0;
+    *value = 0;
+    while (n < 4 && pos+n < end) {
+        uint8_t digit = buf[pos+n];
+        n++;
+        *value += (digit & 127) * multiplier;
+        if ((digit & 128) == 0) {
+            return n;
+        }
+        multiplier <<= 7;
+    }
+    return 0;
+}
+
+// Size of the value of property id at buf[pos], or 0 if unknown/truncated
+uint32_t PubSubClient::propertyLength(uint8_t id, const uint8_t* buf, uint32_t pos, uint32_t end) {
+    uint32_t value;
+    switch (id) {
+        case 0x01: case 0x17: case 0x19: case 0x24:
+        case 0x25: case 0x28: case 0x29: case 0x2A:
+            return 1;
+        case 0x13: case 0x21: case 0x22: case 0x23:
+            return 2;
+        case 0x02: case 0x11: case 0x18: case 0x27:
+            return 4;
+        case 0x0B:
+            return readVarInt(buf, pos, end, &value);
+        case 0x03: case 0x08: case 0x09: case 0x12: case 0x15:
+        case 0x16: case 0x1A: case 0x1C: case 0x1F:
+            // UTF-8 string or binary data
+            if (pos+2 > end) return 0;
+            return 2 + ((buf[pos]<<8) | buf[pos+1]);
+        case 0x26: {
+            // User property: string pair
+            if (pos+2 > end) return 0;
+            uint32_t first = 2 + ((buf[pos]<<8) | buf[pos+1]);
+            if (pos+first+2 > end) return 0;
+            return first + 2 + ((buf[pos+first]<<8) | buf[pos+first+1]);
+        }
+        default:
+            return 0;
+    }
+}
+
+boolean PubSubClient::parseConnackProperties(uint32_t pos, uint32_t end) {
+    uint32_t propLen = 0;
+    uint8_t n = readVarInt(this->rxBuffer, pos, end, &propLen);
+    if (n == 0 || pos+n+propLen > end) {
+        return false;
+    }
+    pos += n;
+    end = pos + propLen;
+
+    while (pos < end) {
+        uint8_t id = this->rxBuffer[pos++];
+        uint32_t size = propertyLength(id, this->rxBuffer, pos, end);
+        if (size == 0 || pos+size > end) {
+            return false;
+        }
+        const uint8_t* v = this->rxBuffer+pos;
+        switch (id) {
+            case MQTT5_PROP_SESSION_EXPIRY:
+                grantedSessionExpiry = ((uint32_t)v[0]<<24) | ((uint32_t)v[1]<<16) | (v[2]<<8) | v[3];
+                break;
+            case MQTT5_PROP_SERVER_KEEP_ALIVE:
+                serverKeepAlive = (v[0]<<8) | v[1];
+                break;
+            case MQTT5_PROP_RECEIVE_MAXIMUM:
+                serverReceiveMaximum = (v[0]<<8) | v[1];
+                break;
+            case MQTT5_PROP_TOPIC_ALIAS_MAXIMUM:
+                serverTopicAliasMaximum = (v[0]<<8) | v[1];
+                break;
+            case MQTT5_PROP_MAXIMUM_PACKET_SIZE:
+                serverMaximumPacketSize = ((uint32_t)v[0]<<24) | ((uint32_t)v[1]<<16) | (v[2]<<8) | v[3];
+                break;
+            default:
+                break;
+        }
+        pos += size;
+    }
+    return true;
+}
+
 
 boolean PubSubClient::connected() {
     boolean rc;
@@ -737,11 +1124,67 @@ int PubSubClient::state() {
     return this->_state;
 }
 
+boolean PubSubClient::sessionPresent() {
+    return this->_sessionPresent;
+}
+
+uint16_t PubSubClient::getNextMsgId() {
+    return this->nextMsgId;
+}
+
+PubSubClient& PubSubClient::setNextMsgId(uint16_t msgId) {
+    this->nextMsgId = (msgId == 0) ? 1 : msgId;
+    return *this;
+}
+
+PubSubClient& PubSubClient::setProtocolVersion(uint8_t version) {
+    this->protocolVersion = (version == MQTT_VERSION_5) ? MQTT_VERSION_5 : MQTT_VERSION;
+    return *this;
+}
+
+uint8_t PubSubClient::getProtocolVersion() {
+    return this->protocolVersion;
+}
+
+PubSubClient& PubSubClient::setSessionExpiry(uint32_t seconds) {
+    this->sessionExpiry = seconds;
+    return *this;
+}
+
+uint32_t PubSubClient::getSessionExpiry() {
+    return this->grantedSessionExpiry;
+}
+
+PubSubClient& PubSubClient::setReceiveMaximum(uint16_t receiveMaximum) {
+    this->receiveMaximum = receiveMaximum;
+    return *this;
+}
+
+uint16_t PubSubClient::getServerReceiveMaximum() {
+    return this->serverReceiveMaximum;
+}
+
+uint16_t PubSubClient::getServerTopicAliasMaximum() {
+    return this->serverTopicAliasMaximum;
+}
+
+uint32_t PubSubClient::getServerMaximumPacketSize() {
+    return this->serverMaximumPacketSize;
+}
+
+uint8_t PubSubClient::reasonCode() {
+    return this->_reasonCode;
+}
+
 boolean PubSubClient::setBufferSize(uint16_t size) {
     if (size == 0) {
         // Cannot set it back to 0
         return false;
     }
+    if (!this->bufferOwned) {
+        // Caller-supplied buffers are never reallocated
+        return false;
+    }
     if (this->bufferSize == 0) {
         this->buffer = (uint8_t*)malloc(size);
     } else {
@@ -753,16 +1196,58 @@ boolean PubSubClient::setBufferSize(uint16_t size) {
         }
     }
     this->bufferSize = size;
+    this->rxBuffer = this->buffer;
+    this->rxBufferSize = size;
     return (this->buffer != NULL);
 }
 
+boolean PubSubClient::setBuffers(uint8_t* txBuffer, uint16_t txSize, uint8_t* rxBuffer, uint16_t rxSize) {
+    if (txBuffer == NULL || txSize < MQTT_MIN_BUFFER_SIZE) {
+        return false;
+    }
+    if (rxBuffer == NULL) {
+        // Shared: one buffer frames both directions
+        rxBuffer = txBuffer;
+        rxSize = txSize;
+    } else if (rxSize < MQTT_MIN_BUFFER_SIZE) {
+        return false;
+    }
+    if (this->bufferOwned) {
+        free(this->buffer);
+    }
+    this->bufferOwned = false;
+    this->buffer = txBuffer;
+    this->bufferSize = txSize;
+    this->rxBuffer = rxBuffer;
+    this->rxBufferSize = rxSize;
+    return true;
+}
+
 uint16_t PubSubClient::getBufferSize() {
     return this->bufferSize;
 }
+
+uint16_t PubSubClient::getRxBufferSize() {
+    return this->rxBufferSize;
+}
+
+PubSubClient& PubSubClient::setOverflowStream(Stream& stream) {
+    this->overflowStream = &stream;
+    return *this;
+}
 PubSubClient& PubSubClient::setKeepAlive(uint16_t keepAlive) {
     this->keepAlive = keepAlive;
     return *this;
 }
+uint16_t PubSubClient::getKeepAlive() {
+    if (this->serverKeepAlive > 0 && this->serverKeepAlive < this->keepAlive) {
+        return this->serverKeepAlive;
+    }
+    return this->keepAlive;
+}
+boolean PubSubClient::isPingOutstanding() {
+    return this->pingOutstanding;
+}
 PubSubClient& PubSubClient::setSocketTimeout(uint16_t timeout) {
     this->socketTimeout = timeout;
     return *this;
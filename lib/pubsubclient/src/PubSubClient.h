@@ -14,6 +14,7 @@
 
 #define MQTT_VERSION_3_1      3
 #define MQTT_VERSION_3_1_1    4
+#define MQTT_VERSION_5        5
 
 // MQTT_VERSION : Pick the version
 //#define MQTT_VERSION MQTT_VERSION_3_1
@@ -36,6 +37,18 @@
 #define MQTT_SOCKET_TIMEOUT 15
 #endif
 
+// MQTT5_TOPIC_ALIAS_SLOTS : number of outbound topic aliases the client keeps
+//  per connection when running MQTT 5 (limited further by the broker's
+//  Topic Alias Maximum). Set to 0 to disable topic aliases.
+#ifndef MQTT5_TOPIC_ALIAS_SLOTS
+#define MQTT5_TOPIC_ALIAS_SLOTS 4
+#endif
+
+// MQTT5_TOPIC_ALIAS_MAX_LEN : longest topic (including terminator) that is
+//  given an alias. Aliases are stored in the client object, not on the heap.
+#ifndef MQTT5_TOPIC_ALIAS_MAX_LEN
+#define MQTT5_TOPIC_ALIAS_MAX_LEN 64
+#endif
 // MQTT_MAX_TRANSFER_SIZE : limit how much data is passed to the network client
 //  in each write call. Needed for the Arduino Wifi Shield. Leave undefined to
 //  pass the entire MQTT packet in each write call.
@@ -52,6 +65,31 @@
 #define MQTT_CONNECT_UNAVAILABLE     3
 #define MQTT_CONNECT_BAD_CREDENTIALS 4
 #define MQTT_CONNECT_UNAUTHORIZED    5
+// With MQTT 5 a refused connection reports the CONNACK reason code (0x80-0x9F)
+
+// MQTT 5 reason codes (subset), see reasonCode()
+#define MQTT5_RC_SUCCESS                  0x00
+#define MQTT5_RC_GRANTED_QOS1             0x01
+#define MQTT5_RC_UNSPECIFIED_ERROR        0x80
+#define MQTT5_RC_MALFORMED_PACKET         0x81
+#define MQTT5_RC_PROTOCOL_ERROR           0x82
+#define MQTT5_RC_UNSUPPORTED_PROTOCOL     0x84
+#define MQTT5_RC_NOT_AUTHORIZED           0x87
+#define MQTT5_RC_SERVER_UNAVAILABLE       0x88
+#define MQTT5_RC_SERVER_BUSY              0x89
+#define MQTT5_RC_SESSION_TAKEN_OVER       0x8E
+#define MQTT5_RC_TOPIC_FILTER_INVALID     0x8F
+#define MQTT5_RC_TOPIC_ALIAS_INVALID      0x94
+#define MQTT5_RC_PACKET_TOO_LARGE         0x95
+#define MQTT5_RC_QUOTA_EXCEEDED           0x97
+
+// MQTT 5 property identifiers used by the client
+#define MQTT5_PROP_SESSION_EXPIRY         0x11
+#define MQTT5_PROP_SERVER_KEEP_ALIVE      0x13
+#define MQTT5_PROP_RECEIVE_MAXIMUM        0x21
+#define MQTT5_PROP_TOPIC_ALIAS_MAXIMUM    0x22
+#define MQTT5_PROP_TOPIC_ALIAS            0x23
+#define MQTT5_PROP_MAXIMUM_PACKET_SIZE    0x27
 
 #define MQTTCONNECT     1 << 4  // Client request to connect to Server
 #define MQTTCONNACK     2 << 4  // Connect Acknowledgment
@@ -76,6 +114,9 @@
 // Maximum size of fixed header and variable length size header
 #define MQTT_MAX_HEADER_SIZE 5
 
+// Smallest buffer accepted by setBuffers()
+#define MQTT_MIN_BUFFER_SIZE 16
+
 #if defined(ESP8266) || defined(ESP32)
 #include <functional>
 #define MQTT_CALLBACK_SIGNATURE std::function<void(char*, uint8_t*, unsigned int)> callback
@@ -88,9 +129,13 @@
 class PubSubClient : public Print {
 private:
    Client* _client;
-   uint8_t* buffer;
+   uint8_t* buffer;        // Transmit buffer (also receive unless setBuffers() split them)
    uint16_t bufferSize;
+   uint8_t* rxBuffer;
+   uint16_t rxBufferSize;
+   boolean bufferOwned;    // false once setBuffers() supplied external memory
    uint16_t keepAlive;
+   uint16_t serverKeepAlive;   // MQTT 5 Server Keep Alive (0 = none)
    uint16_t socketTimeout;
    uint16_t nextMsgId;
    unsigned long lastOutActivity;
@@ -102,6 +147,18 @@ private:
    boolean readByte(uint8_t * result, uint16_t * index);
    boolean write(uint8_t header, uint8_t* buf, uint16_t length);
    uint16_t writeString(const char* string, uint8_t* buf, uint16_t pos);
+   // MQTT 5: writes the PUBLISH topic (or empty topic for a known alias)
+   // followed by the property block. Plain writeString() for MQTT 3.1.1.
+   // A new alias is only bound by bindTopicAlias() once the packet is sent
+   uint16_t writePublishTopic(const char* topic, uint8_t* buf, uint16_t pos);
+   void bindTopicAlias(const char* topic);
+   // MQTT 5 property helpers
+   static uint16_t writeVarInt(uint32_t value, uint8_t* buf, uint16_t pos);
+   static uint8_t readVarInt(const uint8_t* buf, uint32_t pos, uint32_t end, uint32_t* value);
+   static uint32_t propertyLength(uint8_t id, const uint8_t* buf, uint32_t pos, uint32_t end);
+   boolean parseConnackProperties(uint32_t pos, uint32_t end);
+   void initMqtt5();
+   void clearTopicAliases();
    // Build up the header ready to send
    // Returns the size of the header
    // Note: the header is built at the end of the first MQTT_MAX_HEADER_SIZE bytes, so will start
@@ -111,7 +168,23 @@ private:
    const char* domain;
    uint16_t port;
    Stream* stream;
+   Stream* overflowStream;
+   boolean overflowed;
+   uint32_t streamedLength;
    int _state;
+   boolean _sessionPresent;
+   uint8_t protocolVersion;
+   uint8_t _reasonCode;
+   uint32_t sessionExpiry;
+   uint32_t grantedSessionExpiry;
+   uint16_t receiveMaximum;
+   uint16_t serverReceiveMaximum;
+   uint16_t serverTopicAliasMaximum;
+   uint32_t serverMaximumPacketSize;
+#if MQTT5_TOPIC_ALIAS_SLOTS > 0
+   char topicAliases[MQTT5_TOPIC_ALIAS_SLOTS][MQTT5_TOPIC_ALIAS_MAX_LEN];
+   uint16_t pendingTopicAlias;  // Alias written by writePublishTopic(), not yet bound
+#endif
 public:
    PubSubClient();
    PubSubClient(Client& client);
@@ -137,10 +210,28 @@ public:
    PubSubClient& setClient(Client& client);
    PubSubClient& setStream(Stream& stream);
    PubSubClient& setKeepAlive(uint16_t keepAlive);
+   // Keep-alive in effect: the setKeepAlive() value, or an MQTT 5 Server Keep
+   // Alive if that is shorter. The server value only lasts for the connection;
+   // CONNECT always advertises the setKeepAlive() value. Changing it after
+   // connect() only changes how often PINGREQ is sent
+   uint16_t getKeepAlive();
+   // True from sending PINGREQ until its PINGRESP arrives
+   boolean isPingOutstanding();
    PubSubClient& setSocketTimeout(uint16_t timeout);
 
    boolean setBufferSize(uint16_t size);
    uint16_t getBufferSize();
+   // Use caller-owned memory (static or PSRAM) instead of the heap. rxBuffer
+   // may be NULL to share txBuffer for both directions; separate buffers let a
+   // callback publish without overwriting the message it is handling.
+   // setBufferSize() fails from then on, so nothing is reallocated.
+   boolean setBuffers(uint8_t* txBuffer, uint16_t txSize, uint8_t* rxBuffer, uint16_t rxSize);
+   uint16_t getRxBufferSize();
+   // Inbound PUBLISH packets larger than the receive buffer are streamed here
+   // instead of being dropped; the callback then gets payload == NULL and the
+   // number of payload bytes written to the stream. Ignored if setStream() is used.
+   // MQTT 5: CONNECT then no longer limits the broker to the receive buffer size.
+   PubSubClient& setOverflowStream(Stream& stream);
 
    boolean connect(const char* id);
    boolean connect(const char* id, const char* user, const char* pass);
@@ -177,6 +268,29 @@ public:
    boolean loop();
    boolean connected();
    int state();
+   // Session Present flag of the last CONNACK (always false for a clean session)
+   boolean sessionPresent();
+   // Packet identifier state, so a persistent session can be resumed after
+   // the client object is recreated (e.g. across deep sleep)
+   uint16_t getNextMsgId();
+   PubSubClient& setNextMsgId(uint16_t msgId);
+
+   // MQTT 5 (opt-in). Must be set before connect(); any other value selects
+   // the compile-time MQTT_VERSION
+   PubSubClient& setProtocolVersion(uint8_t version);
+   uint8_t getProtocolVersion();
+   // Session Expiry Interval requested in CONNECT (seconds, 0xFFFFFFFF = never)
+   PubSubClient& setSessionExpiry(uint32_t seconds);
+   // Session Expiry Interval in effect after CONNACK (the broker may override it)
+   uint32_t getSessionExpiry();
+   // Receive Maximum announced to the broker (inbound QoS 1 in flight)
+   PubSubClient& setReceiveMaximum(uint16_t receiveMaximum);
+   // Limits announced by the broker in CONNACK
+   uint16_t getServerReceiveMaximum();
+   uint16_t getServerTopicAliasMaximum();
+   uint32_t getServerMaximumPacketSize();
+   // Reason code of the last CONNACK, SUBACK, UNSUBACK or server DISCONNECT
+   uint8_t reasonCode();
 
 };
 
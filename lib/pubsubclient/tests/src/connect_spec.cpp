@@ -312,6 +312,71 @@ int test_connect_custom_keepalive() {
 }
 
 
+int test_connect_session_present() {
+    IT("reports the session present flag for a non-clean session");
+    ShimClient shimClient;
+    shimClient.setAllowConnect(true);
+
+    byte connect[] = {0x10,0x18,0x0,0x4,0x4d,0x51,0x54,0x54,0x4,0x0,0x0,0xf,0x0,0xc,0x63,0x6c,0x69,0x65,0x6e,0x74,0x5f,0x74,0x65,0x73,0x74,0x31};
+    byte connack[] = { 0x20, 0x02, 0x01, 0x00 };
+    shimClient.expect(connect,26);
+    shimClient.respond(connack,4);
+
+    PubSubClient client(server, 1883, callback, shimClient);
+    IS_FALSE(client.sessionPresent());
+
+    int rc = client.connect((char*)"client_test1",0,0,0,0,0,0,0);
+    IS_TRUE(rc);
+    IS_FALSE(shimClient.error());
+    IS_TRUE(client.sessionPresent());
+
+    END_IT
+}
+
+int test_connect_clean_session_not_present() {
+    IT("ignores the session present flag for a clean session");
+    ShimClient shimClient;
+    shimClient.setAllowConnect(true);
+
+    byte connack[] = { 0x20, 0x02, 0x01, 0x00 };
+    shimClient.respond(connack,4);
+
+    PubSubClient client(server, 1883, callback, shimClient);
+    int rc = client.connect((char*)"client_test1");
+    IS_TRUE(rc);
+    IS_FALSE(client.sessionPresent());
+
+    END_IT
+}
+
+int test_connect_resumed_session_keeps_msg_id() {
+    IT("keeps packet identifiers across a non-clean reconnect");
+    ShimClient shimClient;
+    shimClient.setAllowConnect(true);
+
+    byte connack[] = { 0x20, 0x02, 0x01, 0x00 };
+    shimClient.respond(connack,4);
+
+    PubSubClient client(server, 1883, callback, shimClient);
+    client.setNextMsgId(0x1233);
+    int rc = client.connect((char*)"client_test1",0,0,0,0,0,0,0);
+    IS_TRUE(rc);
+    IS_TRUE(client.getNextMsgId() == 0x1233);
+
+    byte subscribe[] = { 0x82,0xa,0x12,0x34,0x0,0x5,0x74,0x6f,0x70,0x69,0x63,0x1 };
+    shimClient.expect(subscribe,12);
+    byte suback[] = { 0x90,0x3,0x12,0x34,0x1 };
+    shimClient.respond(suback,5);
+
+    rc = client.subscribe((char*)"topic",1);
+    IS_TRUE(rc);
+    IS_FALSE(shimClient.error());
+    IS_TRUE(client.getNextMsgId() == 0x1234);
+
+    END_IT
+}
+
+
 int main()
 {
     SUITE("Connect");
@@ -332,5 +397,9 @@ int main()
     test_connect_disconnect_connect();
 
     test_connect_custom_keepalive();
+
+    test_connect_session_present();
+    test_connect_clean_session_not_present();
+    test_connect_resumed_session_keeps_msg_id();
     FINISH
 }
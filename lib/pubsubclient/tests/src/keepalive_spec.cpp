@@ -172,6 +172,42 @@ int test_keepalive_disconnects_hung() {
     END_IT
 }
 
+int test_keepalive_reports_ping_outstanding() {
+    IT("reports an outstanding ping with a keep-alive changed after connect (takes 2 seconds)");
+
+    ShimClient shimClient;
+    shimClient.setAllowConnect(true);
+
+    byte connack[] = { 0x20, 0x02, 0x00, 0x00 };
+    shimClient.respond(connack,4);
+
+    PubSubClient client(server, 1883, callback, shimClient);
+    int rc = client.connect((char*)"client_test1");
+    IS_TRUE(rc);
+    IS_TRUE(client.getKeepAlive() == MQTT_KEEPALIVE);
+    IS_FALSE(client.isPingOutstanding());
+
+    client.setKeepAlive(1);
+    IS_TRUE(client.getKeepAlive() == 1);
+
+    byte pingreq[] = { 0xC0,0x0 };
+    shimClient.expect(pingreq,2);
+    sleep(2);
+    rc = client.loop();
+    IS_TRUE(rc);
+    IS_TRUE(client.isPingOutstanding());
+
+    byte pingresp[] = { 0xD0,0x0 };
+    shimClient.respond(pingresp,2);
+    rc = client.loop();
+    IS_TRUE(rc);
+    IS_FALSE(client.isPingOutstanding());
+
+    IS_FALSE(shimClient.error());
+
+    END_IT
+}
+
 int main()
 {
     SUITE("Keep-alive");
@@ -180,6 +216,7 @@ int main()
     test_keepalive_pings_with_inbound_qos0();
     test_keepalive_no_pings_inbound_qos1();
     test_keepalive_disconnects_hung();
+    test_keepalive_reports_ping_outstanding();
 
     FINISH
 }
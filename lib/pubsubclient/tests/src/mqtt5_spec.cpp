@@ -0,0 +1,508 @@
+#include "PubSubClient.h"
+#include "ShimClient.h"
+#include "Buffer.h"
+#include "BDDTest.h"
+#include "trace.h"
+
+
+byte server[] = { 172, 16, 0, 2 };
+
+bool callback_called = false;
+char lastTopic[1024];
+char lastPayload[1024];
+unsigned int lastLength;
+
+void reset_callback() {
+    callback_called = false;
+    lastTopic[0] = '\0';
+    lastPayload[0] = '\0';
+    lastLength = 0;
+}
+
+void callback(char* topic, byte* payload, unsigned int length) {
+    TRACE("Callback received topic=[" << topic << "] length=" << length << "\n")
+    callback_called = true;
+    strcpy(lastTopic,topic);
+    memcpy(lastPayload,payload,length);
+    lastLength = length;
+}
+
+
+int test_mqtt5_connect_properties() {
+    IT("sends a version 5 connect with properties and reads connack properties");
+    ShimClient shimClient;
+    shimClient.setAllowConnect(true);
+
+    // Session Expiry 3600, Receive Maximum 1, Maximum Packet Size 256
+    byte connect[] = {0x10,0x26,0x0,0x4,0x4d,0x51,0x54,0x54,0x5,0x0,0x0,0xf,
+                      0xd,0x11,0x0,0x0,0xe,0x10,0x21,0x0,0x1,0x27,0x0,0x0,0x1,0x0,
+                      0x0,0xc,0x63,0x6c,0x69,0x65,0x6e,0x74,0x5f,0x74,0x65,0x73,0x74,0x31};
+    // Session present; Topic Alias Maximum 5, Receive Maximum 10, Session Expiry 60
+    byte connack[] = { 0x20, 0x0e, 0x01, 0x00, 0x0b, 0x22, 0x00, 0x05, 0x21, 0x00, 0x0a,
+                       0x11, 0x00, 0x00, 0x00, 0x3c };
+
+    shimClient.expect(connect,40);
+    shimClient.respond(connack,16);
+
+    PubSubClient client(server, 1883, callback, shimClient);
+    client.setProtocolVersion(MQTT_VERSION_5);
+    client.setSessionExpiry(3600);
+    client.setReceiveMaximum(1);
+    IS_TRUE(client.getProtocolVersion() == MQTT_VERSION_5);
+
+    int rc = client.connect((char*)"client_test1",NULL,NULL,0,0,0,0,0);
+    IS_TRUE(rc);
+    IS_FALSE(shimClient.error());
+
+    IS_TRUE(client.state() == MQTT_CONNECTED);
+    IS_TRUE(client.sessionPresent());
+    IS_TRUE(client.getServerTopicAliasMaximum() == 5);
+    IS_TRUE(client.getServerReceiveMaximum() == 10);
+    IS_TRUE(client.getSessionExpiry() == 60);
+
+    END_IT
+}
+
+int test_mqtt5_connect_overflow_stream() {
+    IT("does not limit the packet size when oversized messages are streamed");
+    ShimClient shimClient;
+    shimClient.setAllowConnect(true);
+
+    Stream overflow;
+
+    // No Maximum Packet Size property
+    byte connect[] = {0x10,0x19,0x0,0x4,0x4d,0x51,0x54,0x54,0x5,0x2,0x0,0xf,0x0,
+                      0x0,0xc,0x63,0x6c,0x69,0x65,0x6e,0x74,0x5f,0x74,0x65,0x73,0x74,0x31};
+    byte connack[] = { 0x20, 0x03, 0x00, 0x00, 0x00 };
+    shimClient.expect(connect,27);
+    shimClient.respond(connack,5);
+
+    PubSubClient client(server, 1883, callback, shimClient);
+    client.setProtocolVersion(MQTT_VERSION_5);
+    client.setOverflowStream(overflow);
+    int rc = client.connect((char*)"client_test1");
+    IS_TRUE(rc);
+    IS_FALSE(shimClient.error());
+
+    END_IT
+}
+
+int test_mqtt5_connect_with_will() {
+    IT("sends empty will properties before the will topic");
+    ShimClient shimClient;
+    shimClient.setAllowConnect(true);
+
+    Stream stream;
+
+    byte connect[] = {0x10,0x27,0x0,0x4,0x4d,0x51,0x54,0x54,0x5,0xe,0x0,0xf,0x0,
+                      0x0,0xc,0x63,0x6c,0x69,0x65,0x6e,0x74,0x5f,0x74,0x65,0x73,0x74,0x31,
+                      0x0,0x0,0x9,0x77,0x69,0x6c,0x6c,0x54,0x6f,0x70,0x69,0x63,
+                      0x0,0x0};
+    byte connack[] = { 0x20, 0x03, 0x00, 0x00, 0x00 };
+
+    shimClient.expect(connect,41);
+    shimClient.respond(connack,5);
+
+    PubSubClient client(server, 1883, callback, shimClient, stream);
+    client.setProtocolVersion(MQTT_VERSION_5);
+    int rc = client.connect((char*)"client_test1",(char*)"willTopic",1,0,(char*)"");
+    IS_TRUE(rc);
+    IS_FALSE(shimClient.error());
+
+    END_IT
+}
+
+int test_mqtt5_connect_refused_reason_code() {
+    IT("reports the connack reason code when refused");
+    ShimClient shimClient;
+    shimClient.setAllowConnect(true);
+
+    byte connack[] = { 0x20, 0x03, 0x00, MQTT5_RC_NOT_AUTHORIZED, 0x00 };
+    shimClient.respond(connack,5);
+
+    PubSubClient client(server, 1883, callback, shimClient);
+    client.setProtocolVersion(MQTT_VERSION_5);
+    int rc = client.connect((char*)"client_test1");
+    IS_FALSE(rc);
+
+    IS_TRUE(client.state() == MQTT5_RC_NOT_AUTHORIZED);
+    IS_TRUE(client.reasonCode() == MQTT5_RC_NOT_AUTHORIZED);
+
+    END_IT
+}
+
+int test_mqtt5_publish_no_alias() {
+    IT("publishes with an empty property block when aliases are not offered");
+    ShimClient shimClient;
+    shimClient.setAllowConnect(true);
+
+    byte connack[] = { 0x20, 0x03, 0x00, 0x00, 0x00 };
+    shimClient.respond(connack,5);
+
+    PubSubClient client(server, 1883, callback, shimClient);
+    client.setProtocolVersion(MQTT_VERSION_5);
+    int rc = client.connect((char*)"client_test1");
+    IS_TRUE(rc);
+
+    byte publish[] = {0x30,0xf,0x0,0x5,0x74,0x6f,0x70,0x69,0x63,0x0,0x70,0x61,0x79,0x6c,0x6f,0x61,0x64};
+    shimClient.expect(publish,17);
+
+    rc = client.publish((char*)"topic",(char*)"payload");
+    IS_TRUE(rc);
+    IS_FALSE(shimClient.error());
+
+    END_IT
+}
+
+int test_mqtt5_publish_topic_alias() {
+    IT("replaces a repeated topic with its alias");
+    ShimClient shimClient;
+    shimClient.setAllowConnect(true);
+
+    // Topic Alias Maximum 2
+    byte connack[] = { 0x20, 0x06, 0x00, 0x00, 0x03, 0x22, 0x00, 0x02 };
+    shimClient.respond(connack,8);
+
+    PubSubClient client(server, 1883, callback, shimClient);
+    client.setProtocolVersion(MQTT_VERSION_5);
+    int rc = client.connect((char*)"client_test1");
+    IS_TRUE(rc);
+
+    // First use: full topic plus alias 1
+    byte publish1[] = {0x30,0x12,0x0,0x5,0x74,0x6f,0x70,0x69,0x63,0x3,0x23,0x0,0x1,
+                       0x70,0x61,0x79,0x6c,0x6f,0x61,0x64};
+    shimClient.expect(publish1,20);
+    rc = client.publish((char*)"topic",(char*)"payload");
+    IS_TRUE(rc);
+    IS_FALSE(shimClient.error());
+
+    // Repeat: empty topic, alias 1
+    byte publish2[] = {0x30,0xd,0x0,0x0,0x3,0x23,0x0,0x1,0x70,0x61,0x79,0x6c,0x6f,0x61,0x64};
+    shimClient.expect(publish2,15);
+    rc = client.publish((char*)"topic",(char*)"payload");
+    IS_TRUE(rc);
+    IS_FALSE(shimClient.error());
+
+    // Second topic gets alias 2
+    byte publish3[] = {0x30,0x12,0x0,0x5,0x6f,0x74,0x68,0x65,0x72,0x3,0x23,0x0,0x2,
+                       0x70,0x61,0x79,0x6c,0x6f,0x61,0x64};
+    shimClient.expect(publish3,20);
+    rc = client.publish((char*)"other",(char*)"payload");
+    IS_TRUE(rc);
+    IS_FALSE(shimClient.error());
+
+    // Broker limit reached: no alias
+    byte publish4[] = {0x30,0xf,0x0,0x5,0x74,0x68,0x69,0x72,0x64,0x0,0x70,0x61,0x79,0x6c,0x6f,0x61,0x64};
+    shimClient.expect(publish4,17);
+    rc = client.publish((char*)"third",(char*)"payload");
+    IS_TRUE(rc);
+    IS_FALSE(shimClient.error());
+
+    END_IT
+}
+
+int test_mqtt5_aliases_reset_on_reconnect() {
+    IT("forgets topic aliases when reconnecting");
+    ShimClient shimClient;
+    shimClient.setAllowConnect(true);
+
+    byte connack[] = { 0x20, 0x06, 0x00, 0x00, 0x03, 0x22, 0x00, 0x02 };
+    shimClient.respond(connack,8);
+
+    PubSubClient client(server, 1883, callback, shimClient);
+    client.setProtocolVersion(MQTT_VERSION_5);
+    int rc = client.connect((char*)"client_test1");
+    IS_TRUE(rc);
+
+    byte publish1[] = {0x30,0x12,0x0,0x5,0x74,0x6f,0x70,0x69,0x63,0x3,0x23,0x0,0x1,
+                       0x70,0x61,0x79,0x6c,0x6f,0x61,0x64};
+    shimClient.expect(publish1,20);
+    rc = client.publish((char*)"topic",(char*)"payload");
+    IS_TRUE(rc);
+
+    byte disconnect[] = {0xE0,0x00};
+    shimClient.expect(disconnect,2);
+    client.disconnect();
+
+    byte connect[] = {0x10,0x1e,0x0,0x4,0x4d,0x51,0x54,0x54,0x5,0x2,0x0,0xf,
+                      0x5,0x27,0x0,0x0,0x1,0x0,
+                      0x0,0xc,0x63,0x6c,0x69,0x65,0x6e,0x74,0x5f,0x74,0x65,0x73,0x74,0x31};
+    shimClient.expect(connect,32);
+    shimClient.respond(connack,8);
+    rc = client.connect((char*)"client_test1");
+    IS_TRUE(rc);
+
+    shimClient.expect(publish1,20);
+    rc = client.publish((char*)"topic",(char*)"payload");
+    IS_TRUE(rc);
+    IS_FALSE(shimClient.error());
+
+    END_IT
+}
+
+int test_mqtt5_publish_exceeds_maximum_packet_size() {
+    IT("refuses to publish beyond the broker maximum packet size");
+    ShimClient shimClient;
+    shimClient.setAllowConnect(true);
+
+    // Maximum Packet Size 16
+    byte connack[] = { 0x20, 0x08, 0x00, 0x00, 0x05, 0x27, 0x00, 0x00, 0x00, 0x10 };
+    shimClient.respond(connack,10);
+
+    PubSubClient client(server, 1883, callback, shimClient);
+    client.setProtocolVersion(MQTT_VERSION_5);
+    int rc = client.connect((char*)"client_test1");
+    IS_TRUE(rc);
+    IS_TRUE(client.getServerMaximumPacketSize() == 16);
+
+    rc = client.publish((char*)"topic",(char*)"payload");
+    IS_FALSE(rc);
+
+    byte publish[] = {0x30,0x5,0x0,0x1,0x74,0x0,0x70};
+    shimClient.expect(publish,7);
+    rc = client.publish((char*)"t",(char*)"p");
+    IS_TRUE(rc);
+    IS_FALSE(shimClient.error());
+
+    END_IT
+}
+
+int test_mqtt5_alias_not_bound_by_rejected_publish() {
+    IT("keeps a topic alias free when the publish is rejected as too large");
+    ShimClient shimClient;
+    shimClient.setAllowConnect(true);
+
+    // Topic Alias Maximum 2, Maximum Packet Size 20
+    byte connack[] = { 0x20, 0x0b, 0x00, 0x00, 0x08, 0x22, 0x00, 0x02,
+                       0x27, 0x00, 0x00, 0x00, 0x14 };
+    shimClient.respond(connack,13);
+
+    PubSubClient client(server, 1883, callback, shimClient);
+    client.setProtocolVersion(MQTT_VERSION_5);
+    int rc = client.connect((char*)"client_test1");
+    IS_TRUE(rc);
+
+    rc = client.publish((char*)"topic",(char*)"payload too long");
+    IS_FALSE(rc);
+
+    // The broker never saw the alias: the full topic is sent again
+    byte publish[] = {0x30,0x12,0x0,0x5,0x74,0x6f,0x70,0x69,0x63,0x3,0x23,0x0,0x1,
+                      0x70,0x61,0x79,0x6c,0x6f,0x61,0x64};
+    shimClient.expect(publish,20);
+    rc = client.publish((char*)"topic",(char*)"payload");
+    IS_TRUE(rc);
+    IS_FALSE(shimClient.error());
+
+    END_IT
+}
+
+int test_mqtt5_server_keep_alive() {
+    IT("uses the server keep alive for the connection only");
+    ShimClient shimClient;
+    shimClient.setAllowConnect(true);
+
+    // Server Keep Alive 5
+    byte connack[] = { 0x20, 0x06, 0x00, 0x00, 0x03, 0x13, 0x00, 0x05 };
+    shimClient.respond(connack,8);
+
+    PubSubClient client(server, 1883, callback, shimClient);
+    client.setProtocolVersion(MQTT_VERSION_5);
+    int rc = client.connect((char*)"client_test1");
+    IS_TRUE(rc);
+    IS_TRUE(client.getKeepAlive() == 5);
+
+    byte disconnect[] = {0xE0,0x00};
+    shimClient.expect(disconnect,2);
+    client.disconnect();
+
+    // The next CONNECT still advertises the configured 15 s
+    byte connect[] = {0x10,0x1e,0x0,0x4,0x4d,0x51,0x54,0x54,0x5,0x2,0x0,0xf,
+                      0x5,0x27,0x0,0x0,0x1,0x0,
+                      0x0,0xc,0x63,0x6c,0x69,0x65,0x6e,0x74,0x5f,0x74,0x65,0x73,0x74,0x31};
+    byte plainConnack[] = { 0x20, 0x03, 0x00, 0x00, 0x00 };
+    shimClient.expect(connect,32);
+    shimClient.respond(plainConnack,5);
+    rc = client.connect((char*)"client_test1");
+    IS_TRUE(rc);
+    IS_TRUE(client.getKeepAlive() == 15);
+    IS_FALSE(shimClient.error());
+
+    END_IT
+}
+
+int test_mqtt5_subscribe_reason_code() {
+    IT("subscribes with a property block and reads the suback reason code");
+    ShimClient shimClient;
+    shimClient.setAllowConnect(true);
+
+    byte connack[] = { 0x20, 0x03, 0x00, 0x00, 0x00 };
+    shimClient.respond(connack,5);
+
+    PubSubClient client(server, 1883, callback, shimClient);
+    client.setProtocolVersion(MQTT_VERSION_5);
+    int rc = client.connect((char*)"client_test1");
+    IS_TRUE(rc);
+
+    byte subscribe[] = {0x82,0xb,0x0,0x2,0x0,0x0,0x5,0x74,0x6f,0x70,0x69,0x63,0x1};
+    shimClient.expect(subscribe,13);
+    byte suback[] = {0x90,0x4,0x0,0x2,0x0,MQTT5_RC_GRANTED_QOS1};
+    shimClient.respond(suback,6);
+
+    rc = client.subscribe((char*)"topic",1);
+    IS_TRUE(rc);
+
+    rc = client.loop();
+    IS_TRUE(rc);
+    IS_TRUE(client.reasonCode() == MQTT5_RC_GRANTED_QOS1);
+    IS_FALSE(shimClient.error());
+
+    END_IT
+}
+
+int test_mqtt5_receive_with_properties() {
+    IT("skips publish properties when delivering a message");
+    reset_callback();
+
+    ShimClient shimClient;
+    shimClient.setAllowConnect(true);
+
+    byte connack[] = { 0x20, 0x03, 0x00, 0x00, 0x00 };
+    shimClient.respond(connack,5);
+
+    PubSubClient client(server, 1883, callback, shimClient);
+    client.setProtocolVersion(MQTT_VERSION_5);
+    int rc = client.connect((char*)"client_test1");
+    IS_TRUE(rc);
+
+    // Payload Format Indicator = 1
+    byte publish[] = {0x30,0x11,0x0,0x5,0x74,0x6f,0x70,0x69,0x63,0x2,0x1,0x1,
+                      0x70,0x61,0x79,0x6c,0x6f,0x61,0x64};
+    shimClient.respond(publish,19);
+
+    rc = client.loop();
+    IS_TRUE(rc);
+
+    IS_TRUE(callback_called);
+    IS_TRUE(strcmp(lastTopic,"topic")==0);
+    IS_TRUE(memcmp(lastPayload,"payload",7)==0);
+    IS_TRUE(lastLength == 7);
+
+    IS_FALSE(shimClient.error());
+
+    END_IT
+}
+
+int test_mqtt5_receive_qos1() {
+    IT("acknowledges a qos1 message with properties");
+    reset_callback();
+
+    ShimClient shimClient;
+    shimClient.setAllowConnect(true);
+
+    byte connack[] = { 0x20, 0x03, 0x00, 0x00, 0x00 };
+    shimClient.respond(connack,5);
+
+    PubSubClient client(server, 1883, callback, shimClient);
+    client.setProtocolVersion(MQTT_VERSION_5);
+    int rc = client.connect((char*)"client_test1");
+    IS_TRUE(rc);
+
+    byte publish[] = {0x32,0x11,0x0,0x5,0x74,0x6f,0x70,0x69,0x63,0x12,0x34,0x0,
+                      0x70,0x61,0x79,0x6c,0x6f,0x61,0x64};
+    shimClient.respond(publish,19);
+
+    byte puback[] = {0x40,0x2,0x12,0x34};
+    shimClient.expect(puback,4);
+
+    rc = client.loop();
+    IS_TRUE(rc);
+
+    IS_TRUE(callback_called);
+    IS_TRUE(strcmp(lastTopic,"topic")==0);
+    IS_TRUE(memcmp(lastPayload,"payload",7)==0);
+    IS_TRUE(lastLength == 7);
+
+    IS_FALSE(shimClient.error());
+
+    END_IT
+}
+
+int test_mqtt5_receive_stream() {
+    IT("streams only the payload of a message with properties");
+    reset_callback();
+
+    Stream stream;
+    stream.expect((uint8_t*)"payload",7);
+
+    ShimClient shimClient;
+    shimClient.setAllowConnect(true);
+
+    byte connack[] = { 0x20, 0x03, 0x00, 0x00, 0x00 };
+    shimClient.respond(connack,5);
+
+    PubSubClient client(server, 1883, callback, shimClient, stream);
+    client.setProtocolVersion(MQTT_VERSION_5);
+    int rc = client.connect((char*)"client_test1");
+    IS_TRUE(rc);
+
+    byte publish[] = {0x30,0x11,0x0,0x5,0x74,0x6f,0x70,0x69,0x63,0x2,0x1,0x1,
+                      0x70,0x61,0x79,0x6c,0x6f,0x61,0x64};
+    shimClient.respond(publish,19);
+
+    rc = client.loop();
+    IS_TRUE(rc);
+
+    IS_TRUE(callback_called);
+    IS_TRUE(lastLength == 7);
+    IS_FALSE(stream.error());
+
+    END_IT
+}
+
+int test_mqtt5_server_disconnect() {
+    IT("handles a server disconnect with reason code");
+    ShimClient shimClient;
+    shimClient.setAllowConnect(true);
+
+    byte connack[] = { 0x20, 0x03, 0x00, 0x00, 0x00 };
+    shimClient.respond(connack,5);
+
+    PubSubClient client(server, 1883, callback, shimClient);
+    client.setProtocolVersion(MQTT_VERSION_5);
+    int rc = client.connect((char*)"client_test1");
+    IS_TRUE(rc);
+
+    byte disconnect[] = {0xE0,0x1,MQTT5_RC_SESSION_TAKEN_OVER};
+    shimClient.respond(disconnect,3);
+
+    rc = client.loop();
+    IS_FALSE(rc);
+    IS_TRUE(client.reasonCode() == MQTT5_RC_SESSION_TAKEN_OVER);
+    IS_TRUE(client.state() == MQTT_DISCONNECTED);
+    IS_FALSE(client.connected());
+
+    END_IT
+}
+
+int main()
+{
+    SUITE("MQTT 5");
+
+    test_mqtt5_connect_properties();
+    test_mqtt5_connect_overflow_stream();
+    test_mqtt5_connect_with_will();
+    test_mqtt5_connect_refused_reason_code();
+    test_mqtt5_publish_no_alias();
+    test_mqtt5_publish_topic_alias();
+    test_mqtt5_aliases_reset_on_reconnect();
+    test_mqtt5_publish_exceeds_maximum_packet_size();
+    test_mqtt5_alias_not_bound_by_rejected_publish();
+    test_mqtt5_server_keep_alive();
+    test_mqtt5_subscribe_reason_code();
+    test_mqtt5_receive_with_properties();
+    test_mqtt5_receive_qos1();
+    test_mqtt5_receive_stream();
+    test_mqtt5_server_disconnect();
+
+    FINISH
+}
@@ -176,6 +176,64 @@ int test_publish_P() {
 
 
 
+int test_publish_external_buffer() {
+    IT("publishes from a caller-supplied buffer");
+    static uint8_t buffer[64];
+
+    ShimClient shimClient;
+    shimClient.setAllowConnect(true);
+
+    byte connack[] = { 0x20, 0x02, 0x00, 0x00 };
+    shimClient.respond(connack,4);
+
+    PubSubClient client(server, 1883, callback, shimClient);
+    IS_TRUE(client.setBuffers(buffer,sizeof(buffer),NULL,0));
+    IS_TRUE(client.getBufferSize() == 64);
+    IS_TRUE(client.getRxBufferSize() == 64);
+    IS_FALSE(client.setBufferSize(32));
+    IS_TRUE(client.getBufferSize() == 64);
+
+    int rc = client.connect((char*)"client_test1");
+    IS_TRUE(rc);
+
+    byte publish[] = {0x30,0xe,0x0,0x5,0x74,0x6f,0x70,0x69,0x63,0x70,0x61,0x79,0x6c,0x6f,0x61,0x64};
+    shimClient.expect(publish,16);
+
+    rc = client.publish((char*)"topic",(char*)"payload");
+    IS_TRUE(rc);
+    IS_TRUE(memcmp(buffer+MQTT_MAX_HEADER_SIZE,publish+2,14)==0);
+
+    IS_FALSE(shimClient.error());
+
+    END_IT
+}
+
+int test_publish_external_buffer_too_long() {
+    IT("rejects a publish larger than the caller-supplied buffer");
+    static uint8_t txBuffer[24];
+    static uint8_t rxBuffer[64];
+
+    ShimClient shimClient;
+    shimClient.setAllowConnect(true);
+
+    byte connack[] = { 0x20, 0x02, 0x00, 0x00 };
+    shimClient.respond(connack,4);
+
+    PubSubClient client(server, 1883, callback, shimClient);
+    IS_FALSE(client.setBuffers(txBuffer,4,rxBuffer,sizeof(rxBuffer)));
+    IS_TRUE(client.setBuffers(txBuffer,sizeof(txBuffer),rxBuffer,sizeof(rxBuffer)));
+
+    int rc = client.connect((char*)"client");
+    IS_TRUE(rc);
+
+    rc = client.publish((char*)"topic",(char*)"payload_too_long");
+    IS_FALSE(rc);
+
+    IS_FALSE(shimClient.error());
+
+    END_IT
+}
+
 int main()
 {
     SUITE("Publish");
@@ -186,6 +244,8 @@ int main()
     test_publish_not_connected();
     test_publish_too_long();
     test_publish_P();
+    test_publish_external_buffer();
+    test_publish_external_buffer_too_long();
 
     FINISH
 }
@@ -0,0 +1,311 @@
+// Host throughput benchmark for PubSubClient.
+//
+// Emits one JSON object per line so runs can be diffed or plotted:
+//
+//    $ make bench
+//    $ bin/pubsubclient_bench --time 500 > results.jsonl
+//
+// Heap calls made by the library are counted through the linker's --wrap
+// option (see the Makefile).
+
+#include "PubSubClient.h"
+#include "ShimClient.h"
+#include "Buffer.h"
+#include "trace.h"
+
+#include <chrono>
+#include <stdio.h>
+
+
+byte server[] = { 172, 16, 0, 2 };
+
+// --- Allocation counting ---------------------------------------------------
+
+static unsigned long allocCalls = 0;
+static unsigned long reallocCalls = 0;
+static unsigned long freeCalls = 0;
+
+extern "C" {
+    void* __real_malloc(size_t size);
+    void* __real_realloc(void* ptr, size_t size);
+    void __real_free(void* ptr);
+
+    void* __wrap_malloc(size_t size) {
+        allocCalls++;
+        return __real_malloc(size);
+    }
+    void* __wrap_realloc(void* ptr, size_t size) {
+        reallocCalls++;
+        return __real_realloc(ptr, size);
+    }
+    void __wrap_free(void* ptr) {
+        if (ptr) {
+            freeCalls++;
+        }
+        __real_free(ptr);
+    }
+}
+
+static unsigned long heapCalls() {
+    return allocCalls + reallocCalls;
+}
+
+// --- Client shim -----------------------------------------------------------
+
+// ShimClient that counts outbound bytes without checking them and can replay
+// one inbound packet, optionally split into fragments with a read stall
+// (available() == 0) between them.
+class BenchClient : public ShimClient {
+public:
+    unsigned long long written;
+    unsigned long long stalls;
+
+    BenchClient() : written(0), stalls(0), replay(NULL), replayLength(0), pos(0), fragment(0), gap(false) {}
+
+    virtual size_t write(uint8_t b) {
+        written++;
+        return 1;
+    }
+    virtual size_t write(const uint8_t *buf, size_t size) {
+        written += size;
+        return size;
+    }
+    virtual int available() {
+        if (!replay) {
+            return ShimClient::available();
+        }
+        if (pos >= replayLength) {
+            return 0;
+        }
+        if (gap) {
+            gap = false;
+            stalls++;
+            return 0;
+        }
+        return 1;
+    }
+    virtual int read() {
+        if (!replay) {
+            return ShimClient::read();
+        }
+        uint8_t b = replay[pos++];
+        if (fragment > 0 && pos % fragment == 0 && pos < replayLength) {
+            gap = true;
+        }
+        return b;
+    }
+
+    void setReplay(const uint8_t* packet, size_t length, size_t fragmentSize) {
+        replay = packet;
+        replayLength = length;
+        fragment = fragmentSize;
+        rewind();
+    }
+    void rewind() {
+        pos = 0;
+        gap = false;
+    }
+
+private:
+    const uint8_t* replay;
+    size_t replayLength;
+    size_t pos;
+    size_t fragment;
+    bool gap;
+};
+
+static unsigned long callbacks = 0;
+
+void callback(char* topic, byte* payload, unsigned int length) {
+    callbacks++;
+}
+
+// --- Harness ---------------------------------------------------------------
+
+typedef std::chrono::steady_clock Clock;
+
+static double targetSeconds = 0.2;
+static const unsigned long BATCH = 1000;
+
+struct Result {
+    unsigned long long ops;
+    double seconds;
+    unsigned long heap;
+};
+
+// Runs op() in batches until the time budget is spent
+template <typename Op>
+static Result measure(Op op) {
+    for (unsigned long i = 0; i < BATCH / 10; i++) {
+        op();  // Warm-up
+    }
+
+    Result r;
+    r.ops = 0;
+    unsigned long heapBefore = heapCalls();
+    Clock::time_point start = Clock::now();
+    do {
+        for (unsigned long i = 0; i < BATCH; i++) {
+            op();
+        }
+        r.ops += BATCH;
+        r.seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    } while (r.seconds < targetSeconds);
+    r.heap = heapCalls() - heapBefore;
+    return r;
+}
+
+static bool connectClient(PubSubClient& client, BenchClient& shim, uint8_t protocol) {
+    if (protocol == MQTT_VERSION_5) {
+        // Topic Alias Maximum 16
+        byte connack[] = { 0x20, 0x06, 0x00, 0x00, 0x03, 0x22, 0x00, 0x10 };
+        shim.respond(connack, sizeof(connack));
+        client.setProtocolVersion(MQTT_VERSION_5);
+    } else {
+        byte connack[] = { 0x20, 0x02, 0x00, 0x00 };
+        shim.respond(connack, sizeof(connack));
+    }
+    client.setKeepAlive(0xFFFF);
+    return client.connect((char*)"bench_client");
+}
+
+static void emit(const char* bench, uint8_t protocol, const char* params, const Result& r,
+                 unsigned long long bytes, unsigned long setupHeap) {
+    double opsPerSec = r.ops / r.seconds;
+    printf("{\"bench\":\"%s\",\"protocol\":%u,%s,\"ops\":%llu,\"seconds\":%.4f,"
+           "\"ops_per_s\":%.0f,\"ns_per_op\":%.1f,\"bytes_per_s\":%.0f,"
+           "\"heap_calls_setup\":%lu,\"heap_calls_per_op\":%.4f}\n",
+           bench, protocol, params, r.ops, r.seconds, opsPerSec, 1e9 / opsPerSec,
+           bytes / r.seconds, setupHeap, (double)r.heap / r.ops);
+}
+
+// --- Benchmarks ------------------------------------------------------------
+
+static void benchPublish(uint8_t protocol, size_t topicLength, size_t payloadLength) {
+    char topic[128];
+    memset(topic, 't', topicLength);
+    topic[topicLength] = 0;
+    uint8_t payload[1024];
+    memset(payload, 'p', payloadLength);
+
+    unsigned long heapBefore = heapCalls();
+    BenchClient shim;
+    PubSubClient client(server, 1883, callback, shim);
+    client.setBufferSize(1280);
+    if (!connectClient(client, shim, protocol)) {
+        fprintf(stderr, "publish: connect failed\n");
+        return;
+    }
+    unsigned long setupHeap = heapCalls() - heapBefore;
+
+    unsigned long long before = shim.written;
+    Result r = measure([&]() {
+        client.publish(topic, payload, payloadLength);
+    });
+    // Warm-up publishes are excluded from the byte count
+    unsigned long long perOp = (shim.written - before) / (r.ops + BATCH / 10);
+
+    char params[96];
+    snprintf(params, sizeof(params), "\"topic_len\":%zu,\"payload_len\":%zu,\"wire_bytes\":%llu",
+             topicLength, payloadLength, perOp);
+    emit("publish", protocol, params, r, perOp * r.ops, setupHeap);
+}
+
+static void benchReceive(uint8_t protocol, size_t payloadLength, size_t fragment) {
+    // Inbound QoS 0 PUBLISH on "bench/topic"
+    uint8_t packet[1100];
+    size_t remaining = 2 + 11 + (protocol == MQTT_VERSION_5 ? 1 : 0) + payloadLength;
+    size_t pos = 0;
+    packet[pos++] = MQTTPUBLISH;
+    do {
+        uint8_t digit = remaining & 127;
+        remaining >>= 7;
+        packet[pos++] = digit | (remaining > 0 ? 0x80 : 0);
+    } while (remaining > 0);
+    packet[pos++] = 0;
+    packet[pos++] = 11;
+    memcpy(packet + pos, "bench/topic", 11);
+    pos += 11;
+    if (protocol == MQTT_VERSION_5) {
+        packet[pos++] = 0;  // No properties
+    }
+    memset(packet + pos, 'p', payloadLength);
+    pos += payloadLength;
+
+    unsigned long heapBefore = heapCalls();
+    BenchClient shim;
+    PubSubClient client(server, 1883, callback, shim);
+    client.setBufferSize(1280);
+    if (!connectClient(client, shim, protocol)) {
+        fprintf(stderr, "receive: connect failed\n");
+        return;
+    }
+    unsigned long setupHeap = heapCalls() - heapBefore;
+
+    shim.setReplay(packet, pos, fragment);
+    callbacks = 0;
+    shim.stalls = 0;
+    Result r = measure([&]() {
+        shim.rewind();
+        client.loop();
+    });
+    if (callbacks != r.ops + BATCH / 10) {
+        fprintf(stderr, "receive: %lu callbacks for %llu packets\n", callbacks, r.ops + BATCH / 10);
+    }
+
+    char params[128];
+    snprintf(params, sizeof(params), "\"payload_len\":%zu,\"fragment\":%zu,\"wire_bytes\":%zu,\"stalls_per_op\":%.2f",
+             payloadLength, fragment, pos, (double)shim.stalls / (r.ops + BATCH / 10));
+    emit("receive", protocol, params, r, (unsigned long long)pos * r.ops, setupHeap);
+}
+
+static void benchIdleLoop(uint8_t protocol) {
+    unsigned long heapBefore = heapCalls();
+    BenchClient shim;
+    PubSubClient client(server, 1883, callback, shim);
+    if (!connectClient(client, shim, protocol)) {
+        fprintf(stderr, "idle: connect failed\n");
+        return;
+    }
+    unsigned long setupHeap = heapCalls() - heapBefore;
+
+    Result r = measure([&]() {
+        client.loop();
+    });
+    emit("idle_loop", protocol, "\"payload_len\":0", r, 0, setupHeap);
+}
+
+int main(int argc, char** argv) {
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--time") == 0 && i + 1 < argc) {
+            targetSeconds = atoi(argv[++i]) / 1000.0;
+        } else {
+            fprintf(stderr, "usage: %s [--time <ms per case>]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    const uint8_t protocols[] = { MQTT_VERSION_3_1_1, MQTT_VERSION_5 };
+    const size_t topics[] = { 8, 32, 64 };
+    const size_t payloads[] = { 16, 128, 1024 };
+    const size_t fragments[] = { 0, 64, 16, 1 };
+
+    for (uint8_t p = 0; p < 2; p++) {
+        for (uint8_t t = 0; t < 3; t++) {
+            for (uint8_t s = 0; s < 3; s++) {
+                benchPublish(protocols[p], topics[t], payloads[s]);
+            }
+        }
+    }
+    for (uint8_t p = 0; p < 2; p++) {
+        for (uint8_t s = 0; s < 3; s++) {
+            for (uint8_t f = 0; f < 4; f++) {
+                benchReceive(protocols[p], payloads[s], fragments[f]);
+            }
+        }
+    }
+    for (uint8_t p = 0; p < 2; p++) {
+        benchIdleLoop(protocols[p]);
+    }
+    return 0;
+}
@@ -8,12 +8,14 @@
 byte server[] = { 172, 16, 0, 2 };
 
 bool callback_called = false;
+bool lastPayloadNull = false;
 char lastTopic[1024];
 char lastPayload[1024];
 unsigned int lastLength;
 
 void reset_callback() {
     callback_called = false;
+    lastPayloadNull = false;
     lastTopic[0] = '\0';
     lastPayload[0] = '\0';
     lastLength = 0;
@@ -23,7 +25,10 @@ void callback(char* topic, byte* payload, unsigned int length) {
     TRACE("Callback received topic=[" << topic << "] length=" << length << "\n")
     callback_called = true;
     strcpy(lastTopic,topic);
-    memcpy(lastPayload,payload,length);
+    lastPayloadNull = (payload == NULL);
+    if (payload) {
+        memcpy(lastPayload,payload,length);
+    }
     lastLength = length;
 }
 
@@ -324,6 +329,130 @@ int test_receive_qos1() {
     END_IT
 }
 
+int test_receive_overflow_stream_message() {
+    IT("streams an oversized message to the overflow stream");
+    reset_callback();
+
+    Stream stream;
+
+    ShimClient shimClient;
+    shimClient.setAllowConnect(true);
+
+    byte connack[] = { 0x20, 0x02, 0x00, 0x00 };
+    shimClient.respond(connack,4);
+
+    int length = 80; // See comment in test_receive_max_sized_message before changing this value
+
+    PubSubClient client(server, 1883, callback, shimClient);
+    client.setBufferSize(length-1);
+    client.setOverflowStream(stream);
+    int rc = client.connect((char*)"client_test1");
+    IS_TRUE(rc);
+
+    byte publish[] = {0x30,length-2,0x0,0x5,0x74,0x6f,0x70,0x69,0x63,0x70,0x61,0x79,0x6c,0x6f,0x61,0x64};
+
+    byte bigPublish[length];
+    memset(bigPublish,'A',length);
+    memcpy(bigPublish,publish,16);
+
+    shimClient.respond(bigPublish,length);
+    stream.expect(bigPublish+9,length-9);
+
+    rc = client.loop();
+
+    IS_TRUE(rc);
+
+    IS_TRUE(callback_called);
+    IS_TRUE(strcmp(lastTopic,"topic")==0);
+    IS_TRUE(lastPayloadNull);
+    IS_TRUE(lastLength == length-9);
+    IS_TRUE(stream.length() == length-9);
+
+    IS_FALSE(stream.error());
+    IS_FALSE(shimClient.error());
+
+    END_IT
+}
+
+int test_receive_overflow_stream_fitting_message() {
+    IT("does not use the overflow stream for a message that fits");
+    reset_callback();
+
+    Stream stream;
+
+    ShimClient shimClient;
+    shimClient.setAllowConnect(true);
+
+    byte connack[] = { 0x20, 0x02, 0x00, 0x00 };
+    shimClient.respond(connack,4);
+
+    PubSubClient client(server, 1883, callback, shimClient);
+    client.setOverflowStream(stream);
+    int rc = client.connect((char*)"client_test1");
+    IS_TRUE(rc);
+
+    byte publish[] = {0x30,0xe,0x0,0x5,0x74,0x6f,0x70,0x69,0x63,0x70,0x61,0x79,0x6c,0x6f,0x61,0x64};
+    shimClient.respond(publish,16);
+
+    rc = client.loop();
+
+    IS_TRUE(rc);
+
+    IS_TRUE(callback_called);
+    IS_FALSE(lastPayloadNull);
+    IS_TRUE(memcmp(lastPayload,"payload",7)==0);
+    IS_TRUE(lastLength == 7);
+    IS_TRUE(stream.length() == 0);
+
+    IS_FALSE(shimClient.error());
+
+    END_IT
+}
+
+int test_receive_external_rx_buffer() {
+    IT("receives into a caller-supplied receive buffer");
+    reset_callback();
+
+    static uint8_t txBuffer[32];
+    static uint8_t rxBuffer[80];
+
+    ShimClient shimClient;
+    shimClient.setAllowConnect(true);
+
+    byte connack[] = { 0x20, 0x02, 0x00, 0x00 };
+    shimClient.respond(connack,4);
+
+    int length = 80; // See comment in test_receive_max_sized_message before changing this value
+
+    PubSubClient client(server, 1883, callback, shimClient);
+    IS_TRUE(client.setBuffers(txBuffer,sizeof(txBuffer),rxBuffer,sizeof(rxBuffer)));
+    IS_TRUE(client.getBufferSize() == 32);
+    IS_TRUE(client.getRxBufferSize() == 80);
+    IS_FALSE(client.setBufferSize(128));
+
+    int rc = client.connect((char*)"client_test1");
+    IS_TRUE(rc);
+
+    byte publish[] = {0x30,length-2,0x0,0x5,0x74,0x6f,0x70,0x69,0x63,0x70,0x61,0x79,0x6c,0x6f,0x61,0x64};
+    byte bigPublish[length];
+    memset(bigPublish,'A',length);
+    memcpy(bigPublish,publish,16);
+    shimClient.respond(bigPublish,length);
+
+    rc = client.loop();
+
+    IS_TRUE(rc);
+
+    IS_TRUE(callback_called);
+    IS_TRUE(strcmp(lastTopic,"topic")==0);
+    IS_TRUE(lastLength == length-9);
+    IS_TRUE(memcmp(lastPayload,bigPublish+9,lastLength)==0);
+
+    IS_FALSE(shimClient.error());
+
+    END_IT
+}
+
 int main()
 {
     SUITE("Receive");
@@ -336,5 +465,8 @@ int main()
     test_receive_oversized_stream_message();
     test_receive_qos1();
 
+    test_receive_overflow_stream_message();
+    test_receive_overflow_stream_fitting_message();
+    test_receive_external_rx_buffer();
     FINISH
 }
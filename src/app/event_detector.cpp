@@ -0,0 +1,98 @@
+/**
+ * @file event_detector.cpp
+ * @brief Event detector implementation
+ */
+
+#define LOG_MODULE Drivers::LogModule::APP
+
+#include "event_detector.h"
+#include "config.h"
+
+namespace App {
+
+EventDetector::EventDetector()
+    : _baseline(-1), _candidate(BinEvent::NONE), _confirmCount(0),
+      _candidateSum(0), _candidateAt(0) {
+    _last.type = BinEvent::NONE;
+    _last.fromLevel = -1;
+    _last.toLevel = -1;
+    _last.atMs = 0;
+}
+
+BinEvent EventDetector::update(int8_t fillLevel, uint32_t nowMs) {
+    if (fillLevel < 0) {
+        return BinEvent::NONE;      // Sensor failure says nothing about the level
+    }
+
+    if (_baseline < 0) {
+        _baseline = fillLevel;
+        return BinEvent::NONE;
+    }
+
+    if (_candidate == BinEvent::NONE) {
+        _candidate = classify(fillLevel, 0);
+        if (_candidate == BinEvent::NONE) {
+            _baseline = fillLevel;  // Gradual change: follow it
+            return BinEvent::NONE;
+        }
+        _confirmCount = 1;
+        _candidateSum = fillLevel;
+        _candidateAt = nowMs;
+        DEBUG_PRINTF("[Event] Step %d%% -> %d%%, confirming %s\n",
+                     _baseline, fillLevel, eventName(_candidate));
+    } else if (classify(fillLevel, EVENT_HYSTERESIS) == _candidate) {
+        _confirmCount++;
+        _candidateSum += fillLevel;
+    } else {
+        DEBUG_PRINTF("[Event] %s not confirmed (%d%%)\n", eventName(_candidate), fillLevel);
+        _candidate = BinEvent::NONE;
+        return BinEvent::NONE;
+    }
+
+    if (_confirmCount < EVENT_CONFIRM_SAMPLES) {
+        return BinEvent::NONE;
+    }
+
+    _last.type = _candidate;
+    _last.fromLevel = _baseline;
+    _last.toLevel = (int8_t)(_candidateSum / _confirmCount);
+    _last.atMs = _candidateAt;
+    _baseline = _last.toLevel;
+    _candidate = BinEvent::NONE;
+
+    DEBUG_PRINTF("[Event] %s confirmed: %d%% -> %d%%\n",
+                 eventName(_last.type), _last.fromLevel, _last.toLevel);
+    return _last.type;
+}
+
+const EventInfo& EventDetector::getLastEvent() const {
+    return _last;
+}
+
+bool EventDetector::wantsFastSampling(uint32_t nowMs) const {
+    if (_candidate != BinEvent::NONE) {
+        return true;
+    }
+    return _last.type != BinEvent::NONE && nowMs - _last.atMs < EVENT_FAST_WINDOW_MS;
+}
+
+const char* EventDetector::eventName(BinEvent type) {
+    switch (type) {
+        case BinEvent::EMPTIED:     return "emptied";
+        case BinEvent::SUDDEN_FILL: return "sudden_fill";
+        default:                    return "none";
+    }
+}
+
+BinEvent EventDetector::classify(int8_t fillLevel, int8_t margin) const {
+    int16_t delta = fillLevel - _baseline;
+    if (delta <= -(EVENT_EMPTIED_DELTA - margin)) {
+        return BinEvent::EMPTIED;
+    }
+    if (delta >= EVENT_FILL_DELTA - margin) {
+        return BinEvent::SUDDEN_FILL;
+    }
+    return BinEvent::NONE;
+}
+
+} // namespace App
@@ -0,0 +1,99 @@
+/**
+ * @file event_detector.h
+ * @brief Event detector - collection and sudden-fill step detection
+ */
+
+#ifndef EVENT_DETECTOR_H
+#define EVENT_DETECTOR_H
+
+#include <Arduino.h>
+
+namespace App {
+
+/**
+ * @brief Bin event type
+ */
+enum class BinEvent : uint8_t {
+    NONE,
+    EMPTIED,        // Large drop: collected
+    SUDDEN_FILL     // Large rise: bulk dump or obstruction
+};
+
+/**
+ * @brief Confirmed event
+ */
+struct EventInfo {
+    BinEvent type;
+    int8_t fromLevel;       // Level before the step
+    int8_t toLevel;         // Mean level over the confirming samples
+    uint32_t atMs;          // millis() of the first sample showing the step
+};
+
+/**
+ * @brief Step-change detector on the fill level stream
+ *
+ * A reading that differs from the baseline by EVENT_EMPTIED_DELTA (drop) or
+ * EVENT_FILL_DELTA (rise) opens a candidate. The candidate is confirmed
+ * after EVENT_CONFIRM_SAMPLES consecutive readings that stay beyond the
+ * step minus EVENT_HYSTERESIS, and dropped as soon as one falls back (lid
+ * open, hand in the bin). Without a candidate the baseline follows the
+ * readings, so gradual filling never triggers.
+ *
+ * While a candidate is open and for EVENT_FAST_WINDOW_MS after an event the
+ * detector asks for EVENT_FAST_INTERVAL_MS sampling.
+ */
+class EventDetector {
+public:
+    /**
+     * @brief Constructor
+     */
+    EventDetector();
+
+    /**
+     * @brief Feed a fill level reading
+     * @param fillLevel Fill level (-1 = invalid, ignored)
+     * @param nowMs Current time in milliseconds
+     * @return Confirmed event type (NONE if no event)
+     */
+    BinEvent update(int8_t fillLevel, uint32_t nowMs);
+
+    /**
+     * @brief Get the most recent confirmed event
+     * @return Event info
+     */
+    const EventInfo& getLastEvent() const;
+
+    /**
+     * @brief Check if readings should be taken at the fast interval
+     * @param nowMs Current time in milliseconds
+     * @return true while confirming a step or shortly after an event
+     */
+    bool wantsFastSampling(uint32_t nowMs) const;
+
+    /**
+     * @brief Get a printable name for an event type
+     * @param type Event type
+     * @return Name string
+     */
+    static const char* eventName(BinEvent type);
+
+private:
+    int8_t _baseline;           // Confirmed level (-1 = no reading yet)
+    BinEvent _candidate;
+    uint8_t _confirmCount;
+    int16_t _candidateSum;
+    uint32_t _candidateAt;
+    EventInfo _last;
+
+    /**
+     * @brief Classify a reading against the baseline
+     * @param fillLevel Fill level
+     * @param margin Amount subtracted from the step thresholds
+     * @return Step direction (NONE if within the thresholds)
+     */
+    BinEvent classify(int8_t fillLevel, int8_t margin) const;
+};
+
+} // namespace App
+
+#endif // EVENT_DETECTOR_H
@@ -0,0 +1,209 @@
+/**
+ * @file fill_forecaster.cpp
+ * @brief Fill-rate forecaster implementation
+ */
+
+#define LOG_MODULE Drivers::LogModule::APP
+
+#include "fill_forecaster.h"
+#include "config.h"
+#include <Preferences.h>
+
+namespace App {
+
+namespace {
+
+constexpr uint32_t MODEL_MAGIC = 0x46435331; // "FCS1"
+constexpr const char* PREFS_NAMESPACE = "forecast";
+constexpr const char* PREFS_MODEL_KEY = "model";
+
+constexpr uint8_t SEASON_ONE = 32;           // Q3.5 fixed point: 32 = 1.0
+constexpr float SEASON_MAX = 255.0f / SEASON_ONE;
+constexpr float MIN_RATE = 0.01f;            // %/hour treated as "not filling"
+constexpr uint32_t MAX_GAP_SEC = 7 * 24 * 3600UL;
+
+/**
+ * @brief Forecast model, kept in RTC memory across deep sleep
+ */
+struct ForecastModel {
+    uint32_t magic;
+    uint32_t lastSec;        // Time of last accepted sample (0 = none)
+    float lastFill;          // Fill level of last accepted sample
+    float rate;              // Smoothed deseasonalized fill rate (%/hour)
+    uint16_t samples;        // Samples used to train the rate
+    uint16_t unsaved;        // Updates since last NVS save
+    uint8_t season[FillForecaster::SEASON_SLOTS];
+};
+
+RTC_DATA_ATTR ForecastModel s_model;
+
+} // namespace
+
+FillForecaster::FillForecaster() {
+}
+
+void FillForecaster::begin() {
+    if (s_model.magic == MODEL_MAGIC) {
+        DEBUG_PRINTF("[Forecast] Model restored from RTC (%u samples, %.3f %%/h)\n",
+                     s_model.samples, s_model.rate);
+        return;
+    }
+
+    Preferences prefs;
+    if (prefs.begin(PREFS_NAMESPACE, true)) {
+        size_t len = prefs.getBytes(PREFS_MODEL_KEY, &s_model, sizeof(s_model));
+        prefs.end();
+        if (len == sizeof(s_model) && s_model.magic == MODEL_MAGIC) {
+            // Sample times are not comparable across a power loss
+            s_model.lastSec = 0;
+            s_model.unsaved = 0;
+            DEBUG_PRINTF("[Forecast] Model restored from NVS (%u samples, %.3f %%/h)\n",
+                         s_model.samples, s_model.rate);
+            return;
+        }
+    }
+
+    reset();
+}
+
+bool FillForecaster::update(float fillPercent, uint32_t nowSec, bool calendarValid) {
+    if (s_model.lastSec == 0 || nowSec <= s_model.lastSec ||
+        nowSec - s_model.lastSec > MAX_GAP_SEC) {
+        // First sample, or time base changed (clock sync / long outage)
+        s_model.lastSec = nowSec;
+        s_model.lastFill = fillPercent;
+        return false;
+    }
+
+    uint32_t dtSec = nowSec - s_model.lastSec;
+    if (dtSec < FORECAST_MIN_SAMPLE_GAP_S) {
+        return false;
+    }
+
+    float delta = fillPercent - s_model.lastFill;
+    s_model.lastSec = nowSec;
+    s_model.lastFill = fillPercent;
+
+    if (delta <= -FORECAST_EMPTIED_DROP) {
+        // Bin was emptied; the rate is a property of the site, keep it
+        DEBUG_PRINTLN("[Forecast] Bin emptied - rate model kept");
+        return false;
+    }
+
+    float dtH = dtSec / 3600.0f;
+    float observed = (delta > 0 ? delta : 0) / dtH;
+
+    // Attribute the interval to the seasonal slot at its midpoint
+    uint32_t midSec = nowSec - dtSec / 2;
+    float season = calendarValid ? seasonAt(midSec) : 1.0f;
+    float base = observed / (season > 0.25f ? season : 0.25f);
+
+    if (s_model.samples == 0) {
+        s_model.rate = base;
+    } else {
+        s_model.rate += FORECAST_RATE_ALPHA * (base - s_model.rate);
+    }
+    if (s_model.samples < 0xFFFF) {
+        s_model.samples++;
+    }
+
+    // Train the profile: how much faster/slower this slot is than average
+    if (calendarValid && s_model.rate > MIN_RATE) {
+        float ratio = observed / s_model.rate;
+        if (ratio > SEASON_MAX) ratio = SEASON_MAX;
+        float updated = season + FORECAST_SEASON_GAMMA * (ratio - season);
+        s_model.season[slotFor(midSec)] = (uint8_t)(updated * SEASON_ONE + 0.5f);
+    }
+
+    if (++s_model.unsaved >= FORECAST_SAVE_EVERY) {
+        save();
+    }
+
+    DEBUG_PRINTF("[Forecast] Observed %.3f %%/h, base rate %.3f %%/h (%u samples)\n",
+                 observed, s_model.rate, s_model.samples);
+    return true;
+}
+
+float FillForecaster::etaHours(float thresholdPercent, uint32_t nowSec, bool calendarValid) {
+    if (s_model.lastSec == 0) {
+        return -1.0f;
+    }
+    if (s_model.lastFill >= thresholdPercent) {
+        return 0.0f;
+    }
+    if (s_model.samples < FORECAST_MIN_SAMPLES || s_model.rate < MIN_RATE) {
+        return -1.0f;
+    }
+
+    // Step hour by hour through the seasonal profile
+    float fill = s_model.lastFill;
+    uint32_t t = nowSec;
+    for (uint16_t h = 0; h < FORECAST_HORIZON_H; h++) {
+        float inc = s_model.rate * (calendarValid ? seasonAt(t) : 1.0f);
+        if (fill + inc >= thresholdPercent) {
+            return h + (thresholdPercent - fill) / inc;
+        }
+        fill += inc;
+        t += 3600;
+    }
+
+    return -1.0f;
+}
+
+uint32_t FillForecaster::nextWakeSec(float etaHours) {
+    if (s_model.samples < FORECAST_MIN_SAMPLES) {
+        return FORECAST_LEARN_WAKE_S;
+    }
+    if (etaHours < 0) {
+        return FORECAST_MAX_WAKE_S;
+    }
+    if (etaHours == 0) {
+        return FORECAST_FULL_WAKE_S;
+    }
+
+    // Cover a fixed fraction of the remaining time: intervals shrink
+    // geometrically as the bin approaches the threshold
+    uint32_t wake = (uint32_t)(etaHours * 3600.0f * FORECAST_WAKE_FRACTION);
+    if (wake < FORECAST_MIN_WAKE_S) wake = FORECAST_MIN_WAKE_S;
+    if (wake > FORECAST_MAX_WAKE_S) wake = FORECAST_MAX_WAKE_S;
+    return wake;
+}
+
+float FillForecaster::getRate() {
+    return s_model.rate;
+}
+
+uint16_t FillForecaster::getSampleCount() {
+    return s_model.samples;
+}
+
+void FillForecaster::reset() {
+    memset(&s_model, 0, sizeof(s_model));
+    s_model.magic = MODEL_MAGIC;
+    memset(s_model.season, SEASON_ONE, sizeof(s_model.season));
+    DEBUG_PRINTLN("[Forecast] New model");
+}
+
+float FillForecaster::seasonAt(uint32_t localSec) {
+    return (float)s_model.season[slotFor(localSec)] / SEASON_ONE;
+}
+
+uint8_t FillForecaster::slotFor(uint32_t localSec) {
+    uint32_t days = localSec / 86400UL;
+    uint8_t weekday = (days + 4) % 7;   // 1970-01-01 was a Thursday; 0 = Sunday
+    uint8_t hour = (localSec / 3600UL) % 24;
+    return weekday * 24 + hour;
+}
+
+void FillForecaster::save() {
+    Preferences prefs;
+    if (!prefs.begin(PREFS_NAMESPACE, false)) {
+        return;
+    }
+    s_model.unsaved = 0;
+    prefs.putBytes(PREFS_MODEL_KEY, &s_model, sizeof(s_model));
+    prefs.end();
+    DEBUG_PRINTLN("[Forecast] Model saved to NVS");
+}
+
+} // namespace App
@@ -0,0 +1,103 @@
+/**
+ * @file fill_forecaster.h
+ * @brief Fill-rate forecaster - time-to-full estimate and predictive wake
+ */
+
+#ifndef FILL_FORECASTER_H
+#define FILL_FORECASTER_H
+
+#include <Arduino.h>
+
+namespace App {
+
+/**
+ * @brief Fill-rate forecaster
+ *
+ * Constant-memory model per bin:
+ * - Smoothed base fill rate (%/hour), exponential smoothing
+ * - Weekday x hour seasonal profile (168 multipliers, 1 byte each)
+ *
+ * The model lives in RTC memory and is saved to NVS periodically so it
+ * survives deep sleep and power loss. Without a valid calendar clock the
+ * seasonal profile is neither used nor trained.
+ */
+class FillForecaster {
+public:
+    static constexpr uint8_t SEASON_SLOTS = 7 * 24;
+
+    /**
+     * @brief Constructor
+     */
+    FillForecaster();
+
+    /**
+     * @brief Restore the model from RTC memory or NVS
+     */
+    void begin();
+
+    /**
+     * @brief Feed a fill level sample
+     * @param fillPercent Fill level (0-100)
+     * @param nowSec Current time in seconds (local epoch if calendarValid)
+     * @param calendarValid True if nowSec is a local calendar time
+     * @return false if the sample was skipped (too close or bin emptied)
+     */
+    bool update(float fillPercent, uint32_t nowSec, bool calendarValid);
+
+    /**
+     * @brief Estimate hours until a fill threshold is reached
+     * @param thresholdPercent Fill threshold
+     * @param nowSec Current time in seconds
+     * @param calendarValid True if nowSec is a local calendar time
+     * @return Hours to threshold, 0 if already reached, -1 if unknown or beyond horizon
+     */
+    float etaHours(float thresholdPercent, uint32_t nowSec, bool calendarValid);
+
+    /**
+     * @brief Choose the next wake so sampling is dense only near the threshold
+     * @param etaHours Result of etaHours()
+     * @return Seconds until the next sample
+     */
+    uint32_t nextWakeSec(float etaHours);
+
+    /**
+     * @brief Get smoothed base fill rate
+     * @return Fill rate in %/hour
+     */
+    float getRate();
+
+    /**
+     * @brief Get number of samples the model was trained with
+     * @return Sample count
+     */
+    uint16_t getSampleCount();
+
+    /**
+     * @brief Discard the model (e.g. after moving the device to another bin)
+     */
+    void reset();
+
+private:
+    /**
+     * @brief Seasonal multiplier for a local time
+     * @param localSec Local epoch seconds
+     * @return Multiplier (1.0 = average)
+     */
+    float seasonAt(uint32_t localSec);
+
+    /**
+     * @brief Seasonal slot index (weekday * 24 + hour) for a local time
+     * @param localSec Local epoch seconds
+     * @return Slot index
+     */
+    uint8_t slotFor(uint32_t localSec);
+
+    /**
+     * @brief Save the model to NVS
+     */
+    void save();
+};
+
+} // namespace App
+
+#endif // FILL_FORECASTER_H
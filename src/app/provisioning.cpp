@@ -0,0 +1,168 @@
+/**
+ * @file provisioning.cpp
+ * @brief Provisioning implementation
+ */
+
+#define LOG_MODULE Drivers::LogModule::APP
+
+#include "provisioning.h"
+#include <Preferences.h>
+#include <esp_system.h>
+
+namespace App {
+
+namespace {
+
+constexpr const char* PREFS_NAMESPACE = "prov";
+
+// NVS keys (max 15 characters); the schema only ever gains keys
+constexpr const char* KEY_VERSION = "ver";
+constexpr const char* KEY_ID = "id";
+constexpr const char* KEY_ID_SOURCE = "id_src";
+constexpr const char* KEY_APN = "apn";
+constexpr const char* KEY_APN_USER = "apn_user";
+constexpr const char* KEY_APN_PASS = "apn_pass";
+constexpr const char* KEY_SIM_PIN = "sim_pin";
+constexpr const char* KEY_MQTT_HOST = "mqtt_host";
+constexpr const char* KEY_MQTT_PORT = "mqtt_port";
+constexpr const char* KEY_MQTT_USER = "mqtt_user";
+constexpr const char* KEY_MQTT_PASS = "mqtt_pass";
+constexpr const char* KEY_BIN_HEIGHT = "bin_height_cm";
+constexpr const char* KEY_LATITUDE = "lat";
+constexpr const char* KEY_LONGITUDE = "lon";
+constexpr const char* KEY_INTERVAL = "interval_ms";
+
+/**
+ * @brief Read a string key into a fixed buffer
+ */
+void readString(Preferences& prefs, const char* key, char* out, size_t size, const char* fallback) {
+    String value = prefs.getString(key, fallback);
+    strncpy(out, value.c_str(), size - 1);
+    out[size - 1] = '\0';
+}
+
+} // namespace
+
+Provisioning::Provisioning() : _temporaryId(false) {
+    memset(&_config, 0, sizeof(_config));
+}
+
+const DeviceConfig& Provisioning::load() {
+    memset(&_config, 0, sizeof(_config));
+
+    Preferences prefs;
+    bool opened = prefs.begin(PREFS_NAMESPACE, true);
+    if (!opened) {
+        // Namespace absent: unprovisioned unit, every key takes its default
+        DEBUG_PRINTLN("[Prov] No provisioning record, using compiled defaults");
+    }
+
+    // Reads on a closed handle return the fallback, so one path serves both
+    _config.schemaVersion = opened ? prefs.getUShort(KEY_VERSION, 0) : 0;
+    readString(prefs, KEY_APN, _config.apn, sizeof(_config.apn), GPRS_APN);
+    readString(prefs, KEY_APN_USER, _config.apnUser, sizeof(_config.apnUser), GPRS_USER);
+    readString(prefs, KEY_APN_PASS, _config.apnPass, sizeof(_config.apnPass), GPRS_PASS);
+    readString(prefs, KEY_SIM_PIN, _config.simPin, sizeof(_config.simPin), SIM_PIN);
+    readString(prefs, KEY_MQTT_HOST, _config.mqttBroker, sizeof(_config.mqttBroker), MQTT_BROKER);
+    readString(prefs, KEY_MQTT_USER, _config.mqttUser, sizeof(_config.mqttUser), MQTT_USER);
+    readString(prefs, KEY_MQTT_PASS, _config.mqttPass, sizeof(_config.mqttPass), MQTT_PASS);
+    _config.mqttPort = prefs.getUShort(KEY_MQTT_PORT, MQTT_PORT);
+    _config.binHeightCm = prefs.getFloat(KEY_BIN_HEIGHT, TRASH_CAN_HEIGHT_CM);
+    _config.defaultLatitude = prefs.getFloat(KEY_LATITUDE, DEFAULT_LATITUDE);
+    _config.defaultLongitude = prefs.getFloat(KEY_LONGITUDE, DEFAULT_LONGITUDE);
+    _config.publishIntervalMs = prefs.getUInt(KEY_INTERVAL, PUBLISH_INTERVAL_MS);
+
+    readString(prefs, KEY_ID, _config.deviceId, sizeof(_config.deviceId), "");
+    uint8_t source = prefs.getUChar(KEY_ID_SOURCE, (uint8_t)IdentitySource::PROVISIONED);
+    if (opened) {
+        prefs.end();
+    }
+
+    if (_config.schemaVersion > PROV_SCHEMA_VERSION) {
+        DEBUG_PRINTF("[Prov] Record version %u is newer than %u, unknown keys ignored\n",
+                     _config.schemaVersion, PROV_SCHEMA_VERSION);
+    }
+
+    if (_config.deviceId[0] != '\0') {
+        _config.idSource = (IdentitySource)source;
+    } else if (DEVICE_ID[0] != '\0') {
+        strncpy(_config.deviceId, DEVICE_ID, sizeof(_config.deviceId) - 1);
+        _config.idSource = IdentitySource::COMPILED;
+    } else if (PROV_ID_SOURCE == PROV_ID_EFUSE_MAC) {
+        deriveIdentity(IdentitySource::EFUSE_MAC, NULL, true);
+    } else {
+        _config.idSource = IdentitySource::NONE;   // Resolved once the modem is up
+    }
+
+    DEBUG_PRINTF("[Prov] Record v%u, device ID %s (%s), broker %s:%u, APN %s\n",
+                 _config.schemaVersion,
+                 _config.idSource == IdentitySource::NONE ? "pending" : _config.deviceId,
+                 sourceName(_config.idSource), _config.mqttBroker, _config.mqttPort, _config.apn);
+    return _config;
+}
+
+bool Provisioning::resolveIdentity(const String& imei) {
+    if (_config.idSource != IdentitySource::NONE && !_temporaryId) {
+        return true;
+    }
+
+    // IMEI is 15 digits (14 without the check digit)
+    if (imei.length() >= 14) {
+        _temporaryId = false;
+        return deriveIdentity(IdentitySource::IMEI, imei.c_str(), true);
+    }
+    if (_temporaryId) {
+        return true;
+    }
+
+    // Not persisted: a saved stand-in would hide the IMEI on every later boot
+    DEBUG_PRINTLN("[Prov] IMEI not available, using the eFuse MAC for this boot");
+    _temporaryId = deriveIdentity(IdentitySource::EFUSE_MAC, NULL, false);
+    return _temporaryId;
+}
+
+const DeviceConfig& Provisioning::config() const {
+    return _config;
+}
+
+const char* Provisioning::sourceName(IdentitySource source) {
+    switch (source) {
+        case IdentitySource::PROVISIONED: return "provisioned";
+        case IdentitySource::COMPILED:    return "compiled";
+        case IdentitySource::IMEI:        return "IMEI";
+        case IdentitySource::EFUSE_MAC:   return "eFuse MAC";
+        default:                          return "none";
+    }
+}
+
+bool Provisioning::deriveIdentity(IdentitySource source, const char* serial, bool persist) {
+    if (source == IdentitySource::IMEI) {
+        snprintf(_config.deviceId, sizeof(_config.deviceId), "%s%s", DEVICE_ID_PREFIX, serial);
+    } else {
+        uint8_t mac[6];
+        if (esp_efuse_mac_get_default(mac) != ESP_OK) {
+            return false;
+        }
+        snprintf(_config.deviceId, sizeof(_config.deviceId), "%s%02x%02x%02x%02x%02x%02x",
+                 DEVICE_ID_PREFIX, mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
+    }
+    _config.idSource = source;
+    if (!persist) {
+        DEBUG_PRINTF("[Prov] Device ID %s derived from %s (this boot only)\n",
+                     _config.deviceId, sourceName(source));
+        return true;
+    }
+
+    // Persist so the identity survives a change of link or a modem swap
+    Preferences prefs;
+    if (prefs.begin(PREFS_NAMESPACE, false)) {
+        prefs.putString(KEY_ID, _config.deviceId);
+        prefs.putUChar(KEY_ID_SOURCE, (uint8_t)source);
+        prefs.end();
+    }
+
+    DEBUG_PRINTF("[Prov] Device ID %s derived from %s\n", _config.deviceId, sourceName(source));
+    return true;
+}
+
+} // namespace App
@@ -0,0 +1,112 @@
+/**
+ * @file provisioning.h
+ * @brief Provisioning - runtime device identity and per-unit configuration
+ */
+
+#ifndef PROVISIONING_H
+#define PROVISIONING_H
+
+#include <Arduino.h>
+#include "config.h"
+
+namespace App {
+
+/**
+ * @brief Where the device identity came from
+ */
+enum class IdentitySource : uint8_t {
+    NONE,           // Not resolved yet (waiting for the modem IMEI)
+    PROVISIONED,    // Written to NVS at the factory or by an earlier boot
+    COMPILED,       // DEVICE_ID set in config.h
+    IMEI,           // Derived from the modem IMEI
+    EFUSE_MAC       // Derived from the ESP32 factory MAC
+};
+
+/**
+ * @brief Per-unit configuration, read once at boot
+ *
+ * Plain data: hot paths read fields directly, never NVS.
+ */
+struct DeviceConfig {
+    char deviceId[PROV_ID_MAX];
+    IdentitySource idSource;
+    char apn[PROV_STR_MAX];
+    char apnUser[PROV_STR_MAX];
+    char apnPass[PROV_STR_MAX];
+    char simPin[9];
+    char mqttBroker[PROV_STR_MAX];
+    uint16_t mqttPort;
+    char mqttUser[PROV_STR_MAX];
+    char mqttPass[PROV_STR_MAX];
+    float binHeightCm;
+    float defaultLatitude;
+    float defaultLongitude;
+    uint32_t publishIntervalMs;
+    uint16_t schemaVersion;     // Version of the NVS record (0 = none, defaults only)
+};
+
+/**
+ * @brief Provisioning store
+ *
+ * Values live as typed keys in the "prov" NVS namespace so a factory line
+ * can flash them with nvs_partition_gen.py; missing keys take the
+ * compiled-in defaults from config.h. The record carries a schema version
+ * ("ver"); keys are only ever added, so older records load with defaults
+ * for the new fields.
+ *
+ * Identity precedence: provisioned "id" key, DEVICE_ID, then derived from
+ * the modem IMEI or eFuse MAC (PROV_ID_SOURCE). A derived identity is
+ * written back to NVS so it never changes between boots - except the eFuse
+ * MAC stand-in used while an IMEI identity cannot be read, which lasts for
+ * that boot only so the IMEI identity is still taken once the modem answers.
+ */
+class Provisioning {
+public:
+    /**
+     * @brief Constructor
+     */
+    Provisioning();
+
+    /**
+     * @brief Load configuration from NVS (call once at boot)
+     * @return Loaded configuration
+     */
+    const DeviceConfig& load();
+
+    /**
+     * @brief Resolve a pending (or stand-in) IMEI-based identity
+     * @param imei Modem IMEI (empty if the modem is not available)
+     * @return true if the device has an identity
+     */
+    bool resolveIdentity(const String& imei);
+
+    /**
+     * @brief Get the loaded configuration
+     * @return Configuration
+     */
+    const DeviceConfig& config() const;
+
+    /**
+     * @brief Get a printable name for an identity source
+     * @param source Identity source
+     * @return Name string
+     */
+    static const char* sourceName(IdentitySource source);
+
+private:
+    DeviceConfig _config;
+    bool _temporaryId;      // eFuse MAC stand-in, not persisted
+
+    /**
+     * @brief Derive the identity from a hardware serial
+     * @param source IMEI or EFUSE_MAC
+     * @param serial IMEI digits (ignored for EFUSE_MAC)
+     * @param persist Write the identity back to NVS
+     * @return true if an identity was set
+     */
+    bool deriveIdentity(IdentitySource source, const char* serial, bool persist);
+};
+
+} // namespace App
+
+#endif // PROVISIONING_H
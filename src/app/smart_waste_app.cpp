@@ -3,9 +3,17 @@
  * @brief Smart Waste Application implementation
  */
 
+#define LOG_MODULE Drivers::LogModule::APP
+
 #include "smart_waste_app.h"
 #include "config.h"
-#include "../drivers/gpio_driver.h"
+#include "../drivers/led_driver.h"
+#include "../drivers/pm_driver.h"
+#include "../drivers/at_capture.h"
+#include "../drivers/modem_sleep.h"
+#include "../drivers/ulp_monitor.h"
+#include <sys/time.h>
+#include <time.h>
 
 namespace App {
 
@@ -13,20 +21,34 @@ SmartWasteApp::SmartWasteApp(HAL::ModemHAL& modemHal,
                              HAL::SensorHAL& sensorHal,
                              HAL::GpsHAL& gpsHal,
                              HAL::PowerHAL& powerHal,
-                             Network::GprsManager& gprsManager,
-                             Network::MqttService& mqttService)
+                             Network::LinkManager& linkManager,
+                             Network::MqttService& mqttService,
+                             Network::OutboundQueue& outbound,
+                             Network::SignalMonitor& signalMonitor,
+                             Network::LogUploader& logUploader)
     : _modemHal(modemHal),
       _sensorHal(sensorHal),
       _gpsHal(gpsHal),
       _powerHal(powerHal),
-      _gprsManager(gprsManager),
+      _linkManager(linkManager),
       _mqttService(mqttService),
+      _outbound(outbound),
+      _signalMonitor(signalMonitor),
+      _logUploader(logUploader),
       _state(AppState::INIT),
       _lastPublishTime(0),
       _publishInterval(PUBLISH_INTERVAL_MS),
       _trashCanHeight(TRASH_CAN_HEIGHT_CM),
       _initialized(false),
-      _firstRun(true) {
+      _firstRun(true),
+      _bootLogged(false),
+      _alertActive(false),
+      _lastMqttPoll(0),
+      _lastPmStats(0),
+      _lastQueueStats(0),
+      _sleepMs(0),
+      _errorRetryAt(0),
+      _utcOffsetMin(LOCAL_UTC_OFFSET_MIN) {
     
     // Initialize last readings
     memset(&_lastReadings, 0, sizeof(_lastReadings));
@@ -36,11 +58,30 @@ bool SmartWasteApp::init() {
     DEBUG_PRINTLN("========================================");
     DEBUG_PRINTLN("  Smart Waste Monitoring System");
     DEBUG_PRINTF("  Firmware: %s\n", FIRMWARE_VERSION);
-    DEBUG_PRINTF("  Device ID: %s\n", DEVICE_ID);
     DEBUG_PRINTLN("========================================");
     
     _state = AppState::INIT;
     
+    Drivers::UlpWakeReason wake = _powerHal.getWakeReason();
+    if (wake != Drivers::UlpWakeReason::NONE) {
+        // RAM state is gone; _firstRun publishes the reading at once
+        DEBUG_PRINTF("[App] Woken by ULP: %s (battery raw %u, %u checks)\n",
+                     Drivers::UlpMonitor::reasonName(wake),
+                     Drivers::UlpMonitor::lastBatteryRaw(), Drivers::UlpMonitor::samples());
+    }
+#if AGG_ENABLED
+    if (_aggregator.resume(millis())) {
+        DEBUG_PRINTF("[App] Window resumed after deep sleep (%u readings)\n",
+                     _aggregator.getSampleCount());
+    }
+#endif
+    
+    // Per-unit configuration, read once; hot paths use the cached copy
+    const DeviceConfig& config = _provisioning.load();
+    _publishInterval = config.publishIntervalMs;
+    _trashCanHeight = config.binHeightCm;
+    _gpsHal.setDefaultLocation(config.defaultLatitude, config.defaultLongitude);
+    
     // Initialize hardware
     if (!initHardware()) {
         DEBUG_PRINTLN("[App] Hardware initialization failed");
@@ -55,13 +96,15 @@ bool SmartWasteApp::init() {
         return false;
     }
     
+    _forecaster.begin();
+    
     _initialized = true;
     _state = AppState::IDLE;
     _lastPublishTime = millis();  // Will be overwritten after first publish
     // _firstRun flag (set in constructor) ensures immediate first publish
     
     DEBUG_PRINTLN("[App] Initialization complete");
-    blinkLed(3, 200, 200); // Success indication
+    Drivers::LedDriver::play(Drivers::LedPattern::READY);
     
     return true;
 }
@@ -69,17 +112,7 @@ bool SmartWasteApp::init() {
 bool SmartWasteApp::initHardware() {
     DEBUG_PRINTLN("[App] Initializing hardware...");
     
-    // Initialize modem
-    if (!_modemHal.init()) {
-        DEBUG_PRINTLN("[App] Modem init failed");
-        return false;
-    }
-    
-    // Check SIM
-    if (!_modemHal.checkSim(SIM_PIN)) {
-        DEBUG_PRINTLN("[App] SIM check failed");
-        return false;
-    }
+    // Modem is powered up by the link manager only if cellular is selected
     
     // Initialize ultrasonic sensor
     if (!_sensorHal.init()) {
@@ -93,6 +126,14 @@ bool SmartWasteApp::initHardware() {
         // Continue - will use simulated values
     }
     
+#if PM_ENABLED
+    // Enable DFS / light sleep with modem UART and RI as wake sources
+    if (!_powerHal.initPowerManagement(MODEM_UART_NUM, MODEM_RING_PIN)) {
+        DEBUG_PRINTLN("[App] Power management init failed");
+        // Continue - runs at full clock
+    }
+#endif
+    
     DEBUG_PRINTLN("[App] Hardware initialized");
     return true;
 }
@@ -100,36 +141,57 @@ bool SmartWasteApp::initHardware() {
 bool SmartWasteApp::initNetwork() {
     DEBUG_PRINTLN("[App] Initializing network...");
     
-    // Initialize GPRS
-    if (!_gprsManager.init(GPRS_APN, GPRS_USER, GPRS_PASS)) {
-        DEBUG_PRINTLN("[App] GPRS init failed");
+    const DeviceConfig& config = _provisioning.config();
+    
+    // Initialize link manager (Wi-Fi / cellular)
+    if (!_linkManager.init(config.apn, config.apnUser, config.apnPass, config.simPin)) {
+        DEBUG_PRINTLN("[App] Link manager init failed");
         return false;
     }
     
-    // Connect to GPRS
-    if (!_gprsManager.connect(NETWORK_TIMEOUT_MS)) {
-        DEBUG_PRINTLN("[App] GPRS connection failed");
+    // Bring up the preferred link
+    Drivers::LedDriver::play(Drivers::LedPattern::CONNECTING);
+    bool connected = _linkManager.connect(NETWORK_TIMEOUT_MS);
+    Drivers::LedDriver::cancel(Drivers::LedPattern::CONNECTING);
+    if (!connected) {
+        DEBUG_PRINTLN("[App] Network connection failed");
         return false;
     }
     
-    // Initialize GPS (if enabled)
+    // An IMEI-derived identity needs the modem; falls back to the eFuse MAC
+    if (!_provisioning.resolveIdentity(_modemHal.isReady() ? _modemHal.getIMEI() : String())) {
+        DEBUG_PRINTLN("[App] No device identity");
+        return false;
+    }
+    
+    // Calendar time for the forecaster's weekday/hour profile
+    syncClock();
+    
+    // Initialize GPS (if enabled) - GNSS lives in the modem
 #if GPS_ENABLED
-    if (!_gpsHal.init(GPS_TIMEOUT_MS)) {
+    if (!_modemHal.isReady()) {
+        DEBUG_PRINTLN("[App] Modem off (Wi-Fi link) - using default location");
+    } else if (!_gpsHal.init(GPS_TIMEOUT_MS)) {
         DEBUG_PRINTLN("[App] GPS init failed - will use default location");
         // Continue - will use default coordinates
     }
 #else
     DEBUG_PRINTLN("[App] GPS disabled in config - using fixed coordinates");
-    DEBUG_PRINTF("[App] Location: %.6f, %.6f\n", DEFAULT_LATITUDE, DEFAULT_LONGITUDE);
+    DEBUG_PRINTF("[App] Location: %.6f, %.6f\n", config.defaultLatitude, config.defaultLongitude);
 #endif
     
     // Initialize MQTT
-    if (!_mqttService.init(MQTT_BROKER, MQTT_PORT, MQTT_CLIENT_ID, 
-                           MQTT_USER, MQTT_PASS)) {
+    if (!_mqttService.init(config.mqttBroker, config.mqttPort, config.deviceId,
+                           config.mqttUser, config.mqttPass)) {
         DEBUG_PRINTLN("[App] MQTT init failed");
         return false;
     }
     
+    // Subscribed on connect; a request is served over the same session
+    if (!_logUploader.begin()) {
+        DEBUG_PRINTLN("[App] Log upload route not added");
+    }
+    
     // Connect to MQTT broker
     if (!_mqttService.connect()) {
         DEBUG_PRINTLN("[App] MQTT connection failed");
@@ -149,14 +211,40 @@ void SmartWasteApp::run() {
     }
     
     // Process MQTT messages
-    _mqttService.loop();
+    pollMqtt();
+    
+    // Send due queued messages (alerts immediately, routine in batches)
+    serviceOutbound();
+    
+    // Requested log upload, one chunk at a time behind queued traffic
+    _logUploader.service();
+    
+#if AT_CAPTURE_DUMP_SERIAL
+    // AT traffic around an error, once the capture is complete
+    Drivers::AtCapture::dumpFrozen(Serial);
+#endif
+    
+    // Modem back to slow clock once the exchange is over
+    Drivers::ModemSleep::service();
+    
+#if PM_ENABLED
+    // Let the chip sleep again once the modem UART has gone quiet
+    Drivers::PmDriver::service();
+    
+    if (millis() - _lastPmStats >= PM_STATS_INTERVAL_MS) {
+        _powerHal.printPmStats();
+        Drivers::ModemSleep::printStats();
+        _lastPmStats = millis();
+    }
+#endif
     
     switch (_state) {
         case AppState::IDLE:
             // Print debug info every 10 seconds while idle
             if (millis() - lastDebugPrint >= 10000) {
                 uint32_t elapsed = millis() - _lastPublishTime;
-                uint32_t remaining = (_publishInterval > elapsed) ? (_publishInterval - elapsed) : 0;
+                uint32_t interval = sampleInterval();
+                uint32_t remaining = (interval > elapsed) ? (interval - elapsed) : 0;
                 DEBUG_PRINTF("[App] IDLE - Next publish in %lu seconds\n", remaining / 1000);
                 lastDebugPrint = millis();
             }
@@ -165,34 +253,54 @@ void SmartWasteApp::run() {
                 DEBUG_PRINTLN("[App] Time to publish!");
                 _state = AppState::READING_SENSORS;
             }
+#if DEEP_SLEEP_ENABLED
+            else {
+                uint32_t elapsed = millis() - _lastPublishTime;
+                uint32_t interval = sampleInterval();
+                uint32_t remaining = (interval > elapsed) ? (interval - elapsed) : 0;
+                if (canDeepSleep(remaining)) {
+                    _sleepMs = remaining;
+                    _state = AppState::SLEEP;
+                }
+            }
+#endif
             break;
             
         case AppState::READING_SENSORS:
             DEBUG_PRINTLN("[App] Reading sensors...");
             _lastReadings = readSensors();
+            retryClockSync();
+            updateForecast(_lastReadings);
+#if EVENT_ENABLED
+            detectEvents(_lastReadings);
+#endif
             _state = AppState::PUBLISHING;
             break;
             
         case AppState::PUBLISHING:
-            DEBUG_PRINTLN("[App] Publishing data...");
+            DEBUG_PRINTLN("[App] Queueing data...");
             if (publishData(_lastReadings)) {
                 _lastPublishTime = millis();
-                _firstRun = false;  // Clear first run flag after successful publish
-                DEBUG_PRINTLN("[App] Publish successful!");
-                blinkLed(1, 100, 0); // Success blink
+                _firstRun = false;  // Reading taken; the queue retries delivery
+                serviceOutbound();
             } else {
-                DEBUG_PRINTLN("[App] Publish failed!");
-                blinkLed(5, 50, 50); // Error blink
+                DEBUG_PRINTLN("[App] Queueing failed!");
+                Drivers::LedDriver::play(Drivers::LedPattern::ERROR);
             }
             _state = AppState::IDLE;
             break;
             
         case AppState::ERROR:
-            handleError();
+            // Recovery retries on a timestamp so the loop never blocks
+            if ((int32_t)(millis() - _errorRetryAt) >= 0) {
+                handleError();
+            }
             break;
             
         case AppState::SLEEP:
-            // Not implemented - for future deep sleep support
+            enterDeepSleep(_sleepMs);
+            // Only reached if the sleep could not start
+            _state = AppState::IDLE;
             break;
             
         default:
@@ -225,9 +333,21 @@ SensorReadings SmartWasteApp::readSensors() {
     SensorReadings readings;
     readings.timestamp = millis();
     
-    // Read distance sensor
-    DEBUG_PRINTLN("[App] Reading ultrasonic sensor...");
-    HAL::DistanceReading distReading = _sensorHal.getDistanceAvg(US100_NUM_SAMPLES);
+    // Read distance sensor(s)
+    HAL::DistanceReading distReading;
+    readings.sensorCount = 0;
+    
+    if (_sensorHal.hasArray()) {
+        LOG_D("[App] Reading ultrasonic sensor array...\n");
+        HAL::ArrayReading array = _sensorHal.getArrayReading(US100_NUM_SAMPLES);
+        readings.sensorCount = array.count;
+        memcpy(readings.sensorDistanceCm, array.distanceCm, sizeof(readings.sensorDistanceCm));
+        distReading.valid = array.valid;
+        distReading.distanceCm = array.fusedDistanceCm;
+    } else {
+        LOG_D("[App] Reading ultrasonic sensor...\n");
+        distReading = _sensorHal.getDistanceAvg(US100_NUM_SAMPLES);
+    }
     
     if (distReading.valid) {
         readings.distanceCm = distReading.distanceCm;
@@ -237,44 +357,48 @@ SensorReadings SmartWasteApp::readSensors() {
         // Sensor broken/disconnected - still publish with -1 to indicate failure
         readings.distanceCm = -1;
         readings.fillLevel = -1;
-        DEBUG_PRINTLN("[App] WARNING: Sensor FAILED - publishing fill_level=-1 to indicate broken sensor");
+        LOG_W("[App] WARNING: Sensor FAILED - publishing fill_level=-1 to indicate broken sensor\n");
     }
     
     // Read GPS location (if enabled)
 #if GPS_ENABLED
-    DEBUG_PRINTLN("[App] Reading GPS location...");
-    HAL::GpsLocation gpsLoc = _gpsHal.getLocation(GPS_TIMEOUT_MS);
+    LOG_D("[App] Reading GPS location...\n");
+    // GNSS needs the modem, which is off while Wi-Fi carries the link
+    HAL::GpsLocation gpsLoc = _gpsHal.getLocation(_modemHal.isReady() ? GPS_TIMEOUT_MS : 0);
     readings.latitude = gpsLoc.latitude;
     readings.longitude = gpsLoc.longitude;
     readings.gpsValid = gpsLoc.valid;
     
     if (!gpsLoc.valid) {
-        DEBUG_PRINTLN("[App] GPS timeout - using default coordinates");
+        LOG_W("[App] GPS timeout - using default coordinates\n");
     }
 #else
     // GPS disabled - use fixed coordinates from config
-    DEBUG_PRINTLN("[App] GPS disabled - using fixed coordinates");
-    readings.latitude = DEFAULT_LATITUDE;
-    readings.longitude = DEFAULT_LONGITUDE;
+    LOG_D("[App] GPS disabled - using fixed coordinates\n");
+    readings.latitude = _provisioning.config().defaultLatitude;
+    readings.longitude = _provisioning.config().defaultLongitude;
     readings.gpsValid = false;
 #endif
     
     // Read battery level
-    DEBUG_PRINTLN("[App] Reading battery level...");
+    LOG_D("[App] Reading battery level...\n");
     HAL::BatteryStatus battery = _powerHal.getBatteryStatus();
     readings.batteryLevel = battery.percentage;
+    if (battery.valid && battery.percentage <= LED_LOW_BATTERY_PERCENT) {
+        Drivers::LedDriver::play(Drivers::LedPattern::LOW_BATTERY);
+    }
     
     // Log final readings summary
-    DEBUG_PRINTLN("[App] === SENSOR READINGS COMPLETE ===");
-    DEBUG_PRINTF("  Distance: %.2f cm %s\n", readings.distanceCm, 
-                 readings.distanceCm < 0 ? "(SENSOR ERROR)" : "");
-    DEBUG_PRINTF("  Fill Level: %d%% %s\n", readings.fillLevel,
-                 readings.fillLevel < 0 ? "(SENSOR ERROR)" : "");
-    DEBUG_PRINTF("  Location: %.6f, %.6f (%s)\n", 
-                 readings.latitude, readings.longitude,
-                 readings.gpsValid ? "GPS" : "default");
-    DEBUG_PRINTF("  Battery: %d%%\n", readings.batteryLevel);
-    DEBUG_PRINTLN("[App] ================================");
+    LOG_D("[App] === SENSOR READINGS COMPLETE ===\n");
+    LOG_D("  Distance: %.2f cm %s\n", readings.distanceCm,
+          readings.distanceCm < 0 ? "(SENSOR ERROR)" : "");
+    LOG_D("  Fill Level: %d%% %s\n", readings.fillLevel,
+          readings.fillLevel < 0 ? "(SENSOR ERROR)" : "");
+    LOG_D("  Location: %.6f, %.6f (%s)\n",
+          readings.latitude, readings.longitude,
+          readings.gpsValid ? "GPS" : "default");
+    LOG_D("  Battery: %d%%\n", readings.batteryLevel);
+    LOG_D("[App] ================================\n");
     
     return readings;
 }
@@ -297,28 +421,207 @@ int8_t SmartWasteApp::calculateFillLevel(float distanceCm) {
     return (int8_t)fillLevel;
 }
 
-bool SmartWasteApp::publishData(const SensorReadings& readings) {
-    // Ensure network connection
-    if (!_gprsManager.ensureConnection()) {
-        DEBUG_PRINTLN("[App] Network connection lost");
-        return false;
+void SmartWasteApp::syncClock() {
+    if (_linkManager.getActiveLink() == Network::LinkType::CELLULAR) {
+        uint32_t localSec;
+        int16_t offsetMin;
+        if (_modemHal.getLocalTime(localSec, offsetMin)) {
+            struct timeval tv;
+            tv.tv_sec = localSec - offsetMin * 60;
+            tv.tv_usec = 0;
+            settimeofday(&tv, nullptr);
+            _utcOffsetMin = offsetMin;
+            DEBUG_PRINTF("[App] Clock set from network (UTC%+d min)\n", offsetMin);
+        } else {
+            DEBUG_PRINTLN("[App] Network time not available yet");
+        }
+    } else if (_linkManager.getActiveLink() == Network::LinkType::WIFI) {
+        // SNTP completes in the background
+        configTime(0, 0, NTP_SERVER);
+        DEBUG_PRINTLN("[App] SNTP clock sync started");
+    }
+}
+
+void SmartWasteApp::retryClockSync() {
+    bool calendarValid;
+    localNow(calendarValid);
+    if (!calendarValid) {
+        // NITZ arrives some time after registration (and only once +CLTS
+        // is stored), so the sync at init often comes too early
+        syncClock();
+    }
+}
+
+uint32_t SmartWasteApp::localNow(bool& calendarValid) {
+    time_t now = time(nullptr);
+    calendarValid = (now > 1700000000);  // Clock has been set (after Nov 2023)
+    if (!calendarValid) {
+        return millis() / 1000 + 1;
+    }
+    return (uint32_t)now + _utcOffsetMin * 60;
+}
+
+void SmartWasteApp::updateForecast(SensorReadings& readings) {
+    readings.etaFullMin = -1;
+    if (readings.fillLevel < 0) {
+        return;  // Sensor failure - nothing to learn from
     }
     
-    if (!_mqttService.ensureConnection()) {
-        DEBUG_PRINTLN("[App] MQTT connection lost");
-        return false;
+    bool calendarValid;
+    uint32_t now = localNow(calendarValid);
+    _forecaster.update(readings.fillLevel, now, calendarValid);
+    
+    float eta = _forecaster.etaHours(FILL_FULL_THRESHOLD, now, calendarValid);
+    if (eta >= 0) {
+        readings.etaFullMin = (int32_t)(eta * 60.0f);
     }
     
+#if FORECAST_ENABLED
+    uint32_t wakeSec = _forecaster.nextWakeSec(eta);
+    _publishInterval = wakeSec * 1000UL;
+    DEBUG_PRINTF("[App] Forecast: ETA to %d%% %ld min, next sample in %lu s\n",
+                 FILL_FULL_THRESHOLD, readings.etaFullMin, wakeSec);
+#endif
+}
+
+void SmartWasteApp::detectEvents(const SensorReadings& readings) {
+    if (_events.update(readings.fillLevel, millis()) == BinEvent::NONE) {
+        return;
+    }
+    
+    // Timestamp of the first reading that showed the step
+    const EventInfo& event = _events.getLastEvent();
+    uint32_t ageSec = (millis() - event.atMs) / 1000;
+    time_t now = time(nullptr);
+    
+    Network::EventPayload payload;
+    payload.deviceId = _provisioning.config().deviceId;
+    payload.type = EventDetector::eventName(event.type);
+    payload.fromLevel = event.fromLevel;
+    payload.toLevel = event.toLevel;
+    payload.timeValid = (now > 1700000000);
+    payload.timestamp = payload.timeValid ? (uint32_t)now - ageSec : event.atMs / 1000;
+    
+    String topic;
+    String json;
+    _mqttService.encodeEvent(payload, topic, json);
+    if (!_outbound.enqueue(Network::MessageClass::ALERT, topic.c_str(), json.c_str())) {
+        DEBUG_PRINTLN("[App] Event not queued");
+    }
+}
+
+bool SmartWasteApp::publishData(const SensorReadings& readings) {
+#if AGG_ENABLED
+    uint32_t now = millis();
+    bool jump = _aggregator.add(readings.fillLevel, readings.batteryLevel, now);
+    bool queued = true;
+    
+    // Raw only when the summary would hide something
+    if (_firstRun || jump || isAlert(readings) != _alertActive) {
+        DEBUG_PRINTLN("[App] Anomaly - queueing raw reading");
+        queued = queueReading(readings);
+    }
+    
+    if (_aggregator.isComplete(now)) {
+        queued = queueSummary(readings) && queued;
+    } else {
+        LOG_D("[App] Reading %u/%u in window\n", _aggregator.getSampleCount(), AGG_WINDOW_SAMPLES);
+    }
+    return queued;
+#else
+    return queueReading(readings);
+#endif
+}
+
+bool SmartWasteApp::queueReading(const SensorReadings& readings) {
     // Build payload
     Network::SensorPayload payload;
-    payload.deviceId = DEVICE_ID;
+    payload.deviceId = _provisioning.config().deviceId;
     payload.latitude = readings.latitude;
     payload.longitude = readings.longitude;
     payload.batteryLevel = readings.batteryLevel;
     payload.fillLevel = readings.fillLevel;
+    payload.etaFullMin = readings.etaFullMin;
+    payload.sensorCount = readings.sensorCount;
+    payload.sensorDistanceCm = readings.sensorDistanceCm;
+    
+    // Entering full / sensor-failed state is an alert; staying there is routine
+    bool alert = isAlert(readings);
+    Network::MessageClass cls = (alert && !_alertActive)
+        ? Network::MessageClass::ALERT
+        : Network::MessageClass::TELEMETRY;
+    _alertActive = alert;
+    
+    String topic;
+    String json;
+    _mqttService.encodeSensorData(payload, topic, json);
+    return _outbound.enqueue(cls, topic.c_str(), json.c_str());
+}
+
+bool SmartWasteApp::queueSummary(const SensorReadings& readings) {
+    Network::SummaryPayload payload;
+    if (!_aggregator.close(payload, millis())) {
+        return true;
+    }
+    payload.deviceId = _provisioning.config().deviceId;
+    payload.latitude = readings.latitude;
+    payload.longitude = readings.longitude;
+    payload.etaFullMin = readings.etaFullMin;
+    
+    DEBUG_PRINTF("[App] Window: %u samples (%u invalid), fill %d..%d mean %.1f, battery %+.2f %%/h\n",
+                 payload.samples, payload.invalid, payload.fillMin, payload.fillMax,
+                 payload.fillMean, payload.batteryTrend);
+    
+    String topic;
+    String json;
+    _mqttService.encodeSummary(payload, topic, json);
+    return _outbound.enqueue(Network::MessageClass::TELEMETRY, topic.c_str(), json.c_str());
+}
+
+bool SmartWasteApp::isAlert(const SensorReadings& readings) {
+    return (readings.fillLevel < 0 || readings.fillLevel >= FILL_FULL_THRESHOLD);
+}
+
+void SmartWasteApp::serviceOutbound() {
+    uint8_t sent = _outbound.service();
+    
+    if (sent > 0) {
+        DEBUG_PRINTLN("[App] Publish successful!");
+        if (!_bootLogged) {
+            // Deferred boot diagnostics - off the time-to-first-publish path
+            DEBUG_PRINTF("[App] First publish %lu ms after boot\n", millis());
+            _linkManager.logLinkInfo();
+            _bootLogged = true;
+        }
+        Drivers::LedDriver::play(Drivers::LedPattern::SUCCESS);
+    }
+    
+    if (millis() - _lastQueueStats >= OUTBOUND_STATS_INTERVAL_MS) {
+        _lastQueueStats = millis();
+        _outbound.printStats();
+        String topic = _mqttService.buildDeviceTopic(MQTT_DIAG_TOPIC_SUFFIX);
+        _outbound.enqueue(Network::MessageClass::DIAGNOSTICS, topic.c_str(),
+                          _outbound.buildStatsJson().c_str());
+        _signalMonitor.printStats();
+        _outbound.enqueue(Network::MessageClass::DIAGNOSTICS, topic.c_str(),
+                          _signalMonitor.buildStatsJson().c_str());
+        Drivers::AtCapture::printStats();
+    }
+}
+
+void SmartWasteApp::pollMqtt() {
+#if PM_ENABLED
+    if (!_modemHal.hasPendingData() && millis() - _lastMqttPoll < PM_MQTT_POLL_MS) {
+        return;
+    }
+    _lastMqttPoll = millis();
     
-    // Publish
-    return _mqttService.publishSensorData(payload);
+    // Keep APB clock stable and stay awake while draining the UART
+    Drivers::PmLockGuard uartLock(Drivers::PmLockId::UART_RX);
+    _mqttService.loop();
+#else
+    _mqttService.loop();
+#endif
 }
 
 bool SmartWasteApp::shouldPublish() {
@@ -328,23 +631,73 @@ bool SmartWasteApp::shouldPublish() {
         return true;
     }
     
-    return (millis() - _lastPublishTime >= _publishInterval);
+    return (millis() - _lastPublishTime >= sampleInterval());
+}
+
+uint32_t SmartWasteApp::sampleInterval() {
+#if EVENT_ENABLED
+    if (_events.wantsFastSampling(millis()) && _publishInterval > EVENT_FAST_INTERVAL_MS) {
+        return EVENT_FAST_INTERVAL_MS;
+    }
+#endif
+    return _publishInterval;
+}
+
+bool SmartWasteApp::canDeepSleep(uint32_t remainingMs) {
+    if (remainingMs < DEEP_SLEEP_MIN_S * 1000UL) {
+        return false;
+    }
+    
+    // Anything still in RAM would be lost on wake
+    if (_outbound.hasPending(Network::MessageClass::ALERT) ||
+        _outbound.hasPending(Network::MessageClass::TELEMETRY) ||
+        _outbound.hasPending(Network::MessageClass::DIAGNOSTICS) ||
+        _logUploader.isActive()) {
+        return false;
+    }
+#if EVENT_ENABLED
+    if (_events.wantsFastSampling(millis())) {
+        return false;
+    }
+#endif
+    return true;
+}
+
+void SmartWasteApp::enterDeepSleep(uint32_t sleepMs) {
+    DEBUG_PRINTLN("[App] Entering deep sleep...");
+    
+    Drivers::UlpMonitorConfig ulp;
+    _powerHal.configureUlp(ulp);
+    _sensorHal.configureUlp(ulp);
+    
+#if AGG_ENABLED
+    // The open window continues after wake rather than being cut short
+    _aggregator.suspend(millis());
+#endif
+    
+    // Session is re-established after wake; the modem stays registered
+    _mqttService.disconnect();
+    _modemHal.prepareDeepSleep();
+    
+    _powerHal.enterDeepSleep(ulp, sleepMs);
 }
 
 void SmartWasteApp::handleError() {
     DEBUG_PRINTLN("[App] Handling error state...");
     
-    blinkLed(10, 50, 50); // Error indication
+    Drivers::LedDriver::play(Drivers::LedPattern::FAULT);
     
-    // Try to recover
-    if (!_modemHal.isReady()) {
+    // Try to recover (modem only matters while it carries the link)
+    if (_linkManager.getActiveLink() == Network::LinkType::CELLULAR && !_modemHal.isReady()) {
         DEBUG_PRINTLN("[App] Attempting modem recovery...");
         _modemHal.restart();
     }
     
-    if (!_gprsManager.isConnected()) {
+    if (!_linkManager.isConnected()) {
         DEBUG_PRINTLN("[App] Attempting network recovery...");
-        _gprsManager.connect(NETWORK_TIMEOUT_MS);
+        Drivers::LedDriver::play(Drivers::LedPattern::CONNECTING);
+        _linkManager.connect(NETWORK_TIMEOUT_MS);
+        Drivers::LedDriver::cancel(Drivers::LedPattern::CONNECTING);
     }
     
     if (!_mqttService.isConnected()) {
@@ -353,23 +706,12 @@ void SmartWasteApp::handleError() {
     }
     
     // If all recovered, go back to IDLE
-    if (_modemHal.isReady() && _gprsManager.isConnected()) {
+    if (_linkManager.isConnected()) {
         _state = AppState::IDLE;
         DEBUG_PRINTLN("[App] Recovery successful");
     } else {
-        // Wait before retry
-        delay(10000);
-    }
-}
-
-void SmartWasteApp::blinkLed(int times, int onMs, int offMs) {
-    for (int i = 0; i < times; i++) {
-        Drivers::GpioDriver::writeDigital(BOARD_LED_PIN, LED_ON);
-        delay(onMs);
-        Drivers::GpioDriver::writeDigital(BOARD_LED_PIN, LED_OFF);
-        if (i < times - 1 && offMs > 0) {
-            delay(offMs);
-        }
+        // Retry later; run() keeps the loop serviced meanwhile
+        _errorRetryAt = millis() + ERROR_RETRY_DELAY_MS;
     }
 }
 
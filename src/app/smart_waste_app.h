@@ -11,8 +11,15 @@
 #include "../hal/sensor_hal.h"
 #include "../hal/gps_hal.h"
 #include "../hal/power_hal.h"
-#include "../network/gprs_manager.h"
+#include "../network/link_manager.h"
 #include "../network/mqtt_service.h"
+#include "../network/outbound_queue.h"
+#include "../network/signal_monitor.h"
+#include "../network/log_uploader.h"
+#include "fill_forecaster.h"
+#include "provisioning.h"
+#include "window_aggregator.h"
+#include "event_detector.h"
 
 namespace App {
 
@@ -34,9 +41,12 @@ enum class AppState {
 struct SensorReadings {
     float distanceCm;
     int8_t fillLevel;
+    uint8_t sensorCount;  // Sensors in the array (0 = single sensor)
+    float sensorDistanceCm[Drivers::UltrasonicArrayDriver::MAX_SENSORS];
     float latitude;
     float longitude;
     int8_t batteryLevel;
+    int32_t etaFullMin;   // Forecast minutes to FILL_FULL_THRESHOLD (-1 = unknown)
     bool gpsValid;
     uint32_t timestamp;
 };
@@ -58,15 +68,21 @@ public:
      * @param sensorHal Reference to sensor HAL
      * @param gpsHal Reference to GPS HAL
      * @param powerHal Reference to power HAL
-     * @param gprsManager Reference to GPRS manager
+     * @param linkManager Reference to transport link manager
      * @param mqttService Reference to MQTT service
+     * @param outbound Reference to priority outbound queue
+     * @param signalMonitor Reference to link quality monitor
+     * @param logUploader Reference to remote log uploader
      */
     SmartWasteApp(HAL::ModemHAL& modemHal,
                   HAL::SensorHAL& sensorHal,
                   HAL::GpsHAL& gpsHal,
                   HAL::PowerHAL& powerHal,
-                  Network::GprsManager& gprsManager,
-                  Network::MqttService& mqttService);
+                  Network::LinkManager& linkManager,
+                  Network::MqttService& mqttService,
+                  Network::OutboundQueue& outbound,
+                  Network::SignalMonitor& signalMonitor,
+                  Network::LogUploader& logUploader);
 
     /**
      * @brief Initialize application
@@ -115,8 +131,11 @@ private:
     HAL::SensorHAL& _sensorHal;
     HAL::GpsHAL& _gpsHal;
     HAL::PowerHAL& _powerHal;
-    Network::GprsManager& _gprsManager;
+    Network::LinkManager& _linkManager;
     Network::MqttService& _mqttService;
+    Network::OutboundQueue& _outbound;
+    Network::SignalMonitor& _signalMonitor;
+    Network::LogUploader& _logUploader;
     
     // State
     AppState _state;
@@ -126,6 +145,18 @@ private:
     float _trashCanHeight;
     bool _initialized;
     bool _firstRun;  // Flag to trigger immediate first publish
+    bool _bootLogged;  // Deferred boot diagnostics done
+    bool _alertActive; // Alert condition already reported
+    uint32_t _lastMqttPoll;
+    uint32_t _lastPmStats;
+    uint32_t _lastQueueStats;
+    uint32_t _sleepMs;  // Deep sleep length chosen in IDLE
+    uint32_t _errorRetryAt;  // millis() of the next error recovery attempt
+    FillForecaster _forecaster;
+    Provisioning _provisioning;
+    WindowAggregator _aggregator;
+    EventDetector _events;
+    int16_t _utcOffsetMin;
 
     /**
      * @brief Initialize all hardware components
@@ -153,30 +184,104 @@ private:
     int8_t calculateFillLevel(float distanceCm);
 
     /**
-     * @brief Publish sensor data to MQTT
+     * @brief Set the system clock from the active link (modem NITZ or SNTP)
+     */
+    void syncClock();
+
+    /**
+     * @brief Retry the clock sync until the calendar time is valid
+     */
+    void retryClockSync();
+
+    /**
+     * @brief Get current time for the forecaster
+     * @param calendarValid Set to true if the result is local calendar time
+     * @return Local epoch seconds, or uptime seconds if the clock is not set
+     */
+    uint32_t localNow(bool& calendarValid);
+
+    /**
+     * @brief Feed readings to the forecaster, set ETA and next sample time
+     * @param readings Sensor readings (etaFullMin is filled in)
+     */
+    void updateForecast(SensorReadings& readings);
+
+    /**
+     * @brief Feed readings to the event detector, queue confirmed events
+     * @param readings Sensor readings
+     */
+    void detectEvents(const SensorReadings& readings);
+
+    /**
+     * @brief Aggregate readings; queue summaries and anomalous raw readings
      * @param readings Sensor readings to publish
-     * @return true if published successfully
+     * @return true if accepted (nothing failed to queue)
      */
     bool publishData(const SensorReadings& readings);
 
+    /**
+     * @brief Queue a raw reading for MQTT (alert class on threshold/sensor failure)
+     * @param readings Sensor readings to publish
+     * @return true if queued
+     */
+    bool queueReading(const SensorReadings& readings);
+
+    /**
+     * @brief Close the current window and queue its summary
+     * @param readings Latest readings (location and forecast)
+     * @return true if queued
+     */
+    bool queueSummary(const SensorReadings& readings);
+
+    /**
+     * @brief Check if readings are in the alert state (full or sensor failed)
+     * @param readings Sensor readings
+     * @return true if alerting
+     */
+    bool isAlert(const SensorReadings& readings);
+
+    /**
+     * @brief Send due queued messages and report queue statistics
+     */
+    void serviceOutbound();
+
+    /**
+     * @brief Service MQTT when the modem has data or the poll period elapsed
+     *
+     * Polling only on demand lets the CPU stay in light sleep while the
+     * UART is quiet; RX activity wakes it and is handled immediately.
+     */
+    void pollMqtt();
+
     /**
      * @brief Check if it's time to publish
      * @return true if publish interval elapsed
      */
     bool shouldPublish();
 
+    /**
+     * @brief Get the current sampling interval
+     * @return Interval in milliseconds (shortened around bin events)
+     */
+    uint32_t sampleInterval();
+
     /**
      * @brief Handle error state
      */
     void handleError();
 
     /**
-     * @brief Blink LED for status indication
-     * @param times Number of blinks
-     * @param onMs On duration in ms
-     * @param offMs Off duration in ms
+     * @brief Check if nothing held in RAM would be lost by a deep sleep
+     * @param remainingMs Time until the next sample
+     * @return true if deep sleep is allowed now
+     */
+    bool canDeepSleep(uint32_t remainingMs);
+
+    /**
+     * @brief Arm the ULP monitor and enter deep sleep (does not return)
+     * @param sleepMs Time until the next sample
      */
-    void blinkLed(int times, int onMs = 100, int offMs = 100);
+    void enterDeepSleep(uint32_t sleepMs);
 };
 
 } // namespace App
@@ -0,0 +1,184 @@
+/**
+ * @file window_aggregator.cpp
+ * @brief Window aggregator implementation
+ */
+
+#include "window_aggregator.h"
+#include "config.h"
+#include <esp_sleep.h>
+#include <sys/time.h>
+
+namespace App {
+
+namespace {
+
+constexpr uint32_t PARKED_MAGIC = 0x41475731; // "AGW1"
+
+/**
+ * @brief Open window, kept in RTC memory across deep sleep
+ */
+struct ParkedWindow {
+    uint32_t magic;
+    int64_t parkedAtMs;     // RTC wall clock at suspend (keeps counting in sleep)
+    uint32_t ageMs;         // Window age at suspend
+    uint16_t samples;
+    uint16_t invalid;
+    int8_t fillMin;
+    int8_t fillMax;
+    int8_t fillLast;
+    int8_t prevFill;
+    int8_t batteryLast;
+    float fillSum;
+    float sumT;
+    float sumTT;
+    float sumB;
+    float sumTB;
+};
+
+RTC_DATA_ATTR ParkedWindow s_parked;
+
+int64_t rtcNowMs() {
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return (int64_t)tv.tv_sec * 1000 + tv.tv_usec / 1000;
+}
+
+} // namespace
+
+WindowAggregator::WindowAggregator() : _prevFill(-1) {
+    reset(0);
+}
+
+bool WindowAggregator::add(int8_t fillLevel, int8_t batteryLevel, uint32_t nowMs) {
+    if (_samples == 0) {
+        _startMs = nowMs;
+    }
+    _samples++;
+
+    float t = (nowMs - _startMs) / 3600000.0f;
+    _sumT += t;
+    _sumTT += t * t;
+    _sumB += batteryLevel;
+    _sumTB += t * batteryLevel;
+    _batteryLast = batteryLevel;
+
+    if (fillLevel < 0) {
+        _invalid++;
+        return false;
+    }
+
+    if (_fillLast < 0 || fillLevel < _fillMin) _fillMin = fillLevel;
+    if (_fillLast < 0 || fillLevel > _fillMax) _fillMax = fillLevel;
+    _fillSum += fillLevel;
+    _fillLast = fillLevel;
+
+    bool anomaly = (_prevFill >= 0 && abs(fillLevel - _prevFill) >= AGG_ANOMALY_DELTA);
+    _prevFill = fillLevel;
+    return anomaly;
+}
+
+bool WindowAggregator::isComplete(uint32_t nowMs) const {
+    if (_samples == 0) {
+        return false;
+    }
+    return _samples >= AGG_WINDOW_SAMPLES || nowMs - _startMs >= AGG_WINDOW_MS;
+}
+
+bool WindowAggregator::close(Network::SummaryPayload& summary, uint32_t nowMs) {
+    if (_samples == 0) {
+        return false;
+    }
+
+    uint16_t valid = _samples - _invalid;
+    summary.windowSec = (nowMs - _startMs) / 1000;
+    summary.samples = _samples;
+    summary.invalid = _invalid;
+    summary.fillMin = valid ? _fillMin : -1;
+    summary.fillMax = valid ? _fillMax : -1;
+    summary.fillMean = valid ? _fillSum / valid : -1.0f;
+    summary.fillLast = _fillLast;
+    summary.batteryLast = _batteryLast;
+
+    // Slope = (n*Stb - St*Sb) / (n*Stt - St^2); flat if all samples share a time
+    float n = _samples;
+    float denom = n * _sumTT - _sumT * _sumT;
+    summary.batteryTrend = (denom > 1e-9f) ? (n * _sumTB - _sumT * _sumB) / denom : 0.0f;
+
+    reset(nowMs);
+    return true;
+}
+
+uint16_t WindowAggregator::getSampleCount() const {
+    return _samples;
+}
+
+void WindowAggregator::suspend(uint32_t nowMs) {
+    s_parked.magic = 0;
+    if (_samples == 0) {
+        return;
+    }
+
+    s_parked.parkedAtMs = rtcNowMs();
+    s_parked.ageMs = nowMs - _startMs;
+    s_parked.samples = _samples;
+    s_parked.invalid = _invalid;
+    s_parked.fillMin = _fillMin;
+    s_parked.fillMax = _fillMax;
+    s_parked.fillLast = _fillLast;
+    s_parked.prevFill = _prevFill;
+    s_parked.batteryLast = _batteryLast;
+    s_parked.fillSum = _fillSum;
+    s_parked.sumT = _sumT;
+    s_parked.sumTT = _sumTT;
+    s_parked.sumB = _sumB;
+    s_parked.sumTB = _sumTB;
+    s_parked.magic = PARKED_MAGIC;
+}
+
+bool WindowAggregator::resume(uint32_t nowMs) {
+    // RTC memory also survives a crash reset; only a deep sleep wake resumes
+    bool parked = s_parked.magic == PARKED_MAGIC &&
+                  esp_sleep_get_wakeup_cause() != ESP_SLEEP_WAKEUP_UNDEFINED;
+    s_parked.magic = 0;
+    if (!parked) {
+        return false;
+    }
+
+    // The RTC clock ran through the sleep; a clock set in between is not
+    // expected, but never let it make the window younger than it was
+    int64_t slept = rtcNowMs() - s_parked.parkedAtMs;
+    uint32_t ageMs = s_parked.ageMs + (uint32_t)(slept > 0 ? slept : 0);
+
+    // Unsigned arithmetic: nowMs - _startMs is the age even if this wraps
+    _startMs = nowMs - ageMs;
+    _samples = s_parked.samples;
+    _invalid = s_parked.invalid;
+    _fillMin = s_parked.fillMin;
+    _fillMax = s_parked.fillMax;
+    _fillLast = s_parked.fillLast;
+    _prevFill = s_parked.prevFill;
+    _batteryLast = s_parked.batteryLast;
+    _fillSum = s_parked.fillSum;
+    _sumT = s_parked.sumT;
+    _sumTT = s_parked.sumTT;
+    _sumB = s_parked.sumB;
+    _sumTB = s_parked.sumTB;
+    return true;
+}
+
+void WindowAggregator::reset(uint32_t nowMs) {
+    _startMs = nowMs;
+    _samples = 0;
+    _invalid = 0;
+    _fillMin = -1;
+    _fillMax = -1;
+    _fillLast = -1;
+    _fillSum = 0;
+    _batteryLast = -1;
+    _sumT = 0;
+    _sumTT = 0;
+    _sumB = 0;
+    _sumTB = 0;
+}
+
+} // namespace App
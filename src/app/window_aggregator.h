@@ -0,0 +1,104 @@
+/**
+ * @file window_aggregator.h
+ * @brief Window aggregator - per-window reading summaries
+ */
+
+#ifndef WINDOW_AGGREGATOR_H
+#define WINDOW_AGGREGATOR_H
+
+#include <Arduino.h>
+#include "../network/mqtt_service.h"
+
+namespace App {
+
+/**
+ * @brief Window aggregator
+ *
+ * Folds readings into running statistics for the current window: fill
+ * min/max/mean/last, sample and invalid-sample counts, and the battery
+ * trend as a least-squares slope. Memory is constant regardless of the
+ * window length; no samples are stored.
+ *
+ * A window closes after AGG_WINDOW_SAMPLES readings or AGG_WINDOW_MS,
+ * whichever comes first. An open window is parked in RTC memory over deep
+ * sleep (suspend()/resume()), so sleeping between readings does not cut
+ * windows short.
+ */
+class WindowAggregator {
+public:
+    /**
+     * @brief Constructor
+     */
+    WindowAggregator();
+
+    /**
+     * @brief Fold a reading into the current window
+     * @param fillLevel Fill level (-1 = invalid reading)
+     * @param batteryLevel Battery level (%)
+     * @param nowMs Current time in milliseconds
+     * @return true if the fill level jumped by AGG_ANOMALY_DELTA or more
+     *         since the previous valid reading
+     */
+    bool add(int8_t fillLevel, int8_t batteryLevel, uint32_t nowMs);
+
+    /**
+     * @brief Check if the current window is due to close
+     * @param nowMs Current time in milliseconds
+     * @return true if the window reached its sample count or duration
+     */
+    bool isComplete(uint32_t nowMs) const;
+
+    /**
+     * @brief Close the window and start the next one
+     * @param summary Output; statistics fields are filled in
+     * @param nowMs Current time in milliseconds
+     * @return false if the window held no readings
+     */
+    bool close(Network::SummaryPayload& summary, uint32_t nowMs);
+
+    /**
+     * @brief Get readings in the current window
+     * @return Sample count
+     */
+    uint16_t getSampleCount() const;
+
+    /**
+     * @brief Park the current window in RTC memory before deep sleep
+     * @param nowMs Current time in milliseconds
+     */
+    void suspend(uint32_t nowMs);
+
+    /**
+     * @brief Continue a window parked by suspend() before the last deep sleep
+     * @param nowMs Current time in milliseconds
+     * @return true if a window was restored
+     */
+    bool resume(uint32_t nowMs);
+
+private:
+    uint32_t _startMs;
+    uint16_t _samples;
+    uint16_t _invalid;
+    int8_t _fillMin;
+    int8_t _fillMax;
+    int8_t _fillLast;       // Last valid fill level (-1 = none this window)
+    int8_t _prevFill;       // Last valid fill level across windows (anomaly reference)
+    float _fillSum;
+    int8_t _batteryLast;
+
+    // Least-squares sums for the battery slope (t in hours from window start)
+    float _sumT;
+    float _sumTT;
+    float _sumB;
+    float _sumTB;
+
+    /**
+     * @brief Reset the running statistics
+     * @param nowMs Window start time
+     */
+    void reset(uint32_t nowMs);
+};
+
+} // namespace App
+
+#endif // WINDOW_AGGREGATOR_H
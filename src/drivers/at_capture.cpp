@@ -0,0 +1,331 @@
+/**
+ * @file at_capture.cpp
+ * @brief AT Capture implementation
+ */
+
+#define LOG_MODULE Drivers::LogModule::MODEM
+
+#include "at_capture.h"
+#include "config.h"
+#include <esp_timer.h>
+#include <esp_heap_caps.h>
+#include <freertos/FreeRTOS.h>
+
+namespace Drivers {
+
+namespace {
+
+constexpr uint8_t SLOT_DATA = 26;
+constexpr uint8_t RECORD_HEADER = 6;
+const uint8_t EXPORT_MAGIC[4] = { 'A', 'T', 'C', '1' };
+const char DIRECTION_CHARS[] = { '>', '<', '!' };
+
+/**
+ * @brief One capture record (32 bytes)
+ */
+struct Slot {
+    uint32_t us;            // Timestamp of the first byte
+    uint8_t direction;
+    uint8_t length;
+    uint8_t data[SLOT_DATA];
+};
+
+Slot* s_slots = NULL;
+uint16_t s_capacity = 0;
+uint16_t s_head = 0;                // Next slot to open
+uint16_t s_count = 0;
+uint32_t s_lastUs = 0;              // Last byte (or trigger) recorded
+bool s_open = false;                // Slot before s_head may still grow
+bool s_psram = false;
+
+bool s_triggered = false;
+bool s_frozen = false;
+bool s_exporting = false;           // Held while snapshot()/dump() read the ring
+uint16_t s_postSlots = 0;           // Records still kept after the trigger
+
+uint32_t s_bytes[2] = { 0, 0 };
+uint32_t s_dropped = 0;
+uint32_t s_triggers = 0;
+
+portMUX_TYPE s_mux = portMUX_INITIALIZER_UNLOCKED;
+
+/**
+ * @brief Open the next slot, counting down to the freeze after a trigger
+ * @return Slot to fill, or NULL once frozen
+ */
+Slot* openSlot(uint8_t direction, uint32_t us) {
+    if (s_triggered) {
+        if (s_postSlots == 0) {
+            s_frozen = true;
+            return NULL;
+        }
+        s_postSlots--;
+    }
+
+    Slot* slot = &s_slots[s_head];
+    slot->us = us;
+    slot->direction = direction;
+    slot->length = 0;
+    s_head = (s_head + 1) % s_capacity;
+    if (s_count < s_capacity) {
+        s_count++;
+    }
+    s_open = true;
+    return slot;
+}
+
+/**
+ * @brief Hold the ring for an export
+ * @param first Oldest slot index
+ * @return Number of slots to read
+ */
+uint16_t beginExport(uint16_t& first) {
+    portENTER_CRITICAL(&s_mux);
+    s_exporting = true;
+    s_open = false;
+    uint16_t count = s_count;
+    first = (s_head + s_capacity - count) % s_capacity;
+    portEXIT_CRITICAL(&s_mux);
+    return count;
+}
+
+} // namespace
+
+bool AtCapture::begin() {
+    if (s_slots) {
+        return true;
+    }
+
+    s_slots = (Slot*)heap_caps_malloc(AT_CAPTURE_SLOTS * sizeof(Slot), MALLOC_CAP_SPIRAM);
+    s_capacity = AT_CAPTURE_SLOTS;
+    s_psram = s_slots != NULL;
+    if (!s_slots) {
+        s_slots = (Slot*)heap_caps_malloc(AT_CAPTURE_SLOTS_SMALL * sizeof(Slot),
+                                          MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+        s_capacity = AT_CAPTURE_SLOTS_SMALL;
+    }
+    if (!s_slots) {
+        s_capacity = 0;
+        DEBUG_PRINTLN("[ATC] No memory for the capture ring");
+        return false;
+    }
+
+    DEBUG_PRINTF("[ATC] Capturing %u records in %s\n", s_capacity, s_psram ? "PSRAM" : "internal RAM");
+    return true;
+}
+
+void AtCapture::record(AtDirection direction, const uint8_t* data, size_t length) {
+    if (!s_slots || length == 0) {
+        return;
+    }
+
+    uint32_t now = (uint32_t)esp_timer_get_time();
+    uint8_t dir = (uint8_t)direction;
+
+    portENTER_CRITICAL(&s_mux);
+    if (s_frozen || s_exporting) {
+        s_dropped += length;
+        portEXIT_CRITICAL(&s_mux);
+        return;
+    }
+
+    s_bytes[dir] += length;
+    Slot* slot = NULL;
+    if (s_open) {
+        Slot* last = &s_slots[(s_head + s_capacity - 1) % s_capacity];
+        if (last->direction == dir && last->length < SLOT_DATA &&
+            now - s_lastUs < AT_CAPTURE_GAP_US) {
+            slot = last;
+        }
+    }
+
+    while (length > 0) {
+        if (!slot || slot->length == SLOT_DATA) {
+            slot = openSlot(dir, now);
+            if (!slot) {
+                s_dropped += length;
+                break;
+            }
+        }
+        uint8_t n = (length < (size_t)(SLOT_DATA - slot->length))
+            ? length : SLOT_DATA - slot->length;
+        memcpy(slot->data + slot->length, data, n);
+        slot->length += n;
+        data += n;
+        length -= n;
+    }
+    s_lastUs = now;
+    portEXIT_CRITICAL(&s_mux);
+}
+
+void AtCapture::trigger(const char* reason) {
+    if (!s_slots) {
+        return;
+    }
+
+    portENTER_CRITICAL(&s_mux);
+    s_triggers++;
+    bool first = !s_triggered && !s_exporting;
+    if (first) {
+        // The marker is the first post-trigger record
+        s_postSlots = AT_CAPTURE_POST_SLOTS + 1;
+        s_triggered = true;
+        Slot* slot = openSlot((uint8_t)AtDirection::MARK, (uint32_t)esp_timer_get_time());
+        if (slot) {
+            size_t n = strlen(reason);
+            slot->length = (n < SLOT_DATA) ? n : SLOT_DATA;
+            memcpy(slot->data, reason, slot->length);
+        }
+        s_open = false;
+        s_lastUs = (uint32_t)esp_timer_get_time();
+    }
+    portEXIT_CRITICAL(&s_mux);
+
+    if (first) {
+        DEBUG_PRINTF("[ATC] Triggered: %s\n", reason);
+    }
+}
+
+void AtCapture::arm() {
+    portENTER_CRITICAL(&s_mux);
+    s_triggered = false;
+    s_frozen = false;
+    s_exporting = false;
+    s_postSlots = 0;
+    portEXIT_CRITICAL(&s_mux);
+}
+
+bool AtCapture::isFrozen() {
+    // A link that went quiet after the trigger will not fill the post records
+    return s_frozen || (s_triggered &&
+        (uint32_t)esp_timer_get_time() - s_lastUs >= AT_CAPTURE_SETTLE_MS * 1000UL);
+}
+
+uint16_t AtCapture::snapshot(uint8_t* out, uint16_t size) {
+    if (!s_slots || size <= sizeof(EXPORT_MAGIC)) {
+        return 0;
+    }
+
+    uint16_t first;
+    uint16_t count = beginExport(first);
+
+    // Newest records that fit, written oldest first
+    uint32_t length = sizeof(EXPORT_MAGIC);
+    uint16_t skip = count;
+    while (skip > 0) {
+        const Slot& slot = s_slots[(first + skip - 1) % s_capacity];
+        if (length + RECORD_HEADER + slot.length > size) {
+            break;
+        }
+        length += RECORD_HEADER + slot.length;
+        skip--;
+    }
+
+    uint16_t n = 0;
+    if (skip < count) {
+        memcpy(out, EXPORT_MAGIC, sizeof(EXPORT_MAGIC));
+        n = sizeof(EXPORT_MAGIC);
+        for (uint16_t i = skip; i < count; i++) {
+            const Slot& slot = s_slots[(first + i) % s_capacity];
+            memcpy(out + n, &slot.us, 4);       // Little endian on the ESP32
+            out[n + 4] = slot.direction;
+            out[n + 5] = slot.length;
+            memcpy(out + n + RECORD_HEADER, slot.data, slot.length);
+            n += RECORD_HEADER + slot.length;
+        }
+    }
+
+    arm();
+    return n;
+}
+
+void AtCapture::dump(Print& out) {
+    if (!s_slots) {
+        return;
+    }
+
+    uint16_t first;
+    uint16_t count = beginExport(first);
+
+    // Bypass the deferred log so the lines are not cut or interleaved
+    LogDriver::flush();
+    out.printf("[ATC] Trace: %u records\n", count);
+    for (uint16_t i = 0; i < count; i++) {
+        const Slot& slot = s_slots[(first + i) % s_capacity];
+        char line[16 + SLOT_DATA * 2];
+        int n = snprintf(line, sizeof(line), "@%lu %c ", (unsigned long)slot.us,
+                         DIRECTION_CHARS[slot.direction]);
+        for (uint8_t j = 0; j < slot.length; j++) {
+            n += snprintf(line + n, sizeof(line) - n, "%02X", slot.data[j]);
+        }
+        out.println(line);
+    }
+    out.println("[ATC] End of trace");
+
+    arm();
+}
+
+bool AtCapture::dumpFrozen(Print& out) {
+    if (!isFrozen()) {
+        return false;
+    }
+    dump(out);
+    return true;
+}
+
+AtCaptureStats AtCapture::getStats() {
+    AtCaptureStats stats;
+    stats.slots = s_capacity;
+    stats.psram = s_psram;
+    stats.frozen = isFrozen();
+    stats.txBytes = s_bytes[(uint8_t)AtDirection::TX];
+    stats.rxBytes = s_bytes[(uint8_t)AtDirection::RX];
+    stats.dropped = s_dropped;
+    stats.triggers = s_triggers;
+    return stats;
+}
+
+void AtCapture::printStats() {
+    AtCaptureStats stats = getStats();
+    DEBUG_PRINTF("[ATC] %u/%u records%s, TX %lu B, RX %lu B, %lu dropped, %lu triggers\n",
+                 s_count, stats.slots, stats.frozen ? " (frozen)" : "",
+                 stats.txBytes, stats.rxBytes, stats.dropped, stats.triggers);
+}
+
+AtCaptureStream::AtCaptureStream(Stream& stream) : _stream(stream) {
+}
+
+int AtCaptureStream::available() {
+    return _stream.available();
+}
+
+int AtCaptureStream::read() {
+    int value = _stream.read();
+    if (value >= 0) {
+        uint8_t byte = (uint8_t)value;
+        AtCapture::record(AtDirection::RX, &byte, 1);
+    }
+    return value;
+}
+
+int AtCaptureStream::peek() {
+    return _stream.peek();
+}
+
+void AtCaptureStream::flush() {
+    _stream.flush();
+}
+
+size_t AtCaptureStream::write(uint8_t value) {
+    size_t n = _stream.write(value);
+    AtCapture::record(AtDirection::TX, &value, n);
+    return n;
+}
+
+size_t AtCaptureStream::write(const uint8_t* buffer, size_t size) {
+    size_t n = _stream.write(buffer, size);
+    AtCapture::record(AtDirection::TX, buffer, n);
+    return n;
+}
+
+} // namespace Drivers
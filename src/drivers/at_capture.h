@@ -0,0 +1,147 @@
+/**
+ * @file at_capture.h
+ * @brief AT Capture - timestamped modem UART traffic ring for post-mortem traces
+ */
+
+#ifndef AT_CAPTURE_H
+#define AT_CAPTURE_H
+
+#include <Arduino.h>
+
+namespace Drivers {
+
+/**
+ * @brief Record kinds in a capture
+ */
+enum class AtDirection : uint8_t {
+    TX,             // MCU to modem
+    RX,             // Modem to MCU
+    MARK            // Trigger marker (data is the reason)
+};
+
+/**
+ * @brief Capture statistics
+ */
+struct AtCaptureStats {
+    uint16_t slots;         // Ring capacity in records (0 = not allocated)
+    bool psram;             // Ring lives in PSRAM
+    bool frozen;            // Triggered capture complete
+    uint32_t txBytes;       // Bytes captured since boot
+    uint32_t rxBytes;
+    uint32_t dropped;       // Bytes passed through while frozen
+    uint32_t triggers;      // Triggers since boot (repeats while frozen included)
+};
+
+/**
+ * @brief AT traffic capture
+ *
+ * AtCaptureStream sits between TinyGSM and the modem UART and hands every
+ * byte to record(). Bytes are stored in fixed 32-byte records stamped with
+ * esp_timer microseconds; a byte continues the previous record while the
+ * direction is unchanged and it follows within AT_CAPTURE_GAP_US. Recording
+ * is a few stores under a spinlock, so link timing is left alone (unlike
+ * StreamDebugger, which echoes every byte to the debug port).
+ *
+ * The ring overwrites its oldest records until trigger() is called on an
+ * error. A marker record is written, AT_CAPTURE_POST_SLOTS more records are
+ * kept, and the ring then freezes so the traffic around the error survives
+ * until it is exported with snapshot() or dump(), which re-arm it. A link
+ * that stays quiet for AT_CAPTURE_SETTLE_MS after the trigger also counts
+ * as a complete capture.
+ *
+ * Export format (snapshot, little endian): "ATC1", then per record
+ * u32 timestamp (us), u8 direction, u8 length, data. The serial dump
+ * prints one "@<us> <dir> <hex>" line per record, dir being '>' (TX),
+ * '<' (RX) or '!' (marker). tools/at_replay.py reads both.
+ */
+class AtCapture {
+public:
+    /**
+     * @brief Allocate the ring (PSRAM first, a smaller internal ring otherwise)
+     * @return true if capturing
+     */
+    static bool begin();
+
+    /**
+     * @brief Record bytes passing the tap
+     * @param direction TX or RX
+     * @param data Bytes
+     * @param length Byte count
+     */
+    static void record(AtDirection direction, const uint8_t* data, size_t length);
+
+    /**
+     * @brief Mark an error and freeze the ring after the post-trigger records
+     * @param reason Short description (kept in the marker record)
+     */
+    static void trigger(const char* reason);
+
+    /**
+     * @brief Resume capturing after a freeze
+     */
+    static void arm();
+
+    /**
+     * @brief Check if a triggered capture is complete
+     * @return true if frozen, or quiet for AT_CAPTURE_SETTLE_MS after a trigger
+     */
+    static bool isFrozen();
+
+    /**
+     * @brief Serialize the most recent records (oldest first) and re-arm
+     * @param out Destination buffer
+     * @param size Destination size; older records are skipped if they do not fit
+     * @return Number of bytes written (0 if nothing was captured)
+     */
+    static uint16_t snapshot(uint8_t* out, uint16_t size);
+
+    /**
+     * @brief Print the whole ring as text lines and re-arm
+     * @param out Output (usually Serial)
+     */
+    static void dump(Print& out);
+
+    /**
+     * @brief Dump the ring once if a trigger froze it
+     * @param out Output (usually Serial)
+     * @return true if a trace was printed
+     */
+    static bool dumpFrozen(Print& out);
+
+    /**
+     * @brief Get statistics
+     * @return Statistics snapshot
+     */
+    static AtCaptureStats getStats();
+
+    /**
+     * @brief Log capture statistics
+     */
+    static void printStats();
+};
+
+/**
+ * @brief Stream tap recording all traffic through AtCapture
+ */
+class AtCaptureStream : public Stream {
+public:
+    /**
+     * @brief Constructor
+     * @param stream Underlying stream (the modem UART)
+     */
+    explicit AtCaptureStream(Stream& stream);
+
+    int available() override;
+    int read() override;
+    int peek() override;
+    void flush() override;
+    size_t write(uint8_t value) override;
+    size_t write(const uint8_t* buffer, size_t size) override;
+
+private:
+    Stream& _stream;
+};
+
+} // namespace Drivers
+
+#endif // AT_CAPTURE_H
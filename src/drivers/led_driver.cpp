@@ -0,0 +1,218 @@
+/**
+ * @file led_driver.cpp
+ * @brief LED Driver implementation
+ */
+
+#define LOG_MODULE Drivers::LogModule::GENERAL
+
+#include "led_driver.h"
+#include "pm_driver.h"
+#include "config.h"
+#include <esp_timer.h>
+#include <driver/ledc.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+
+namespace Drivers {
+
+namespace {
+
+constexpr ledc_mode_t MODE = LEDC_LOW_SPEED_MODE;
+constexpr ledc_channel_t CHANNEL = (ledc_channel_t)LED_LEDC_CHANNEL;
+constexpr ledc_timer_t TIMER = (ledc_timer_t)LED_LEDC_TIMER;
+constexpr uint32_t RESOLUTION_BITS = 14;
+constexpr uint32_t DUTY_FULL = 1UL << RESOLUTION_BITS;
+constexpr uint64_t REF_TICK_HZ = 1000000;
+
+/**
+ * @brief On/off cycle of a pattern
+ *
+ * With REF_TICK and 14-bit duty the period can be 17 ms to 16 s.
+ */
+struct PatternDef {
+    uint16_t onMs;
+    uint16_t offMs;
+    uint8_t cycles;     // 0 = repeat until replaced
+};
+
+const PatternDef PATTERNS[(uint8_t)LedPattern::COUNT] = {
+    {    0,   0,  0 },  // OFF
+    {  200, 200,  3 },  // READY
+    {  100, 100,  1 },  // SUCCESS
+    {   50,  50,  5 },  // ERROR
+    {   50,  50, 10 },  // FAULT
+    {  100, 900,  0 },  // CONNECTING
+    { 1000, 500,  2 },  // LOW_BATTERY
+};
+
+SemaphoreHandle_t s_mutex = NULL;
+esp_timer_handle_t s_timer = NULL;
+bool s_ready = false;
+bool s_idleOn = false;
+LedPattern s_current = LedPattern::OFF;
+int64_t s_endUs = 0;
+
+LedPattern s_queue[LED_QUEUE_DEPTH];
+uint8_t s_queued = 0;
+
+} // namespace
+
+bool LedDriver::begin(uint8_t pin, bool activeLow) {
+    if (s_ready) {
+        return true;
+    }
+
+    ledc_timer_config_t timerConfig = {};
+    timerConfig.speed_mode = MODE;
+    timerConfig.duty_resolution = (ledc_timer_bit_t)RESOLUTION_BITS;
+    timerConfig.timer_num = TIMER;
+    timerConfig.freq_hz = 1;
+    timerConfig.clk_cfg = LEDC_USE_REF_TICK;
+    if (ledc_timer_config(&timerConfig) != ESP_OK) {
+        DEBUG_PRINTLN("[LED] LEDC timer config failed");
+        return false;
+    }
+
+    // Polarity is handled in the GPIO matrix, so duty and idle level mean "lit"
+    ledc_channel_config_t channelConfig = {};
+    channelConfig.gpio_num = pin;
+    channelConfig.speed_mode = MODE;
+    channelConfig.channel = CHANNEL;
+    channelConfig.intr_type = LEDC_INTR_DISABLE;
+    channelConfig.timer_sel = TIMER;
+    channelConfig.duty = 0;
+    channelConfig.hpoint = 0;
+    channelConfig.flags.output_invert = activeLow ? 1 : 0;
+    if (ledc_channel_config(&channelConfig) != ESP_OK) {
+        DEBUG_PRINTLN("[LED] LEDC channel config failed");
+        return false;
+    }
+
+    esp_timer_create_args_t timerArgs = {};
+    timerArgs.callback = &LedDriver::onTimer;
+    timerArgs.name = "led";
+    s_mutex = xSemaphoreCreateMutex();
+    if (!s_mutex || esp_timer_create(&timerArgs, &s_timer) != ESP_OK) {
+        DEBUG_PRINTLN("[LED] Pattern timer not created");
+        return false;
+    }
+
+    ledc_stop(MODE, CHANNEL, s_idleOn ? 1 : 0);
+    s_ready = true;
+    return true;
+}
+
+void LedDriver::play(LedPattern pattern) {
+    if (!s_ready || pattern == LedPattern::OFF) {
+        return;
+    }
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+
+    if (s_current == LedPattern::OFF ||
+        (PATTERNS[(uint8_t)s_current].cycles == 0 && s_current != pattern)) {
+        start(pattern);
+    } else if (s_current != pattern || s_queued > 0) {
+        // Repeated requests collapse into one
+        bool duplicate = s_queued > 0 && s_queue[s_queued - 1] == pattern;
+        if (!duplicate && s_queued < LED_QUEUE_DEPTH) {
+            s_queue[s_queued++] = pattern;
+        }
+    }
+
+    xSemaphoreGive(s_mutex);
+}
+
+void LedDriver::cancel(LedPattern pattern) {
+    if (!s_ready) {
+        return;
+    }
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+
+    uint8_t kept = 0;
+    for (uint8_t i = 0; i < s_queued; i++) {
+        if (s_queue[i] != pattern) {
+            s_queue[kept++] = s_queue[i];
+        }
+    }
+    s_queued = kept;
+
+    if (s_current == pattern) {
+        esp_timer_stop(s_timer);
+        next();
+    }
+
+    xSemaphoreGive(s_mutex);
+}
+
+void LedDriver::setIdle(bool on) {
+    if (!s_ready) {
+        s_idleOn = on;
+        return;
+    }
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+
+    s_idleOn = on;
+    if (s_current == LedPattern::OFF) {
+        ledc_stop(MODE, CHANNEL, on ? 1 : 0);
+    }
+
+    xSemaphoreGive(s_mutex);
+}
+
+LedPattern LedDriver::current() {
+    return s_current;
+}
+
+void LedDriver::onTimer(void* arg) {
+    (void)arg;
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+
+    // Ignore a late expiry that raced with cancel() and a newer pattern
+    if (s_current != LedPattern::OFF && esp_timer_get_time() >= s_endUs) {
+        next();
+    }
+
+    xSemaphoreGive(s_mutex);
+}
+
+void LedDriver::start(LedPattern pattern) {
+    const PatternDef& def = PATTERNS[(uint8_t)pattern];
+    uint32_t periodMs = def.onMs + def.offMs;
+
+    // LEDC divider is 10.8 fixed point: REF_TICK / (cycle rate x 2^bits)
+    uint32_t divider = (uint32_t)(REF_TICK_HZ * periodMs * 256 / 1000 / DUTY_FULL);
+    ledc_timer_set(MODE, TIMER, divider, RESOLUTION_BITS, LEDC_REF_TICK);
+    ledc_set_duty(MODE, CHANNEL, DUTY_FULL * def.onMs / periodMs);
+    ledc_update_duty(MODE, CHANNEL);
+    ledc_timer_rst(MODE, TIMER);    // Start on a whole on phase
+
+    if (s_current == LedPattern::OFF) {
+        PmDriver::acquire(PmLockId::LED);
+    }
+    s_current = pattern;
+
+    if (def.cycles > 0) {
+        // Stop half way through the last off phase, clear of another on phase
+        uint64_t durationUs = ((uint64_t)def.cycles * periodMs - def.offMs / 2) * 1000;
+        s_endUs = esp_timer_get_time() + durationUs;
+        esp_timer_start_once(s_timer, durationUs);
+    }
+}
+
+void LedDriver::next() {
+    if (s_queued > 0) {
+        LedPattern pattern = s_queue[0];
+        s_queued--;
+        memmove(s_queue, s_queue + 1, s_queued * sizeof(s_queue[0]));
+        start(pattern);
+        return;
+    }
+
+    ledc_stop(MODE, CHANNEL, s_idleOn ? 1 : 0);
+    if (s_current != LedPattern::OFF) {
+        PmDriver::release(PmLockId::LED);
+    }
+    s_current = LedPattern::OFF;
+}
+
+} // namespace Drivers
@@ -0,0 +1,80 @@
+/**
+ * @file led_driver.h
+ * @brief LED Driver - hardware-timed status patterns on the board LED
+ */
+
+#ifndef LED_DRIVER_H
+#define LED_DRIVER_H
+
+#include <Arduino.h>
+
+namespace Drivers {
+
+/**
+ * @brief Status patterns
+ */
+enum class LedPattern : uint8_t {
+    OFF,            // Nothing playing (steady idle level)
+    READY,          // Initialization complete
+    SUCCESS,        // Message delivered
+    ERROR,          // Queueing / publish failure
+    FAULT,          // Application error state
+    CONNECTING,     // Link being brought up (repeats until replaced)
+    LOW_BATTERY,    // Battery below LED_LOW_BATTERY_PERCENT
+    COUNT
+};
+
+/**
+ * @brief LED Driver class
+ *
+ * Each pattern is a number of on/off cycles. A cycle is generated by an
+ * LEDC channel (period and duty from the pattern) clocked from REF_TICK,
+ * so blinking needs no CPU time and does not follow DFS clock changes.
+ * A one-shot esp_timer ends a finite pattern and starts the next queued
+ * one; a repeating pattern plays until another pattern is requested.
+ * While a pattern plays the LED PM lock keeps the chip out of light sleep.
+ * Callers never wait.
+ */
+class LedDriver {
+public:
+    /**
+     * @brief Route the LED pin to LEDC and create the pattern timer
+     * @param pin GPIO pin number
+     * @param activeLow True if the LED lights with the pin LOW
+     * @return true if initialized
+     */
+    static bool begin(uint8_t pin, bool activeLow);
+
+    /**
+     * @brief Queue a pattern (replaces a repeating pattern immediately)
+     * @param pattern Pattern to play
+     */
+    static void play(LedPattern pattern);
+
+    /**
+     * @brief End a pattern if it is playing or queued
+     * @param pattern Pattern to cancel
+     */
+    static void cancel(LedPattern pattern);
+
+    /**
+     * @brief Set the level shown when no pattern is playing
+     * @param on True to keep the LED lit (e.g. modem powered)
+     */
+    static void setIdle(bool on);
+
+    /**
+     * @brief Get the pattern currently playing
+     * @return Current pattern (OFF if idle)
+     */
+    static LedPattern current();
+
+private:
+    static void onTimer(void* arg);
+    static void start(LedPattern pattern);
+    static void next();
+};
+
+} // namespace Drivers
+
+#endif // LED_DRIVER_H
@@ -0,0 +1,409 @@
+/**
+ * @file log_driver.cpp
+ * @brief Log Driver implementation
+ */
+
+#include "log_driver.h"
+#include "pm_driver.h"
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <atomic>
+
+namespace Drivers {
+
+static_assert((LOG_BUFFER_SIZE & (LOG_BUFFER_SIZE - 1)) == 0, "LOG_BUFFER_SIZE must be a power of two");
+static_assert(LOG_RECORD_MAX_SIZE % 4 == 0 && LOG_RECORD_MAX_SIZE <= LOG_BUFFER_SIZE / 4,
+              "LOG_RECORD_MAX_SIZE must be a multiple of 4 and fit the ring several times");
+
+uint8_t LogDriver::_levels[(uint8_t)LogModule::COUNT] = {};
+
+namespace {
+
+constexpr uint32_t RING_MASK = LOG_BUFFER_SIZE - 1;
+constexpr uint8_t LEVEL_MASK = 0x0F;
+constexpr uint8_t LEVEL_PAD = 0x0F;         // Filler record up to the ring end
+constexpr uint8_t FLAG_TRUNCATED = 0x80;
+
+// Records are 4-byte aligned. The first word of each holds size, level and
+// module; it is written last, so a zero word marks a reserved slot whose
+// producer has not finished yet. The consumer zeroes slots it releases.
+alignas(4) uint8_t s_ring[LOG_BUFFER_SIZE];
+std::atomic<uint32_t> s_head(0);            // Free-running reserve position
+std::atomic<uint32_t> s_tail(0);            // Free-running consume position
+std::atomic<uint32_t> s_written(0);
+std::atomic<uint32_t> s_dropped(0);
+std::atomic<uint32_t> s_truncated(0);
+std::atomic<bool> s_wakePending(false);
+std::atomic_flag s_draining = ATOMIC_FLAG_INIT;
+uint16_t s_highWater = 0;                   // Racy by design, statistics only
+
+Print* s_out = NULL;
+TaskHandle_t s_task = NULL;
+uint32_t s_droppedReported = 0;
+bool s_lineStart = true;
+
+// Formatted output history, overwritten oldest first
+uint8_t s_history[LOG_HISTORY_SIZE];
+uint16_t s_historyHead = 0;                 // Next write position
+uint16_t s_historyLength = 0;
+portMUX_TYPE s_historyMux = portMUX_INITIALIZER_UNLOCKED;
+
+/**
+ * @brief Append formatted output to the history ring
+ */
+void appendHistory(const char* text, size_t length) {
+    if (length > LOG_HISTORY_SIZE) {
+        text += length - LOG_HISTORY_SIZE;
+        length = LOG_HISTORY_SIZE;
+    }
+
+    portENTER_CRITICAL(&s_historyMux);
+    size_t first = LOG_HISTORY_SIZE - s_historyHead;
+    if (first > length) {
+        first = length;
+    }
+    memcpy(s_history + s_historyHead, text, first);
+    memcpy(s_history, text + first, length - first);
+    s_historyHead = (s_historyHead + length) % LOG_HISTORY_SIZE;
+    s_historyLength = (s_historyLength + length > LOG_HISTORY_SIZE)
+        ? LOG_HISTORY_SIZE : s_historyLength + length;
+    portEXIT_CRITICAL(&s_historyMux);
+}
+
+struct Value {
+    uint8_t type;
+    int64_t i;
+    uint64_t u;
+    double d;
+    const char* s;
+};
+
+/**
+ * @brief Read the next captured argument
+ * @return false if no arguments remain
+ */
+bool nextArg(const uint8_t* args, uint16_t length, uint16_t& pos, Value& v) {
+    if (pos >= length) {
+        return false;
+    }
+    v.type = args[pos++];
+    v.s = NULL;
+    switch (v.type) {
+        case LogArgs::I32: { int32_t x; memcpy(&x, args + pos, 4); pos += 4; v.i = x; v.u = (uint32_t)x; v.d = x; break; }
+        case LogArgs::U32: { uint32_t x; memcpy(&x, args + pos, 4); pos += 4; v.i = x; v.u = x; v.d = x; break; }
+        case LogArgs::I64: { int64_t x; memcpy(&x, args + pos, 8); pos += 8; v.i = x; v.u = (uint64_t)x; v.d = (double)x; break; }
+        case LogArgs::U64:
+        case LogArgs::PTR: { uint64_t x; memcpy(&x, args + pos, 8); pos += 8; v.i = (int64_t)x; v.u = x; v.d = (double)x; break; }
+        case LogArgs::F64: { double x; memcpy(&x, args + pos, 8); pos += 8; v.i = (int64_t)x; v.u = (uint64_t)x; v.d = x; break; }
+        case LogArgs::STR: {
+            v.s = (const char*)(args + pos);
+            pos += strnlen(v.s, length - pos) + 1;
+            v.i = 0; v.u = 0; v.d = 0;
+            break;
+        }
+        default:
+            pos = length;
+            return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Format a message from its format string and captured arguments
+ *
+ * Each conversion is handed to snprintf on its own with the length
+ * modifier replaced to match the captured value, so "%lu" works the same
+ * whether the argument was captured as 32 or 64 bit.
+ */
+size_t formatMessage(const char* format, const uint8_t* args, uint16_t length, char* out, size_t size) {
+    size_t n = 0;
+    uint16_t pos = 0;
+    const char* p = format;
+
+    while (*p && n + 1 < size) {
+        if (*p != '%') {
+            out[n++] = *p++;
+            continue;
+        }
+        if (p[1] == '%') {
+            out[n++] = '%';
+            p += 2;
+            continue;
+        }
+
+        // Flags, width and precision are kept; length modifiers are dropped
+        char spec[16];
+        uint8_t s = 0;
+        spec[s++] = *p++;
+        while (*p && strchr("-+ #0123456789.hlLzjt", *p)) {
+            if (!strchr("hlLzjt", *p) && s < sizeof(spec) - 4) {
+                spec[s++] = *p;
+            }
+            p++;
+        }
+        if (!*p) {
+            break;
+        }
+        char conv = *p++;
+
+        Value v;
+        if (!nextArg(args, length, pos, v)) {
+            n += snprintf(out + n, size - n, "<?>");
+            continue;
+        }
+
+        int written;
+        switch (conv) {
+            case 'd': case 'i':
+                spec[s++] = 'l'; spec[s++] = 'l'; spec[s++] = conv; spec[s] = 0;
+                written = snprintf(out + n, size - n, spec, (long long)v.i);
+                break;
+            case 'u': case 'x': case 'X': case 'o':
+                spec[s++] = 'l'; spec[s++] = 'l'; spec[s++] = conv; spec[s] = 0;
+                written = snprintf(out + n, size - n, spec, (unsigned long long)v.u);
+                break;
+            case 'c':
+                spec[s++] = conv; spec[s] = 0;
+                written = snprintf(out + n, size - n, spec, (int)v.i);
+                break;
+            case 'f': case 'F': case 'e': case 'E': case 'g': case 'G': case 'a': case 'A':
+                spec[s++] = conv; spec[s] = 0;
+                written = snprintf(out + n, size - n, spec, v.d);
+                break;
+            case 's':
+                spec[s++] = conv; spec[s] = 0;
+                written = snprintf(out + n, size - n, spec, v.s ? v.s : "<?>");
+                break;
+            case 'p':
+                written = snprintf(out + n, size - n, "%p", (void*)(uintptr_t)v.u);
+                break;
+            default:
+                written = 0;
+                break;
+        }
+        if (written > 0) {
+            n += written;
+        }
+    }
+
+    if (n >= size) {
+        n = size - 1;
+    }
+    out[n] = '\0';
+    return n;
+}
+
+/**
+ * @brief Format one record as a line and write it to the sink
+ */
+void emit(const uint8_t* record, uint16_t size, uint8_t flags) {
+    static const char levelChars[] = "?EWIDV";
+    char line[LOG_LINE_MAX_SIZE];
+    size_t n = 0;
+
+    uint32_t timestamp;
+    const char* format;
+    memcpy(&timestamp, record + 4, 4);
+    memcpy(&format, record + 8, sizeof(format));
+
+    if (s_lineStart) {
+        uint8_t level = flags & LEVEL_MASK;
+        n = snprintf(line, sizeof(line), "%6lu.%03lu %c ",
+                     (unsigned long)(timestamp / 1000), (unsigned long)(timestamp % 1000),
+                     level < sizeof(levelChars) - 1 ? levelChars[level] : '?');
+    }
+
+    uint16_t header = 8 + sizeof(format);
+    n += formatMessage(format, record + header, size - header, line + n, sizeof(line) - n);
+
+    // A line cut short by the line buffer still ends the line
+    size_t formatLength = strlen(format);
+    if (n == sizeof(line) - 1 && formatLength > 0 && format[formatLength - 1] == '\n') {
+        line[n - 1] = '\n';
+    }
+    s_lineStart = (n > 0 && line[n - 1] == '\n');
+    s_out->write((const uint8_t*)line, n);
+    appendHistory(line, n);
+}
+
+} // namespace
+
+void LogArgs::addString(const char* s) {
+    if (s == NULL) {
+        s = "(null)";
+    }
+    if (_pos + 2 > _capacity) {
+        _truncated = true;
+        _pos = _capacity;
+        return;
+    }
+    _buffer[_pos++] = STR;
+    uint16_t room = _capacity - _pos - 1;
+    size_t len = strnlen(s, room);
+    if (len == room && s[len] != '\0') {
+        _truncated = true;
+    }
+    memcpy(_buffer + _pos, s, len);
+    _pos += len;
+    _buffer[_pos++] = '\0';
+}
+
+bool LogDriver::begin(Print& out) {
+    s_out = &out;
+    s_lineStart = true;
+
+#if LOG_DEFERRED
+    if (s_task == NULL &&
+        xTaskCreate(drainTask, "log", LOG_DRAIN_TASK_STACK, NULL,
+                    LOG_DRAIN_TASK_PRIORITY, &s_task) != pdPASS) {
+        s_task = NULL;
+        return false;
+    }
+#endif
+    return true;
+}
+
+uint16_t LogDriver::flush() {
+    return drain(UINT16_MAX);
+}
+
+LogStats LogDriver::getStats() {
+    LogStats stats;
+    stats.written = s_written.load(std::memory_order_relaxed);
+    stats.dropped = s_dropped.load(std::memory_order_relaxed);
+    stats.truncated = s_truncated.load(std::memory_order_relaxed);
+    stats.highWater = s_highWater;
+    return stats;
+}
+
+void LogDriver::setLevel(LogModule module, LogLevel level) {
+    if ((uint8_t)module < (uint8_t)LogModule::COUNT) {
+        _levels[(uint8_t)module] = (uint8_t)level;
+    }
+}
+
+uint16_t LogDriver::snapshot(uint8_t* out, uint16_t size) {
+    portENTER_CRITICAL(&s_historyMux);
+    uint16_t length = (s_historyLength < size) ? s_historyLength : size;
+    uint16_t start = (s_historyHead + LOG_HISTORY_SIZE - length) % LOG_HISTORY_SIZE;
+    uint16_t first = LOG_HISTORY_SIZE - start;
+    if (first > length) {
+        first = length;
+    }
+    memcpy(out, s_history + start, first);
+    memcpy(out + first, s_history, length - first);
+    portEXIT_CRITICAL(&s_historyMux);
+    return length;
+}
+
+void LogDriver::commit(uint8_t* record, uint16_t length, bool truncated,
+                       LogLevel level, LogModule module, const char* format) {
+    uint32_t size = (length + 3) & ~3u;
+    uint32_t timestamp = millis();
+    memcpy(record + 4, &timestamp, 4);
+    memcpy(record + 8, &format, sizeof(format));
+
+    // Reserve the slot, plus filler if it would straddle the ring end
+    uint32_t head = s_head.load(std::memory_order_relaxed);
+    uint32_t pad;
+    uint32_t used;
+    do {
+        uint32_t contiguous = LOG_BUFFER_SIZE - (head & RING_MASK);
+        pad = (contiguous < size) ? contiguous : 0;
+        used = head + pad + size - s_tail.load(std::memory_order_acquire);
+        if (used > LOG_BUFFER_SIZE) {
+            s_dropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+    } while (!s_head.compare_exchange_weak(head, head + pad + size, std::memory_order_relaxed));
+
+    if (pad) {
+        uint32_t word = pad | ((uint32_t)LEVEL_PAD << 16);
+        __atomic_store_n((uint32_t*)(s_ring + (head & RING_MASK)), word, __ATOMIC_RELEASE);
+        head += pad;
+    }
+
+    uint8_t* slot = s_ring + (head & RING_MASK);
+    memcpy(slot + 4, record + 4, size - 4);
+    uint8_t flags = (uint8_t)level | (truncated ? FLAG_TRUNCATED : 0);
+    uint32_t word = size | ((uint32_t)flags << 16) | ((uint32_t)module << 24);
+    __atomic_store_n((uint32_t*)slot, word, __ATOMIC_RELEASE);
+
+    s_written.fetch_add(1, std::memory_order_relaxed);
+    if (truncated) {
+        s_truncated.fetch_add(1, std::memory_order_relaxed);
+    }
+    if (used > s_highWater) {
+        s_highWater = used;
+    }
+
+    // The drain task polls; only wake it early when the ring fills up
+    if (used >= LOG_BUFFER_SIZE / 2 && s_task != NULL &&
+        !s_wakePending.exchange(true, std::memory_order_relaxed)) {
+        xTaskNotifyGive(s_task);
+    }
+}
+
+uint16_t LogDriver::drain(uint16_t maxRecords) {
+    if (s_out == NULL || s_draining.test_and_set(std::memory_order_acquire)) {
+        return 0;
+    }
+
+    uint32_t tail = s_tail.load(std::memory_order_relaxed);
+    if (tail == s_head.load(std::memory_order_acquire)) {
+        s_draining.clear(std::memory_order_release);
+        return 0;
+    }
+
+    // Keep the APB clock (and so the UART baud rate) stable while writing
+    PmLockGuard txLock(PmLockId::LOG_TX);
+
+    uint32_t dropped = s_dropped.load(std::memory_order_relaxed);
+    if (dropped != s_droppedReported) {
+        char line[48];
+        int n = snprintf(line, sizeof(line), "[Log] %lu record(s) dropped\n",
+                         (unsigned long)(dropped - s_droppedReported));
+        s_out->write((const uint8_t*)line, n);
+        appendHistory(line, n);
+        s_droppedReported = dropped;
+    }
+
+    uint16_t count = 0;
+    uint8_t record[LOG_RECORD_MAX_SIZE];
+    while (count < maxRecords && tail != s_head.load(std::memory_order_acquire)) {
+        uint8_t* slot = s_ring + (tail & RING_MASK);
+        uint32_t word = __atomic_load_n((uint32_t*)slot, __ATOMIC_ACQUIRE);
+        if (word == 0) {
+            break;  // Producer still copying
+        }
+
+        uint16_t size = word & 0xFFFF;
+        uint8_t flags = (word >> 16) & 0xFF;
+        bool pad = (flags & LEVEL_MASK) == LEVEL_PAD;
+        if (!pad) {
+            memcpy(record, slot, size);
+        }
+        memset(slot, 0, size);
+        tail += size;
+        s_tail.store(tail, std::memory_order_release);
+
+        if (!pad) {
+            emit(record, size, flags);
+            count++;
+        }
+    }
+
+    s_draining.clear(std::memory_order_release);
+    return count;
+}
+
+void LogDriver::drainTask(void* param) {
+    (void)param;
+    for (;;) {
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(LOG_DRAIN_PERIOD_MS));
+        s_wakePending.store(false, std::memory_order_relaxed);
+        drain(UINT16_MAX);
+    }
+}
+
+} // namespace Drivers
@@ -0,0 +1,247 @@
+/**
+ * @file log_driver.h
+ * @brief Log Driver - deferred binary logging into a lock-free ring buffer
+ */
+
+#ifndef LOG_DRIVER_H
+#define LOG_DRIVER_H
+
+#include <Arduino.h>
+#include "config.h"
+
+namespace Drivers {
+
+/**
+ * @brief Log severity, ordered from most to least severe
+ */
+enum class LogLevel : uint8_t {
+    ERROR = LOG_LEVEL_ERROR,
+    WARN = LOG_LEVEL_WARN,
+    INFO = LOG_LEVEL_INFO,
+    DEBUG = LOG_LEVEL_DEBUG,
+    VERBOSE = LOG_LEVEL_VERBOSE
+};
+
+/**
+ * @brief Firmware module that produced a record
+ *
+ * Each source file selects its tag by defining LOG_MODULE before its
+ * first include; files that do not are logged as GENERAL.
+ */
+enum class LogModule : uint8_t {
+    GENERAL,
+    APP,
+    SENSOR,
+    GPS,
+    MODEM,
+    POWER,
+    LINK,
+    MQTT,
+    COUNT
+};
+
+/**
+ * @brief Log ring statistics
+ */
+struct LogStats {
+    uint32_t written;       // Records committed to the ring
+    uint32_t dropped;       // Records lost because the ring was full
+    uint32_t truncated;     // Records whose arguments did not fit
+    uint16_t highWater;     // Peak ring usage in bytes
+};
+
+/**
+ * @brief Captures log arguments as tagged raw values
+ *
+ * Overloads cover the fundamental types so the capture path never touches
+ * the format string; the drain side matches values to conversions.
+ */
+class LogArgs {
+public:
+    enum Type : uint8_t { I32, U32, I64, U64, F64, STR, PTR };
+
+    LogArgs(uint8_t* buffer, uint16_t start, uint16_t capacity)
+        : _buffer(buffer), _pos(start), _capacity(capacity), _truncated(false) {}
+
+    void add(bool v) { put(U32, (uint32_t)v); }
+    void add(char v) { put(I32, (int32_t)v); }
+    void add(signed char v) { put(I32, (int32_t)v); }
+    void add(unsigned char v) { put(U32, (uint32_t)v); }
+    void add(short v) { put(I32, (int32_t)v); }
+    void add(unsigned short v) { put(U32, (uint32_t)v); }
+    void add(int v) { put(I32, (int32_t)v); }
+    void add(unsigned int v) { put(U32, (uint32_t)v); }
+    void add(long v) { addWide(v); }
+    void add(unsigned long v) { addWide(v); }
+    void add(long long v) { put(I64, v); }
+    void add(unsigned long long v) { put(U64, v); }
+    void add(float v) { put(F64, (double)v); }
+    void add(double v) { put(F64, v); }
+    void add(const char* v) { addString(v); }
+    void add(const String& v) { addString(v.c_str()); }
+    void add(const void* v) { put(PTR, (uint64_t)(uintptr_t)v); }
+
+    uint16_t length() const { return _pos; }
+    bool truncated() const { return _truncated; }
+
+private:
+    uint8_t* _buffer;
+    uint16_t _pos;
+    uint16_t _capacity;
+    bool _truncated;
+
+    template <typename T>
+    void put(Type type, T value) {
+        if (_pos + 1 + sizeof(T) > _capacity) {
+            _truncated = true;
+            _pos = _capacity;   // Later arguments are dropped too
+            return;
+        }
+        _buffer[_pos++] = type;
+        memcpy(_buffer + _pos, &value, sizeof(T));
+        _pos += sizeof(T);
+    }
+
+    // long is 32 bit on the ESP32 but 64 bit on host builds
+    void addWide(long v) {
+        if (sizeof(long) > 4) put(I64, (int64_t)v); else put(I32, (int32_t)v);
+    }
+    void addWide(unsigned long v) {
+        if (sizeof(long) > 4) put(U64, (uint64_t)v); else put(U32, (uint32_t)v);
+    }
+
+    void addString(const char* s);
+};
+
+/**
+ * @brief Log Driver class
+ *
+ * Log calls store the format string pointer (the string itself stays in
+ * flash) plus the raw argument values in a fixed ring; no formatting or
+ * UART I/O happens on the caller's path. Producers reserve space with a
+ * single compare-and-swap, so any task may log without taking a lock.
+ * A low-priority drain task formats the records and writes them to the
+ * sink, or flush() does it on demand. The last LOG_HISTORY_SIZE bytes of
+ * formatted output are kept for remote retrieval.
+ */
+class LogDriver {
+public:
+    /**
+     * @brief Set the output sink and start the drain task
+     * @param out Sink for formatted lines (usually Serial)
+     * @return true if the drain task is running
+     */
+    static bool begin(Print& out);
+
+    /**
+     * @brief Format and write all pending records from the calling task
+     * @return Number of records written
+     */
+    static uint16_t flush();
+
+    /**
+     * @brief Get ring statistics
+     * @return Statistics snapshot
+     */
+    static LogStats getStats();
+
+    /**
+     * @brief Lower the level of one module at runtime
+     * @param module Module to filter
+     * @param level Most verbose level still recorded (LOG_LEVEL still applies)
+     */
+    static void setLevel(LogModule module, LogLevel level);
+
+    /**
+     * @brief Copy the most recent printed output (oldest byte first)
+     * @param out Destination buffer
+     * @param size Destination size; older output is skipped if it does not fit
+     * @return Number of bytes copied
+     */
+    static uint16_t snapshot(uint8_t* out, uint16_t size);
+
+    /**
+     * @brief Capture a log call (use the LOG_* macros)
+     * @param level Record severity
+     * @param module Source module
+     * @param format printf-style format string with static storage
+     * @param args Arguments for the format conversions
+     */
+    template <typename... Args>
+    static void write(LogLevel level, LogModule module, const char* format, const Args&... args) {
+        uint8_t limit = _levels[(uint8_t)module];
+        if (limit != 0 && (uint8_t)level > limit) {
+            return;
+        }
+        uint8_t record[LOG_RECORD_MAX_SIZE];
+        LogArgs capture(record, HEADER_SIZE, LOG_RECORD_MAX_SIZE);
+        addAll(capture, args...);
+        commit(record, capture.length(), capture.truncated(), level, module, format);
+    }
+
+private:
+    // Commit word (size, level, module), timestamp, format pointer
+    static constexpr uint16_t HEADER_SIZE = 4 + 4 + sizeof(const char*);
+
+    static uint8_t _levels[(uint8_t)LogModule::COUNT];  // 0 = LOG_LEVEL only
+
+    static void addAll(LogArgs&) {}
+
+    template <typename T, typename... Rest>
+    static void addAll(LogArgs& capture, const T& first, const Rest&... rest) {
+        capture.add(first);
+        addAll(capture, rest...);
+    }
+
+    static void commit(uint8_t* record, uint16_t length, bool truncated,
+                       LogLevel level, LogModule module, const char* format);
+    static uint16_t drain(uint16_t maxRecords);
+    static void drainTask(void* param);
+};
+
+} // namespace Drivers
+
+// =============================================================================
+// Logging macros
+// =============================================================================
+// Calls above LOG_LEVEL compile to nothing, arguments included.
+
+#ifndef LOG_MODULE
+    #define LOG_MODULE          Drivers::LogModule::GENERAL
+#endif
+
+#if !SERIAL_DEBUG
+    #define LOG_WRITE(level, ...)   do {} while (0)
+#elif LOG_DEFERRED
+    #define LOG_WRITE(level, ...)   Drivers::LogDriver::write(level, LOG_MODULE, __VA_ARGS__)
+#else
+    #define LOG_WRITE(level, ...)   Serial.printf(__VA_ARGS__)
+#endif
+
+#if SERIAL_DEBUG && LOG_LEVEL >= LOG_LEVEL_ERROR
+    #define LOG_E(...)          LOG_WRITE(Drivers::LogLevel::ERROR, __VA_ARGS__)
+#else
+    #define LOG_E(...)          do {} while (0)
+#endif
+#if SERIAL_DEBUG && LOG_LEVEL >= LOG_LEVEL_WARN
+    #define LOG_W(...)          LOG_WRITE(Drivers::LogLevel::WARN, __VA_ARGS__)
+#else
+    #define LOG_W(...)          do {} while (0)
+#endif
+#if SERIAL_DEBUG && LOG_LEVEL >= LOG_LEVEL_INFO
+    #define LOG_I(...)          LOG_WRITE(Drivers::LogLevel::INFO, __VA_ARGS__)
+#else
+    #define LOG_I(...)          do {} while (0)
+#endif
+#if SERIAL_DEBUG && LOG_LEVEL >= LOG_LEVEL_DEBUG
+    #define LOG_D(...)          LOG_WRITE(Drivers::LogLevel::DEBUG, __VA_ARGS__)
+#else
+    #define LOG_D(...)          do {} while (0)
+#endif
+#if SERIAL_DEBUG && LOG_LEVEL >= LOG_LEVEL_VERBOSE
+    #define LOG_V(...)          LOG_WRITE(Drivers::LogLevel::VERBOSE, __VA_ARGS__)
+#else
+    #define LOG_V(...)          do {} while (0)
+#endif
+
+#endif // LOG_DRIVER_H
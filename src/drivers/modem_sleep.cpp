@@ -0,0 +1,182 @@
+/**
+ * @file modem_sleep.cpp
+ * @brief Modem Sleep implementation
+ */
+
+#define LOG_MODULE Drivers::LogModule::MODEM
+
+#include "modem_sleep.h"
+#include "gpio_driver.h"
+#include "config.h"
+#include <esp_timer.h>
+#include <esp_sleep.h>
+#include <driver/gpio.h>
+#include <driver/rtc_io.h>
+
+namespace Drivers {
+
+namespace {
+
+int8_t s_dtrPin = -1;
+int8_t s_ringPin = -1;
+bool s_enabled = false;
+bool s_asleep = false;
+bool s_ringLow = false;
+uint32_t s_lastActivity = 0;
+int64_t s_sleptAtUs = 0;
+
+uint32_t s_sleeps = 0;
+uint32_t s_guardWaits = 0;
+uint32_t s_rings = 0;
+uint64_t s_asleepUs = 0;
+
+void setDtr(bool sleep) {
+    GpioDriver::writeDigital(s_dtrPin, sleep ? HIGH : LOW);
+    if (sleep) {
+        s_sleptAtUs = esp_timer_get_time();
+        s_sleeps++;
+    } else if (s_asleep) {
+        s_asleepUs += esp_timer_get_time() - s_sleptAtUs;
+    }
+    s_asleep = sleep;
+}
+
+} // namespace
+
+void ModemSleep::begin(uint8_t dtrPin, uint8_t ringPin) {
+    s_dtrPin = dtrPin;
+    s_ringPin = ringPin;
+
+    // After a deep sleep the modem is still in slow clock behind a held DTR:
+    // keep the level until the first command wakes it with the guard time
+    bool heldHigh = esp_sleep_get_wakeup_cause() != ESP_SLEEP_WAKEUP_UNDEFINED;
+    GpioDriver::writeDigital(dtrPin, heldHigh ? HIGH : LOW);
+    GpioDriver::configurePin(dtrPin, PinMode::OUTPUT_MODE);
+    gpio_hold_dis((gpio_num_t)dtrPin);
+    s_asleep = heldHigh;
+    s_sleptAtUs = esp_timer_get_time();
+
+    // RI is active low and pulses on URCs / incoming data
+    GpioDriver::configurePin(ringPin, PinMode::INPUT_PULLUP_MODE);
+}
+
+void ModemSleep::setEnabled(bool enabled) {
+    if (s_dtrPin < 0) {
+        return;
+    }
+    if (!enabled && s_asleep) {
+        setDtr(false);
+    }
+    s_enabled = enabled;
+    s_lastActivity = millis();
+    DEBUG_PRINTF("[ModemSleep] Slow clock %s\n", enabled ? "enabled" : "disabled");
+}
+
+void ModemSleep::service() {
+    bool ringing = isRinging();
+    if (ringing && !s_ringLow) {
+        s_rings++;
+    }
+    s_ringLow = ringing;
+
+    if (!s_enabled || s_asleep || ringing) {
+        return;
+    }
+    if (millis() - s_lastActivity < MODEM_SLEEP_IDLE_MS) {
+        return;
+    }
+    setDtr(true);
+}
+
+void ModemSleep::beforeWrite() {
+    s_lastActivity = millis();
+    if (!s_asleep) {
+        return;
+    }
+
+    setDtr(false);
+    s_guardWaits++;
+    delay(MODEM_SLEEP_GUARD_MS);
+    s_lastActivity = millis();
+}
+
+void ModemSleep::onActivity() {
+    s_lastActivity = millis();
+}
+
+bool ModemSleep::isRinging() {
+    return s_ringPin >= 0 && GpioDriver::readDigital(s_ringPin) == LOW;
+}
+
+bool ModemSleep::prepareDeepSleep() {
+    if (s_dtrPin < 0) {
+        return false;
+    }
+
+    if (s_enabled) {
+        // Keep the modem in slow clock while the pads are powered down
+        setDtr(true);
+        gpio_hold_en((gpio_num_t)s_dtrPin);
+        gpio_deep_sleep_hold_en();
+    }
+
+    rtc_gpio_pullup_en((gpio_num_t)s_ringPin);
+    rtc_gpio_pulldown_dis((gpio_num_t)s_ringPin);
+    return esp_sleep_enable_ext0_wakeup((gpio_num_t)s_ringPin, 0) == ESP_OK;
+}
+
+ModemSleepStats ModemSleep::getStats() {
+    ModemSleepStats stats;
+    stats.enabled = s_enabled;
+    stats.asleep = s_asleep;
+    stats.sleeps = s_sleeps;
+    stats.guardWaits = s_guardWaits;
+    stats.rings = s_rings;
+    stats.asleepUs = s_asleepUs;
+    if (s_asleep) {
+        stats.asleepUs += esp_timer_get_time() - s_sleptAtUs;
+    }
+    return stats;
+}
+
+void ModemSleep::printStats() {
+    ModemSleepStats stats = getStats();
+    DEBUG_PRINTF("[ModemSleep] %s, asleep %lu s, %lu sleeps, %lu guarded wakes, %lu rings\n",
+                 stats.enabled ? "on" : "off", (uint32_t)(stats.asleepUs / 1000000ULL),
+                 stats.sleeps, stats.guardWaits, stats.rings);
+}
+
+ModemSleepStream::ModemSleepStream(Stream& stream) : _stream(stream) {
+}
+
+int ModemSleepStream::available() {
+    return _stream.available();
+}
+
+int ModemSleepStream::read() {
+    int value = _stream.read();
+    if (value >= 0) {
+        ModemSleep::onActivity();
+    }
+    return value;
+}
+
+int ModemSleepStream::peek() {
+    return _stream.peek();
+}
+
+void ModemSleepStream::flush() {
+    _stream.flush();
+}
+
+size_t ModemSleepStream::write(uint8_t value) {
+    ModemSleep::beforeWrite();
+    return _stream.write(value);
+}
+
+size_t ModemSleepStream::write(const uint8_t* buffer, size_t size) {
+    ModemSleep::beforeWrite();
+    return _stream.write(buffer, size);
+}
+
+} // namespace Drivers
@@ -0,0 +1,117 @@
+/**
+ * @file modem_sleep.h
+ * @brief Modem Sleep - DTR-controlled slow-clock mode with RI wake
+ */
+
+#ifndef MODEM_SLEEP_H
+#define MODEM_SLEEP_H
+
+#include <Arduino.h>
+
+namespace Drivers {
+
+/**
+ * @brief Modem sleep statistics
+ */
+struct ModemSleepStats {
+    bool enabled;           // Slow clock configured on the modem
+    bool asleep;            // DTR currently high
+    uint32_t sleeps;        // DTR raised since boot
+    uint32_t guardWaits;    // Commands that had to wake the modem first
+    uint32_t rings;         // RI pulses seen
+    uint64_t asleepUs;      // Time with DTR high
+};
+
+/**
+ * @brief Modem sleep controller
+ *
+ * With AT+CSCLK=1 the SIM7000 enters slow-clock mode whenever DTR is high
+ * and the module is idle; the data connection and MQTT session stay up.
+ * service() raises DTR once the UART has been quiet for MODEM_SLEEP_IDLE_MS.
+ * ModemSleepStream sits in front of the UART, so the first byte of the next
+ * command lowers DTR and waits MODEM_SLEEP_GUARD_MS for the modem's UART
+ * to come back; callers never handle sleep themselves.
+ *
+ * With AT+CFGRI=1 the modem pulses RI low on URCs and incoming data. RI is a
+ * light sleep wake source (PowerHAL) and, after prepareDeepSleep(), an EXT0
+ * deep sleep wake source. isRinging() lets the MQTT poll react at once.
+ */
+class ModemSleep {
+public:
+    /**
+     * @brief Configure DTR and RI (releases a DTR hold kept over deep sleep)
+     * @param dtrPin DTR GPIO
+     * @param ringPin RI GPIO (active low)
+     */
+    static void begin(uint8_t dtrPin, uint8_t ringPin);
+
+    /**
+     * @brief Allow or stop sleeping between exchanges
+     * @param enabled True once slow clock is configured on the modem
+     */
+    static void setEnabled(bool enabled);
+
+    /**
+     * @brief Raise DTR after an idle UART (call in loop)
+     */
+    static void service();
+
+    /**
+     * @brief Wake the modem before a command (lowers DTR, waits the guard time)
+     */
+    static void beforeWrite();
+
+    /**
+     * @brief Note UART activity (keeps the modem awake)
+     */
+    static void onActivity();
+
+    /**
+     * @brief Check if the modem is signalling a URC or incoming data
+     * @return true while RI is low
+     */
+    static bool isRinging();
+
+    /**
+     * @brief Hold DTR high and arm RI as the deep sleep wake source
+     * @return true if the wake source is armed
+     */
+    static bool prepareDeepSleep();
+
+    /**
+     * @brief Get statistics
+     * @return Statistics snapshot
+     */
+    static ModemSleepStats getStats();
+
+    /**
+     * @brief Log sleep statistics
+     */
+    static void printStats();
+};
+
+/**
+ * @brief Stream tap that wakes the modem before writing
+ */
+class ModemSleepStream : public Stream {
+public:
+    /**
+     * @brief Constructor
+     * @param stream Underlying stream (the modem UART)
+     */
+    explicit ModemSleepStream(Stream& stream);
+
+    int available() override;
+    int read() override;
+    int peek() override;
+    void flush() override;
+    size_t write(uint8_t value) override;
+    size_t write(const uint8_t* buffer, size_t size) override;
+
+private:
+    Stream& _stream;
+};
+
+} // namespace Drivers
+
+#endif // MODEM_SLEEP_H
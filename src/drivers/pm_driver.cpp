@@ -0,0 +1,224 @@
+/**
+ * @file pm_driver.cpp
+ * @brief Power Management Driver implementation
+ */
+
+#define LOG_MODULE Drivers::LogModule::POWER
+
+#include "pm_driver.h"
+#include "config.h"
+#include <sdkconfig.h>
+#include <esp_pm.h>
+#include <esp_sleep.h>
+#include <esp_timer.h>
+#include <driver/gpio.h>
+#include <driver/uart.h>
+
+namespace Drivers {
+
+namespace {
+
+constexpr uint8_t LOCK_COUNT = (uint8_t)PmLockId::COUNT;
+
+#if CONFIG_PM_ENABLE
+esp_pm_lock_handle_t s_handles[LOCK_COUNT] = {};
+#endif
+
+portMUX_TYPE s_mux = portMUX_INITIALIZER_UNLOCKED;
+bool s_enabled = false;
+bool s_lightSleep = false;
+int64_t s_startUs = 0;
+
+// Per-lock recursion depth and residency accounting
+uint16_t s_depth[LOCK_COUNT] = {};
+int64_t s_heldSinceUs[LOCK_COUNT] = {};
+uint64_t s_heldUs[LOCK_COUNT] = {};
+uint32_t s_acquireCount[LOCK_COUNT] = {};
+
+// Aggregate "any lock held" accounting
+uint16_t s_anyDepth = 0;
+int64_t s_anySinceUs = 0;
+uint64_t s_anyHeldUs = 0;
+
+// Modem exchange in progress (UART_RX held by PmUartStream)
+bool s_uartHeld = false;
+uint32_t s_uartActivity = 0;
+
+} // namespace
+
+bool PmDriver::createLocks() {
+#if CONFIG_PM_ENABLE
+    static const char* names[LOCK_COUNT] = { "cpu", "uart_rx", "sensor", "log_tx", "led" };
+    // CPU work needs full clock; UART and echo timing need a stable APB clock;
+    // the LED runs from REF_TICK and only needs the chip to stay awake.
+    // Any held lock also keeps the chip out of light sleep.
+    static const esp_pm_lock_type_t types[LOCK_COUNT] = {
+        ESP_PM_CPU_FREQ_MAX, ESP_PM_APB_FREQ_MAX, ESP_PM_CPU_FREQ_MAX, ESP_PM_APB_FREQ_MAX,
+        ESP_PM_NO_LIGHT_SLEEP
+    };
+
+    for (uint8_t i = 0; i < LOCK_COUNT; i++) {
+        if (s_handles[i]) continue;
+        if (esp_pm_lock_create(types[i], 0, names[i], &s_handles[i]) != ESP_OK) {
+            DEBUG_PRINTF("[PM] Failed to create lock '%s'\n", names[i]);
+            return false;
+        }
+    }
+    return true;
+#else
+    return false;
+#endif
+}
+
+bool PmDriver::configure(uint16_t maxFreqMhz, uint16_t minFreqMhz, bool lightSleep) {
+    s_startUs = esp_timer_get_time();
+
+#if CONFIG_PM_ENABLE
+    esp_pm_config_esp32_t pmConfig = {};
+    pmConfig.max_freq_mhz = maxFreqMhz;
+    pmConfig.min_freq_mhz = minFreqMhz;
+    pmConfig.light_sleep_enable = lightSleep;
+
+    esp_err_t err = esp_pm_configure(&pmConfig);
+    if (err == ESP_ERR_NOT_SUPPORTED && lightSleep) {
+        // Light sleep needs CONFIG_FREERTOS_USE_TICKLESS_IDLE in the framework
+        DEBUG_PRINTLN("[PM] Light sleep not supported by framework, using DFS only");
+        pmConfig.light_sleep_enable = false;
+        lightSleep = false;
+        err = esp_pm_configure(&pmConfig);
+    }
+
+    if (err != ESP_OK) {
+        DEBUG_PRINTF("[PM] esp_pm_configure failed: %d\n", err);
+        return false;
+    }
+
+    if (!createLocks()) {
+        return false;
+    }
+
+    s_enabled = true;
+    s_lightSleep = lightSleep;
+    DEBUG_PRINTF("[PM] DFS %d-%d MHz, light sleep %s\n",
+                 minFreqMhz, maxFreqMhz, lightSleep ? "on" : "off");
+    return true;
+#else
+    (void)maxFreqMhz;
+    (void)minFreqMhz;
+    (void)lightSleep;
+    DEBUG_PRINTLN("[PM] CONFIG_PM_ENABLE not set in framework, power management disabled");
+    return false;
+#endif
+}
+
+bool PmDriver::enableUartWakeup(uint8_t uartNum, int threshold) {
+    if (uart_set_wakeup_threshold((uart_port_t)uartNum, threshold) != ESP_OK) {
+        return false;
+    }
+    return esp_sleep_enable_uart_wakeup(uartNum) == ESP_OK;
+}
+
+bool PmDriver::enableGpioWakeup(uint8_t pin, uint8_t level) {
+    gpio_int_type_t type = (level == LOW) ? GPIO_INTR_LOW_LEVEL : GPIO_INTR_HIGH_LEVEL;
+    if (gpio_wakeup_enable((gpio_num_t)pin, type) != ESP_OK) {
+        return false;
+    }
+    return esp_sleep_enable_gpio_wakeup() == ESP_OK;
+}
+
+void PmDriver::acquire(PmLockId id) {
+    uint8_t i = (uint8_t)id;
+    if (i >= LOCK_COUNT) return;
+
+#if CONFIG_PM_ENABLE
+    if (s_handles[i]) {
+        esp_pm_lock_acquire(s_handles[i]);
+    }
+#endif
+
+    int64_t now = esp_timer_get_time();
+    portENTER_CRITICAL(&s_mux);
+    if (s_depth[i]++ == 0) {
+        s_heldSinceUs[i] = now;
+        s_acquireCount[i]++;
+    }
+    if (s_anyDepth++ == 0) {
+        s_anySinceUs = now;
+    }
+    portEXIT_CRITICAL(&s_mux);
+}
+
+void PmDriver::release(PmLockId id) {
+    uint8_t i = (uint8_t)id;
+    if (i >= LOCK_COUNT) return;
+
+    int64_t now = esp_timer_get_time();
+    portENTER_CRITICAL(&s_mux);
+    if (s_depth[i] == 0) {
+        portEXIT_CRITICAL(&s_mux);
+        return; // Unbalanced release
+    }
+    if (--s_depth[i] == 0) {
+        s_heldUs[i] += now - s_heldSinceUs[i];
+    }
+    if (--s_anyDepth == 0) {
+        s_anyHeldUs += now - s_anySinceUs;
+    }
+    portEXIT_CRITICAL(&s_mux);
+
+#if CONFIG_PM_ENABLE
+    if (s_handles[i]) {
+        esp_pm_lock_release(s_handles[i]);
+    }
+#endif
+}
+
+bool PmDriver::isEnabled() {
+    return s_enabled;
+}
+
+PmStats PmDriver::getStats() {
+    PmStats stats;
+    int64_t now = esp_timer_get_time();
+
+    portENTER_CRITICAL(&s_mux);
+    stats.enabled = s_enabled;
+    stats.lightSleepEnabled = s_lightSleep;
+    stats.uptimeUs = now - s_startUs;
+    for (uint8_t i = 0; i < LOCK_COUNT; i++) {
+        stats.heldUs[i] = s_heldUs[i] + (s_depth[i] ? (now - s_heldSinceUs[i]) : 0);
+        stats.acquireCount[i] = s_acquireCount[i];
+    }
+    stats.anyHeldUs = s_anyHeldUs + (s_anyDepth ? (now - s_anySinceUs) : 0);
+    portEXIT_CRITICAL(&s_mux);
+
+    if (stats.uptimeUs > 0 && stats.anyHeldUs <= stats.uptimeUs) {
+        stats.idlePercent = (uint8_t)(100 - (stats.anyHeldUs * 100) / stats.uptimeUs);
+    } else {
+        stats.idlePercent = 0;
+    }
+    return stats;
+}
+
+void PmDriver::dumpLocks() {
+#if CONFIG_PM_ENABLE && CONFIG_PM_PROFILING
+    esp_pm_dump_locks(stdout);
+#endif
+}
+
+void PmDriver::onUartActivity() {
+    s_uartActivity = millis();
+    if (!s_uartHeld) {
+        acquire(PmLockId::UART_RX);
+        s_uartHeld = true;
+    }
+}
+
+void PmDriver::service() {
+    if (s_uartHeld && millis() - s_uartActivity >= PM_UART_IDLE_MS) {
+        release(PmLockId::UART_RX);
+        s_uartHeld = false;
+    }
+}
+
+} // namespace Drivers
@@ -0,0 +1,177 @@
+/**
+ * @file pm_driver.h
+ * @brief Power Management Driver - ESP-IDF DFS, automatic light sleep and PM locks
+ */
+
+#ifndef PM_DRIVER_H
+#define PM_DRIVER_H
+
+#include <Arduino.h>
+
+namespace Drivers {
+
+/**
+ * @brief Power management locks used by the firmware
+ *
+ * While any lock is held the system stays out of light sleep.
+ * With no lock held the idle task may drop the clock to the minimum
+ * frequency and enter automatic light sleep.
+ */
+enum class PmLockId : uint8_t {
+    CPU,            // CPU is computing (held around each loop iteration)
+    UART_RX,        // Modem UART is receiving / exchanging data
+    SENSOR_CAPTURE, // Ultrasonic echo capture in progress
+    LOG_TX,         // Log drain task is writing to the debug UART
+    LED,            // Status LED pattern playing (LEDC clock stops in light sleep)
+    COUNT
+};
+
+/**
+ * @brief Power management residency statistics
+ */
+struct PmStats {
+    bool enabled;             // True if esp_pm_configure() succeeded
+    bool lightSleepEnabled;   // True if automatic light sleep is active
+    uint64_t uptimeUs;        // Time since PmDriver::configure()
+    uint64_t heldUs[(uint8_t)PmLockId::COUNT];     // Total time each lock was held
+    uint32_t acquireCount[(uint8_t)PmLockId::COUNT]; // Number of acquisitions per lock
+    uint64_t anyHeldUs;       // Time with at least one lock held (full clock, no sleep)
+    uint8_t idlePercent;      // Share of uptime with no lock held (0-100)
+};
+
+/**
+ * @brief Power Management Driver class
+ *
+ * Thin wrapper over esp_pm_* APIs. All methods are safe to call when
+ * power management is not compiled into the framework (CONFIG_PM_ENABLE);
+ * in that case locks only update the residency statistics.
+ */
+class PmDriver {
+public:
+    /**
+     * @brief Configure dynamic frequency scaling and automatic light sleep
+     * @param maxFreqMhz CPU frequency while a lock is held
+     * @param minFreqMhz CPU frequency when idle
+     * @param lightSleep Enable automatic light sleep when idle
+     * @return true if power management was configured
+     */
+    static bool configure(uint16_t maxFreqMhz, uint16_t minFreqMhz, bool lightSleep);
+
+    /**
+     * @brief Enable UART RX as a light sleep wake source
+     * @param uartNum UART peripheral number
+     * @param threshold Number of RX edges required to wake
+     * @return true if wake source enabled
+     */
+    static bool enableUartWakeup(uint8_t uartNum, int threshold);
+
+    /**
+     * @brief Enable a GPIO level as a light sleep wake source
+     * @param pin GPIO pin number
+     * @param level Level that triggers wake (HIGH or LOW)
+     * @return true if wake source enabled
+     */
+    static bool enableGpioWakeup(uint8_t pin, uint8_t level);
+
+    /**
+     * @brief Acquire a power management lock (recursive)
+     * @param id Lock to acquire
+     */
+    static void acquire(PmLockId id);
+
+    /**
+     * @brief Release a power management lock
+     * @param id Lock to release
+     */
+    static void release(PmLockId id);
+
+    /**
+     * @brief Check if power management is active
+     * @return true if configured successfully
+     */
+    static bool isEnabled();
+
+    /**
+     * @brief Get residency statistics
+     * @return Statistics snapshot
+     */
+    static PmStats getStats();
+
+    /**
+     * @brief Print ESP-IDF lock profiling (requires CONFIG_PM_PROFILING)
+     */
+    static void dumpLocks();
+
+    /**
+     * @brief Note modem UART traffic; holds UART_RX until the UART goes quiet
+     */
+    static void onUartActivity();
+
+    /**
+     * @brief Release UART_RX once the UART has been quiet for PM_UART_IDLE_MS (call in loop)
+     */
+    static void service();
+
+private:
+    static bool createLocks();
+};
+
+/**
+ * @brief RAII helper that holds a power management lock for its scope
+ */
+class PmLockGuard {
+public:
+    explicit PmLockGuard(PmLockId id) : _id(id) { PmDriver::acquire(_id); }
+    ~PmLockGuard() { PmDriver::release(_id); }
+
+    PmLockGuard(const PmLockGuard&) = delete;
+    PmLockGuard& operator=(const PmLockGuard&) = delete;
+
+private:
+    PmLockId _id;
+};
+
+/**
+ * @brief Stream tap that holds UART_RX for an outstanding modem exchange
+ *
+ * Bytes arriving while the chip wakes from light sleep are lost, so every
+ * byte written to or read from the modem keeps the lock until the UART has
+ * been quiet for PM_UART_IDLE_MS, on every code path, not only the MQTT poll.
+ */
+class PmUartStream : public Stream {
+public:
+    /**
+     * @brief Constructor
+     * @param stream Underlying stream (the modem UART)
+     */
+    explicit PmUartStream(Stream& stream) : _stream(stream) {}
+
+    int available() override { return _stream.available(); }
+    int peek() override { return _stream.peek(); }
+    void flush() override { _stream.flush(); }
+
+    int read() override {
+        int value = _stream.read();
+        if (value >= 0) {
+            PmDriver::onUartActivity();
+        }
+        return value;
+    }
+
+    size_t write(uint8_t value) override {
+        PmDriver::onUartActivity();
+        return _stream.write(value);
+    }
+
+    size_t write(const uint8_t* buffer, size_t size) override {
+        PmDriver::onUartActivity();
+        return _stream.write(buffer, size);
+    }
+
+private:
+    Stream& _stream;
+};
+
+} // namespace Drivers
+
+#endif // PM_DRIVER_H
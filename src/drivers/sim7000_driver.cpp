@@ -3,16 +3,44 @@
  * @brief SIM7000G Modem Driver implementation
  */
 
+#define LOG_MODULE Drivers::LogModule::MODEM
+
 #include "sim7000_driver.h"
 #include "gpio_driver.h"
+#include "led_driver.h"
+#include "at_capture.h"
+#include "modem_sleep.h"
+#include <Preferences.h>
 
 namespace Drivers {
 
+namespace {
+const char* PREFS_NAMESPACE = "modem";
+const char* PREFS_PROFILE_KEY = "profile";
+
+// Bump whenever persistProfile() changes what it writes: the stored hash
+// then no longer matches and modems holding the old profile are updated
+constexpr uint32_t PROFILE_VERSION = 2;     // 1: +IPR, 2: +CLTS=1
+
+uint32_t fnv1a(const char* data) {
+    uint32_t hash = 2166136261UL;
+    while (*data) {
+        hash ^= (uint8_t)*data++;
+        hash *= 16777619UL;
+    }
+    return hash;
+}
+} // namespace
+
 SIM7000Driver::SIM7000Driver(HardwareSerial& serial)
-    : _serial(serial), _modem(nullptr), _initialized(false) {
+    : _serial(serial), _modem(nullptr), _sleepTap(nullptr), _pmTap(nullptr), _bootTimeMs(0),
+      _bootEvent(ModemBootEvent::NONE), _initialized(false), _hardwareReady(false) {
 #if DUMP_AT_COMMANDS
     _debugger = nullptr;
 #endif
+#if AT_CAPTURE_ENABLED
+    _capture = nullptr;
+#endif
 }
 
 SIM7000Driver::~SIM7000Driver() {
@@ -20,12 +48,26 @@ SIM7000Driver::~SIM7000Driver() {
         delete _modem;
         _modem = nullptr;
     }
+    if (_sleepTap) {
+        delete _sleepTap;
+        _sleepTap = nullptr;
+    }
+    if (_pmTap) {
+        delete _pmTap;
+        _pmTap = nullptr;
+    }
 #if DUMP_AT_COMMANDS
     if (_debugger) {
         delete _debugger;
         _debugger = nullptr;
     }
 #endif
+#if AT_CAPTURE_ENABLED
+    if (_capture) {
+        delete _capture;
+        _capture = nullptr;
+    }
+#endif
 }
 
 bool SIM7000Driver::initHardware() {
@@ -35,12 +77,16 @@ bool SIM7000Driver::initHardware() {
     GpioDriver::configurePin(MODEM_PWRKEY_PIN, PinMode::OUTPUT_MODE);
     GpioDriver::writeDigital(MODEM_PWRKEY_PIN, LOW);
     
-    // Configure LED pin
-    GpioDriver::configurePin(BOARD_LED_PIN, PinMode::OUTPUT_MODE);
-    GpioDriver::writeDigital(BOARD_LED_PIN, LED_OFF);
+#if MODEM_STATUS_PIN >= 0
+    GpioDriver::configurePin(MODEM_STATUS_PIN, PinMode::INPUT_MODE);
+#endif
+    
+    // DTR low (modem awake) and ring indicator (active low) for URC / data wake
+    ModemSleep::begin(MODEM_DTR_PIN, MODEM_RING_PIN);
     
     // Initialize serial communication
     _serial.begin(MODEM_BAUDRATE, SERIAL_8N1, MODEM_RX_PIN, MODEM_TX_PIN);
+    _hardwareReady = true;
     
     DEBUG_PRINTLN("[SIM7000] Hardware initialized");
     return true;
@@ -49,40 +95,104 @@ bool SIM7000Driver::initHardware() {
 bool SIM7000Driver::powerOn() {
     DEBUG_PRINTLN("[SIM7000] Powering on modem...");
     
-    // Power on sequence for SIM7000G
-    GpioDriver::writeDigital(MODEM_PWRKEY_PIN, LOW);
-    delay(100);
-    GpioDriver::writeDigital(MODEM_PWRKEY_PIN, HIGH);
-    delay(1000);
-    GpioDriver::writeDigital(MODEM_PWRKEY_PIN, LOW);
+    createModem();
+    uint32_t start = millis();
+    
+    // Modem keeps running across MCU resets - a PWRKEY pulse would turn it off
+    if (testAT(MODEM_AT_PROBE_MS)) {
+        _bootEvent = ModemBootEvent::ALREADY_ON;
+    } else {
+        pulsePowerKey(MODEM_PWRKEY_PULSE_MS);
+        _bootEvent = waitForReady(MODEM_BOOT_TIMEOUT_MS);
+    }
+    _bootTimeMs = millis() - start;
     
-    // Wait for modem to boot
-    delay(MODEM_INIT_DELAY_MS);
+    if (_bootEvent == ModemBootEvent::NONE) {
+        DEBUG_PRINTF("[SIM7000] No readiness signal after %lu ms\n", _bootTimeMs);
+        return false;
+    }
     
-    // Turn on LED to indicate modem power
-    GpioDriver::writeDigital(BOARD_LED_PIN, LED_ON);
+    // Keep LED lit between status patterns to indicate modem power
+    LedDriver::setIdle(true);
     
-    DEBUG_PRINTLN("[SIM7000] Power on sequence complete");
+    DEBUG_PRINTF("[SIM7000] Modem ready after %lu ms (event %d)\n",
+                 _bootTimeMs, (int)_bootEvent);
     return true;
 }
 
+ModemBootEvent SIM7000Driver::waitForReady(uint32_t timeout) {
+    static const char RDY[] = "RDY";
+    uint8_t matched = 0;
+    uint32_t start = millis();
+    uint32_t lastProbe = start;
+    
+    while (millis() - start < timeout) {
+#if MODEM_STATUS_PIN >= 0
+        if (GpioDriver::readDigital(MODEM_STATUS_PIN) == HIGH) {
+            return ModemBootEvent::STATUS_PIN;
+        }
+#endif
+        // RDY is only sent when the baud rate is fixed (AT+IPR, see persistProfile)
+        while (_serial.available()) {
+            char c = _serial.read();
+            matched = (c == RDY[matched]) ? matched + 1 : (c == RDY[0] ? 1 : 0);
+            if (matched == sizeof(RDY) - 1) {
+                return ModemBootEvent::RDY_URC;
+            }
+        }
+        
+        // With autobaud the modem stays silent until it sees an AT
+        if (millis() - lastProbe >= MODEM_AT_PROBE_MS) {
+            lastProbe = millis();
+            _modem->sendAT(GF(""));
+            if (_modem->waitResponse(MODEM_AT_PROBE_MS / 2) == 1) {
+                return ModemBootEvent::AT_RESPONSE;
+            }
+        }
+        delay(10);
+    }
+    
+    return ModemBootEvent::NONE;
+}
+
+uint32_t SIM7000Driver::getBootTimeMs() {
+    return _bootTimeMs;
+}
+
+ModemBootEvent SIM7000Driver::getBootEvent() {
+    return _bootEvent;
+}
+
 void SIM7000Driver::powerOff() {
     DEBUG_PRINTLN("[SIM7000] Powering off modem...");
     
-    if (_modem) {
-        _modem->poweroff();
+    if (!_hardwareReady) {
+        initHardware();
     }
     
-    // Hardware power off
-    GpioDriver::writeDigital(MODEM_PWRKEY_PIN, HIGH);
-    delay(1500);
-    GpioDriver::writeDigital(MODEM_PWRKEY_PIN, LOW);
+    // Fall back to PWRKEY only if the AT power down was not acknowledged;
+    // pulsing after a successful +CPOWD would switch the modem back on
+    bool softOff = _modem && _modem->poweroff();
+    if (!softOff) {
+        pulsePowerKey(1500);
+    }
     
-    GpioDriver::writeDigital(BOARD_LED_PIN, LED_OFF);
+    ModemSleep::setEnabled(false);
+    LedDriver::setIdle(false);
+    _initialized = false;
     
     DEBUG_PRINTLN("[SIM7000] Modem powered off");
 }
 
+bool SIM7000Driver::isPoweredOn() {
+    // Without the UART the probe would always report "off"
+    if (!_hardwareReady) {
+        initHardware();
+    }
+    createModem();
+    return testAT(MODEM_AT_PROBE_MS);
+}
+
 void SIM7000Driver::reset() {
     DEBUG_PRINTLN("[SIM7000] Resetting modem...");
     
@@ -91,34 +201,71 @@ void SIM7000Driver::reset() {
     powerOn();
 }
 
-bool SIM7000Driver::initModem() {
-    DEBUG_PRINTLN("[SIM7000] Initializing modem communication...");
+void SIM7000Driver::pulsePowerKey(uint32_t durationMs) {
+    GpioDriver::writeDigital(MODEM_PWRKEY_PIN, HIGH);
+    delay(durationMs);
+    GpioDriver::writeDigital(MODEM_PWRKEY_PIN, LOW);
+}
+
+void SIM7000Driver::createModem() {
+    // Innermost, so every byte on the UART keeps the chip awake
+    if (!_pmTap) {
+        _pmTap = new PmUartStream(_serial);
+    }
+    Stream* stream = _pmTap;
     
-    // Create TinyGSM instance
 #if DUMP_AT_COMMANDS
     if (!_debugger) {
-        _debugger = new StreamDebugger(_serial, Serial);
+        _debugger = new StreamDebugger(*stream, Serial);
     }
-    if (!_modem) {
-        _modem = new TinyGsm(*_debugger);
+    stream = _debugger;
+#endif
+    
+#if AT_CAPTURE_ENABLED
+    // Recorded in RAM without slowing the link; see AtCapture
+    if (!_capture && AtCapture::begin()) {
+        _capture = new AtCaptureStream(*stream);
     }
-#else
-    if (!_modem) {
-        _modem = new TinyGsm(_serial);
+    if (_capture) {
+        stream = _capture;
     }
 #endif
+    
+    // Outermost, so a command wakes the modem before anything is sent
+    if (!_sleepTap) {
+        _sleepTap = new ModemSleepStream(*stream);
+    }
+    
+    if (!_modem) {
+        _modem = new TinyGsm(*_sleepTap);
+    }
+}
 
-    // Try to initialize modem
-    int retry = 0;
+bool SIM7000Driver::initModem() {
+    DEBUG_PRINTLN("[SIM7000] Initializing modem communication...");
+    
+    createModem();
+    
+    // Bounded recovery: a few power cycles, then report failure
+    uint8_t cycles = 0;
     while (!testAT(1000)) {
-        DEBUG_PRINT(".");
-        if (retry++ > 10) {
-            DEBUG_PRINTLN("\n[SIM7000] Modem not responding, power cycling...");
-            reset();
-            retry = 0;
+        if (cycles++ >= MODEM_MAX_POWER_CYCLES) {
+            DEBUG_PRINTLN("[SIM7000] Modem not responding, giving up");
+            AtCapture::trigger("modem not responding");
+            return false;
         }
+        DEBUG_PRINTLN("[SIM7000] Modem not responding, power cycling...");
+        reset();
     }
-    DEBUG_PRINTLN();
+    
+#if MODEM_PERSIST_PROFILE
+    // One AT&V query instead of re-sending the whole configuration set
+    if (isProfileValid()) {
+        _initialized = true;
+        DEBUG_PRINTLN("[SIM7000] Stored profile verified, skipping full init");
+        return true;
+    }
+#endif
     
     // Initialize modem
     if (!_modem->init()) {
@@ -126,12 +273,75 @@ bool SIM7000Driver::initModem() {
         return false;
     }
     
+#if MODEM_PERSIST_PROFILE
+    if (!persistProfile()) {
+        DEBUG_PRINTLN("[SIM7000] Warning: could not persist modem profile");
+    }
+#endif
+    
     _initialized = true;
     DEBUG_PRINTLN("[SIM7000] Modem initialized successfully");
     
     return true;
 }
 
+uint32_t SIM7000Driver::queryProfileHash() {
+    _modem->sendAT(GF("&V"));
+    String profile;
+    if (_modem->waitResponse(2000L, profile) != 1) {
+        return 0;
+    }
+    return (fnv1a(profile.c_str()) ^ PROFILE_VERSION) * 16777619UL;
+}
+
+bool SIM7000Driver::isProfileValid() {
+    Preferences prefs;
+    if (!prefs.begin(PREFS_NAMESPACE, true)) {
+        return false;
+    }
+    uint32_t stored = prefs.getUInt(PREFS_PROFILE_KEY, 0);
+    prefs.end();
+    
+    if (stored == 0) {
+        return false;
+    }
+    return queryProfileHash() == stored;
+}
+
+bool SIM7000Driver::persistProfile() {
+    // Fixed baud rate so the modem announces RDY on the next boot
+    _modem->sendAT(GF("+IPR="), MODEM_BAUDRATE);
+    if (_modem->waitResponse() != 1) {
+        return false;
+    }
+    
+    // Network time sync (NITZ) so +CCLK returns local time after registration
+    _modem->sendAT(GF("+CLTS=1"));
+    if (_modem->waitResponse() != 1) {
+        return false;
+    }
+    
+    _modem->sendAT(GF("&W"));
+    if (_modem->waitResponse() != 1) {
+        return false;
+    }
+    
+    uint32_t hash = queryProfileHash();
+    if (hash == 0) {
+        return false;
+    }
+    
+    Preferences prefs;
+    if (!prefs.begin(PREFS_NAMESPACE, false)) {
+        return false;
+    }
+    prefs.putUInt(PREFS_PROFILE_KEY, hash);
+    prefs.end();
+    
+    DEBUG_PRINTF("[SIM7000] Profile saved to NVRAM (hash %08lx)\n", hash);
+    return true;
+}
+
 bool SIM7000Driver::testAT(uint32_t timeout) {
     if (!_modem) return false;
     return _modem->testAT(timeout);
@@ -151,11 +361,138 @@ String SIM7000Driver::getModemInfo() {
     return _modem->getModemInfo();
 }
 
+String SIM7000Driver::getIMEI() {
+    if (!_modem) return "";
+    return _modem->getIMEI();
+}
+
 int SIM7000Driver::getSimStatus() {
     if (!_modem) return -1;
     return _modem->getSimStatus();
 }
 
+int SIM7000Driver::getSignalQuality() {
+    if (!_modem) return -1;
+    return _modem->getSignalQuality();
+}
+
+bool SIM7000Driver::getRsrp(int16_t& rsrpDbm) {
+    if (!_modem) return false;
+    
+    // +CESQ: <rxlev>,<ber>,<rscp>,<ecno>,<rsrq>,<rsrp>
+    _modem->sendAT(GF("+CESQ"));
+    String response;
+    if (_modem->waitResponse(1000L, response) != 1) {
+        return false;
+    }
+    
+    int values[6];
+    const char* p = strstr(response.c_str(), "+CESQ:");
+    if (!p || sscanf(p, "+CESQ: %d,%d,%d,%d,%d,%d", &values[0], &values[1], &values[2],
+                     &values[3], &values[4], &values[5]) != 6) {
+        return false;
+    }
+    
+    // 0..97 maps to -140..-44 dBm; 255 = not known (not on LTE)
+    if (values[5] > 97) {
+        return false;
+    }
+    rsrpDbm = values[5] - 141;
+    return true;
+}
+
+bool SIM7000Driver::setRadioMode(uint8_t networkMode, uint8_t preferredMode) {
+    if (!_modem) return false;
+    if (!_modem->setNetworkMode(networkMode)) {
+        return false;
+    }
+    return preferredMode == 0 || _modem->setPreferredMode(preferredMode);
+}
+
+int16_t SIM7000Driver::getSystemMode() {
+    if (!_modem) return -1;
+    bool autoReport;
+    int16_t mode;
+    if (!_modem->getNetworkSystemMode(autoReport, mode)) {
+        return -1;
+    }
+    return mode;
+}
+
+bool SIM7000Driver::getServingCell(ServingCell& cell) {
+    if (!_modem) return false;
+    
+    // +CPSI: LTE CAT-M1,Online,310-410,0x4804,74777865,334,EUTRAN-BAND12,5110,...
+    // +CPSI: GSM,Online,310-410,0x1234,12345,...
+    _modem->sendAT(GF("+CPSI?"));
+    String response;
+    if (_modem->waitResponse(1000L, response) != 1) {
+        return false;
+    }
+    
+    int start = response.indexOf("+CPSI: ");
+    if (start < 0) {
+        return false;
+    }
+    char line[128];
+    strncpy(line, response.c_str() + start + 7, sizeof(line) - 1);
+    line[sizeof(line) - 1] = '\0';
+    
+    memset(&cell, 0, sizeof(cell));
+    char* saveptr = NULL;
+    char* field = strtok_r(line, ",\r\n", &saveptr);
+    for (uint8_t i = 0; field != NULL; i++) {
+        switch (i) {
+            case 0:
+                strncpy(cell.system, field, sizeof(cell.system) - 1);
+                break;
+            case 1:
+                if (strcmp(field, "Online") != 0) return false;
+                break;
+            case 2: {
+                uint8_t n = 0;
+                for (const char* c = field; *c && n < sizeof(cell.plmn) - 1; c++) {
+                    if (isdigit((unsigned char)*c)) cell.plmn[n++] = *c;
+                }
+                break;
+            }
+            case 3:
+                cell.tac = (uint16_t)strtoul(field, NULL, 16);
+                break;
+            case 4:
+                cell.cellId = strtoul(field, NULL, 10);
+                break;
+            case 6: {
+                const char* band = strstr(field, "BAND");
+                if (band) cell.band = (uint8_t)atoi(band + 4);
+                break;
+            }
+            case 7:
+                if (cell.band) cell.earfcn = strtoul(field, NULL, 10);
+                break;
+        }
+        field = strtok_r(NULL, ",\r\n", &saveptr);
+    }
+    return cell.plmn[0] != '\0';
+}
+
+bool SIM7000Driver::selectOperator(const char* plmn) {
+    if (!_modem) return false;
+    if (plmn && plmn[0]) {
+        // Mode 4: manual, modem falls back to automatic if the PLMN is gone
+        _modem->sendAT(GF("+COPS=4,2,\""), plmn, GF("\""));
+    } else {
+        _modem->sendAT(GF("+COPS=0"));
+    }
+    return _modem->waitResponse(10000L) == 1;
+}
+
+bool SIM7000Driver::setBands(const char* mode, const char* bands) {
+    if (!_modem) return false;
+    _modem->sendAT(GF("+CBANDCFG=\""), mode, GF("\","), bands);
+    return _modem->waitResponse() == 1;
+}
+
 bool SIM7000Driver::unlockSim(const char* pin) {
     if (!_modem || !pin || strlen(pin) == 0) return true;
     return _modem->simUnlock(pin);
@@ -172,4 +509,26 @@ int8_t SIM7000Driver::waitResponse(uint32_t timeout) {
     return _modem->waitResponse(timeout);
 }
 
+bool SIM7000Driver::hasPendingData() {
+    return _serial.available() > 0 || ModemSleep::isRinging();
+}
+
+bool SIM7000Driver::setSleepMode(bool enable) {
+    if (!_modem) return false;
+    
+    // Stop raising DTR first so the disabling commands are not guarded
+    if (!enable) {
+        ModemSleep::setEnabled(false);
+    }
+    
+    bool ok = _modem->sleepEnable(enable);
+    _modem->sendAT(GF("+CFGRI="), enable ? 1 : 0);
+    ok = (_modem->waitResponse() == 1) && ok;
+    
+    if (enable && ok) {
+        ModemSleep::setEnabled(true);
+    }
+    return ok;
+}
+
 } // namespace Drivers
@@ -24,8 +24,38 @@
 #include <StreamDebugger.h>
 #endif
 
+#if AT_CAPTURE_ENABLED
+#include "at_capture.h"
+#endif
+
+#include "modem_sleep.h"
+#include "pm_driver.h"
+
 namespace Drivers {
 
+/**
+ * @brief How modem readiness was detected during boot
+ */
+enum class ModemBootEvent {
+    NONE,           // Not booted / timed out
+    ALREADY_ON,     // Modem answered AT before any PWRKEY pulse
+    STATUS_PIN,     // STATUS pin went high
+    RDY_URC,        // "RDY" URC received
+    AT_RESPONSE     // First AT probe answered
+};
+
+/**
+ * @brief Serving cell reported by AT+CPSI
+ */
+struct ServingCell {
+    char system[16];    // "LTE CAT-M1", "LTE NB-IOT", "GSM"
+    char plmn[7];       // MCC + MNC digits
+    uint16_t tac;       // TAC (LTE) or LAC (GSM)
+    uint32_t cellId;
+    uint8_t band;       // E-UTRAN band (0 = not LTE)
+    uint32_t earfcn;    // E-UTRAN channel (0 = not LTE)
+};
+
 /**
  * @brief SIM7000G Modem Driver
  * 
@@ -52,8 +82,12 @@ public:
     bool initHardware();
 
     /**
-     * @brief Power on the modem
-     * @return true if modem powered on
+     * @brief Power on the modem and wait until it is ready
+     *
+     * Skips the PWRKEY pulse if the modem already answers AT (e.g. after
+     * an MCU-only reset), otherwise pulses PWRKEY and returns as soon as
+     * readiness is detected instead of sleeping a fixed boot delay.
+     * @return true if modem is ready for AT commands
      */
     bool powerOn();
 
@@ -62,6 +96,15 @@ public:
      */
     void powerOff();
 
+    /**
+     * @brief Check if the modem is powered (answers a short AT probe)
+     *
+     * Configures the pins and UART first if initHardware() has not run, so
+     * the probe also works on paths that never bring the modem up (Wi-Fi).
+     * @return true if modem responds
+     */
+    bool isPoweredOn();
+
     /**
      * @brief Reset the modem
      */
@@ -69,10 +112,33 @@ public:
 
     /**
      * @brief Initialize modem communication
+     *
+     * If the configuration profile stored in modem NVRAM matches the one
+     * recorded at the last full init (one AT&V query), the full TinyGSM
+     * init sequence is skipped.
      * @return true if modem responds to AT commands
      */
     bool initModem();
 
+    /**
+     * @brief Wait for modem readiness after power on
+     * @param timeout Timeout in milliseconds
+     * @return Event that signalled readiness, NONE on timeout
+     */
+    ModemBootEvent waitForReady(uint32_t timeout = MODEM_BOOT_TIMEOUT_MS);
+
+    /**
+     * @brief Get duration of the last boot sequence
+     * @return Milliseconds from power on to ready
+     */
+    uint32_t getBootTimeMs();
+
+    /**
+     * @brief Get how readiness was detected in the last boot
+     * @return Boot event
+     */
+    ModemBootEvent getBootEvent();
+
     /**
      * @brief Test if modem responds to AT command
      * @param timeout Timeout in milliseconds
@@ -98,12 +164,68 @@ public:
      */
     String getModemInfo();
 
+    /**
+     * @brief Get modem IMEI
+     * @return IMEI digits (empty if unavailable)
+     */
+    String getIMEI();
+
     /**
      * @brief Get SIM status
      * @return SIM status code
      */
     int getSimStatus();
 
+    /**
+     * @brief Get signal quality (AT+CSQ)
+     * @return CSQ 0-31, 99 if unknown, -1 if no modem
+     */
+    int getSignalQuality();
+
+    /**
+     * @brief Get LTE reference signal power (AT+CESQ)
+     * @param rsrpDbm Output RSRP in dBm
+     * @return true if the modem reported an RSRP (LTE serving cell)
+     */
+    bool getRsrp(int16_t& rsrpDbm);
+
+    /**
+     * @brief Restrict the radio access technologies searched
+     * @param networkMode AT+CNMP mode (2 auto, 13 GSM, 38 LTE, 51 GSM+LTE)
+     * @param preferredMode AT+CMNB mode (1 CAT-M, 2 NB-IoT, 3 both; 0 = leave)
+     * @return true if accepted
+     */
+    bool setRadioMode(uint8_t networkMode, uint8_t preferredMode);
+
+    /**
+     * @brief Get the serving system (AT+CNSMOD)
+     * @return 0 no service, 1-3 GSM/GPRS/EGPRS, 7 CAT-M, 9 NB-IoT, -1 error
+     */
+    int16_t getSystemMode();
+
+    /**
+     * @brief Get the serving cell (AT+CPSI)
+     * @param cell Output cell info
+     * @return true if the modem is online on a cell
+     */
+    bool getServingCell(ServingCell& cell);
+
+    /**
+     * @brief Select the operator (AT+COPS)
+     * @param plmn MCC+MNC to try first (manual with automatic fallback),
+     *             NULL or empty for automatic selection
+     * @return true if accepted
+     */
+    bool selectOperator(const char* plmn);
+
+    /**
+     * @brief Set the LTE bands searched (AT+CBANDCFG)
+     * @param mode "CAT-M" or "NB-IOT"
+     * @param bands Comma-separated band list
+     * @return true if accepted
+     */
+    bool setBands(const char* mode, const char* bands);
+
     /**
      * @brief Unlock SIM with PIN
      * @param pin SIM PIN code
@@ -124,15 +246,65 @@ public:
      */
     int8_t waitResponse(uint32_t timeout = 1000);
 
+    /**
+     * @brief Check if the modem UART has unread bytes or RI is signalling
+     * @return true if RX data is pending
+     */
+    bool hasPendingData();
+
+    /**
+     * @brief Configure slow clock (AT+CSCLK) and RI on data (AT+CFGRI)
+     * @param enable True to let the modem sleep between exchanges
+     * @return true if the modem accepted both settings
+     */
+    bool setSleepMode(bool enable);
+
 private:
     HardwareSerial& _serial;
     TinyGsm* _modem;
+    ModemSleepStream* _sleepTap;
+    PmUartStream* _pmTap;
+    uint32_t _bootTimeMs;
+    ModemBootEvent _bootEvent;
     
 #if DUMP_AT_COMMANDS
     StreamDebugger* _debugger;
 #endif
+#if AT_CAPTURE_ENABLED
+    AtCaptureStream* _capture;
+#endif
 
     bool _initialized;
+    bool _hardwareReady;    // Pins and UART configured (initHardware ran)
+
+    /**
+     * @brief Create the TinyGSM instance (and AT debugger / capture tap) if needed
+     */
+    void createModem();
+
+    /**
+     * @brief Pulse PWRKEY to toggle modem power
+     * @param durationMs Pulse length in milliseconds
+     */
+    void pulsePowerKey(uint32_t durationMs);
+
+    /**
+     * @brief Hash the modem's stored configuration profile (AT&V)
+     * @return FNV-1a hash, or 0 on error
+     */
+    uint32_t queryProfileHash();
+
+    /**
+     * @brief Check stored profile against the hash recorded in NVS
+     * @return true if modem profile is known-good
+     */
+    bool isProfileValid();
+
+    /**
+     * @brief Save current config to modem NVRAM and record its hash
+     * @return true if saved
+     */
+    bool persistProfile();
 };
 
 } // namespace Drivers
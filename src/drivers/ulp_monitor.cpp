@@ -0,0 +1,184 @@
+/**
+ * @file ulp_monitor.cpp
+ * @brief ULP Monitor implementation
+ */
+
+#define LOG_MODULE Drivers::LogModule::POWER
+
+#include "ulp_monitor.h"
+#include "config.h"
+#include <esp_sleep.h>
+#include <esp32/ulp.h>
+#include <driver/adc.h>
+#include <driver/rtc_io.h>
+#include <soc/rtc_cntl_reg.h>
+#include <soc/rtc_io_reg.h>
+
+namespace Drivers {
+
+namespace {
+
+constexpr uint32_t PROGRAM_ADDR = 8;        // Words; variables live below
+constexpr size_t PROGRAM_MAX = 64;          // Instructions and labels
+static_assert(ULP_VAR_COUNT <= PROGRAM_ADDR, "ULP variables overlap the program");
+static_assert((PROGRAM_ADDR + PROGRAM_MAX) * 4 <= CONFIG_ESP32_ULP_COPROC_RESERVE_MEM,
+              "ULP program does not fit the reserved RTC slow memory");
+
+// Branch labels
+enum Label : uint8_t {
+    L_BATTERY_WAKE,
+    L_LID,
+    L_HEARTBEAT,
+    L_HEARTBEAT_WAKE,
+    L_WAKE,
+    L_WAIT_READY
+};
+
+uint16_t readVar(UlpVar var) {
+    return RTC_SLOW_MEM[var] & 0xFFFF;
+}
+
+/**
+ * @brief Assemble the monitor program (mirrors ulpMonitorStep)
+ * @return Number of instructions
+ */
+size_t assemble(ulp_insn_t* program, const UlpMonitorConfig& config) {
+    size_t n = 0;
+
+    // R3 = variable base; samples++
+    program[n++] = I_MOVI(R3, 0);
+    program[n++] = I_LD(R0, R3, ULP_VAR_SAMPLES);
+    program[n++] = I_ADDI(R0, R0, 1);
+    program[n++] = I_ST(R0, R3, ULP_VAR_SAMPLES);
+
+    if (config.batteryChannel >= 0) {
+        // level = mean of the samples; wake if outside [low, high]
+        program[n++] = I_MOVI(R1, 0);
+        for (uint8_t i = 0; i < ULP_ADC_OVERSAMPLE; i++) {
+            program[n++] = I_ADC(R0, 0, config.batteryChannel);
+            program[n++] = I_ADDR(R1, R1, R0);
+        }
+        program[n++] = I_RSHI(R0, R1, 2);
+        program[n++] = I_ST(R0, R3, ULP_VAR_BATT_LAST);
+        program[n++] = I_LD(R1, R3, ULP_VAR_BATT_LOW);
+        program[n++] = I_SUBR(R2, R0, R1);              // Overflow: level < low
+        program[n++] = M_BXF(L_BATTERY_WAKE);
+        program[n++] = I_LD(R1, R3, ULP_VAR_BATT_HIGH);
+        program[n++] = I_SUBR(R2, R1, R0);              // Overflow: level > high
+        program[n++] = M_BXF(L_BATTERY_WAKE);
+        program[n++] = M_BX(L_LID);
+        program[n++] = M_LABEL(L_BATTERY_WAKE);
+        program[n++] = I_MOVI(R0, (uint16_t)UlpWakeReason::BATTERY);
+        program[n++] = M_BX(L_WAKE);
+    }
+
+    program[n++] = M_LABEL(L_LID);
+    if (config.lidPin >= 0) {
+        // Wake on any change from the last level
+        int bit = RTC_GPIO_IN_NEXT_S + rtc_io_number_get((gpio_num_t)config.lidPin);
+        program[n++] = I_RD_REG(RTC_GPIO_IN_REG, bit, bit);
+        program[n++] = I_LD(R1, R3, ULP_VAR_LID_LAST);
+        program[n++] = I_SUBR(R2, R0, R1);
+        program[n++] = M_BXZ(L_HEARTBEAT);
+        program[n++] = I_ST(R0, R3, ULP_VAR_LID_LAST);
+        program[n++] = I_MOVI(R0, (uint16_t)UlpWakeReason::LID);
+        program[n++] = M_BX(L_WAKE);
+    }
+
+    // Count the heartbeat down; halt until the next period unless it expired
+    program[n++] = M_LABEL(L_HEARTBEAT);
+    program[n++] = I_LD(R0, R3, ULP_VAR_HEARTBEAT);
+    program[n++] = I_SUBI(R0, R0, 1);
+    program[n++] = M_BXZ(L_HEARTBEAT_WAKE);
+    program[n++] = I_ST(R0, R3, ULP_VAR_HEARTBEAT);
+    program[n++] = I_HALT();
+    program[n++] = M_LABEL(L_HEARTBEAT_WAKE);
+    program[n++] = I_MOVI(R0, (uint16_t)UlpWakeReason::HEARTBEAT);
+
+    // Record the reason, wait until the SoC can be woken, stop the ULP timer
+    program[n++] = M_LABEL(L_WAKE);
+    program[n++] = I_ST(R0, R3, ULP_VAR_REASON);
+    program[n++] = M_LABEL(L_WAIT_READY);
+    program[n++] = I_RD_REG(RTC_CNTL_LOW_POWER_ST_REG, RTC_CNTL_RDY_FOR_WAKEUP_S,
+                            RTC_CNTL_RDY_FOR_WAKEUP_S);
+    program[n++] = M_BL(L_WAIT_READY, 1);
+    program[n++] = I_WAKE();
+    program[n++] = I_END();
+    program[n++] = I_HALT();
+
+    return n;
+}
+
+} // namespace
+
+bool UlpMonitor::start(const UlpMonitorConfig& config) {
+    if (config.batteryChannel >= 0) {
+        adc1_config_width(ADC_WIDTH_BIT_12);
+        adc1_config_channel_atten((adc1_channel_t)config.batteryChannel, ADC_ATTEN_DB_11);
+        adc1_ulp_enable();
+    }
+
+    if (config.lidPin >= 0) {
+        gpio_num_t pin = (gpio_num_t)config.lidPin;
+        rtc_gpio_init(pin);
+        rtc_gpio_set_direction(pin, RTC_GPIO_MODE_INPUT_ONLY);
+        rtc_gpio_pullup_en(pin);
+        rtc_gpio_pulldown_dis(pin);
+        // Pull-up stays on through deep sleep
+        esp_sleep_pd_config(ESP_PD_DOMAIN_RTC_PERIPH, ESP_PD_OPTION_ON);
+    }
+
+    ulp_insn_t program[PROGRAM_MAX];
+    size_t size = assemble(program, config);
+
+    RTC_SLOW_MEM[ULP_VAR_BATT_LOW] = config.batteryLow;
+    RTC_SLOW_MEM[ULP_VAR_BATT_HIGH] = config.batteryHigh;
+    RTC_SLOW_MEM[ULP_VAR_BATT_LAST] = 0;
+    RTC_SLOW_MEM[ULP_VAR_LID_LAST] = config.lidLevel;
+    RTC_SLOW_MEM[ULP_VAR_HEARTBEAT] = config.heartbeatPeriods ? config.heartbeatPeriods : 1;
+    RTC_SLOW_MEM[ULP_VAR_REASON] = (uint16_t)UlpWakeReason::NONE;
+    RTC_SLOW_MEM[ULP_VAR_SAMPLES] = 0;
+
+    if (ulp_process_macros_and_load(PROGRAM_ADDR, program, &size) != ESP_OK) {
+        DEBUG_PRINTLN("[ULP] Program load failed");
+        return false;
+    }
+    if (ulp_set_wakeup_period(0, config.periodMs * 1000) != ESP_OK ||
+        esp_sleep_enable_ulp_wakeup() != ESP_OK ||
+        ulp_run(PROGRAM_ADDR) != ESP_OK) {
+        DEBUG_PRINTLN("[ULP] Start failed");
+        return false;
+    }
+
+    DEBUG_PRINTF("[ULP] %u instructions every %lu ms: battery %s [%u, %u], lid %s, heartbeat %u\n",
+                 (unsigned)size, config.periodMs, config.batteryChannel >= 0 ? "on" : "off",
+                 config.batteryLow, config.batteryHigh, config.lidPin >= 0 ? "on" : "off",
+                 config.heartbeatPeriods);
+    return true;
+}
+
+UlpWakeReason UlpMonitor::wakeReason() {
+    if (esp_sleep_get_wakeup_cause() != ESP_SLEEP_WAKEUP_ULP) {
+        return UlpWakeReason::NONE;
+    }
+    return (UlpWakeReason)readVar(ULP_VAR_REASON);
+}
+
+uint16_t UlpMonitor::lastBatteryRaw() {
+    return readVar(ULP_VAR_BATT_LAST);
+}
+
+uint16_t UlpMonitor::samples() {
+    return readVar(ULP_VAR_SAMPLES);
+}
+
+const char* UlpMonitor::reasonName(UlpWakeReason reason) {
+    switch (reason) {
+        case UlpWakeReason::BATTERY:   return "battery";
+        case UlpWakeReason::LID:       return "lid";
+        case UlpWakeReason::HEARTBEAT: return "heartbeat";
+        default:                       return "none";
+    }
+}
+
+} // namespace Drivers
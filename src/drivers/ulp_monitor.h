@@ -0,0 +1,75 @@
+/**
+ * @file ulp_monitor.h
+ * @brief ULP Monitor - battery / lid checks by the ULP coprocessor during deep sleep
+ */
+
+#ifndef ULP_MONITOR_H
+#define ULP_MONITOR_H
+
+#include <Arduino.h>
+#include "ulp_monitor_logic.h"
+
+namespace Drivers {
+
+/**
+ * @brief What the ULP checks while the main CPU sleeps
+ */
+struct UlpMonitorConfig {
+    int8_t batteryChannel;      // ADC1 channel of the battery divider (-1 = no check)
+    uint16_t batteryLow;        // Wake below this raw value
+    uint16_t batteryHigh;       // Wake above this raw value
+    int8_t lidPin;              // Lid switch RTC GPIO (-1 = no check)
+    uint8_t lidLevel;           // Lid level when armed
+    uint32_t periodMs;          // ULP run period
+    uint16_t heartbeatPeriods;  // Runs until the scheduled wake
+};
+
+/**
+ * @brief ULP coprocessor monitor
+ *
+ * A short ULP FSM program, assembled at runtime with the ulp_macro
+ * instructions, runs every periodMs while the main cores are in deep sleep.
+ * Each run averages ULP_ADC_OVERSAMPLE battery samples and compares them
+ * with a band, compares the lid switch with its armed level and counts the
+ * heartbeat down. The CPU is woken only when one of them fires; otherwise
+ * the ULP halts until its next period. The decision logic is described by
+ * ulpMonitorStep() (ulp_monitor_logic.h), which tools/ulp_sim runs on a PC.
+ */
+class UlpMonitor {
+public:
+    /**
+     * @brief Load the program, set the shared variables and start the ULP
+     * @param config Checks to run
+     * @return true if the ULP is running and armed as a wake source
+     */
+    static bool start(const UlpMonitorConfig& config);
+
+    /**
+     * @brief Why the ULP woke the CPU
+     * @return Reason, or NONE if this boot was not a ULP wake
+     */
+    static UlpWakeReason wakeReason();
+
+    /**
+     * @brief Last battery value the ULP sampled
+     * @return Raw ADC value (0 if not sampled)
+     */
+    static uint16_t lastBatteryRaw();
+
+    /**
+     * @brief Number of ULP runs in the last sleep
+     * @return Runs since the monitor was started
+     */
+    static uint16_t samples();
+
+    /**
+     * @brief Name of a wake reason for logs
+     * @param reason Wake reason
+     * @return Static string
+     */
+    static const char* reasonName(UlpWakeReason reason);
+};
+
+} // namespace Drivers
+
+#endif // ULP_MONITOR_H
@@ -0,0 +1,94 @@
+/**
+ * @file ulp_monitor_logic.h
+ * @brief ULP Monitor decision logic - shared by the ULP program and the host simulator
+ *
+ * Plain C++ with no ESP-IDF dependencies, so tools/ulp_sim builds it on a PC.
+ * UlpMonitor assembles the ULP program from the same variable layout and
+ * mirrors ulpMonitorStep() instruction for instruction; keep the two in step.
+ */
+
+#ifndef ULP_MONITOR_LOGIC_H
+#define ULP_MONITOR_LOGIC_H
+
+#include <stdint.h>
+
+namespace Drivers {
+
+/**
+ * @brief Shared variables at the start of RTC slow memory (one word each)
+ *
+ * The ULP reads and writes the low 16 bits of each word.
+ */
+enum UlpVar : uint8_t {
+    ULP_VAR_BATT_LOW,       // Band: wake below this raw ADC value
+    ULP_VAR_BATT_HIGH,      // Band: wake above this raw ADC value
+    ULP_VAR_BATT_LAST,      // Last battery sample (4x averaged)
+    ULP_VAR_LID_LAST,       // Lid level when armed / last seen
+    ULP_VAR_HEARTBEAT,      // ULP periods left until the next scheduled wake
+    ULP_VAR_REASON,         // UlpWakeReason of the last wake
+    ULP_VAR_SAMPLES,        // ULP runs since armed
+    ULP_VAR_COUNT
+};
+
+/**
+ * @brief Why the ULP woke the main CPU
+ */
+enum class UlpWakeReason : uint16_t {
+    NONE,           // Not woken by the ULP
+    BATTERY,        // Battery left its band
+    LID,            // Lid switch changed
+    HEARTBEAT       // Next sample is due
+};
+
+constexpr uint8_t ULP_ADC_OVERSAMPLE = 4;   // Samples averaged per run (power of two)
+
+/**
+ * @brief Inputs sampled by one ULP run
+ */
+struct UlpInputs {
+    uint16_t adc[ULP_ADC_OVERSAMPLE];   // Battery ADC samples
+    uint16_t lidLevel;                  // Lid switch GPIO level (0/1)
+};
+
+/**
+ * @brief One ULP run: sample, compare, count down
+ * @param vars Shared variables (ULP_VAR_COUNT entries, 16-bit values)
+ * @param in Sampled inputs
+ * @param battery Battery check compiled in
+ * @param lid Lid check compiled in
+ * @return Wake reason (NONE = halt until the next period)
+ */
+inline UlpWakeReason ulpMonitorStep(uint16_t* vars, const UlpInputs& in, bool battery, bool lid) {
+    vars[ULP_VAR_SAMPLES]++;
+
+    if (battery) {
+        uint16_t sum = 0;
+        for (uint8_t i = 0; i < ULP_ADC_OVERSAMPLE; i++) {
+            sum += in.adc[i];
+        }
+        uint16_t level = sum / ULP_ADC_OVERSAMPLE;
+        vars[ULP_VAR_BATT_LAST] = level;
+        if (level < vars[ULP_VAR_BATT_LOW] || level > vars[ULP_VAR_BATT_HIGH]) {
+            vars[ULP_VAR_REASON] = (uint16_t)UlpWakeReason::BATTERY;
+            return UlpWakeReason::BATTERY;
+        }
+    }
+
+    if (lid && in.lidLevel != vars[ULP_VAR_LID_LAST]) {
+        vars[ULP_VAR_LID_LAST] = in.lidLevel;
+        vars[ULP_VAR_REASON] = (uint16_t)UlpWakeReason::LID;
+        return UlpWakeReason::LID;
+    }
+
+    uint16_t left = vars[ULP_VAR_HEARTBEAT] - 1;
+    if (left == 0) {
+        vars[ULP_VAR_REASON] = (uint16_t)UlpWakeReason::HEARTBEAT;
+        return UlpWakeReason::HEARTBEAT;
+    }
+    vars[ULP_VAR_HEARTBEAT] = left;
+    return UlpWakeReason::NONE;
+}
+
+} // namespace Drivers
+
+#endif // ULP_MONITOR_LOGIC_H
@@ -0,0 +1,200 @@
+/**
+ * @file us_array_driver.cpp
+ * @brief Ultrasonic Sensor Array Driver implementation
+ */
+
+#include "us_array_driver.h"
+#include <driver/mcpwm.h>
+#include <soc/soc.h>
+
+namespace Drivers {
+
+namespace {
+
+constexpr uint8_t CHANNELS_PER_UNIT = 3;
+constexpr uint32_t TICKS_PER_US = APB_CLK_FREQ / 1000000;
+
+// A later-slot echo this close to an earlier-slot echo shifted by the
+// stagger is the earlier sensor's ping, not a real surface
+constexpr uint32_t CROSSTALK_TOLERANCE_US = 150;
+
+mcpwm_unit_t unitFor(uint8_t index) {
+    return (index < CHANNELS_PER_UNIT) ? MCPWM_UNIT_0 : MCPWM_UNIT_1;
+}
+
+mcpwm_capture_channel_id_t channelFor(uint8_t index) {
+    return (mcpwm_capture_channel_id_t)(index % CHANNELS_PER_UNIT);
+}
+
+bool IRAM_ATTR onCapture(mcpwm_unit_t unit, mcpwm_capture_channel_id_t channel,
+                         const cap_event_data_t* edata, void* arg) {
+    EchoChannel* ch = (EchoChannel*)arg;
+
+    if (edata->cap_edge == MCPWM_POS_EDGE) {
+        ch->riseTicks = edata->cap_value;
+        ch->risen = true;
+    } else if (ch->risen && !ch->done) {
+        ch->widthTicks = edata->cap_value - ch->riseTicks;
+        ch->done = true;
+    }
+    return false;
+}
+
+} // namespace
+
+UltrasonicArrayDriver::UltrasonicArrayDriver(const UsArraySensor* sensors, uint8_t count)
+    : _sensors(sensors), _count(count > MAX_SENSORS ? MAX_SENSORS : count),
+      _maxSlot(0), _initialized(false) {
+    memset(_channels, 0, sizeof(_channels));
+}
+
+bool UltrasonicArrayDriver::init() {
+    bool ok = true;
+
+    for (uint8_t i = 0; i < _count; i++) {
+        const UsArraySensor& s = _sensors[i];
+
+        GpioDriver::configurePin(s.triggerPin, PinMode::OUTPUT_MODE);
+        GpioDriver::writeDigital(s.triggerPin, LOW);
+        GpioDriver::configurePin(s.echoPin, PinMode::INPUT_MODE);
+
+        if (s.slot > _maxSlot) {
+            _maxSlot = s.slot;
+        }
+
+        // Route echo pin to its own capture input, timestamp both edges
+        mcpwm_io_signals_t signal = (mcpwm_io_signals_t)((int)MCPWM_CAP_0 + (int)channelFor(i));
+        mcpwm_capture_config_t conf = {};
+        conf.cap_edge = MCPWM_BOTH_EDGE;
+        conf.cap_prescale = 1;
+        conf.capture_cb = onCapture;
+        conf.user_data = &_channels[i];
+
+        if (mcpwm_gpio_init(unitFor(i), signal, s.echoPin) != ESP_OK ||
+            mcpwm_capture_enable_channel(unitFor(i), channelFor(i), &conf) != ESP_OK) {
+            ok = false;
+        }
+    }
+
+    delay(50); // Let sensors settle
+    _initialized = ok;
+    return ok;
+}
+
+uint8_t UltrasonicArrayDriver::getCount() {
+    return _count;
+}
+
+uint8_t UltrasonicArrayDriver::measureEchoDurations(uint32_t* durationsUs, uint32_t timeoutUs,
+                                                    uint32_t staggerUs) {
+    if (!_initialized) {
+        return 0;
+    }
+
+    for (uint8_t i = 0; i < _count; i++) {
+        _channels[i].risen = false;
+        _channels[i].done = false;
+        durationsUs[i] = 0;
+    }
+
+    // Fire slot by slot; sensors within a slot are triggered together
+    uint32_t start = micros();
+    for (uint8_t slot = 0; slot <= _maxSlot; slot++) {
+        if (slot > 0) {
+            delayMicroseconds(staggerUs);
+        }
+        for (uint8_t i = 0; i < _count; i++) {
+            if (_sensors[i].slot == slot) {
+                GpioDriver::writeDigital(_sensors[i].triggerPin, HIGH);
+            }
+        }
+        delayMicroseconds(10);
+        for (uint8_t i = 0; i < _count; i++) {
+            if (_sensors[i].slot == slot) {
+                GpioDriver::writeDigital(_sensors[i].triggerPin, LOW);
+            }
+        }
+    }
+
+    // Echoes are captured in hardware; wait for all of them or the window end
+    uint32_t window = timeoutUs + _maxSlot * staggerUs;
+    while (micros() - start < window) {
+        bool pending = false;
+        for (uint8_t i = 0; i < _count; i++) {
+            if (!_channels[i].done) {
+                pending = true;
+                break;
+            }
+        }
+        if (!pending) {
+            break;
+        }
+        delayMicroseconds(100);
+    }
+
+    for (uint8_t i = 0; i < _count; i++) {
+        if (_channels[i].done) {
+            uint32_t us = _channels[i].widthTicks / TICKS_PER_US;
+            durationsUs[i] = (us < timeoutUs) ? us : 0;
+        }
+    }
+
+    // Drop later-slot echoes that line up with an earlier sensor's ping
+    uint8_t valid = 0;
+    for (uint8_t j = 0; j < _count; j++) {
+        for (uint8_t i = 0; i < _count && durationsUs[j] != 0; i++) {
+            if (_sensors[i].slot >= _sensors[j].slot || durationsUs[i] == 0) {
+                continue;
+            }
+            uint32_t shift = (_sensors[j].slot - _sensors[i].slot) * staggerUs;
+            if (durationsUs[i] <= shift) {
+                continue;
+            }
+            int32_t diff = (int32_t)(durationsUs[i] - shift) - (int32_t)durationsUs[j];
+            if (abs(diff) < (int32_t)CROSSTALK_TOLERANCE_US) {
+                durationsUs[j] = 0;
+            }
+        }
+        if (durationsUs[j] != 0) {
+            valid++;
+        }
+    }
+
+    return valid;
+}
+
+uint8_t UltrasonicArrayDriver::measureDistancesAvgCm(float* distancesCm, uint8_t samples,
+                                                     uint32_t timeoutUs, uint32_t staggerUs) {
+    if (samples == 0) samples = 1;
+
+    float sum[MAX_SENSORS] = {};
+    uint8_t validSamples[MAX_SENSORS] = {};
+    uint32_t durations[MAX_SENSORS];
+
+    for (uint8_t n = 0; n < samples; n++) {
+        measureEchoDurations(durations, timeoutUs, staggerUs);
+
+        for (uint8_t i = 0; i < _count; i++) {
+            if (durations[i] > 0) {
+                sum[i] += (durations[i] * SOUND_SPEED_CM_PER_US) / 2.0f;
+                validSamples[i]++;
+            }
+        }
+
+        delay(60); // Minimum 60ms between measurements for US-100
+    }
+
+    uint8_t validSensors = 0;
+    for (uint8_t i = 0; i < _count; i++) {
+        if (validSamples[i] == 0) {
+            distancesCm[i] = -1.0f;
+        } else {
+            distancesCm[i] = sum[i] / validSamples[i];
+            validSensors++;
+        }
+    }
+
+    return validSensors;
+}
+
+} // namespace Drivers
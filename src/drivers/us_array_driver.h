@@ -0,0 +1,105 @@
+/**
+ * @file us_array_driver.h
+ * @brief Ultrasonic Sensor Array Driver - staggered triggers, MCPWM echo capture
+ */
+
+#ifndef US_ARRAY_DRIVER_H
+#define US_ARRAY_DRIVER_H
+
+#include <Arduino.h>
+#include "gpio_driver.h"
+
+namespace Drivers {
+
+/**
+ * @brief One ultrasonic sensor of the array
+ */
+struct UsArraySensor {
+    uint8_t triggerPin;  // GPIO pin for trigger
+    uint8_t echoPin;     // GPIO pin for echo (routed to an MCPWM capture input)
+    uint8_t slot;        // Firing slot; sensors sharing a slot fire together
+};
+
+/**
+ * @brief Per-channel echo capture state, written from the capture ISR
+ */
+struct EchoChannel {
+    volatile uint32_t riseTicks;
+    volatile uint32_t widthTicks;
+    volatile bool risen;
+    volatile bool done;
+};
+
+/**
+ * @brief Ultrasonic Sensor Array Driver (HC-SR04 / US-100 GPIO mode)
+ *
+ * Each echo line is routed to its own MCPWM capture channel (2 units x 3
+ * channels), so all echo pulses are timestamped in hardware in parallel
+ * instead of busy-waiting on one pin at a time.
+ *
+ * Crosstalk: sensors are grouped in firing slots. Sensors in the same slot
+ * fire simultaneously and must not see each other's beam; slots are fired
+ * in order, separated by a short stagger, so neighbouring sensors are not
+ * triggered into each other's ping. A full cycle still fits in one echo
+ * window, so acquisition time stays close to that of a single sensor.
+ *
+ * Capture timestamps count APB clock ticks; callers must keep APB at
+ * 80 MHz during a measurement (PmLockId::SENSOR_CAPTURE).
+ */
+class UltrasonicArrayDriver {
+public:
+    static constexpr uint8_t MAX_SENSORS = 6;
+
+    /**
+     * @brief Constructor
+     * @param sensors Sensor table (must outlive the driver)
+     * @param count Number of sensors (0 disables the array)
+     */
+    UltrasonicArrayDriver(const UsArraySensor* sensors, uint8_t count);
+
+    /**
+     * @brief Configure trigger pins and capture channels
+     * @return true if all capture channels were enabled
+     */
+    bool init();
+
+    /**
+     * @brief Get number of configured sensors
+     * @return Sensor count
+     */
+    uint8_t getCount();
+
+    /**
+     * @brief Fire one staggered cycle and capture all echoes
+     * @param durationsUs Output echo durations per sensor (0 = no echo)
+     * @param timeoutUs Echo timeout in microseconds (per sensor)
+     * @param staggerUs Delay between firing slots in microseconds
+     * @return Number of sensors that returned an echo
+     */
+    uint8_t measureEchoDurations(uint32_t* durationsUs, uint32_t timeoutUs, uint32_t staggerUs);
+
+    /**
+     * @brief Measure all sensors with averaging
+     * @param distancesCm Output averaged distance per sensor (-1 = all samples failed)
+     * @param samples Number of cycles to average
+     * @param timeoutUs Echo timeout in microseconds
+     * @param staggerUs Delay between firing slots in microseconds
+     * @return Number of sensors with at least one valid sample
+     */
+    uint8_t measureDistancesAvgCm(float* distancesCm, uint8_t samples,
+                                  uint32_t timeoutUs, uint32_t staggerUs);
+
+private:
+    const UsArraySensor* _sensors;
+    uint8_t _count;
+    uint8_t _maxSlot;
+    bool _initialized;
+    EchoChannel _channels[MAX_SENSORS];
+
+    // Speed of sound in cm/us (343 m/s = 0.0343 cm/us), as in US100Driver
+    static constexpr float SOUND_SPEED_CM_PER_US = 0.0343f;
+};
+
+} // namespace Drivers
+
+#endif // US_ARRAY_DRIVER_H
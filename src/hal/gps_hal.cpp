@@ -3,6 +3,8 @@
  * @brief GPS HAL implementation
  */
 
+#define LOG_MODULE Drivers::LogModule::GPS
+
 #include "gps_hal.h"
 #include "config.h"
 
@@ -3,8 +3,11 @@
  * @brief Modem HAL implementation
  */
 
+#define LOG_MODULE Drivers::LogModule::MODEM
+
 #include "modem_hal.h"
 #include "config.h"
+#include "../drivers/modem_sleep.h"
 
 namespace HAL {
 
@@ -23,11 +26,9 @@ bool ModemHAL::init() {
         return false;
     }
     
-    // Power on modem
+    // Power on modem; a missed readiness signal is recovered by initModem()
     if (!_driver.powerOn()) {
-        _status = ModemStatus::ERROR;
-        DEBUG_PRINTLN("[ModemHAL] Power on failed");
-        return false;
+        DEBUG_PRINTLN("[ModemHAL] Power on not confirmed, continuing");
     }
     
     // Initialize modem communication
@@ -38,13 +39,21 @@ bool ModemHAL::init() {
     }
     
     _status = ModemStatus::READY;
-    DEBUG_PRINTLN("[ModemHAL] Modem ready");
-    DEBUG_PRINTF("[ModemHAL] Name: %s\n", _driver.getModemName().c_str());
-    DEBUG_PRINTF("[ModemHAL] Info: %s\n", _driver.getModemInfo().c_str());
+    DEBUG_PRINTF("[ModemHAL] Modem ready (boot %lu ms)\n", _driver.getBootTimeMs());
+    
+#if MODEM_SLEEP_ENABLED
+    sleep();
+#endif
     
+    // Name/info queries are deferred to logInfo() - not needed to publish
     return true;
 }
 
+void ModemHAL::logInfo() {
+    DEBUG_PRINTF("[ModemHAL] Name: %s\n", _driver.getModemName().c_str());
+    DEBUG_PRINTF("[ModemHAL] Info: %s\n", _driver.getModemInfo().c_str());
+}
+
 bool ModemHAL::isReady() {
     return _status == ModemStatus::READY;
 }
@@ -61,6 +70,38 @@ String ModemHAL::getInfo() {
     return _driver.getModemName() + " - " + _driver.getModemInfo();
 }
 
+String ModemHAL::getIMEI() {
+    return _driver.getIMEI();
+}
+
+int ModemHAL::getSignalQuality() {
+    return _driver.getSignalQuality();
+}
+
+bool ModemHAL::getRsrp(int16_t& rsrpDbm) {
+    return _driver.getRsrp(rsrpDbm);
+}
+
+bool ModemHAL::setRadioMode(uint8_t networkMode, uint8_t preferredMode) {
+    return _driver.setRadioMode(networkMode, preferredMode);
+}
+
+int16_t ModemHAL::getSystemMode() {
+    return _driver.getSystemMode();
+}
+
+bool ModemHAL::getServingCell(Drivers::ServingCell& cell) {
+    return _driver.getServingCell(cell);
+}
+
+bool ModemHAL::selectOperator(const char* plmn) {
+    return _driver.selectOperator(plmn);
+}
+
+bool ModemHAL::setBands(const char* mode, const char* bands) {
+    return _driver.setBands(mode, bands);
+}
+
 bool ModemHAL::checkSim(const char* pin) {
     DEBUG_PRINTLN("[ModemHAL] Checking SIM...");
     
@@ -92,7 +133,7 @@ bool ModemHAL::checkSim(const char* pin) {
     if (simStatus == 0) {
         DEBUG_PRINTLN("[ModemHAL] SIM error - check if SIM is inserted");
     } else if (simStatus == 2) {
-        DEBUG_PRINTLN("[ModemHAL] SIM locked - PIN required, set SIM_PIN in config.h");
+        DEBUG_PRINTLN("[ModemHAL] SIM locked - PIN required, provision sim_pin");
     } else if (simStatus == 3) {
         DEBUG_PRINTLN("[ModemHAL] SIM antitheft locked");
     }
@@ -107,19 +148,72 @@ void ModemHAL::restart() {
     
     if (_driver.initModem()) {
         _status = ModemStatus::READY;
+#if MODEM_SLEEP_ENABLED
+        sleep();
+#endif
     } else {
         _status = ModemStatus::ERROR;
     }
 }
 
+void ModemHAL::powerOff() {
+    // Probe first: a PWRKEY pulse on a modem that is already off turns it on
+    if (_status == ModemStatus::OFF && !_driver.isPoweredOn()) {
+        return;
+    }
+    _driver.powerOff();
+    _status = ModemStatus::OFF;
+}
+
 void ModemHAL::sleep() {
-    DEBUG_PRINTLN("[ModemHAL] Entering sleep mode...");
-    _driver.getModem().sleepEnable(true);
+    if (!_driver.setSleepMode(true)) {
+        DEBUG_PRINTLN("[ModemHAL] Slow clock not accepted, modem stays awake");
+    }
 }
 
 void ModemHAL::wake() {
-    DEBUG_PRINTLN("[ModemHAL] Waking from sleep...");
-    _driver.getModem().sleepEnable(false);
+    _driver.setSleepMode(false);
+}
+
+bool ModemHAL::prepareDeepSleep() {
+    if (_status == ModemStatus::OFF) {
+        return false;
+    }
+    return Drivers::ModemSleep::prepareDeepSleep();
+}
+
+bool ModemHAL::hasPendingData() {
+    return _driver.hasPendingData();
+}
+
+bool ModemHAL::getLocalTime(uint32_t& localSec, int16_t& utcOffsetMin) {
+    if (!isReady()) {
+        return false;
+    }
+    
+    int year, month, day, hour, minute, second;
+    float timezone;
+    if (!_driver.getModem().getNetworkTime(&year, &month, &day, &hour, &minute,
+                                           &second, &timezone)) {
+        return false;
+    }
+    
+    // Modem RTC starts at its factory date until the network provides time
+    if (year < 2024 || month < 1 || month > 12) {
+        return false;
+    }
+    
+    // Days since 1970-01-01 (civil calendar, March-based year)
+    int y = (month <= 2) ? year - 1 : year;
+    int era = y / 400;
+    int yoe = y - era * 400;
+    int doy = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+    int doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    uint32_t days = era * 146097 + doe - 719468;
+    
+    localSec = days * 86400UL + hour * 3600UL + minute * 60UL + second;
+    utcOffsetMin = (int16_t)(timezone * 60);
+    return true;
 }
 
 } // namespace HAL
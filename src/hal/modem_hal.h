@@ -62,6 +62,66 @@ public:
      */
     String getInfo();
 
+    /**
+     * @brief Get modem IMEI
+     * @return IMEI digits (empty if unavailable)
+     */
+    String getIMEI();
+
+    /**
+     * @brief Get signal quality (AT+CSQ)
+     * @return CSQ 0-31, 99 if unknown
+     */
+    int getSignalQuality();
+
+    /**
+     * @brief Get LTE reference signal power (AT+CESQ)
+     * @param rsrpDbm Output RSRP in dBm
+     * @return true if reported
+     */
+    bool getRsrp(int16_t& rsrpDbm);
+
+    /**
+     * @brief Restrict the radio access technologies searched
+     * @param networkMode AT+CNMP mode
+     * @param preferredMode AT+CMNB mode (0 = leave)
+     * @return true if accepted
+     */
+    bool setRadioMode(uint8_t networkMode, uint8_t preferredMode);
+
+    /**
+     * @brief Get the serving system (AT+CNSMOD)
+     * @return System mode, -1 on error
+     */
+    int16_t getSystemMode();
+
+    /**
+     * @brief Get the serving cell (AT+CPSI)
+     * @param cell Output cell info
+     * @return true if online on a cell
+     */
+    bool getServingCell(Drivers::ServingCell& cell);
+
+    /**
+     * @brief Select the operator (AT+COPS)
+     * @param plmn MCC+MNC to try first, NULL or empty for automatic
+     * @return true if accepted
+     */
+    bool selectOperator(const char* plmn);
+
+    /**
+     * @brief Set the LTE bands searched (AT+CBANDCFG)
+     * @param mode "CAT-M" or "NB-IOT"
+     * @param bands Comma-separated band list
+     * @return true if accepted
+     */
+    bool setBands(const char* mode, const char* bands);
+
+    /**
+     * @brief Query and log modem name/info (non-essential, run after first publish)
+     */
+    void logInfo();
+
     /**
      * @brief Check and unlock SIM if needed
      * @param pin SIM PIN (empty if not required)
@@ -75,15 +135,40 @@ public:
     void restart();
 
     /**
-     * @brief Put modem to sleep
+     * @brief Power the modem down (no-op if it is already off)
+     */
+    void powerOff();
+
+    /**
+     * @brief Let the modem sleep between exchanges (DTR slow clock, RI wake)
      */
     void sleep();
 
     /**
-     * @brief Wake modem from sleep
+     * @brief Keep the modem awake (slow clock off)
      */
     void wake();
 
+    /**
+     * @brief Keep the modem in slow clock over deep sleep, RI wakes the CPU
+     * @return true if RI is armed as a wake source
+     */
+    bool prepareDeepSleep();
+
+    /**
+     * @brief Check if the modem has sent data not yet processed
+     * @return true if UART RX data is pending
+     */
+    bool hasPendingData();
+
+    /**
+     * @brief Get network-synchronized local time from the modem clock
+     * @param localSec Output local time as seconds since 1970-01-01
+     * @param utcOffsetMin Output offset of local time from UTC in minutes
+     * @return true if the modem clock holds a network time
+     */
+    bool getLocalTime(uint32_t& localSec, int16_t& utcOffsetMin);
+
 private:
     Drivers::SIM7000Driver& _driver;
     ModemStatus _status;
@@ -3,11 +3,32 @@
  * @brief Power HAL implementation
  */
 
+#define LOG_MODULE Drivers::LogModule::POWER
+
 #include "power_hal.h"
 #include "config.h"
+#include "../drivers/log_driver.h"
+#include <esp_sleep.h>
 
 namespace HAL {
 
+namespace {
+
+constexpr uint32_t BAND_MAGIC = 0x554C5042; // "ULPB"
+
+/**
+ * @brief ULP battery band, kept in RTC memory across deep sleep
+ */
+struct UlpBand {
+    uint32_t magic;
+    uint16_t low;
+    uint16_t high;
+};
+
+RTC_DATA_ATTR UlpBand s_band;
+
+} // namespace
+
 PowerHAL::PowerHAL(int8_t adcPin, float voltageDivider)
     : _adcPin(adcPin), _voltageDivider(voltageDivider),
       _minVoltage(BATTERY_MIN_VOLTAGE), _maxVoltage(BATTERY_MAX_VOLTAGE),
@@ -88,6 +109,119 @@ void PowerHAL::setSimulatedLevel(uint8_t percentage) {
     _useSimulated = true;
 }
 
+bool PowerHAL::initPowerManagement(uint8_t uartNum, int8_t ringPin) {
+    DEBUG_PRINTLN("[PowerHAL] Initializing power management...");
+
+    if (!Drivers::PmDriver::configure(PM_MAX_CPU_FREQ_MHZ, PM_MIN_CPU_FREQ_MHZ,
+                                      PM_LIGHT_SLEEP_ENABLED)) {
+        DEBUG_PRINTLN("[PowerHAL] Power management unavailable, running at full clock");
+        return false;
+    }
+
+    // Timer wake is implicit (tickless idle); add modem UART RX and RI
+    if (!Drivers::PmDriver::enableUartWakeup(uartNum, PM_UART_WAKE_THRESHOLD)) {
+        DEBUG_PRINTLN("[PowerHAL] Warning: UART wake source not enabled");
+    }
+
+    if (ringPin >= 0 && !Drivers::PmDriver::enableGpioWakeup(ringPin, LOW)) {
+        DEBUG_PRINTLN("[PowerHAL] Warning: GPIO wake source not enabled");
+    }
+
+    return true;
+}
+
+Drivers::PmStats PowerHAL::getPmStats() {
+    return Drivers::PmDriver::getStats();
+}
+
+void PowerHAL::printPmStats() {
+    Drivers::PmStats stats = Drivers::PmDriver::getStats();
+
+    DEBUG_PRINTF("[PowerHAL] PM %s, light sleep %s, idle %d%% of %lu s\n",
+                 stats.enabled ? "on" : "off",
+                 stats.lightSleepEnabled ? "on" : "off",
+                 stats.idlePercent, (uint32_t)(stats.uptimeUs / 1000000ULL));
+    DEBUG_PRINTF("[PowerHAL] Locks held (ms): cpu=%lu uart=%lu sensor=%lu log=%lu led=%lu\n",
+                 (uint32_t)(stats.heldUs[(uint8_t)Drivers::PmLockId::CPU] / 1000),
+                 (uint32_t)(stats.heldUs[(uint8_t)Drivers::PmLockId::UART_RX] / 1000),
+                 (uint32_t)(stats.heldUs[(uint8_t)Drivers::PmLockId::SENSOR_CAPTURE] / 1000),
+                 (uint32_t)(stats.heldUs[(uint8_t)Drivers::PmLockId::LOG_TX] / 1000),
+                 (uint32_t)(stats.heldUs[(uint8_t)Drivers::PmLockId::LED] / 1000));
+
+    Drivers::PmDriver::dumpLocks();
+}
+
+bool PowerHAL::configureUlp(Drivers::UlpMonitorConfig& config) {
+    config.batteryChannel = -1;
+    config.batteryLow = 0;
+    config.batteryHigh = 0xFFFF;
+
+    // The ULP can only sample ADC1 (channels 0-7)
+    int8_t channel = _available ? digitalPinToAnalogChannel(_adcPin) : -1;
+    if (channel < 0 || channel > 7) {
+        DEBUG_PRINTLN("[PowerHAL] Battery pin not on ADC1, ULP battery check off");
+        return false;
+    }
+
+    // Keep the band until the battery leaves it: re-centring before every
+    // sleep would follow a slow drain and never wake for it
+    if (s_band.magic == BAND_MAGIC &&
+        Drivers::UlpMonitor::wakeReason() != Drivers::UlpWakeReason::BATTERY) {
+        config.batteryChannel = channel;
+        config.batteryLow = s_band.low;
+        config.batteryHigh = s_band.high;
+        DEBUG_PRINTF("[PowerHAL] ULP battery band %u..%u raw (kept)\n",
+                     config.batteryLow, config.batteryHigh);
+        return true;
+    }
+
+    // Raw counts per mV at the pin, from the calibrated reading
+    uint32_t raw = 0;
+    for (uint8_t i = 0; i < 8; i++) {
+        raw += Drivers::AdcDriver::readRaw(_adcPin);
+    }
+    raw /= 8;
+    uint32_t pinMilliV = Drivers::AdcDriver::readMilliVoltsAvg(_adcPin, 8);
+    if (raw == 0 || pinMilliV == 0) {
+        return false;
+    }
+
+    uint32_t band = (uint32_t)(ULP_BATTERY_BAND_MV / _voltageDivider * raw / pinMilliV);
+    config.batteryChannel = channel;
+    config.batteryLow = raw > band ? raw - band : 0;
+    config.batteryHigh = raw + band < 4095 ? raw + band : 4095;
+    s_band.low = config.batteryLow;
+    s_band.high = config.batteryHigh;
+    s_band.magic = BAND_MAGIC;
+
+    DEBUG_PRINTF("[PowerHAL] ULP battery band %u..%u raw (now %lu, %lumV)\n",
+                 config.batteryLow, config.batteryHigh, raw,
+                 (uint32_t)(pinMilliV * _voltageDivider));
+    return true;
+}
+
+void PowerHAL::enterDeepSleep(Drivers::UlpMonitorConfig& config, uint32_t sleepMs) {
+    config.periodMs = ULP_PERIOD_MS;
+    uint32_t periods = sleepMs / ULP_PERIOD_MS;
+    config.heartbeatPeriods = periods == 0 ? 1 : (periods > 0xFFFF ? 0xFFFF : periods);
+
+    bool monitored = (config.batteryChannel >= 0 || config.lidPin >= 0) &&
+                     Drivers::UlpMonitor::start(config);
+    if (!monitored) {
+        // Nothing for the ULP to watch: plain timer wake
+        esp_sleep_enable_timer_wakeup((uint64_t)sleepMs * 1000ULL);
+    }
+
+    DEBUG_PRINTF("[PowerHAL] Deep sleep for %lu s (%s)\n", sleepMs / 1000,
+                 monitored ? "ULP monitor" : "timer");
+    Drivers::LogDriver::flush();
+    esp_deep_sleep_start();
+}
+
+Drivers::UlpWakeReason PowerHAL::getWakeReason() {
+    return Drivers::UlpMonitor::wakeReason();
+}
+
 uint8_t PowerHAL::voltageToPercentage(float voltageV) {
     if (voltageV <= _minVoltage) return 0;
     if (voltageV >= _maxVoltage) return 100;
@@ -8,6 +8,8 @@
 
 #include <Arduino.h>
 #include "../drivers/adc_driver.h"
+#include "../drivers/pm_driver.h"
+#include "../drivers/ulp_monitor.h"
 
 namespace HAL {
 
@@ -76,6 +78,48 @@ public:
      */
     void setSimulatedLevel(uint8_t percentage);
 
+    /**
+     * @brief Enable DFS, automatic light sleep and wake sources
+     * @param uartNum Modem UART number (RX wakes the CPU)
+     * @param ringPin Modem RI pin (active low, -1 to skip)
+     * @return true if power management is active
+     */
+    bool initPowerManagement(uint8_t uartNum, int8_t ringPin = -1);
+
+    /**
+     * @brief Get power management residency statistics
+     * @return Statistics snapshot
+     */
+    Drivers::PmStats getPmStats();
+
+    /**
+     * @brief Log power management residency statistics
+     */
+    void printPmStats();
+
+    /**
+     * @brief Fill the ULP battery band around the current voltage
+     *
+     * The band is kept in RTC memory and only re-centred after the battery
+     * left it (a BATTERY wake), so a slow drain still causes a wake.
+     * @param config ULP config to update (battery check off if unsupported)
+     * @return true if the ULP can watch the battery (ADC1 pin)
+     */
+    bool configureUlp(Drivers::UlpMonitorConfig& config);
+
+    /**
+     * @brief Start the ULP monitor and enter deep sleep (does not return)
+     * @param config Checks for the ULP
+     * @param sleepMs Time until the scheduled (heartbeat) wake
+     */
+    void enterDeepSleep(Drivers::UlpMonitorConfig& config, uint32_t sleepMs);
+
+    /**
+     * @brief Why the ULP woke the CPU at this boot
+     * @return Wake reason (NONE if not a ULP wake)
+     */
+    Drivers::UlpWakeReason getWakeReason();
+
 private:
     int8_t _adcPin;
     float _voltageDivider;
@@ -3,18 +3,30 @@
  * @brief Sensor HAL implementation
  */
 
+#define LOG_MODULE Drivers::LogModule::SENSOR
+
 #include "sensor_hal.h"
 #include "config.h"
+#include "../drivers/pm_driver.h"
+#include <driver/rtc_io.h>
 
 namespace HAL {
 
-SensorHAL::SensorHAL(Drivers::US100Driver& driver)
-    : _driver(driver), _timeoutUs(US100_TIMEOUT_US), _initialized(false) {
+SensorHAL::SensorHAL(Drivers::US100Driver& driver, Drivers::UltrasonicArrayDriver& array)
+    : _driver(driver), _array(array), _timeoutUs(US100_TIMEOUT_US), _initialized(false) {
 }
 
 bool SensorHAL::init() {
     DEBUG_PRINTLN("[SensorHAL] Initializing sensor...");
     
+    if (hasArray()) {
+        // Array owns the trigger/echo pins; echoes go to MCPWM capture
+        _initialized = _array.init();
+        DEBUG_PRINTF("[SensorHAL] Sensor array: %d sensors, capture %s\n",
+                     _array.getCount(), _initialized ? "ready" : "FAILED");
+        return _initialized;
+    }
+    
     _driver.init();
     _initialized = true;
     
@@ -32,6 +44,8 @@ DistanceReading SensorHAL::getDistance() {
     DistanceReading reading;
     reading.timestamp = millis();
     
+    // Echo timing is busy-waited; keep the clock fixed during capture
+    Drivers::PmLockGuard captureLock(Drivers::PmLockId::SENSOR_CAPTURE);
     float distance = _driver.measureDistanceCm(_timeoutUs);
     
     if (distance < 0 || distance < SENSOR_MIN_DISTANCE_CM || distance > SENSOR_MAX_DISTANCE_CM) {
@@ -51,6 +65,7 @@ DistanceReading SensorHAL::getDistanceAvg(uint8_t samples) {
     DistanceReading reading;
     reading.timestamp = millis();
     
+    Drivers::PmLockGuard captureLock(Drivers::PmLockId::SENSOR_CAPTURE);
     float distance = _driver.measureDistanceAvgCm(samples, _timeoutUs);
     
     if (distance < 0 || distance < SENSOR_MIN_DISTANCE_CM || distance > SENSOR_MAX_DISTANCE_CM) {
@@ -66,8 +81,57 @@ DistanceReading SensorHAL::getDistanceAvg(uint8_t samples) {
     return reading;
 }
 
+bool SensorHAL::hasArray() {
+    return _array.getCount() > 0;
+}
+
+ArrayReading SensorHAL::getArrayReading(uint8_t samples) {
+    ArrayReading reading;
+    memset(&reading, 0, sizeof(reading));
+    reading.timestamp = millis();
+    reading.count = _array.getCount();
+    reading.fusedDistanceCm = -1;
+    reading.minDistanceCm = -1;
+    
+    {
+        Drivers::PmLockGuard captureLock(Drivers::PmLockId::SENSOR_CAPTURE);
+        _array.measureDistancesAvgCm(reading.distanceCm, samples, _timeoutUs, US_ARRAY_STAGGER_US);
+    }
+    reading.durationMs = millis() - reading.timestamp;
+    
+    float sum = 0;
+    for (uint8_t i = 0; i < reading.count; i++) {
+        float d = reading.distanceCm[i];
+        if (d < SENSOR_MIN_DISTANCE_CM || d > SENSOR_MAX_DISTANCE_CM) {
+            reading.distanceCm[i] = -1;
+            continue;
+        }
+        sum += d;
+        reading.validCount++;
+        if (reading.minDistanceCm < 0 || d < reading.minDistanceCm) {
+            reading.minDistanceCm = d;
+        }
+    }
+    
+    if (reading.validCount > 0) {
+        reading.valid = true;
+        reading.fusedDistanceCm = sum / reading.validCount;
+    }
+    
+    DEBUG_PRINTF("[SensorHAL] Array: %d/%d valid, fused %.2f cm, min %.2f cm (%lu ms)\n",
+                 reading.validCount, reading.count, reading.fusedDistanceCm,
+                 reading.minDistanceCm, reading.durationMs);
+    
+    return reading;
+}
+
 bool SensorHAL::isConnected() {
     // Try to get a reading to verify sensor connection
+    Drivers::PmLockGuard captureLock(Drivers::PmLockId::SENSOR_CAPTURE);
+    if (hasArray()) {
+        uint32_t durations[Drivers::UltrasonicArrayDriver::MAX_SENSORS];
+        return _array.measureEchoDurations(durations, _timeoutUs, US_ARRAY_STAGGER_US) > 0;
+    }
     float distance = _driver.measureDistanceCm(_timeoutUs);
     return (distance > 0);
 }
@@ -76,4 +140,24 @@ void SensorHAL::setTimeout(unsigned long timeoutUs) {
     _timeoutUs = timeoutUs;
 }
 
+bool SensorHAL::configureUlp(Drivers::UlpMonitorConfig& config) {
+    config.lidPin = ULP_LID_PIN;
+    config.lidLevel = 0;
+    if (config.lidPin < 0) {
+        return false;
+    }
+    if (!rtc_gpio_is_valid_gpio((gpio_num_t)config.lidPin)) {
+        DEBUG_PRINTF("[SensorHAL] Lid pin %d is not an RTC GPIO, ULP lid check off\n", config.lidPin);
+        config.lidPin = -1;
+        return false;
+    }
+
+    // Armed at the current level; any change wakes the CPU
+    pinMode(config.lidPin, INPUT_PULLUP);
+    config.lidLevel = digitalRead(config.lidPin);
+    DEBUG_PRINTF("[SensorHAL] ULP lid check on pin %d (now %s)\n", config.lidPin,
+                 config.lidLevel ? "high" : "low");
+    return true;
+}
+
 } // namespace HAL
@@ -8,6 +8,8 @@
 
 #include <Arduino.h>
 #include "../drivers/us100_driver.h"
+#include "../drivers/us_array_driver.h"
+#include "../drivers/ulp_monitor.h"
 
 namespace HAL {
 
@@ -20,6 +22,20 @@ struct DistanceReading {
     uint32_t timestamp; // Reading timestamp (millis)
 };
 
+/**
+ * @brief Multi-sensor array reading result
+ */
+struct ArrayReading {
+    bool valid;              // True if at least one sensor is valid
+    uint8_t count;           // Number of sensors in the array
+    uint8_t validCount;      // Number of sensors with a valid reading
+    float distanceCm[Drivers::UltrasonicArrayDriver::MAX_SENSORS]; // Per sensor (-1 = invalid)
+    float fusedDistanceCm;   // Mean of valid sensors (fill profile average)
+    float minDistanceCm;     // Closest valid reading (highest point of the pile)
+    uint32_t durationMs;     // Acquisition time
+    uint32_t timestamp;      // Reading timestamp (millis)
+};
+
 /**
  * @brief Sensor HAL class - abstracts distance sensor operations
  */
@@ -28,8 +44,9 @@ public:
     /**
      * @brief Constructor
      * @param driver Reference to US100 driver
+     * @param array Reference to sensor array driver (count 0 = single sensor)
      */
-    SensorHAL(Drivers::US100Driver& driver);
+    SensorHAL(Drivers::US100Driver& driver, Drivers::UltrasonicArrayDriver& array);
 
     /**
      * @brief Initialize sensor
@@ -50,6 +67,19 @@ public:
      */
     DistanceReading getDistanceAvg(uint8_t samples = 5);
 
+    /**
+     * @brief Check if a multi-sensor array is configured
+     * @return true if the array driver has sensors
+     */
+    bool hasArray();
+
+    /**
+     * @brief Get averaged readings from all sensors of the array
+     * @param samples Number of staggered cycles to average
+     * @return Per-sensor distances and fused result
+     */
+    ArrayReading getArrayReading(uint8_t samples = 5);
+
     /**
      * @brief Check if sensor is connected and responding
      * @return true if sensor responds
@@ -62,8 +92,16 @@ public:
      */
     void setTimeout(unsigned long timeoutUs);
 
+    /**
+     * @brief Arm the lid switch check for the ULP at its current level
+     * @param config ULP config to update (lid check off if no lid pin)
+     * @return true if the ULP watches the lid
+     */
+    bool configureUlp(Drivers::UlpMonitorConfig& config);
+
 private:
     Drivers::US100Driver& _driver;
+    Drivers::UltrasonicArrayDriver& _array;
     unsigned long _timeoutUs;
     bool _initialized;
 };
@@ -11,7 +11,7 @@
  * Architecture:
  * - Device Drivers: Low-level hardware access
  * - HAL: Hardware abstraction
- * - Network: GPRS and MQTT communication
+ * - Network: Wi-Fi/GPRS link selection and MQTT communication
  * - App: Main application logic
  */
 
@@ -22,7 +22,11 @@
 #include "drivers/gpio_driver.h"
 #include "drivers/adc_driver.h"
 #include "drivers/us100_driver.h"
+#include "drivers/us_array_driver.h"
 #include "drivers/sim7000_driver.h"
+#include "drivers/pm_driver.h"
+#include "drivers/log_driver.h"
+#include "drivers/led_driver.h"
 
 // HAL
 #include "hal/modem_hal.h"
@@ -31,8 +35,13 @@
 #include "hal/power_hal.h"
 
 // Network
+#include "network/rat_selector.h"
 #include "network/gprs_manager.h"
+#include "network/link_manager.h"
 #include "network/mqtt_service.h"
+#include "network/signal_monitor.h"
+#include "network/outbound_queue.h"
+#include "network/log_uploader.h"
 
 // App
 #include "app/smart_waste_app.h"
@@ -42,24 +51,38 @@
 // =============================================================================
 
 // Hardware Serial for modem communication
-HardwareSerial SerialAT(1);
+HardwareSerial SerialAT(MODEM_UART_NUM);
 
 // Device Drivers
 Drivers::US100Driver ultrasonicDriver(US100_TRIGGER_PIN, US100_ECHO_PIN);
+#if US_ARRAY_ENABLED
+const Drivers::UsArraySensor ultrasonicSensors[] = { US_ARRAY_SENSORS };
+Drivers::UltrasonicArrayDriver ultrasonicArray(ultrasonicSensors,
+    sizeof(ultrasonicSensors) / sizeof(ultrasonicSensors[0]));
+#else
+Drivers::UltrasonicArrayDriver ultrasonicArray(nullptr, 0);
+#endif
 Drivers::SIM7000Driver sim7000Driver(SerialAT);
 
 // Hardware Abstraction Layer
 HAL::ModemHAL modemHal(sim7000Driver);
-HAL::SensorHAL sensorHal(ultrasonicDriver);
+HAL::SensorHAL sensorHal(ultrasonicDriver, ultrasonicArray);
 HAL::GpsHAL gpsHal(sim7000Driver);
 HAL::PowerHAL powerHal(BATTERY_ADC_PIN, BATTERY_VOLTAGE_DIVIDER);
 
 // Network Layer
-Network::GprsManager gprsManager(modemHal);
-Network::MqttService mqttService(gprsManager);
+Network::RatSelector ratSelector(modemHal);
+Network::CellCache cellCache(modemHal);
+Network::GprsManager gprsManager(modemHal, ratSelector, cellCache);
+Network::LinkManager linkManager(modemHal, gprsManager);
+Network::MqttService mqttService(linkManager);
+Network::SignalMonitor signalMonitor(modemHal, linkManager);
+Network::OutboundQueue outboundQueue(mqttService, signalMonitor);
+Network::LogUploader logUploader(mqttService, outboundQueue, signalMonitor);
 
 // Application Layer
-App::SmartWasteApp app(modemHal, sensorHal, gpsHal, powerHal, gprsManager, mqttService);
+App::SmartWasteApp app(modemHal, sensorHal, gpsHal, powerHal, linkManager, mqttService,
+                       outboundQueue, signalMonitor, logUploader);
 
 // =============================================================================
 // Setup
@@ -70,6 +93,16 @@ void setup() {
     Serial.begin(115200);
     delay(100);
     
+    // Log calls only queue records; the drain task prints them
+    if (!Drivers::LogDriver::begin(Serial)) {
+        Serial.println("WARNING: Log drain task not started");
+    }
+    
+    // Status LED patterns run from LEDC and a timer, never from the loop
+    if (!Drivers::LedDriver::begin(BOARD_LED_PIN, LED_ON == LOW)) {
+        Serial.println("WARNING: Status LED not available");
+    }
+    
     Serial.println();
     Serial.println("========================================");
     Serial.println("  Smart Waste Monitoring System");
@@ -78,6 +111,7 @@ void setup() {
     
     // Initialize application
     if (!app.init()) {
+        Drivers::LogDriver::flush();
         Serial.println("ERROR: Application initialization failed!");
         Serial.println("System will attempt recovery...");
     }
@@ -88,11 +122,19 @@ void setup() {
 // =============================================================================
 
 void loop() {
-    // Run application
-    app.run();
+    // Run application at full clock; the lock is dropped before idling
+    {
+        Drivers::PmLockGuard cpuLock(Drivers::PmLockId::CPU);
+        app.run();
+    }
     
+#if PM_ENABLED
+    // Idle with no locks held so the chip can enter automatic light sleep
+    delay(PM_LOOP_IDLE_MS);
+#else
     // Small delay to prevent watchdog issues
     delay(10);
+#endif
 }
 
 // =============================================================================
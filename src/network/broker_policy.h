@@ -0,0 +1,234 @@
+/**
+ * @file broker_policy.h
+ * @brief Broker Policy - MQTT broker choice, learning and backoff
+ *
+ * Plain C++ with no Arduino or ESP-IDF dependencies, so the host specs in
+ * tests/ build it on a PC. BrokerSelector keeps the state in RTC memory and
+ * NVS and feeds it the configured limits.
+ */
+
+#ifndef BROKER_POLICY_H
+#define BROKER_POLICY_H
+
+#include <stdint.h>
+
+namespace Network {
+
+constexpr uint16_t BROKER_FAIL_RATE_ONE = 0xFFFF;  // failRate value for "always fails"
+constexpr uint8_t BROKER_FAIL_RATE_WEIGHT = 8;     // Rate follows roughly the last 8 attempts
+
+/**
+ * @brief Per-broker connect statistics
+ */
+struct BrokerStats {
+    uint32_t avgConnectMs;  // Smoothed time to CONNACK (0 = never connected)
+    uint16_t failRate;      // Decaying failure rate (BROKER_FAIL_RATE_ONE = 100 %)
+    uint8_t failStreak;     // Consecutive failures
+    uint8_t legacyProtocol; // 1 = broker refused MQTT 5, use 3.1.1
+};
+
+/**
+ * @brief Selection state shared by all brokers
+ */
+struct BrokerState {
+    uint16_t connects;          // Successful connects since the last probe
+    uint8_t nextProbe;          // Next broker to try on fail-back probe
+    uint8_t outageFailures;     // Failures while every broker was skipped
+    uint8_t lastBroker;         // Broker of the last successful connect
+};
+
+/**
+ * @brief Limits the policy works with (MQTT_BROKER_* in config.h)
+ */
+struct BrokerPolicyConfig {
+    uint8_t maxFailStreak;      // Skip a broker after this many failures in a row
+    uint16_t probeEvery;        // Connects to a fallback between fail-back probes
+    uint32_t retryDelayMs;      // Reconnect delay while a broker is usable
+    uint32_t backoffMaxMs;      // Longest reconnect delay during an outage
+};
+
+/**
+ * @brief Broker selection policy over an ordered broker list
+ *
+ * Index 0 is the primary. While the primary is usable - not on a fail
+ * streak of maxFailStreak - it is always chosen, whatever the others have
+ * learned. Once it is skipped, the usable fallback with the lowest expected
+ * connect cost (smoothed connect time scaled by the decaying failure rate)
+ * is used; brokers that never connected follow in list order. Every
+ * probeEvery connects to a fallback, a skipped broker is tried again so the
+ * primary is returned to once it recovers (fail-back).
+ *
+ * When every broker is skipped, one broker is tried per attempt, least
+ * failed first, and the reconnect delay doubles per failure up to
+ * backoffMaxMs.
+ */
+class BrokerPolicy {
+public:
+    /**
+     * @brief Constructor
+     * @param config Limits
+     * @param state Selection state (owned by the caller)
+     * @param stats Per-broker statistics, count entries (owned by the caller)
+     * @param count Number of brokers (1..32)
+     */
+    BrokerPolicy(const BrokerPolicyConfig& config, BrokerState& state,
+                 BrokerStats* stats, uint8_t count)
+        : _config(config), _state(state), _stats(stats), _count(count) {
+    }
+
+    /**
+     * @brief Choose the broker for the next connect
+     * @return Broker index
+     */
+    uint8_t select() {
+        int8_t chosen = best(0);
+        if (chosen < 0) {
+            // Every broker is failing: rotate, least-failed first
+            chosen = 0;
+            for (uint8_t i = 1; i < _count; i++) {
+                if (_stats[i].failStreak < _stats[chosen].failStreak) {
+                    chosen = i;
+                }
+            }
+            return chosen;
+        }
+
+        // On a fallback: now and then retry a skipped broker for fail-back
+        if (chosen != 0 && _state.connects >= _config.probeEvery) {
+            for (uint8_t n = 0; n < _count; n++) {
+                uint8_t b = _state.nextProbe;
+                _state.nextProbe = (b + 1 < _count) ? b + 1 : 0;
+                if (b != chosen && !isUsable(b)) {
+                    _state.connects = 0;
+                    return b;
+                }
+            }
+        }
+
+        return chosen;
+    }
+
+    /**
+     * @brief Choose a broker to fail over to within the same connect
+     * @param tried Bit mask of brokers already tried
+     * @return Broker index, or -1 if no usable broker is left
+     */
+    int8_t failover(uint32_t tried) {
+        return best(tried);
+    }
+
+    /**
+     * @brief Record the outcome of a connect
+     * @param index Broker that was tried
+     * @param success True if the broker accepted the connection
+     * @param elapsedMs Time from the connect call to CONNACK or failure
+     * @return true if the change is worth persisting (fail streak or
+     *         connected broker changed)
+     */
+    bool record(uint8_t index, bool success, uint32_t elapsedMs) {
+        BrokerStats& stats = _stats[index];
+        uint8_t streak = stats.failStreak;
+        int32_t target = success ? 0 : BROKER_FAIL_RATE_ONE;
+        stats.failRate = (uint16_t)(stats.failRate + (target - (int32_t)stats.failRate) / BROKER_FAIL_RATE_WEIGHT);
+
+        if (success) {
+            bool moved = (index != _state.lastBroker);
+            stats.failStreak = 0;
+            stats.avgConnectMs = (stats.avgConnectMs == 0)
+                ? elapsedMs
+                : (stats.avgConnectMs * 3 + elapsedMs) / 4;
+            if (_state.connects < UINT16_MAX) {
+                _state.connects++;
+            }
+            _state.outageFailures = 0;
+            _state.lastBroker = index;
+            return moved || streak != 0;
+        }
+
+        if (stats.failStreak < UINT8_MAX) {
+            stats.failStreak++;
+        }
+        if (best(0) < 0 && _state.outageFailures < UINT8_MAX) {
+            _state.outageFailures++;
+        }
+        return stats.failStreak != streak;
+    }
+
+    /**
+     * @brief Get the delay before the next reconnect attempt
+     * @return retryDelayMs, doubling per failure while every broker fails
+     */
+    uint32_t retryDelay() const {
+        uint32_t delay = _config.retryDelayMs;
+        for (uint8_t i = 1; i < _state.outageFailures && delay < _config.backoffMaxMs; i++) {
+            delay *= 2;
+        }
+        return delay < _config.backoffMaxMs ? delay : _config.backoffMaxMs;
+    }
+
+    /**
+     * @brief Check if a broker may be selected
+     * @param index Broker index
+     * @return true if not on a fail streak
+     */
+    bool isUsable(uint8_t index) const {
+        return _stats[index].failStreak < _config.maxFailStreak;
+    }
+
+    /**
+     * @brief Expected connect cost of a broker
+     * @param index Broker index
+     * @return Connect ms per successful connect (-1 = never connected)
+     */
+    float expectedCost(uint8_t index) const {
+        const BrokerStats& stats = _stats[index];
+        if (stats.avgConnectMs == 0) {
+            return -1.0f;
+        }
+
+        // Failed attempts cost time too: scale by attempts per success
+        float success = (BROKER_FAIL_RATE_ONE - stats.failRate + 1) / (float)(BROKER_FAIL_RATE_ONE + 1);
+        return stats.avgConnectMs / success;
+    }
+
+private:
+    const BrokerPolicyConfig& _config;
+    BrokerState& _state;
+    BrokerStats* _stats;
+    uint8_t _count;
+
+    /**
+     * @brief Best usable broker not in a mask
+     * @param exclude Bit mask of brokers to skip
+     * @return Broker index, or -1 if none is usable
+     */
+    int8_t best(uint32_t exclude) const {
+        int8_t chosen = -1;
+        int8_t firstUntested = -1;
+        float chosenCost = 0;
+        for (uint8_t i = 0; i < _count; i++) {
+            if ((exclude & (1UL << i)) || !isUsable(i)) {
+                continue;
+            }
+            if (i == 0) {
+                return 0;   // The primary whenever it is usable
+            }
+            float cost = expectedCost(i);
+            if (cost < 0) {
+                if (firstUntested < 0) {
+                    firstUntested = i;
+                }
+            } else if (chosen < 0 || cost < chosenCost) {
+                chosen = i;
+                chosenCost = cost;
+            }
+        }
+
+        // Fallbacks that never connected are tried in list order
+        return chosen >= 0 ? chosen : firstUntested;
+    }
+};
+
+} // namespace Network
+
+#endif // BROKER_POLICY_H
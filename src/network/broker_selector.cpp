@@ -0,0 +1,195 @@
+/**
+ * @file broker_selector.cpp
+ * @brief Broker Selector implementation
+ */
+
+#define LOG_MODULE Drivers::LogModule::MQTT
+
+#include "broker_selector.h"
+#include "config.h"
+#include <Preferences.h>
+
+namespace Network {
+
+namespace {
+
+/**
+ * @brief Broker endpoint
+ */
+struct BrokerEndpoint {
+    const char* host;
+    uint16_t port;
+    const char* user;
+    const char* pass;
+};
+
+// Entry 0 stands for the provisioned broker, so an empty fallback list works
+const BrokerEndpoint BROKERS[] = { { NULL, 0, NULL, NULL }, MQTT_BROKER_FALLBACKS };
+constexpr uint8_t BROKER_COUNT = sizeof(BROKERS) / sizeof(BROKERS[0]);
+static_assert(BROKER_COUNT <= 32, "Broker masks hold 32 entries");
+
+const BrokerPolicyConfig POLICY_CONFIG = {
+    MQTT_BROKER_MAX_FAIL_STREAK, MQTT_BROKER_PROBE_EVERY,
+    MQTT_RECONNECT_DELAY_MS, MQTT_BROKER_BACKOFF_MAX_MS
+};
+
+constexpr uint32_t MODEL_MAGIC = 0x42524B32; // "BRK2"
+constexpr const char* PREFS_NAMESPACE = "broker";
+constexpr const char* PREFS_MODEL_KEY = "model";
+
+/**
+ * @brief Broker model, kept in RTC memory across deep sleep
+ */
+struct BrokerModel {
+    uint32_t magic;
+    uint32_t listHash;          // Broker list the statistics belong to
+    BrokerState state;
+    BrokerStats stats[BROKER_COUNT];
+};
+
+RTC_DATA_ATTR BrokerModel s_model;
+
+uint32_t hashEndpoint(uint32_t hash, const char* host, uint16_t port) {
+    for (const char* c = host; *c; c++) {
+        hash = (hash ^ (uint8_t)*c) * 16777619UL;
+    }
+    hash = (hash ^ (port & 0xFF)) * 16777619UL;
+    return (hash ^ (port >> 8)) * 16777619UL;
+}
+
+} // namespace
+
+BrokerSelector::BrokerSelector()
+    : _primaryPort(0), _policy(POLICY_CONFIG, s_model.state, s_model.stats, BROKER_COUNT) {
+}
+
+void BrokerSelector::begin(const char* host, uint16_t port, const char* user, const char* pass) {
+    _primaryHost = host;
+    _primaryPort = port;
+    _primaryUser = user;
+    _primaryPass = pass;
+
+    uint32_t hash = 2166136261UL;
+    for (uint8_t i = 0; i < BROKER_COUNT; i++) {
+        hash = hashEndpoint(hash, this->host(i), this->port(i));
+    }
+    if (s_model.magic == MODEL_MAGIC && s_model.listHash == hash) {
+        return;
+    }
+
+    Preferences prefs;
+    if (prefs.begin(PREFS_NAMESPACE, true)) {
+        size_t len = prefs.getBytes(PREFS_MODEL_KEY, &s_model, sizeof(s_model));
+        prefs.end();
+        if (len == sizeof(s_model) && s_model.magic == MODEL_MAGIC && s_model.listHash == hash) {
+            DEBUG_PRINTLN("[Broker] Model restored from NVS");
+            return;
+        }
+    }
+
+    memset(&s_model, 0, sizeof(s_model));
+    s_model.magic = MODEL_MAGIC;
+    s_model.listHash = hash;
+    DEBUG_PRINTF("[Broker] %u broker(s), starting with %s:%u\n", BROKER_COUNT, host, port);
+}
+
+uint8_t BrokerSelector::count() {
+    return BROKER_COUNT;
+}
+
+uint8_t BrokerSelector::select() {
+    uint8_t chosen = _policy.select();
+    if (chosen != 0 && !_policy.isUsable(chosen)) {
+        DEBUG_PRINTF("[Broker] Trying skipped %s:%u\n", host(chosen), port(chosen));
+    }
+    return chosen;
+}
+
+int8_t BrokerSelector::failover(uint32_t tried) {
+    return _policy.failover(tried);
+}
+
+const char* BrokerSelector::host(uint8_t index) {
+    return index == 0 ? _primaryHost.c_str() : BROKERS[index].host;
+}
+
+uint16_t BrokerSelector::port(uint8_t index) {
+    return index == 0 ? _primaryPort : BROKERS[index].port;
+}
+
+const char* BrokerSelector::user(uint8_t index) {
+    if (!hasCredentials(index)) {
+        return NULL;
+    }
+    return index == 0 ? _primaryUser.c_str() : BROKERS[index].user;
+}
+
+const char* BrokerSelector::pass(uint8_t index) {
+    if (!hasCredentials(index)) {
+        return NULL;
+    }
+    return index == 0 ? _primaryPass.c_str() : BROKERS[index].pass;
+}
+
+bool BrokerSelector::isLegacyProtocol(uint8_t index) {
+    return s_model.stats[index].legacyProtocol != 0;
+}
+
+void BrokerSelector::setLegacyProtocol(uint8_t index) {
+    if (s_model.stats[index].legacyProtocol) {
+        return;
+    }
+    s_model.stats[index].legacyProtocol = 1;
+    save();
+}
+
+void BrokerSelector::record(uint8_t index, bool success, uint32_t elapsedMs) {
+    DEBUG_PRINTF("[Broker] %s:%u %s after %lu ms\n", host(index), port(index),
+                 success ? "connected" : "failed", elapsedMs);
+
+    // Statistics ride in RTC memory; NVS only sees changes of state
+    if (_policy.record(index, success, elapsedMs)) {
+        save();
+    }
+}
+
+uint32_t BrokerSelector::retryDelay() {
+    return _policy.retryDelay();
+}
+
+BrokerStats BrokerSelector::getStats(uint8_t index) {
+    return s_model.stats[index];
+}
+
+void BrokerSelector::printStats() {
+    for (uint8_t i = 0; i < BROKER_COUNT; i++) {
+        const BrokerStats& stats = s_model.stats[i];
+        if (stats.avgConnectMs == 0 && stats.failRate == 0) {
+            continue;
+        }
+        DEBUG_PRINTF("[Broker] %s:%u fail rate %.0f %%, avg %lu ms, ~%.0f ms/connect%s%s\n",
+                     host(i), port(i), stats.failRate * 100.0f / BROKER_FAIL_RATE_ONE,
+                     stats.avgConnectMs, _policy.expectedCost(i),
+                     _policy.isUsable(i) ? "" : " (skipped)",
+                     stats.legacyProtocol ? " (3.1.1)" : "");
+    }
+}
+
+bool BrokerSelector::hasCredentials(uint8_t index) {
+    if (index == 0) {
+        return _primaryUser.length() > 0 && _primaryPass.length() > 0;
+    }
+    const BrokerEndpoint& broker = BROKERS[index];
+    return broker.user && broker.user[0] && broker.pass && broker.pass[0];
+}
+
+void BrokerSelector::save() {
+    Preferences prefs;
+    if (!prefs.begin(PREFS_NAMESPACE, false)) {
+        return;
+    }
+    prefs.putBytes(PREFS_MODEL_KEY, &s_model, sizeof(s_model));
+    prefs.end();
+}
+
+} // namespace Network
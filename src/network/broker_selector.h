@@ -0,0 +1,150 @@
+/**
+ * @file broker_selector.h
+ * @brief Broker Selector - ordered MQTT broker list with learned health
+ */
+
+#ifndef BROKER_SELECTOR_H
+#define BROKER_SELECTOR_H
+
+#include <Arduino.h>
+#include "broker_policy.h"
+
+namespace Network {
+
+/**
+ * @brief MQTT broker selection manager
+ *
+ * The broker list is the provisioned broker followed by
+ * MQTT_BROKER_FALLBACKS, each fallback with its own credentials. The choice
+ * itself is made by BrokerPolicy: the primary whenever it is usable, else
+ * the healthiest fallback, with fail-back probes and an outage backoff.
+ *
+ * The model lives in RTC memory. It is saved to NVS only when a fail streak
+ * or the connected broker changes, and reset when the broker list changes.
+ * Brokers that refused MQTT 5 are remembered and get 3.1.1 from then on.
+ */
+class BrokerSelector {
+public:
+    /**
+     * @brief Constructor
+     */
+    BrokerSelector();
+
+    /**
+     * @brief Build the list and restore the model from RTC memory or NVS
+     * @param host Provisioned (primary) broker host
+     * @param port Provisioned broker port
+     * @param user Provisioned user name ("" = anonymous)
+     * @param pass Provisioned password
+     */
+    void begin(const char* host, uint16_t port, const char* user, const char* pass);
+
+    /**
+     * @brief Get the number of brokers in the list
+     * @return Broker count
+     */
+    uint8_t count();
+
+    /**
+     * @brief Choose the broker for the next connect
+     * @return Broker index
+     */
+    uint8_t select();
+
+    /**
+     * @brief Choose a broker to fail over to within the same connect
+     * @param tried Bit mask of brokers already tried
+     * @return Broker index, or -1 if no healthy broker is left
+     */
+    int8_t failover(uint32_t tried);
+
+    /**
+     * @brief Get a broker's host
+     * @param index Broker index
+     * @return Host name (valid until the next begin())
+     */
+    const char* host(uint8_t index);
+
+    /**
+     * @brief Get a broker's port
+     * @param index Broker index
+     * @return Port
+     */
+    uint16_t port(uint8_t index);
+
+    /**
+     * @brief Get a broker's user name
+     * @param index Broker index
+     * @return User name, NULL for an anonymous connect
+     */
+    const char* user(uint8_t index);
+
+    /**
+     * @brief Get a broker's password
+     * @param index Broker index
+     * @return Password, NULL for an anonymous connect
+     */
+    const char* pass(uint8_t index);
+
+    /**
+     * @brief Check if a broker only speaks MQTT 3.1.1
+     * @param index Broker index
+     * @return true if the broker refused MQTT 5 before
+     */
+    bool isLegacyProtocol(uint8_t index);
+
+    /**
+     * @brief Remember that a broker refused MQTT 5
+     * @param index Broker index
+     */
+    void setLegacyProtocol(uint8_t index);
+
+    /**
+     * @brief Record the outcome of a connect
+     * @param index Broker that was tried
+     * @param success True if the broker accepted the connection
+     * @param elapsedMs Time from the connect call to CONNACK or failure
+     */
+    void record(uint8_t index, bool success, uint32_t elapsedMs);
+
+    /**
+     * @brief Get the delay before the next reconnect attempt
+     * @return MQTT_RECONNECT_DELAY_MS, longer while every broker is failing
+     */
+    uint32_t retryDelay();
+
+    /**
+     * @brief Get statistics for a broker
+     * @param index Broker index
+     * @return Statistics snapshot
+     */
+    BrokerStats getStats(uint8_t index);
+
+    /**
+     * @brief Log per-broker statistics
+     */
+    void printStats();
+
+private:
+    String _primaryHost;
+    uint16_t _primaryPort;
+    String _primaryUser;
+    String _primaryPass;
+    BrokerPolicy _policy;
+
+    /**
+     * @brief Check if a broker has a user name and password
+     * @param index Broker index
+     * @return true if both are set
+     */
+    bool hasCredentials(uint8_t index);
+
+    /**
+     * @brief Save the model to NVS
+     */
+    void save();
+};
+
+} // namespace Network
+
+#endif // BROKER_SELECTOR_H
@@ -0,0 +1,222 @@
+/**
+ * @file cell_cache.cpp
+ * @brief Cell Cache implementation
+ */
+
+#define LOG_MODULE Drivers::LogModule::LINK
+
+#include "cell_cache.h"
+#include "config.h"
+#include <Preferences.h>
+
+namespace Network {
+
+namespace {
+
+constexpr uint32_t CACHE_MAGIC = 0x43454C31; // "CEL1"
+constexpr const char* PREFS_NAMESPACE = "cell";
+constexpr const char* PREFS_CACHE_KEY = "cache";
+
+/**
+ * @brief Last-good cell, kept in RTC memory across deep sleep
+ */
+struct CellModel {
+    uint32_t magic;
+    bool valid;
+    Rat rat;
+    char plmn[7];
+    uint8_t band;
+    uint32_t earfcn;
+    uint32_t cellId;
+    uint16_t tac;
+    uint8_t failStreak;     // Targeted failures in a row
+    bool restricted;        // Modem holds a targeted configuration
+    RegStats stats[(uint8_t)RegStrategy::COUNT];
+};
+
+RTC_DATA_ATTR CellModel s_cell;
+
+const char* bandMode(Rat rat) {
+    switch (rat) {
+        case Rat::CATM:  return "CAT-M";
+        case Rat::NBIOT: return "NB-IOT";
+        default:         return NULL;
+    }
+}
+
+const char* strategyName(RegStrategy strategy) {
+    return strategy == RegStrategy::TARGETED ? "targeted" : "full";
+}
+
+} // namespace
+
+CellCache::CellCache(HAL::ModemHAL& modemHal) : _modemHal(modemHal) {
+}
+
+void CellCache::begin() {
+    if (s_cell.magic == CACHE_MAGIC) {
+        return;
+    }
+
+    Preferences prefs;
+    if (prefs.begin(PREFS_NAMESPACE, true)) {
+        size_t len = prefs.getBytes(PREFS_CACHE_KEY, &s_cell, sizeof(s_cell));
+        prefs.end();
+        if (len == sizeof(s_cell) && s_cell.magic == CACHE_MAGIC) {
+            // The flag is not saved when it changes; the modem keeps its
+            // band configuration over power loss, so assume a restriction
+            s_cell.restricted = s_cell.valid;
+            if (s_cell.valid) {
+                DEBUG_PRINTF("[Cell] Last good: %s PLMN %s band %u\n",
+                             RatSelector::ratName(s_cell.rat), s_cell.plmn, s_cell.band);
+            }
+            return;
+        }
+    }
+
+    memset(&s_cell, 0, sizeof(s_cell));
+    s_cell.magic = CACHE_MAGIC;
+}
+
+bool CellCache::applyTargeted(Rat rat) {
+#if REG_CACHE_ENABLED
+    if (!s_cell.valid || (rat != Rat::AUTO && rat != s_cell.rat)) {
+        return false;
+    }
+
+    if (!_modemHal.selectOperator(s_cell.plmn)) {
+        return false;
+    }
+    s_cell.restricted = true;
+
+    const char* mode = bandMode(s_cell.rat);
+    if (mode && s_cell.band) {
+        char band[4];
+        snprintf(band, sizeof(band), "%u", s_cell.band);
+        _modemHal.setBands(mode, band);
+    }
+
+    DEBUG_PRINTF("[Cell] Targeted: %s PLMN %s band %u\n",
+                 RatSelector::ratName(s_cell.rat), s_cell.plmn, s_cell.band);
+    return true;
+#else
+    return false;
+#endif
+}
+
+void CellCache::restoreFull() {
+    if (!s_cell.restricted) {
+        return;
+    }
+
+    _modemHal.setBands("CAT-M", REG_BANDS_CATM);
+    _modemHal.setBands("NB-IOT", REG_BANDS_NBIOT);
+    _modemHal.selectOperator(NULL);
+    s_cell.restricted = false;
+    DEBUG_PRINTLN("[Cell] Full band scan restored");
+}
+
+void CellCache::record(RegStrategy strategy, bool success, uint32_t elapsedMs) {
+    RegStats& stats = s_cell.stats[(uint8_t)strategy];
+    if (stats.attempts < UINT16_MAX) {
+        stats.attempts++;
+    }
+    if (success) {
+        if (stats.successes < UINT16_MAX) {
+            stats.successes++;
+        }
+        stats.avgMs = (stats.avgMs == 0) ? elapsedMs : (stats.avgMs * 3 + elapsedMs) / 4;
+    }
+
+    bool changed = false;
+    if (strategy == RegStrategy::TARGETED) {
+        uint8_t streak = s_cell.failStreak;
+        bool valid = s_cell.valid;
+        s_cell.failStreak = success ? 0 : s_cell.failStreak + 1;
+        if (s_cell.failStreak >= REG_MAX_FAIL_STREAK) {
+            DEBUG_PRINTLN("[Cell] Cached cell keeps failing, dropped");
+            s_cell.valid = false;
+            s_cell.failStreak = 0;
+        }
+        changed = (s_cell.failStreak != streak || s_cell.valid != valid);
+    }
+
+    DEBUG_PRINTF("[Cell] %s registration %s after %lu ms\n", strategyName(strategy),
+                 success ? "succeeded" : "failed", elapsedMs);
+
+    // Statistics ride in RTC memory; NVS only sees changes of state
+    if (changed) {
+        save();
+    }
+}
+
+void CellCache::update() {
+    Drivers::ServingCell cell;
+    if (!_modemHal.getServingCell(cell)) {
+        return;
+    }
+
+    Rat rat = ratForSystem(cell.system);
+    if (rat == Rat::AUTO) {
+        return;
+    }
+
+    bool moved = !s_cell.valid || strcmp(cell.plmn, s_cell.plmn) != 0 ||
+                 cell.band != s_cell.band || rat != s_cell.rat;
+    if (s_cell.valid && cell.cellId != s_cell.cellId) {
+        DEBUG_PRINTF("[Cell] Cell changed %lu -> %lu (EARFCN %lu)\n",
+                     s_cell.cellId, cell.cellId, cell.earfcn);
+    }
+
+    s_cell.valid = true;
+    s_cell.rat = rat;
+    memcpy(s_cell.plmn, cell.plmn, sizeof(s_cell.plmn));
+    s_cell.band = cell.band;
+    s_cell.earfcn = cell.earfcn;
+    s_cell.cellId = cell.cellId;
+    s_cell.tac = cell.tac;
+
+    if (moved) {
+        DEBUG_PRINTF("[Cell] Cached %s PLMN %s band %u EARFCN %lu TAC 0x%04X\n",
+                     RatSelector::ratName(rat), cell.plmn, cell.band, cell.earfcn, cell.tac);
+        save();
+    }
+}
+
+RegStats CellCache::getStats(RegStrategy strategy) {
+    return s_cell.stats[(uint8_t)strategy];
+}
+
+void CellCache::printStats() {
+    if (s_cell.valid) {
+        DEBUG_PRINTF("[Cell] %s PLMN %s band %u EARFCN %lu cell %lu\n",
+                     RatSelector::ratName(s_cell.rat), s_cell.plmn, s_cell.band,
+                     s_cell.earfcn, s_cell.cellId);
+    }
+    for (uint8_t s = 0; s < (uint8_t)RegStrategy::COUNT; s++) {
+        const RegStats& stats = s_cell.stats[s];
+        if (stats.attempts == 0) {
+            continue;
+        }
+        DEBUG_PRINTF("[Cell] %-8s %u/%u ok, avg %lu ms\n", strategyName((RegStrategy)s),
+                     stats.successes, stats.attempts, stats.avgMs);
+    }
+}
+
+Rat CellCache::ratForSystem(const char* system) {
+    if (strstr(system, "CAT-M")) return Rat::CATM;
+    if (strstr(system, "NB")) return Rat::NBIOT;
+    if (strstr(system, "GSM")) return Rat::GSM;
+    return Rat::AUTO;
+}
+
+void CellCache::save() {
+    Preferences prefs;
+    if (!prefs.begin(PREFS_NAMESPACE, false)) {
+        return;
+    }
+    prefs.putBytes(PREFS_CACHE_KEY, &s_cell, sizeof(s_cell));
+    prefs.end();
+}
+
+} // namespace Network
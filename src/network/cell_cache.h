@@ -0,0 +1,119 @@
+/**
+ * @file cell_cache.h
+ * @brief Cell Cache - last-good operator/band for targeted registration
+ */
+
+#ifndef CELL_CACHE_H
+#define CELL_CACHE_H
+
+#include <Arduino.h>
+#include "rat_selector.h"
+#include "../hal/modem_hal.h"
+
+namespace Network {
+
+/**
+ * @brief Registration strategy
+ */
+enum class RegStrategy : uint8_t {
+    TARGETED,   // Last-good PLMN and band
+    FULL,       // All configured bands, automatic operator
+    COUNT
+};
+
+/**
+ * @brief Per-strategy registration statistics
+ */
+struct RegStats {
+    uint16_t attempts;
+    uint16_t successes;
+    uint32_t avgMs;         // Smoothed time to registration (0 = never measured)
+};
+
+/**
+ * @brief Last-good cell cache
+ *
+ * After each registration the serving cell (AT+CPSI: PLMN, band, EARFCN,
+ * TAC/cell) is stored. The next attach first selects that operator
+ * (+COPS mode 4, automatic fallback in the modem) and restricts the LTE
+ * search to its band (+CBANDCFG). If that does not register within
+ * REG_TARGETED_TIMEOUT_MS the full band lists (REG_BANDS_CATM,
+ * REG_BANDS_NBIOT) and automatic selection are restored for the normal scan.
+ * After a targeted hit the restriction is left in place on the attached
+ * modem and only undone by the next registration that does not target.
+ *
+ * The SIM7000 cannot lock to an EARFCN, so channel and cell are kept to
+ * report cell changes. The cache is dropped after REG_MAX_FAIL_STREAK
+ * targeted failures in a row. It lives in RTC memory; NVS is written only
+ * when the cached cell (PLMN, band, RAT, validity) or the fail streak
+ * changes, so the statistics are lost on power loss.
+ */
+class CellCache {
+public:
+    /**
+     * @brief Constructor
+     * @param modemHal Reference to modem HAL
+     */
+    CellCache(HAL::ModemHAL& modemHal);
+
+    /**
+     * @brief Restore the cache from RTC memory or NVS
+     */
+    void begin();
+
+    /**
+     * @brief Configure a targeted registration if a matching cell is cached
+     * @param rat RAT about to be searched
+     * @return true if the targeted configuration was applied
+     */
+    bool applyTargeted(Rat rat);
+
+    /**
+     * @brief Undo a targeted configuration (full bands, automatic operator)
+     */
+    void restoreFull();
+
+    /**
+     * @brief Record the outcome of a registration attempt
+     * @param strategy Strategy used
+     * @param success True if registered
+     * @param elapsedMs Time spent
+     */
+    void record(RegStrategy strategy, bool success, uint32_t elapsedMs);
+
+    /**
+     * @brief Store the current serving cell (call after registration)
+     */
+    void update();
+
+    /**
+     * @brief Get statistics for a strategy
+     * @param strategy Strategy
+     * @return Statistics snapshot
+     */
+    RegStats getStats(RegStrategy strategy);
+
+    /**
+     * @brief Log the cached cell and per-strategy statistics
+     */
+    void printStats();
+
+private:
+    HAL::ModemHAL& _modemHal;
+
+    /**
+     * @brief Map a CPSI system name to a RAT
+     * @param system System string
+     * @return RAT (AUTO if unknown)
+     */
+    static Rat ratForSystem(const char* system);
+
+    /**
+     * @brief Save the cache to NVS
+     */
+    void save();
+};
+
+} // namespace Network
+
+#endif // CELL_CACHE_H
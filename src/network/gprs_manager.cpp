@@ -3,13 +3,18 @@
  * @brief GPRS Connection Manager implementation
  */
 
+#define LOG_MODULE Drivers::LogModule::LINK
+
 #include "gprs_manager.h"
 #include "config.h"
+#include "../drivers/at_capture.h"
 
 namespace Network {
 
-GprsManager::GprsManager(HAL::ModemHAL& modemHal)
-    : _modemHal(modemHal), _client(nullptr), _state(GprsState::DISCONNECTED) {
+GprsManager::GprsManager(HAL::ModemHAL& modemHal, RatSelector& ratSelector,
+                         CellCache& cellCache)
+    : _modemHal(modemHal), _ratSelector(ratSelector), _cellCache(cellCache), _client(nullptr),
+      _state(GprsState::DISCONNECTED) {
 }
 
 bool GprsManager::init(const char* apn, const char* user, const char* pass) {
@@ -24,6 +29,9 @@ bool GprsManager::init(const char* apn, const char* user, const char* pass) {
         _client = new TinyGsmClient(_modemHal.getModem());
     }
     
+    _ratSelector.begin();
+    _cellCache.begin();
+    
     DEBUG_PRINTF("[GPRS] APN: %s\n", apn);
     return true;
 }
@@ -41,8 +49,9 @@ bool GprsManager::connect(uint32_t timeout) {
     TinyGsm& modem = _modemHal.getModem();
     
     // Wait for network registration
-    if (!waitForNetwork(timeout)) {
+    if (!registerNetwork(timeout)) {
         DEBUG_PRINTLN("[GPRS] Network registration failed");
+        Drivers::AtCapture::trigger("registration failed");
         _state = GprsState::ERROR;
         return false;
     }
@@ -52,6 +61,7 @@ bool GprsManager::connect(uint32_t timeout) {
     
     if (!modem.gprsConnect(_apn.c_str(), _user.c_str(), _pass.c_str())) {
         DEBUG_PRINTLN("[GPRS] GPRS connection failed");
+        Drivers::AtCapture::trigger("gprs connect failed");
         _state = GprsState::ERROR;
         return false;
     }
@@ -65,13 +75,14 @@ bool GprsManager::connect(uint32_t timeout) {
     _state = GprsState::CONNECTED;
     DEBUG_PRINTLN("[GPRS] Connected successfully");
     
-    // Print connection info
+    return true;
+}
+
+void GprsManager::logNetworkInfo() {
     NetworkInfo info = getNetworkInfo();
     DEBUG_PRINTF("[GPRS] Operator: %s\n", info.operatorName.c_str());
     DEBUG_PRINTF("[GPRS] Signal: %d\n", info.signalQuality);
     DEBUG_PRINTF("[GPRS] IP: %s\n", info.ipAddress.c_str());
-    
-    return true;
 }
 
 void GprsManager::disconnect() {
@@ -135,6 +146,11 @@ NetworkInfo GprsManager::getNetworkInfo() {
     return info;
 }
 
+String GprsManager::getOperator() {
+    TinyGsm& modem = _modemHal.getModem();
+    return modem.getOperator();
+}
+
 int GprsManager::getSignalQuality() {
     TinyGsm& modem = _modemHal.getModem();
     return modem.getSignalQuality();
@@ -151,7 +167,7 @@ bool GprsManager::ensureConnection() {
     TinyGsm& modem = _modemHal.getModem();
     
     if (!modem.isNetworkConnected()) {
-        if (!waitForNetwork(NETWORK_TIMEOUT_MS)) {
+        if (!registerNetwork(NETWORK_TIMEOUT_MS)) {
             return false;
         }
     }
@@ -174,4 +190,59 @@ TinyGsmClient& GprsManager::getClient() {
     return *_client;
 }
 
+void GprsManager::logRatStats() {
+    _ratSelector.printStats();
+    _cellCache.printStats();
+}
+
+bool GprsManager::registerNetwork(uint32_t timeout) {
+    Rat rat = _ratSelector.select();
+    if (!_ratSelector.apply(rat)) {
+        rat = Rat::AUTO;
+    }
+    
+    uint32_t started = millis();
+    bool registered = false;
+    
+    // Last-good operator and band first: a hit skips the full band scan. The
+    // restriction stays after a hit - reconfiguring an attached modem would
+    // start a reselection - and is replaced or undone on the next attach
+    if (_cellCache.applyTargeted(rat)) {
+        registered = waitForNetwork(min(timeout, (uint32_t)REG_TARGETED_TIMEOUT_MS));
+        _cellCache.record(RegStrategy::TARGETED, registered, millis() - started);
+        if (!registered) {
+            _cellCache.restoreFull();
+        }
+    } else {
+        _cellCache.restoreFull();
+    }
+    
+    // A pinned RAT gets a shorter budget; the rest goes to the multi-RAT search
+    uint32_t elapsed = millis() - started;
+    if (!registered && elapsed < timeout) {
+        uint32_t remaining = timeout - elapsed;
+        uint32_t budget = (rat != Rat::AUTO && remaining > RAT_PINNED_TIMEOUT_MS)
+            ? RAT_PINNED_TIMEOUT_MS : remaining;
+        uint32_t fullStart = millis();
+        registered = waitForNetwork(budget);
+        _cellCache.record(RegStrategy::FULL, registered, millis() - fullStart);
+    }
+    _ratSelector.record(rat, registered, millis() - started);
+    
+    elapsed = millis() - started;
+    if (!registered && rat != Rat::AUTO && elapsed < timeout) {
+        DEBUG_PRINTLN("[GPRS] Falling back to multi-RAT search");
+        _ratSelector.apply(Rat::AUTO);
+        uint32_t fallbackStart = millis();
+        registered = waitForNetwork(timeout - elapsed);
+        _ratSelector.record(Rat::AUTO, registered, millis() - fallbackStart);
+        _cellCache.record(RegStrategy::FULL, registered, millis() - fallbackStart);
+    }
+    
+    if (registered) {
+        _cellCache.update();
+    }
+    return registered;
+}
+
 } // namespace Network
@@ -8,6 +8,8 @@
 
 #include <Arduino.h>
 #include "../hal/modem_hal.h"
+#include "rat_selector.h"
+#include "cell_cache.h"
 
 namespace Network {
 
@@ -39,8 +41,10 @@ public:
     /**
      * @brief Constructor
      * @param modemHal Reference to modem HAL
+     * @param ratSelector Reference to RAT selector
+     * @param cellCache Reference to last-good cell cache
      */
-    GprsManager(HAL::ModemHAL& modemHal);
+    GprsManager(HAL::ModemHAL& modemHal, RatSelector& ratSelector, CellCache& cellCache);
 
     /**
      * @brief Initialize GPRS manager
@@ -88,6 +92,17 @@ public:
      */
     NetworkInfo getNetworkInfo();
 
+    /**
+     * @brief Get the registered operator name
+     * @return Operator name (empty if unknown)
+     */
+    String getOperator();
+
+    /**
+     * @brief Query and log operator, signal and IP (non-essential)
+     */
+    void logNetworkInfo();
+
     /**
      * @brief Get signal quality (0-31)
      * @return Signal quality, or -1 if error
@@ -106,13 +121,28 @@ public:
      */
     TinyGsmClient& getClient();
 
+    /**
+     * @brief Log per-RAT and per-strategy attach statistics
+     */
+    void logRatStats();
+
 private:
     HAL::ModemHAL& _modemHal;
+    RatSelector& _ratSelector;
+    CellCache& _cellCache;
     TinyGsmClient* _client;
     GprsState _state;
     String _apn;
     String _user;
     String _pass;
+
+    /**
+     * @brief Register on the last-good cell and learned RAT, falling back to
+     *        a full band scan and then a multi-RAT search
+     * @param timeout Total registration timeout in milliseconds
+     * @return true if registered
+     */
+    bool registerNetwork(uint32_t timeout);
 };
 
 } // namespace Network
@@ -0,0 +1,166 @@
+/**
+ * @file keepalive_tuner.cpp
+ * @brief Keepalive Tuner implementation
+ */
+
+#define LOG_MODULE Drivers::LogModule::MQTT
+
+#include "keepalive_tuner.h"
+#include "config.h"
+#include <Preferences.h>
+
+namespace Network {
+
+namespace {
+
+constexpr uint32_t MODEL_MAGIC = 0x4B414C31; // "KAL1"
+constexpr const char* PREFS_NAMESPACE = "keepalive";
+
+/**
+ * @brief Keepalive model of one network, kept in RTC memory across deep sleep
+ */
+struct KeepaliveModel {
+    uint32_t magic;
+    uint32_t network;       // FNV-1a hash of the network name
+    uint16_t safeS;
+    uint16_t failS;         // 0 = no expiry seen
+    uint8_t confirms;       // Idle pings answered at the probe interval
+};
+
+RTC_DATA_ATTR KeepaliveModel s_model;
+
+uint32_t hashName(const char* name) {
+    uint32_t hash = 2166136261UL;
+    for (const char* c = name; *c; c++) {
+        hash = (hash ^ (uint8_t)*c) * 16777619UL;
+    }
+    return hash;
+}
+
+void prefsKey(uint32_t network, char* key, size_t size) {
+    snprintf(key, size, "n%08lx", (unsigned long)network);
+}
+
+/**
+ * @brief Next interval to test above the safe one
+ * @return Probe interval, or the safe interval once converged
+ */
+uint16_t probeInterval() {
+    uint16_t upper = s_model.failS ? s_model.failS : MQTT_KEEPALIVE_MAX_S;
+    if (upper <= s_model.safeS + MQTT_KEEPALIVE_STEP_S) {
+        return s_model.safeS;
+    }
+    if (s_model.failS == 0) {
+        return min((uint32_t)s_model.safeS * 2, (uint32_t)MQTT_KEEPALIVE_MAX_S);
+    }
+    return (s_model.safeS + s_model.failS) / 2;
+}
+
+} // namespace
+
+KeepaliveTuner::KeepaliveTuner() : _pings(0), _expiries(0) {
+}
+
+void KeepaliveTuner::begin(const char* network) {
+    uint32_t hash = hashName(network);
+    if (s_model.magic == MODEL_MAGIC && s_model.network == hash) {
+        return;
+    }
+
+    char key[12];
+    prefsKey(hash, key, sizeof(key));
+
+    Preferences prefs;
+    if (prefs.begin(PREFS_NAMESPACE, true)) {
+        size_t len = prefs.getBytes(key, &s_model, sizeof(s_model));
+        prefs.end();
+        if (len == sizeof(s_model) && s_model.magic == MODEL_MAGIC && s_model.network == hash) {
+            DEBUG_PRINTF("[Keepalive] %s: safe %u s, expired %u s\n",
+                         network, s_model.safeS, s_model.failS);
+            return;
+        }
+    }
+
+    memset(&s_model, 0, sizeof(s_model));
+    s_model.magic = MODEL_MAGIC;
+    s_model.network = hash;
+    s_model.safeS = MQTT_KEEPALIVE_MIN_S;
+    DEBUG_PRINTF("[Keepalive] %s: new network, starting at %u s\n", network, s_model.safeS);
+}
+
+uint16_t KeepaliveTuner::interval() {
+#if MQTT_KEEPALIVE_ADAPTIVE
+    return probeInterval();
+#else
+    return MQTT_KEEPALIVE_MIN_S;
+#endif
+}
+
+bool KeepaliveTuner::isProbing() {
+    return interval() > s_model.safeS;
+}
+
+void KeepaliveTuner::onPingAnswered(uint32_t idleMs) {
+    _pings++;
+
+    // Traffic in the gap refreshes the NAT entry, so only a fully idle gap counts
+    uint16_t probe = interval();
+    if (probe <= s_model.safeS || idleMs + 1000 < (uint32_t)probe * 1000) {
+        return;
+    }
+
+    if (++s_model.confirms < MQTT_KEEPALIVE_CONFIRMS) {
+        return;
+    }
+
+    s_model.safeS = probe;
+    s_model.confirms = 0;
+    DEBUG_PRINTF("[Keepalive] %u s confirmed, next %u s\n", probe, interval());
+    save();
+}
+
+void KeepaliveTuner::onExpired() {
+    _expiries++;
+
+    uint16_t expired = interval();
+    s_model.confirms = 0;
+    s_model.failS = expired;
+    if (expired <= s_model.safeS) {
+        // The NAT timeout shrank below what was learned
+        s_model.safeS = max((uint16_t)(expired / 2), (uint16_t)MQTT_KEEPALIVE_MIN_S);
+    }
+
+    DEBUG_PRINTF("[Keepalive] Idle connection expired at %u s, safe %u s, next %u s\n",
+                 expired, s_model.safeS, interval());
+    save();
+}
+
+KeepaliveStats KeepaliveTuner::getStats() {
+    KeepaliveStats stats;
+    stats.safeS = s_model.safeS;
+    stats.failS = s_model.failS;
+    stats.intervalS = interval();
+    stats.pings = _pings;
+    stats.expiries = _expiries;
+    return stats;
+}
+
+void KeepaliveTuner::printStats() {
+    DEBUG_PRINTF("[Keepalive] Interval %u s (%s), safe %u s, expired %u s, %lu pings, %lu expiries\n",
+                 interval(), isProbing() ? "probing" : "settled", s_model.safeS,
+                 s_model.failS, _pings, _expiries);
+}
+
+void KeepaliveTuner::save() {
+    char key[12];
+    prefsKey(s_model.network, key, sizeof(key));
+
+    Preferences prefs;
+    if (!prefs.begin(PREFS_NAMESPACE, false)) {
+        return;
+    }
+    prefs.putBytes(key, &s_model, sizeof(s_model));
+    prefs.end();
+}
+
+} // namespace Network
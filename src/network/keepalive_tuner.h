@@ -0,0 +1,102 @@
+/**
+ * @file keepalive_tuner.h
+ * @brief Keepalive Tuner - learns the longest MQTT ping interval the network allows
+ */
+
+#ifndef KEEPALIVE_TUNER_H
+#define KEEPALIVE_TUNER_H
+
+#include <Arduino.h>
+
+namespace Network {
+
+/**
+ * @brief Keepalive statistics
+ */
+struct KeepaliveStats {
+    uint16_t safeS;         // Longest interval confirmed to survive
+    uint16_t failS;         // Shortest interval seen to expire (0 = none yet)
+    uint16_t intervalS;     // Interval in use
+    uint32_t pings;         // Pings answered since boot
+    uint32_t expiries;      // Idle expiries detected since boot
+};
+
+/**
+ * @brief Adaptive MQTT keepalive controller
+ *
+ * Carrier NATs drop idle TCP flows after an operator-specific time, and
+ * every PINGREQ wakes the radio. The tuner searches for the longest ping
+ * interval that still keeps the flow alive:
+ *
+ * - Starting from MQTT_KEEPALIVE_MIN_S (known safe), the interval doubles
+ *   after MQTT_KEEPALIVE_CONFIRMS pings answered after a fully idle gap.
+ * - An unanswered ping, or the socket dying with a ping outstanding, marks
+ *   the interval as expired. The search then bisects between the safe and
+ *   expired intervals until they are MQTT_KEEPALIVE_STEP_S apart.
+ * - If the safe interval itself expires (the NAT timeout shrank) it is
+ *   halved and the search starts again from there.
+ *
+ * CONNECT advertises MQTT_KEEPALIVE_MAX_S so the broker accepts any
+ * interval tried; pings are then sent at the learned interval. The result
+ * is kept per network (operator or Wi-Fi SSID) in RTC memory and NVS.
+ */
+class KeepaliveTuner {
+public:
+    /**
+     * @brief Constructor
+     */
+    KeepaliveTuner();
+
+    /**
+     * @brief Load the model for a network (call before each connect)
+     * @param network Operator name or Wi-Fi SSID
+     */
+    void begin(const char* network);
+
+    /**
+     * @brief Get the ping interval to use
+     * @return Interval in seconds
+     */
+    uint16_t interval();
+
+    /**
+     * @brief Check if the interval in use is still being tested
+     * @return true while probing above the safe interval
+     */
+    bool isProbing();
+
+    /**
+     * @brief Record a ping answered after an idle gap
+     * @param idleMs Time without any traffic before the ping
+     */
+    void onPingAnswered(uint32_t idleMs);
+
+    /**
+     * @brief Record the connection expiring while idle
+     */
+    void onExpired();
+
+    /**
+     * @brief Get statistics
+     * @return Statistics snapshot
+     */
+    KeepaliveStats getStats();
+
+    /**
+     * @brief Log the learned interval
+     */
+    void printStats();
+
+private:
+    uint32_t _pings;
+    uint32_t _expiries;
+
+    /**
+     * @brief Save the model to NVS under the network's key
+     */
+    void save();
+};
+
+} // namespace Network
+
+#endif // KEEPALIVE_TUNER_H
@@ -0,0 +1,355 @@
+/**
+ * @file link_manager.cpp
+ * @brief Transport Link Manager implementation
+ */
+
+#define LOG_MODULE Drivers::LogModule::LINK
+
+#include "link_manager.h"
+#include "config.h"
+
+namespace Network {
+
+namespace {
+
+const WifiCredential KNOWN_NETWORKS[] = { WIFI_KNOWN_NETWORKS };
+constexpr uint8_t KNOWN_NETWORK_COUNT = sizeof(KNOWN_NETWORKS) / sizeof(KNOWN_NETWORKS[0]);
+
+constexpr uint32_t LINK_CACHE_MAGIC = 0x4C4E4B31; // "LNK1"
+
+/**
+ * @brief Link selection cache, kept in RTC memory across resets/deep sleep
+ */
+struct LinkCache {
+    uint32_t magic;
+    LinkType lastGood;
+    int8_t wifiIndex;        // Index into KNOWN_NETWORKS of last good AP
+    int32_t wifiChannel;
+    uint8_t wifiBssid[6];
+    uint8_t cellularSinceProbe; // Cellular connects since Wi-Fi was last tried
+    LinkStats stats[2];      // [0] = Wi-Fi, [1] = cellular
+};
+
+RTC_DATA_ATTR LinkCache s_cache;
+
+LinkStats& statsFor(LinkType type) {
+    return s_cache.stats[type == LinkType::WIFI ? 0 : 1];
+}
+
+const char* linkName(LinkType type) {
+    switch (type) {
+        case LinkType::WIFI:     return "Wi-Fi";
+        case LinkType::CELLULAR: return "cellular";
+        default:                 return "none";
+    }
+}
+
+} // namespace
+
+LinkManager::LinkManager(HAL::ModemHAL& modemHal, GprsManager& gprsManager)
+    : _modemHal(modemHal), _gprsManager(gprsManager),
+      _active(LinkType::NONE), _gprsInitialized(false) {
+}
+
+bool LinkManager::init(const char* apn, const char* user, const char* pass,
+                       const char* simPin) {
+    DEBUG_PRINTLN("[Link] Initializing...");
+
+    _apn = apn;
+    _user = user;
+    _pass = pass;
+    _simPin = simPin;
+
+    if (s_cache.magic != LINK_CACHE_MAGIC) {
+        memset(&s_cache, 0, sizeof(s_cache));
+        s_cache.magic = LINK_CACHE_MAGIC;
+        s_cache.lastGood = LinkType::NONE;
+        s_cache.wifiIndex = -1;
+    }
+
+    DEBUG_PRINTF("[Link] Wi-Fi %s, %d known network(s), last good: %s\n",
+                 WIFI_ENABLED ? "enabled" : "disabled",
+                 KNOWN_NETWORK_COUNT, linkName(s_cache.lastGood));
+    return true;
+}
+
+bool LinkManager::connect(uint32_t timeout) {
+    LinkType first = selectPreferred();
+    LinkType second = (first == LinkType::WIFI) ? LinkType::CELLULAR : LinkType::WIFI;
+
+    if (tryLink(first, timeout)) {
+        return true;
+    }
+
+    if (second == LinkType::WIFI && !WIFI_ENABLED) {
+        return false;
+    }
+
+    DEBUG_PRINTF("[Link] %s failed, falling back to %s\n", linkName(first), linkName(second));
+    return tryLink(second, timeout);
+}
+
+void LinkManager::disconnect() {
+    if (_active == LinkType::WIFI) {
+        _wifiClient.stop();
+        WiFi.disconnect(true);
+    } else if (_active == LinkType::CELLULAR) {
+        _gprsManager.disconnect();
+    }
+    _active = LinkType::NONE;
+}
+
+bool LinkManager::isConnected() {
+    switch (_active) {
+        case LinkType::WIFI:
+            return WiFi.status() == WL_CONNECTED;
+        case LinkType::CELLULAR:
+            return _gprsManager.isConnected();
+        default:
+            return false;
+    }
+}
+
+bool LinkManager::ensureConnection() {
+    if (isConnected()) {
+        return true;
+    }
+
+    if (_active == LinkType::CELLULAR && _gprsManager.ensureConnection()) {
+        return true;
+    }
+
+    if (_active == LinkType::WIFI) {
+        DEBUG_PRINTLN("[Link] Wi-Fi lost, reconnecting...");
+        if (tryLink(LinkType::WIFI, 0)) {
+            return true;
+        }
+    }
+
+    // Re-run selection (may fail over to the other link)
+    return connect(NETWORK_TIMEOUT_MS);
+}
+
+Client& LinkManager::getClient() {
+    if (_active == LinkType::WIFI) {
+        return _wifiClient;
+    }
+    return _gprsManager.getClient();
+}
+
+LinkType LinkManager::getActiveLink() {
+    return _active;
+}
+
+String LinkManager::getNetworkName() {
+    switch (_active) {
+        case LinkType::WIFI:
+            return String("wifi:") + WiFi.SSID();
+        case LinkType::CELLULAR:
+            return _gprsManager.getOperator();
+        default:
+            return String();
+    }
+}
+
+LinkStats LinkManager::getStats(LinkType type) {
+    return statsFor(type);
+}
+
+GprsManager& LinkManager::getCellular() {
+    return _gprsManager;
+}
+
+void LinkManager::logLinkInfo() {
+    LinkStats& stats = statsFor(_active);
+    DEBUG_PRINTF("[Link] Active: %s (connect %lu ms, avg %lu ms, %u ok / %u failed)\n",
+                 linkName(_active), stats.lastConnectMs, stats.avgConnectMs,
+                 stats.successCount, stats.failCount);
+
+    if (_active == LinkType::WIFI) {
+        DEBUG_PRINTF("[Link] SSID: %s, RSSI: %d dBm, IP: %s\n",
+                     WiFi.SSID().c_str(), WiFi.RSSI(), WiFi.localIP().toString().c_str());
+    } else if (_active == LinkType::CELLULAR) {
+        _modemHal.logInfo();
+        _gprsManager.logNetworkInfo();
+        _gprsManager.logRatStats();
+    }
+}
+
+LinkType LinkManager::selectPreferred() {
+    if (!WIFI_ENABLED) {
+        return LinkType::CELLULAR;
+    }
+
+    LinkStats& wifi = statsFor(LinkType::WIFI);
+    LinkStats& cell = statsFor(LinkType::CELLULAR);
+
+    // A site where Wi-Fi keeps failing or is slower than expected goes cellular,
+    // with an occasional Wi-Fi re-probe in case coverage appeared
+    bool wifiPoor = (wifi.failStreak >= LINK_MAX_FAIL_STREAK &&
+                     cell.failStreak < LINK_MAX_FAIL_STREAK) ||
+                    (wifi.avgConnectMs > WIFI_MAX_CONNECT_MS &&
+                     cell.avgConnectMs != 0 && cell.avgConnectMs < wifi.avgConnectMs);
+    if (wifiPoor && s_cache.cellularSinceProbe < LINK_WIFI_REPROBE_EVERY) {
+        return LinkType::CELLULAR;
+    }
+
+    // Otherwise Wi-Fi first: far cheaper in energy and airtime when in range.
+    // connectWifi() returns quickly if no known SSID is visible.
+    return LinkType::WIFI;
+}
+
+bool LinkManager::tryLink(LinkType type, uint32_t timeout) {
+    DEBUG_PRINTF("[Link] Trying %s...\n", linkName(type));
+
+    if (type == LinkType::WIFI) {
+        s_cache.cellularSinceProbe = 0;
+    }
+
+    uint32_t start = millis();
+    bool ok = (type == LinkType::WIFI) ? connectWifi() : connectCellular(timeout);
+    uint32_t elapsed = millis() - start;
+
+    recordAttempt(type, ok, elapsed);
+
+    if (!ok) {
+        return false;
+    }
+
+    _active = type;
+    s_cache.lastGood = type;
+    if (type == LinkType::CELLULAR) {
+        if (s_cache.cellularSinceProbe < 255) s_cache.cellularSinceProbe++;
+    }
+    DEBUG_PRINTF("[Link] %s up in %lu ms\n", linkName(type), elapsed);
+
+    if (type == LinkType::WIFI) {
+        // Keep the modem fully off while Wi-Fi carries the traffic
+        _modemHal.powerOff();
+    }
+    return true;
+}
+
+bool LinkManager::connectWifi() {
+#if WIFI_ENABLED
+    WiFi.persistent(false);
+    WiFi.mode(WIFI_STA);
+
+    int8_t index = -1;
+    int32_t channel = 0;
+    const uint8_t* bssid = nullptr;
+
+    // Cached AP: connect directly on the known channel/BSSID without scanning
+    if (s_cache.lastGood == LinkType::WIFI &&
+        s_cache.wifiIndex >= 0 && s_cache.wifiIndex < KNOWN_NETWORK_COUNT) {
+        index = s_cache.wifiIndex;
+        channel = s_cache.wifiChannel;
+        bssid = s_cache.wifiBssid;
+    } else {
+        index = scanForKnownNetwork();
+        if (index < 0) {
+            DEBUG_PRINTLN("[Link] No known Wi-Fi network in range");
+            WiFi.mode(WIFI_OFF);
+            return false;
+        }
+    }
+
+    const WifiCredential& net = KNOWN_NETWORKS[index];
+    DEBUG_PRINTF("[Link] Connecting to SSID %s\n", net.ssid);
+    WiFi.begin(net.ssid, net.pass, channel, bssid);
+
+    uint32_t start = millis();
+    while (WiFi.status() != WL_CONNECTED) {
+        if (millis() - start >= WIFI_CONNECT_TIMEOUT_MS) {
+            DEBUG_PRINTLN("[Link] Wi-Fi connect timeout");
+            WiFi.disconnect(true);
+            WiFi.mode(WIFI_OFF);
+            // Forget the cached AP so the next attempt rescans
+            s_cache.wifiIndex = -1;
+            return false;
+        }
+        delay(50);
+    }
+
+    s_cache.wifiIndex = index;
+    s_cache.wifiChannel = WiFi.channel();
+    memcpy(s_cache.wifiBssid, WiFi.BSSID(), sizeof(s_cache.wifiBssid));
+    return true;
+#else
+    return false;
+#endif
+}
+
+bool LinkManager::connectCellular(uint32_t timeout) {
+#if WIFI_ENABLED
+    if (_active == LinkType::WIFI || WiFi.status() == WL_CONNECTED) {
+        _wifiClient.stop();
+        WiFi.disconnect(true);
+    }
+    WiFi.mode(WIFI_OFF);
+#endif
+
+    // Modem is only powered when cellular is actually needed
+    if (!_modemHal.isReady()) {
+        if (!_modemHal.init()) {
+            DEBUG_PRINTLN("[Link] Modem init failed");
+            return false;
+        }
+        if (!_modemHal.checkSim(_simPin.c_str())) {
+            DEBUG_PRINTLN("[Link] SIM check failed");
+            return false;
+        }
+    }
+
+    if (!_gprsInitialized) {
+        if (!_gprsManager.init(_apn.c_str(), _user.c_str(), _pass.c_str())) {
+            return false;
+        }
+        _gprsInitialized = true;
+    }
+
+    return _gprsManager.connect(timeout);
+}
+
+int8_t LinkManager::scanForKnownNetwork() {
+    int16_t found = WiFi.scanNetworks(false, false, false, WIFI_SCAN_MS_PER_CHAN);
+    int8_t best = -1;
+    int32_t bestRssi = -127;
+
+    for (int16_t i = 0; i < found; i++) {
+        String ssid = WiFi.SSID(i);
+        for (uint8_t k = 0; k < KNOWN_NETWORK_COUNT; k++) {
+            if (ssid == KNOWN_NETWORKS[k].ssid && WiFi.RSSI(i) > bestRssi) {
+                best = k;
+                bestRssi = WiFi.RSSI(i);
+            }
+        }
+    }
+    WiFi.scanDelete();
+
+    if (best >= 0) {
+        DEBUG_PRINTF("[Link] Found %s (%ld dBm)\n", KNOWN_NETWORKS[best].ssid, bestRssi);
+    }
+    return best;
+}
+
+void LinkManager::recordAttempt(LinkType type, bool success, uint32_t elapsedMs) {
+    LinkStats& stats = statsFor(type);
+
+    if (success) {
+        stats.successCount++;
+        stats.failStreak = 0;
+        stats.lastConnectMs = elapsedMs;
+        // Exponential moving average, alpha = 1/4
+        stats.avgConnectMs = (stats.avgConnectMs == 0)
+            ? elapsedMs
+            : (stats.avgConnectMs * 3 + elapsedMs) / 4;
+    } else {
+        stats.failCount++;
+        if (stats.failStreak < 255) {
+            stats.failStreak++;
+        }
+    }
+}
+
+} // namespace Network
@@ -0,0 +1,190 @@
+/**
+ * @file link_manager.h
+ * @brief Transport Link Manager - selects Wi-Fi or cellular backhaul
+ */
+
+#ifndef LINK_MANAGER_H
+#define LINK_MANAGER_H
+
+#include <Arduino.h>
+#include <WiFi.h>
+#include "gprs_manager.h"
+#include "../hal/modem_hal.h"
+
+namespace Network {
+
+/**
+ * @brief Transport link type
+ */
+enum class LinkType : uint8_t {
+    NONE,
+    WIFI,
+    CELLULAR
+};
+
+/**
+ * @brief Known Wi-Fi network credentials
+ */
+struct WifiCredential {
+    const char* ssid;
+    const char* pass;
+};
+
+/**
+ * @brief Per-link connection statistics
+ */
+struct LinkStats {
+    uint32_t avgConnectMs;   // Smoothed connect time (0 = never measured)
+    uint32_t lastConnectMs;  // Last successful connect time
+    uint16_t successCount;
+    uint16_t failCount;
+    uint8_t failStreak;      // Consecutive failures
+};
+
+/**
+ * @brief Transport Link Manager
+ *
+ * Owns the choice of backhaul and exposes a single Client for MQTT:
+ * - Wi-Fi when a configured SSID is in range (modem stays powered down)
+ * - Cellular (GPRS/LTE-M via GprsManager) otherwise
+ *
+ * The last good link, Wi-Fi BSSID/channel and connect-time statistics
+ * are cached in RTC memory so the next attempt starts with the link that
+ * worked and can skip the Wi-Fi scan.
+ */
+class LinkManager {
+public:
+    /**
+     * @brief Constructor
+     * @param modemHal Reference to modem HAL
+     * @param gprsManager Reference to GPRS manager
+     */
+    LinkManager(HAL::ModemHAL& modemHal, GprsManager& gprsManager);
+
+    /**
+     * @brief Initialize link manager
+     * @param apn Access Point Name for cellular
+     * @param user Username (optional)
+     * @param pass Password (optional)
+     * @param simPin SIM PIN (optional)
+     * @return true if initialization successful
+     */
+    bool init(const char* apn, const char* user = "", const char* pass = "",
+              const char* simPin = "");
+
+    /**
+     * @brief Select and bring up a link
+     * @param timeout Cellular connection timeout in milliseconds
+     * @return true if a link is up
+     */
+    bool connect(uint32_t timeout = 180000);
+
+    /**
+     * @brief Take down the active link
+     */
+    void disconnect();
+
+    /**
+     * @brief Check if the active link is up
+     * @return true if connected
+     */
+    bool isConnected();
+
+    /**
+     * @brief Ensure a link is up, reconnecting or failing over if needed
+     * @return true if a link is up
+     */
+    bool ensureConnection();
+
+    /**
+     * @brief Get client of the active link
+     * @return Client reference (Wi-Fi or TinyGSM)
+     */
+    Client& getClient();
+
+    /**
+     * @brief Get active link type
+     * @return Active link
+     */
+    LinkType getActiveLink();
+
+    /**
+     * @brief Get a name for the network behind the active link
+     * @return Operator name (cellular) or "wifi:<SSID>"
+     */
+    String getNetworkName();
+
+    /**
+     * @brief Get connection statistics for a link
+     * @param type Link type
+     * @return Statistics
+     */
+    LinkStats getStats(LinkType type);
+
+    /**
+     * @brief Log details of the active link (non-essential queries)
+     */
+    void logLinkInfo();
+
+    /**
+     * @brief Get GPRS manager (cellular link)
+     * @return GprsManager reference
+     */
+    GprsManager& getCellular();
+
+private:
+    HAL::ModemHAL& _modemHal;
+    GprsManager& _gprsManager;
+    WiFiClient _wifiClient;
+    LinkType _active;
+    bool _gprsInitialized;
+    String _apn;
+    String _user;
+    String _pass;
+    String _simPin;
+
+    /**
+     * @brief Decide which link to try first
+     * @return Preferred link
+     */
+    LinkType selectPreferred();
+
+    /**
+     * @brief Try to bring up a link and record the result
+     * @param type Link type
+     * @param timeout Timeout in milliseconds
+     * @return true if connected
+     */
+    bool tryLink(LinkType type, uint32_t timeout);
+
+    /**
+     * @brief Connect to a known Wi-Fi network
+     * @return true if connected
+     */
+    bool connectWifi();
+
+    /**
+     * @brief Bring up the modem and cellular data
+     * @param timeout Timeout in milliseconds
+     * @return true if connected
+     */
+    bool connectCellular(uint32_t timeout);
+
+    /**
+     * @brief Find the strongest configured SSID in a scan
+     * @return Index into the known network list, or -1
+     */
+    int8_t scanForKnownNetwork();
+
+    /**
+     * @brief Record a connect attempt in the link statistics
+     * @param type Link type
+     * @param success Attempt result
+     * @param elapsedMs Attempt duration
+     */
+    void recordAttempt(LinkType type, bool success, uint32_t elapsedMs);
+};
+
+} // namespace Network
+
+#endif // LINK_MANAGER_H
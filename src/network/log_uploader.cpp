@@ -0,0 +1,252 @@
+/**
+ * @file log_uploader.cpp
+ * @brief Log Uploader implementation
+ */
+
+#define LOG_MODULE Drivers::LogModule::MQTT
+
+#include "log_uploader.h"
+#include "../drivers/log_driver.h"
+#include "../drivers/at_capture.h"
+
+namespace Network {
+
+namespace {
+
+constexpr uint8_t WINDOW_BITS = 8;
+constexpr uint8_t LOOKAHEAD_BITS = 4;
+constexpr uint16_t WINDOW_SIZE = 1 << WINDOW_BITS;
+constexpr uint16_t MAX_MATCH = 1 << LOOKAHEAD_BITS;
+constexpr uint16_t MIN_MATCH = 2;   // Backref (13 bits) beats two literals (18 bits)
+
+// Chunk JSON: ~140 bytes of fields plus the base64 data
+constexpr size_t CHUNK_PAYLOAD_MAX = 160 + (LOG_UPLOAD_CHUNK_SIZE + 2) / 3 * 4;
+static_assert(CHUNK_PAYLOAD_MAX + OUTBOUND_TOPIC_MAX <= MQTT_TX_BUFFER_SIZE,
+              "LOG_UPLOAD_CHUNK_SIZE does not fit the MQTT TX buffer");
+
+/**
+ * @brief MSB-first bit writer
+ */
+struct BitWriter {
+    uint8_t* out;
+    uint16_t size;
+    uint16_t pos;
+    uint8_t bit;        // Next bit mask in out[pos]
+    bool overflow;
+
+    void put(uint16_t value, uint8_t count) {
+        while (count--) {
+            if (bit == 0x80) {
+                if (pos >= size) {
+                    overflow = true;
+                    return;
+                }
+                out[pos] = 0;
+            }
+            if (value & (1 << count)) {
+                out[pos] |= bit;
+            }
+            bit >>= 1;
+            if (bit == 0) {
+                bit = 0x80;
+                pos++;
+            }
+        }
+    }
+
+    uint16_t length() const {
+        return (bit == 0x80) ? pos : pos + 1;
+    }
+};
+
+/**
+ * @brief Base64-encode into a NUL-terminated buffer
+ * @return Characters written
+ */
+size_t base64Encode(const uint8_t* in, size_t length, char* out) {
+    static const char alphabet[] =
+        "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    size_t n = 0;
+    for (size_t i = 0; i < length; i += 3) {
+        uint32_t v = (uint32_t)in[i] << 16;
+        if (i + 1 < length) v |= (uint32_t)in[i + 1] << 8;
+        if (i + 2 < length) v |= in[i + 2];
+        out[n++] = alphabet[(v >> 18) & 0x3F];
+        out[n++] = alphabet[(v >> 12) & 0x3F];
+        out[n++] = (i + 1 < length) ? alphabet[(v >> 6) & 0x3F] : '=';
+        out[n++] = (i + 2 < length) ? alphabet[v & 0x3F] : '=';
+    }
+    out[n] = '\0';
+    return n;
+}
+
+} // namespace
+
+LogUploader::LogUploader(MqttService& mqttService, OutboundQueue& outbound,
+                         SignalMonitor& signalMonitor)
+    : _mqtt(mqttService), _outbound(outbound), _signal(signalMonitor), _rawLength(0),
+      _length(0), _nextSeq(0), _totalChunks(0), _lastChunkAt(0), _startedAt(0), _atTrace(false),
+      _active(false), _requested(false), _requestedFrom(-1), _requestedAtTrace(false) {
+    _id[0] = '\0';
+    _requestedId[0] = '\0';
+}
+
+bool LogUploader::begin() {
+    String topic = _mqtt.buildDeviceTopic(LOG_UPLOAD_CMD_SUFFIX);
+    return _mqtt.route(topic.c_str(), [this](const MqttMessage& msg) {
+        onRequest(msg);
+    });
+}
+
+void LogUploader::service() {
+    if (_requested) {
+        _requested = false;
+        bool resume = _active || _length > 0;
+        if (_requestedFrom >= 0 && resume && strcmp(_requestedId, _id) == 0 &&
+            _requestedAtTrace == _atTrace) {
+            // Resend from a chunk the server is missing
+            _nextSeq = (_requestedFrom < _totalChunks) ? _requestedFrom : _totalChunks;
+            _active = _nextSeq < _totalChunks;
+            DEBUG_PRINTF("[Logs] Upload '%s' resumed at chunk %d/%d\n", _id, _nextSeq, _totalChunks);
+        } else {
+            strcpy(_id, _requestedId);
+            _atTrace = _requestedAtTrace;
+            _active = prepare();
+        }
+    }
+
+    if (!_active || millis() - _lastChunkAt < LOG_UPLOAD_INTERVAL_MS) {
+        return;
+    }
+
+    // Never compete with readings; a dropped link pauses the upload
+    if (!_mqtt.isConnected() ||
+        _outbound.hasPending(MessageClass::ALERT) ||
+        _outbound.hasPending(MessageClass::TELEMETRY)) {
+        return;
+    }
+
+    if (_signal.shouldDefer(millis() - _startedAt)) {
+        return;
+    }
+
+    _lastChunkAt = millis();
+    if (!sendChunk(_nextSeq)) {
+        DEBUG_PRINTF("[Logs] Chunk %d not sent, will retry\n", _nextSeq);
+        return;
+    }
+
+    if (++_nextSeq >= _totalChunks) {
+        _active = false;
+        DEBUG_PRINTF("[Logs] Upload '%s' complete (%d chunks)\n", _id, _totalChunks);
+    }
+}
+
+bool LogUploader::isActive() {
+    return _active || _requested;
+}
+
+uint16_t LogUploader::compress(const uint8_t* in, uint16_t length, uint8_t* out, uint16_t size) {
+    BitWriter writer = { out, size, 0, 0x80, false };
+
+    uint16_t i = 0;
+    while (i < length && !writer.overflow) {
+        // Longest match in the window behind i (overlap allowed)
+        uint16_t bestLength = 0;
+        uint16_t bestOffset = 0;
+        uint16_t start = (i > WINDOW_SIZE) ? i - WINDOW_SIZE : 0;
+        uint16_t limit = (length - i < MAX_MATCH) ? length - i : MAX_MATCH;
+
+        for (uint16_t j = start; j < i; j++) {
+            uint16_t k = 0;
+            while (k < limit && in[j + k] == in[i + k]) {
+                k++;
+            }
+            if (k > bestLength) {
+                bestLength = k;
+                bestOffset = i - j;
+                if (k == limit) {
+                    break;
+                }
+            }
+        }
+
+        if (bestLength >= MIN_MATCH) {
+            writer.put(0, 1);
+            writer.put(bestOffset - 1, WINDOW_BITS);
+            writer.put(bestLength - 1, LOOKAHEAD_BITS);
+            i += bestLength;
+        } else {
+            writer.put(1, 1);
+            writer.put(in[i], 8);
+            i++;
+        }
+    }
+
+    return writer.overflow ? 0 : writer.length();
+}
+
+void LogUploader::onRequest(const MqttMessage& msg) {
+    StaticJsonDocument<128> doc;
+    _requestedId[0] = '\0';
+    _requestedFrom = -1;
+    _requestedAtTrace = false;
+
+    if (msg.payload != NULL && msg.length > 0 &&
+        !deserializeJson(doc, (const char*)msg.payload, msg.length)) {
+        const char* id = doc["id"] | "";
+        strncpy(_requestedId, id, sizeof(_requestedId) - 1);
+        _requestedId[sizeof(_requestedId) - 1] = '\0';
+        _requestedFrom = doc["from"] | -1;
+        _requestedAtTrace = strcmp(doc["source"] | "logs", "at") == 0;
+    }
+
+    _requested = true;
+    DEBUG_PRINTF("[Logs] Upload requested (id '%s', from %ld%s)\n", _requestedId, _requestedFrom,
+                 _requestedAtTrace ? ", AT capture" : "");
+}
+
+bool LogUploader::prepare() {
+    if (_atTrace) {
+        // Newest records that fit; the capture is re-armed for the next error
+        _rawLength = Drivers::AtCapture::snapshot(_raw, sizeof(_raw));
+    } else {
+        // Push queued records into the history first
+        Drivers::LogDriver::flush();
+        _rawLength = Drivers::LogDriver::snapshot(_raw, sizeof(_raw));
+    }
+    _length = compress(_raw, _rawLength, _data, sizeof(_data));
+    _nextSeq = 0;
+    _startedAt = millis();
+    _totalChunks = (_length + LOG_UPLOAD_CHUNK_SIZE - 1) / LOG_UPLOAD_CHUNK_SIZE;
+
+    if (_length == 0) {
+        DEBUG_PRINTLN("[Logs] Nothing to upload");
+        return false;
+    }
+
+    DEBUG_PRINTF("[Logs] Upload '%s': %d bytes compressed to %d, %d chunks\n",
+                 _id, _rawLength, _length, _totalChunks);
+    return true;
+}
+
+bool LogUploader::sendChunk(uint16_t seq) {
+    char payload[CHUNK_PAYLOAD_MAX];
+    uint16_t offset = seq * LOG_UPLOAD_CHUNK_SIZE;
+    uint16_t count = (_length - offset < LOG_UPLOAD_CHUNK_SIZE) ? _length - offset : LOG_UPLOAD_CHUNK_SIZE;
+
+    int n = snprintf(payload, sizeof(payload),
+                     "{\"id\":\"%s\",\"source\":\"%s\",\"seq\":%u,\"total\":%u,\"raw\":%u,"
+                     "\"size\":%u,\"codec\":\"heatshrink\",\"w\":%u,\"l\":%u,\"data\":\"",
+                     _id, _atTrace ? "at" : "logs", seq, _totalChunks, _rawLength, _length,
+                     WINDOW_BITS, LOOKAHEAD_BITS);
+    n += base64Encode(_data + offset, count, payload + n);
+    payload[n++] = '"';
+    payload[n++] = '}';
+    payload[n] = '\0';
+
+    String topic = _mqtt.buildDeviceTopic(LOG_UPLOAD_TOPIC_SUFFIX);
+    return _mqtt.publishMessage(topic.c_str(), payload);
+}
+
+} // namespace Network
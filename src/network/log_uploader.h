@@ -0,0 +1,120 @@
+/**
+ * @file log_uploader.h
+ * @brief Log Uploader - compressed, chunked log retrieval over MQTT
+ */
+
+#ifndef LOG_UPLOADER_H
+#define LOG_UPLOADER_H
+
+#include <Arduino.h>
+#include "config.h"
+#include "mqtt_service.h"
+#include "outbound_queue.h"
+#include "signal_monitor.h"
+
+namespace Network {
+
+/**
+ * @brief On-demand diagnostics upload
+ *
+ * A message on {prefix}/{device}/cmd/logs snapshots the recent log output
+ * (or the AT traffic capture), compresses it and publishes it in chunks on
+ * {prefix}/{device}/diag/logs.
+ *
+ * Request:  {"id":"abc"}                start a new upload
+ *           {"id":"abc","from":7}       resend an upload from chunk 7
+ *           {"id":"abc","source":"at"}  upload the AT capture (see AtCapture)
+ * Chunk:    {"id":"abc","source":"logs","seq":0,"total":9,"raw":4096,
+ *            "size":1630,"codec":"heatshrink","w":8,"l":4,"data":"<base64>"}
+ *
+ * The stream is heatshrink-compatible (window 2^8, lookahead 2^4), so
+ * `heatshrink -d -w 8 -l 4` restores the concatenated chunks.
+ *
+ * One chunk is sent per LOG_UPLOAD_INTERVAL_MS, and only while the link is
+ * up and no alert or telemetry is waiting. On a poor signal the upload waits
+ * for a better window, up to SIGNAL_MAX_DEFER_MS after the request. A chunk that fails to publish is
+ * retried after the next reconnect, so an upload resumes where it stopped.
+ */
+class LogUploader {
+public:
+    /**
+     * @brief Constructor
+     * @param mqttService Reference to MQTT service
+     * @param outbound Reference to outbound queue (for flow control)
+     * @param signalMonitor Reference to signal monitor (for deferral)
+     */
+    LogUploader(MqttService& mqttService, OutboundQueue& outbound, SignalMonitor& signalMonitor);
+
+    /**
+     * @brief Route the upload request topic
+     * @return true if routed
+     */
+    bool begin();
+
+    /**
+     * @brief Prepare requested uploads and send due chunks (call in loop)
+     */
+    void service();
+
+    /**
+     * @brief Check if an upload is in progress
+     * @return true if chunks remain to be sent
+     */
+    bool isActive();
+
+    /**
+     * @brief Compress a buffer into a heatshrink-compatible stream
+     * @param in Input data
+     * @param length Input length
+     * @param out Output buffer
+     * @param size Output buffer size
+     * @return Compressed length (0 if the output buffer is too small)
+     */
+    static uint16_t compress(const uint8_t* in, uint16_t length, uint8_t* out, uint16_t size);
+
+private:
+    MqttService& _mqtt;
+    OutboundQueue& _outbound;
+    SignalMonitor& _signal;
+
+    uint8_t _raw[LOG_HISTORY_SIZE];
+    uint8_t _data[LOG_HISTORY_SIZE + LOG_HISTORY_SIZE / 8 + 1];  // Worst case 9 bits per byte
+    uint16_t _rawLength;
+    uint16_t _length;
+    uint16_t _nextSeq;
+    uint16_t _totalChunks;
+    uint32_t _lastChunkAt;
+    uint32_t _startedAt;        // Upload prepared (deferral deadline base)
+    char _id[LOG_UPLOAD_ID_MAX];
+    bool _atTrace;              // Upload holds the AT capture, not the log
+    bool _active;
+
+    // Set by the message handler, acted on in service()
+    bool _requested;
+    char _requestedId[LOG_UPLOAD_ID_MAX];
+    int32_t _requestedFrom;     // -1 = new snapshot
+    bool _requestedAtTrace;
+
+    /**
+     * @brief Handle an upload request message
+     * @param msg Inbound message
+     */
+    void onRequest(const MqttMessage& msg);
+
+    /**
+     * @brief Snapshot and compress the log history or AT capture
+     * @return true if there is something to send
+     */
+    bool prepare();
+
+    /**
+     * @brief Publish one chunk
+     * @param seq Chunk index
+     * @return true if published
+     */
+    bool sendChunk(uint16_t seq);
+};
+
+} // namespace Network
+
+#endif // LOG_UPLOADER_H
@@ -3,83 +3,185 @@
  * @brief MQTT Service implementation
  */
 
+#define LOG_MODULE Drivers::LogModule::MQTT
+
 #include "mqtt_service.h"
 #include "config.h"
+#include "../drivers/at_capture.h"
 
 namespace Network {
 
-MqttService::MqttService(GprsManager& gprsManager)
-    : _gprsManager(gprsManager), _mqtt(nullptr), _state(MqttState::DISCONNECTED),
-      _port(1883), _lastReconnectAttempt(0) {
+namespace {
+
+constexpr uint32_t SESSION_MAGIC = 0x4D534E31; // "MSN1"
+
+/**
+ * @brief MQTT session state, kept in RTC memory across deep sleep
+ */
+struct SessionCache {
+    uint32_t magic;
+    uint16_t nextMsgId;   // Packet identifier sequence of the broker session
+    uint32_t subsHash;    // Subscription set acknowledged in this session (0 = none)
+};
+
+RTC_DATA_ATTR SessionCache s_session;
+
+// Framing buffers live in .bss so the client never touches the heap; separate
+// RX/TX lets a message handler publish without clobbering the inbound packet
+uint8_t s_txBuffer[MQTT_TX_BUFFER_SIZE];
+uint8_t s_rxBuffer[MQTT_RX_BUFFER_SIZE];
+
+} // namespace
+
+MqttService::MqttService(LinkManager& linkManager)
+    : _link(linkManager), _mqtt(nullptr), _state(MqttState::DISCONNECTED),
+      _lastReconnectAttempt(0), _sessionResumed(false),
+      _lastTraffic(0), _pingSentAt(0), _pingIdleMs(0), _subCount(0) {
 }
 
 bool MqttService::init(const char* broker, uint16_t port, const char* clientId,
                        const char* user, const char* pass) {
     DEBUG_PRINTLN("[MQTT] Initializing...");
     
-    _broker = broker;
-    _port = port;
+    _brokers.begin(broker, port, user, pass);
     _clientId = clientId;
-    _user = user;
-    _pass = pass;
     
     // Create MQTT client
     if (!_mqtt) {
-        _mqtt = new PubSubClient(_gprsManager.getClient());
+        _mqtt = new PubSubClient(_link.getClient());
+        _mqtt->setCallback([this](char* topic, uint8_t* payload, unsigned int length) {
+            onMessage(topic, payload, length);
+        });
     }
     
-    // Set buffer size (default 256 is too small for JSON payload)
-    _mqtt->setBufferSize(512);
-    
-    // Set keep-alive to 60 seconds
-    _mqtt->setKeepAlive(60);
+    // Static buffers (default 256 is too small for JSON payload)
+    _mqtt->setBuffers(s_txBuffer, sizeof(s_txBuffer), s_rxBuffer, sizeof(s_rxBuffer));
     
     // Set socket timeout (in seconds)
     _mqtt->setSocketTimeout(30);
     
-    _mqtt->setServer(broker, port);
+#if MQTT_USE_V5
+    _mqtt->setProtocolVersion(MQTT_VERSION_5);
+    _mqtt->setSessionExpiry(MQTT_CLEAN_SESSION ? 0 : MQTT_SESSION_EXPIRY_S);
+    _mqtt->setReceiveMaximum(1);    // Inbound messages are handled one at a time
+#endif
+    
+    if (s_session.magic != SESSION_MAGIC) {
+        memset(&s_session, 0, sizeof(s_session));
+        s_session.magic = SESSION_MAGIC;
+        s_session.nextMsgId = 1;
+    }
     
-    DEBUG_PRINTF("[MQTT] Broker: %s:%d\n", broker, port);
+    DEBUG_PRINTF("[MQTT] Broker: %s:%d (+%d fallback)\n", broker, port, _brokers.count() - 1);
     DEBUG_PRINTF("[MQTT] Client ID: %s\n", clientId);
-    DEBUG_PRINTF("[MQTT] Buffer size: 512 bytes\n");
+    DEBUG_PRINTF("[MQTT] Buffers: TX %d, RX %d bytes\n", MQTT_TX_BUFFER_SIZE, MQTT_RX_BUFFER_SIZE);
     
     return true;
 }
 
 bool MqttService::connect() {
-    if (!_gprsManager.isConnected()) {
-        DEBUG_PRINTLN("[MQTT] GPRS not connected");
+    if (!_link.isConnected()) {
+        DEBUG_PRINTLN("[MQTT] Network link not connected");
         _state = MqttState::ERROR;
         return false;
     }
     
+    // Active link may have changed (Wi-Fi <-> cellular) since last connect
+    _mqtt->setClient(_link.getClient());
+    
     _state = MqttState::CONNECTING;
-    DEBUG_PRINTF("[MQTT] Connecting to %s...\n", _broker.c_str());
+    String willTopic = buildDeviceTopic(MQTT_STATUS_TOPIC_SUFFIX);
     
-    bool connected = false;
+    // Continue the packet identifier sequence of a resumed session
+    _mqtt->setNextMsgId(s_session.nextMsgId);
     
-    if (_user.length() > 0 && _pass.length() > 0) {
-        connected = _mqtt->connect(_clientId.c_str(), _user.c_str(), _pass.c_str());
-    } else {
-        connected = _mqtt->connect(_clientId.c_str());
+    // Advertise the longest interval so the broker accepts any probe; pings
+    // are then sent at the interval learned for this network
+    _keepalive.begin(_link.getNetworkName().c_str());
+    _mqtt->setKeepAlive(MQTT_KEEPALIVE_ADAPTIVE ? MQTT_KEEPALIVE_MAX_S : MQTT_KEEPALIVE_MIN_S);
+    
+    // Best broker first; MQTT_BROKER_FAILOVER_TRIES bounds the time spent
+    uint32_t tried = 0;
+    int8_t index = _brokers.select();
+    bool connected = false;
+    for (uint8_t attempt = 0; index >= 0 && attempt < MQTT_BROKER_FAILOVER_TRIES; attempt++) {
+        tried |= 1UL << index;
+        connected = connectBroker(index, willTopic);
+        if (connected) {
+            break;
+        }
+        index = _brokers.failover(tried);
     }
     
     if (!connected) {
-        DEBUG_PRINTF("[MQTT] Connection failed, state: %d\n", _mqtt->state());
+        DEBUG_PRINTF("[MQTT] No broker reachable, next attempt in %lu s\n",
+                     _brokers.retryDelay() / 1000);
         _state = MqttState::ERROR;
         return false;
     }
     
+    if (_mqtt->getProtocolVersion() == MQTT_VERSION_5) {
+        DEBUG_PRINTF("[MQTT] MQTT 5: session expiry %lu s, topic aliases %u, receive max %u\n",
+                     _mqtt->getSessionExpiry(), _mqtt->getServerTopicAliasMaximum(),
+                     _mqtt->getServerReceiveMaximum());
+    }
+    
+    // Never ping less often than a broker-imposed (MQTT 5) keepalive
+    _mqtt->setKeepAlive(min(_keepalive.interval(), _mqtt->getKeepAlive()));
+    _pingSentAt = 0;
+    _lastTraffic = millis();
+    _keepalive.printStats();
+    _brokers.printStats();
+    
     _state = MqttState::CONNECTED;
-    DEBUG_PRINTLN("[MQTT] Connected successfully");
+    _sessionResumed = _mqtt->sessionPresent();
+    DEBUG_PRINTF("[MQTT] Connected successfully (session %s)\n",
+                 _sessionResumed ? "resumed" : "new");
+    
+    if (!_sessionResumed) {
+        // Broker-side state is gone; subscriptions must be sent again
+        s_session.subsHash = 0;
+    }
+    restoreSubscriptions();
+    
+    // Clears the retained will left by an earlier drop-out
+    _mqtt->publish(willTopic.c_str(), MQTT_ONLINE_MESSAGE, MQTT_WILL_RETAIN);
     
+    saveSession();
     return true;
 }
 
+bool MqttService::connectBroker(uint8_t index, const String& willTopic) {
+    DEBUG_PRINTF("[MQTT] Connecting to %s:%u...\n", _brokers.host(index), _brokers.port(index));
+    _mqtt->setServer(_brokers.host(index), _brokers.port(index));
+#if MQTT_USE_V5
+    _mqtt->setProtocolVersion(_brokers.isLegacyProtocol(index) ? MQTT_VERSION_3_1_1 : MQTT_VERSION_5);
+#endif
+    
+    uint32_t start = millis();
+    bool connected = _mqtt->connect(_clientId.c_str(), _brokers.user(index), _brokers.pass(index),
+                                    willTopic.c_str(), MQTT_WILL_QOS, MQTT_WILL_RETAIN,
+                                    MQTT_WILL_MESSAGE, MQTT_CLEAN_SESSION);
+    _brokers.record(index, connected, millis() - start);
+    
+    if (!connected) {
+        DEBUG_PRINTF("[MQTT] Connection failed, state: %d\n", _mqtt->state());
+        Drivers::AtCapture::trigger("mqtt connect failed");
+        if (_mqtt->getProtocolVersion() == MQTT_VERSION_5 &&
+            (_mqtt->state() == MQTT_CONNECT_BAD_PROTOCOL || _mqtt->state() == MQTT5_RC_UNSUPPORTED_PROTOCOL)) {
+            // 3.1.1-only broker: only this one gets 3.1.1 from now on
+            DEBUG_PRINTLN("[MQTT] Broker refused MQTT 5, using 3.1.1 with it");
+            _brokers.setLegacyProtocol(index);
+        }
+    }
+    return connected;
+}
+
 void MqttService::disconnect() {
     DEBUG_PRINTLN("[MQTT] Disconnecting...");
     
     if (_mqtt) {
+        saveSession();
         _mqtt->disconnect();
     }
     
@@ -103,12 +205,24 @@ MqttState MqttService::getState() {
 }
 
 void MqttService::loop() {
-    if (_mqtt && isConnected()) {
+    if (!_mqtt) {
+        return;
+    }
+    if (isConnected()) {
         _mqtt->loop();
     }
+    trackKeepalive();
 }
 
 bool MqttService::publishSensorData(const SensorPayload& payload) {
+    String topic;
+    String jsonPayload;
+    encodeSensorData(payload, topic, jsonPayload);
+    
+    return publishMessage(topic.c_str(), jsonPayload.c_str());
+}
+
+bool MqttService::publishMessage(const char* topic, const char* payload, bool retained) {
     if (!ensureConnection()) {
         DEBUG_PRINTLN("[MQTT] Cannot publish - not connected");
         return false;
@@ -117,12 +231,9 @@ bool MqttService::publishSensorData(const SensorPayload& payload) {
     // Call loop() to process any pending messages and maintain connection
     _mqtt->loop();
     
-    String topic = buildTopic(payload.deviceId);
-    String jsonPayload = buildJsonPayload(payload);
-    
-    DEBUG_PRINTF("[MQTT] Publishing to: %s\n", topic.c_str());
-    DEBUG_PRINTF("[MQTT] Payload: %s\n", jsonPayload.c_str());
-    DEBUG_PRINTF("[MQTT] Payload length: %d bytes\n", jsonPayload.length());
+    LOG_D("[MQTT] Publishing to: %s\n", topic);
+    LOG_V("[MQTT] Payload: %s\n", payload);
+    LOG_D("[MQTT] Payload length: %d bytes\n", strlen(payload));
     
     // Check connection state before publish
     if (!_mqtt->connected()) {
@@ -133,17 +244,17 @@ bool MqttService::publishSensorData(const SensorPayload& payload) {
     
     // Use simple publish (QoS 0 - fire and forget)
     // Note: Over cellular, return value may be unreliable
-    bool returnValue = _mqtt->publish(topic.c_str(), jsonPayload.c_str());
+    bool returnValue = _mqtt->publish(topic, payload, retained);
+    _lastTraffic = millis();
     
-    // Give time for the packet to be sent
-    delay(100);
-    _mqtt->loop();
+    // No wait here: the next pollMqtt() services the client, so the CPU
+    // lock is not held while the packet drains
     
     // Check if we're still connected after publish attempt
     bool stillConnected = _mqtt->connected();
     
     if (returnValue) {
-        DEBUG_PRINTLN("[MQTT] Publish successful");
+        LOG_D("[MQTT] Publish successful\n");
         return true;
     } else if (stillConnected) {
         // Return value was false but we're still connected
@@ -155,36 +266,57 @@ bool MqttService::publishSensorData(const SensorPayload& payload) {
     } else {
         // Actually disconnected
         DEBUG_PRINTF("[MQTT] Publish failed and disconnected! State: %d\n", _mqtt->state());
+        Drivers::AtCapture::trigger("publish disconnected");
         _state = MqttState::DISCONNECTED;
         return false;
     }
 }
 
+void MqttService::encodeSensorData(const SensorPayload& payload, String& topic, String& json) {
+    topic = buildTopic(payload.deviceId);
+    json = buildJsonPayload(payload);
+}
+
+void MqttService::encodeSummary(const SummaryPayload& payload, String& topic, String& json) {
+    topic = buildDeviceTopic(MQTT_SUMMARY_TOPIC_SUFFIX);
+    json = buildSummaryJson(payload);
+}
+
+void MqttService::encodeEvent(const EventPayload& payload, String& topic, String& json) {
+    topic = buildDeviceTopic(MQTT_EVENT_TOPIC_SUFFIX);
+    json = buildEventJson(payload);
+}
+
+String MqttService::buildDeviceTopic(const char* suffix) {
+    return String(MQTT_TOPIC_PREFIX) + "/" + _clientId + "/" + suffix;
+}
+
 bool MqttService::publish(const char* topic, const char* payload, bool retained) {
     if (!ensureConnection()) {
         return false;
     }
     
+    _lastTraffic = millis();
     return _mqtt->publish(topic, payload, retained);
 }
 
-bool MqttService::ensureConnection() {
+bool MqttService::ensureConnection(bool immediate) {
     if (isConnected()) {
         return true;
     }
     
     // Check if enough time passed since last attempt
     uint32_t now = millis();
-    if (now - _lastReconnectAttempt < MQTT_RECONNECT_DELAY_MS) {
+    if (!immediate && now - _lastReconnectAttempt < _brokers.retryDelay()) {
         return false;
     }
     _lastReconnectAttempt = now;
     
     DEBUG_PRINTLN("[MQTT] Connection lost, reconnecting...");
     
-    // Ensure GPRS is connected first
-    if (!_gprsManager.ensureConnection()) {
-        DEBUG_PRINTLN("[MQTT] GPRS reconnection failed");
+    // Ensure the network link is up first
+    if (!_link.ensureConnection()) {
+        DEBUG_PRINTLN("[MQTT] Network link reconnection failed");
         return false;
     }
     
@@ -193,17 +325,137 @@ bool MqttService::ensureConnection() {
 }
 
 void MqttService::setCallback(MQTT_CALLBACK_SIGNATURE) {
-    if (_mqtt) {
-        _mqtt->setCallback(callback);
+    _fallback = callback;
+}
+
+bool MqttService::route(const char* filter, MessageHandler handler, uint8_t qos) {
+    if (!_router.add(filter, handler)) {
+        return false;
+    }
+    
+    return subscribe(filter, qos);
+}
+
+void MqttService::onMessage(char* topic, uint8_t* payload, unsigned int length) {
+    _lastTraffic = millis();
+    if (_router.dispatch(topic, payload, length) == 0) {
+        if (_fallback) {
+            _fallback(topic, payload, length);
+        } else {
+            DEBUG_PRINTF("[MQTT] No route for %s\n", topic);
+        }
     }
 }
 
-bool MqttService::subscribe(const char* topic) {
+void MqttService::trackKeepalive() {
+    uint32_t now = millis();
+    
+    if (_pingSentAt == 0) {
+        if (_mqtt->connected() && _mqtt->isPingOutstanding()) {
+            _pingSentAt = now;
+            _pingIdleMs = now - _lastTraffic;
+        }
+        return;
+    }
+    
+    bool connected = _mqtt->connected();
+    if (connected && !_mqtt->isPingOutstanding()) {
+        _keepalive.onPingAnswered(_pingIdleMs);
+        _pingSentAt = 0;
+        _lastTraffic = now;
+        return;
+    }
+    
+    if (connected && now - _pingSentAt < MQTT_KEEPALIVE_PING_TIMEOUT_MS) {
+        return;
+    }
+    
+    // A NAT that dropped the flow swallows the ping (or answers with a reset);
+    // a ping sent after other traffic says nothing about the idle timeout
+    DEBUG_PRINTF("[MQTT] Ping %s after %lu s idle\n",
+                 connected ? "unanswered" : "lost with the socket", _pingIdleMs / 1000);
+    if (_pingIdleMs + 1000 >= (uint32_t)_mqtt->getKeepAlive() * 1000) {
+        _keepalive.onExpired();
+    }
+    _pingSentAt = 0;
+    
+    if (connected) {
+        // Drop the dead flow now rather than one more keepalive later
+        _link.getClient().stop();
+    }
+    _state = MqttState::DISCONNECTED;
+}
+
+bool MqttService::subscribe(const char* topic, uint8_t qos) {
+    bool known = false;
+    for (uint8_t i = 0; i < _subCount; i++) {
+        if (_subTopics[i] == topic) {
+            _subQos[i] = qos;
+            known = true;
+        }
+    }
+    if (!known) {
+        if (_subCount >= MQTT_MAX_SUBSCRIPTIONS) {
+            DEBUG_PRINTF("[MQTT] Subscription table full, %s not added\n", topic);
+            return false;
+        }
+        _subTopics[_subCount] = topic;
+        _subQos[_subCount] = qos;
+        _subCount++;
+    }
+    
     if (!isConnected()) {
-        return false;
+        return true;  // Subscribed on the next connect
+    }
+    
+    return restoreSubscriptions();
+}
+
+bool MqttService::isSessionResumed() {
+    return _sessionResumed;
+}
+
+bool MqttService::restoreSubscriptions() {
+    if (_subCount == 0) {
+        return true;
+    }
+    
+    uint32_t hash = subscriptionHash();
+    if (hash == s_session.subsHash) {
+        DEBUG_PRINTF("[MQTT] Session holds %d subscription(s), skipping SUBSCRIBE\n", _subCount);
+        return true;
     }
     
-    return _mqtt->subscribe(topic);
+    for (uint8_t i = 0; i < _subCount; i++) {
+        if (!_mqtt->subscribe(_subTopics[i].c_str(), _subQos[i])) {
+            DEBUG_PRINTF("[MQTT] Subscribe to %s failed\n", _subTopics[i].c_str());
+            return false;
+        }
+        DEBUG_PRINTF("[MQTT] Subscribed to %s (QoS %d)\n", _subTopics[i].c_str(), _subQos[i]);
+    }
+    
+    // Only a persistent session keeps the subscriptions for the next wake
+    s_session.subsHash = MQTT_CLEAN_SESSION ? 0 : hash;
+    saveSession();
+    return true;
+}
+
+uint32_t MqttService::subscriptionHash() {
+    uint32_t hash = 2166136261UL;
+    for (uint8_t i = 0; i < _subCount; i++) {
+        const char* p = _subTopics[i].c_str();
+        while (*p) {
+            hash = (hash ^ (uint8_t)*p++) * 16777619UL;
+        }
+        hash = (hash ^ _subQos[i]) * 16777619UL;
+    }
+    return hash ? hash : 1;
+}
+
+void MqttService::saveSession() {
+    if (_mqtt) {
+        s_session.nextMsgId = _mqtt->getNextMsgId();
+    }
 }
 
 String MqttService::buildTopic(const char* deviceId) {
@@ -212,7 +464,7 @@ String MqttService::buildTopic(const char* deviceId) {
 }
 
 String MqttService::buildJsonPayload(const SensorPayload& payload) {
-    StaticJsonDocument<256> doc;
+    StaticJsonDocument<384> doc;
     
     doc["device_id"] = payload.deviceId;
     
@@ -222,6 +474,74 @@ String MqttService::buildJsonPayload(const SensorPayload& payload) {
     
     doc["battery_level"] = payload.batteryLevel;
     doc["fill_level"] = payload.fillLevel;
+    if (payload.etaFullMin >= 0) {
+        doc["eta_full_min"] = payload.etaFullMin;
+    }
+    
+    // Per-sensor profile for multi-sensor containers
+    if (payload.sensorCount > 0 && payload.sensorDistanceCm) {
+        JsonArray distances = doc.createNestedArray("distances_cm");
+        for (uint8_t i = 0; i < payload.sensorCount; i++) {
+            distances.add(payload.sensorDistanceCm[i]);
+        }
+    }
+    
+    String output;
+    serializeJson(doc, output);
+    
+    return output;
+}
+
+String MqttService::buildSummaryJson(const SummaryPayload& payload) {
+    StaticJsonDocument<384> doc;
+    
+    doc["device_id"] = payload.deviceId;
+    
+    JsonObject location = doc.createNestedObject("location");
+    location["latitude"] = payload.latitude;
+    location["longitude"] = payload.longitude;
+    
+    doc["window_s"] = payload.windowSec;
+    doc["samples"] = payload.samples;
+    doc["invalid"] = payload.invalid;
+    
+    // Omitted when every reading in the window failed
+    if (payload.fillLast >= 0) {
+        JsonObject fill = doc.createNestedObject("fill");
+        fill["min"] = payload.fillMin;
+        fill["max"] = payload.fillMax;
+        fill["mean"] = roundf(payload.fillMean * 10.0f) / 10.0f;
+        fill["last"] = payload.fillLast;
+    }
+    
+    JsonObject battery = doc.createNestedObject("battery");
+    battery["last"] = payload.batteryLast;
+    battery["trend_per_h"] = roundf(payload.batteryTrend * 100.0f) / 100.0f;
+    
+    if (payload.etaFullMin >= 0) {
+        doc["eta_full_min"] = payload.etaFullMin;
+    }
+    
+    String output;
+    serializeJson(doc, output);
+    
+    return output;
+}
+
+String MqttService::buildEventJson(const EventPayload& payload) {
+    StaticJsonDocument<192> doc;
+    
+    doc["device_id"] = payload.deviceId;
+    doc["event"] = payload.type;
+    doc["from"] = payload.fromLevel;
+    doc["to"] = payload.toLevel;
+    
+    // Uptime only until the clock has been set
+    if (payload.timeValid) {
+        doc["ts"] = payload.timestamp;
+    } else {
+        doc["uptime_s"] = payload.timestamp;
+    }
     
     String output;
     serializeJson(doc, output);
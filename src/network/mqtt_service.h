@@ -9,7 +9,11 @@
 #include <Arduino.h>
 #include <PubSubClient.h>
 #include <ArduinoJson.h>
-#include "gprs_manager.h"
+#include "config.h"
+#include "link_manager.h"
+#include "topic_router.h"
+#include "keepalive_tuner.h"
+#include "broker_selector.h"
 
 namespace Network {
 
@@ -32,6 +36,40 @@ struct SensorPayload {
     float longitude;
     int8_t batteryLevel;
     int8_t fillLevel;
+    int32_t etaFullMin;             // Forecast minutes to full (-1 = unknown)
+    uint8_t sensorCount;            // Array sensors (0 = single sensor)
+    const float* sensorDistanceCm;  // Per-sensor distances (-1 = invalid)
+};
+
+/**
+ * @brief Windowed summary payload
+ */
+struct SummaryPayload {
+    const char* deviceId;
+    float latitude;
+    float longitude;
+    uint32_t windowSec;             // Window duration
+    uint16_t samples;               // Readings in the window
+    uint16_t invalid;               // Readings with a sensor failure
+    int8_t fillMin;                 // -1 = no valid reading
+    int8_t fillMax;
+    float fillMean;
+    int8_t fillLast;
+    int8_t batteryLast;
+    float batteryTrend;             // Battery slope over the window (%/hour)
+    int32_t etaFullMin;             // Forecast minutes to full (-1 = unknown)
+};
+
+/**
+ * @brief Bin event payload
+ */
+struct EventPayload {
+    const char* deviceId;
+    const char* type;               // "emptied", "sudden_fill"
+    int8_t fromLevel;
+    int8_t toLevel;
+    uint32_t timestamp;             // UTC epoch seconds, or uptime seconds
+    bool timeValid;                 // timestamp is UTC (clock was set)
 };
 
 /**
@@ -41,14 +79,14 @@ class MqttService {
 public:
     /**
      * @brief Constructor
-     * @param gprsManager Reference to GPRS manager
+     * @param linkManager Reference to transport link manager
      */
-    MqttService(GprsManager& gprsManager);
+    MqttService(LinkManager& linkManager);
 
     /**
      * @brief Initialize MQTT service
-     * @param broker MQTT broker address
-     * @param port MQTT broker port
+     * @param broker Primary MQTT broker address (fallbacks from config)
+     * @param port Primary MQTT broker port
      * @param clientId Client ID
      * @param user Username (optional)
      * @param pass Password (optional)
@@ -58,7 +96,7 @@ public:
               const char* user = "", const char* pass = "");
 
     /**
-     * @brief Connect to MQTT broker
+     * @brief Connect to the best broker, failing over to another on error
      * @return true if connected
      */
     bool connect();
@@ -101,37 +139,142 @@ public:
      */
     bool publish(const char* topic, const char* payload, bool retained = false);
 
+    /**
+     * @brief Publish a prepared message, tolerating the cellular write quirk
+     * @param topic MQTT topic
+     * @param payload Message payload
+     * @param retained Retain flag
+     * @return true if the message was (likely) sent
+     */
+    bool publishMessage(const char* topic, const char* payload, bool retained = false);
+
+    /**
+     * @brief Encode sensor data into its topic and JSON payload
+     * @param payload Sensor payload data
+     * @param topic Output topic
+     * @param json Output JSON payload
+     */
+    void encodeSensorData(const SensorPayload& payload, String& topic, String& json);
+
+    /**
+     * @brief Encode a window summary into its topic and JSON payload
+     * @param payload Summary payload data
+     * @param topic Output topic
+     * @param json Output JSON payload
+     */
+    void encodeSummary(const SummaryPayload& payload, String& topic, String& json);
+
+    /**
+     * @brief Encode a bin event into its topic and JSON payload
+     * @param payload Event payload data
+     * @param topic Output topic
+     * @param json Output JSON payload
+     */
+    void encodeEvent(const EventPayload& payload, String& topic, String& json);
+
+    /**
+     * @brief Build a topic below the device prefix
+     * @param suffix Topic suffix (e.g. "diag")
+     * @return Full topic string
+     */
+    String buildDeviceTopic(const char* suffix);
+
     /**
      * @brief Ensure connection, reconnect if needed
+     * @param immediate Skip the reconnect throttle (urgent traffic)
      * @return true if connected
      */
-    bool ensureConnection();
+    bool ensureConnection(bool immediate = false);
 
     /**
-     * @brief Set callback for incoming messages
+     * @brief Set callback for incoming messages no route matched
      * @param callback Callback function
      */
     void setCallback(MQTT_CALLBACK_SIGNATURE);
 
     /**
-     * @brief Subscribe to topic
+     * @brief Route a topic filter to a handler and subscribe to it
+     * @param filter MQTT topic filter ('+' and '#' wildcards allowed)
+     * @param handler Handler for matching messages
+     * @param qos Requested QoS (0 or 1)
+     * @return true if routed and subscribed (or deferred until connected)
+     */
+    bool route(const char* filter, MessageHandler handler, uint8_t qos = 1);
+
+    /**
+     * @brief Subscribe to topic (remembered and restored after reconnect)
      * @param topic Topic to subscribe
-     * @return true if subscription successful
+     * @param qos Requested QoS (0 or 1)
+     * @return true if subscription successful (or deferred until connected)
      */
-    bool subscribe(const char* topic);
+    bool subscribe(const char* topic, uint8_t qos = 1);
+
+    /**
+     * @brief Check if the broker resumed the previous session on last connect
+     * @return true if the session (and its subscriptions) survived
+     */
+    bool isSessionResumed();
 
 private:
-    GprsManager& _gprsManager;
+    LinkManager& _link;
     PubSubClient* _mqtt;
     MqttState _state;
     
-    String _broker;
-    uint16_t _port;
+    BrokerSelector _brokers;
     String _clientId;
-    String _user;
-    String _pass;
     
     uint32_t _lastReconnectAttempt;
+    bool _sessionResumed;
+    
+    KeepaliveTuner _keepalive;
+    uint32_t _lastTraffic;      // Last publish, inbound message or ping answer
+    uint32_t _pingSentAt;       // 0 = no ping being tracked
+    uint32_t _pingIdleMs;       // Idle gap before the tracked ping
+    
+    TopicRouter _router;
+    std::function<void(char*, uint8_t*, unsigned int)> _fallback;
+    
+    String _subTopics[MQTT_MAX_SUBSCRIPTIONS];
+    uint8_t _subQos[MQTT_MAX_SUBSCRIPTIONS];
+    uint8_t _subCount;
+
+    /**
+     * @brief Send CONNECT to one broker and record the outcome
+     * @param index Broker index
+     * @param willTopic Will topic
+     * @return true if the broker accepted the connection
+     */
+    bool connectBroker(uint8_t index, const String& willTopic);
+
+    /**
+     * @brief Dispatch an inbound message to its routes (or the fallback)
+     * @param topic Message topic
+     * @param payload Message payload
+     * @param length Payload length
+     */
+    void onMessage(char* topic, uint8_t* payload, unsigned int length);
+
+    /**
+     * @brief Follow pings for the keepalive tuner and drop an expired flow
+     */
+    void trackKeepalive();
+
+    /**
+     * @brief Subscribe all remembered topics unless the session survived
+     * @return true if subscriptions are in place
+     */
+    bool restoreSubscriptions();
+
+    /**
+     * @brief Hash of the remembered subscription set
+     * @return FNV-1a hash over topics and QoS
+     */
+    uint32_t subscriptionHash();
+
+    /**
+     * @brief Save packet identifier / session state to RTC memory
+     */
+    void saveSession();
 
     /**
      * @brief Build topic string for sensor data
@@ -146,6 +289,20 @@ private:
      * @return JSON string
      */
     String buildJsonPayload(const SensorPayload& payload);
+
+    /**
+     * @brief Build JSON payload from a window summary
+     * @param payload Summary payload
+     * @return JSON string
+     */
+    String buildSummaryJson(const SummaryPayload& payload);
+
+    /**
+     * @brief Build JSON payload from a bin event
+     * @param payload Event payload
+     * @return JSON string
+     */
+    String buildEventJson(const EventPayload& payload);
 };
 
 } // namespace Network
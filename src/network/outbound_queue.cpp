@@ -0,0 +1,278 @@
+/**
+ * @file outbound_queue.cpp
+ * @brief Priority outbound message queue implementation
+ */
+
+#define LOG_MODULE Drivers::LogModule::MQTT
+
+#include "outbound_queue.h"
+
+namespace Network {
+
+namespace {
+
+const char* className(MessageClass cls) {
+    switch (cls) {
+        case MessageClass::ALERT:       return "alert";
+        case MessageClass::TELEMETRY:   return "telemetry";
+        case MessageClass::DIAGNOSTICS: return "diagnostics";
+        default:                        return "?";
+    }
+}
+
+} // namespace
+
+OutboundQueue::OutboundQueue(MqttService& mqttService, SignalMonitor& signalMonitor)
+    : _mqtt(mqttService), _signal(signalMonitor), _lastWindow(0), _windowStarted(false) {
+    memset(_slots, 0, sizeof(_slots));
+    memset(_accum, 0, sizeof(_accum));
+}
+
+bool OutboundQueue::enqueue(MessageClass cls, const char* topic, const char* payload, bool retained) {
+    if (strlen(topic) >= OUTBOUND_TOPIC_MAX || strlen(payload) >= OUTBOUND_PAYLOAD_MAX) {
+        DEBUG_PRINTF("[Queue] %s message too large, dropped\n", className(cls));
+        _accum[(uint8_t)cls].dropped++;
+        return false;
+    }
+
+    int8_t slot = allocate(cls);
+    if (slot < 0) {
+        DEBUG_PRINTF("[Queue] Full, %s message dropped\n", className(cls));
+        _accum[(uint8_t)cls].dropped++;
+        return false;
+    }
+
+    Message& msg = _slots[slot];
+    msg.used = true;
+    msg.cls = cls;
+    msg.retained = retained;
+    msg.attempts = 0;
+    msg.enqueuedAt = millis();
+    strcpy(msg.topic, topic);
+    strcpy(msg.payload, payload);
+
+    DEBUG_PRINTF("[Queue] Queued %s message (%d pending)\n", className(cls), countPending(cls));
+    return true;
+}
+
+uint8_t OutboundQueue::service() {
+    bool alertPending = hasPending(MessageClass::ALERT);
+    bool routineDue = windowDue();
+    uint8_t routine = countPending(MessageClass::TELEMETRY) + countPending(MessageClass::DIAGNOSTICS);
+
+    // Poor signal: routine traffic waits for a cheaper window unless the
+    // queue is full (sending beats evicting)
+    bool routineHeld = (routineDue || alertPending) && routine > 0 &&
+                       routine < OUTBOUND_QUEUE_SIZE && _signal.shouldDefer(oldestRoutineAge());
+    if (routineHeld) {
+        routineDue = false;
+    }
+
+    if (!alertPending && !routineDue) {
+        return 0;
+    }
+
+    // Alerts bypass the reconnect throttle; routine traffic waits for it
+    if (!_mqtt.ensureConnection(alertPending)) {
+        return 0;
+    }
+
+    // Routine traffic piggybacks on a connection opened for an alert
+    bool includeRoutine = routineDue || (alertPending && !routineHeld);
+    uint8_t published = 0;
+    uint8_t budget = OUTBOUND_MAX_PER_SERVICE;
+
+    while (budget > 0) {
+        int8_t index = pickNext(includeRoutine);
+        if (index < 0) {
+            break;
+        }
+
+        Message& msg = _slots[index];
+        msg.attempts++;
+
+        uint32_t started = millis();
+        if (!_mqtt.publishMessage(msg.topic, msg.payload, msg.retained)) {
+            DEBUG_PRINTF("[Queue] Publish of %s message failed (attempt %d)\n",
+                         className(msg.cls), msg.attempts);
+            break;  // Link is down; keep the message and retry next service
+        }
+
+        _signal.recordTransmit(strlen(msg.topic) + strlen(msg.payload), millis() - started);
+
+        uint32_t latency = millis() - msg.enqueuedAt;
+        ClassAccum& acc = _accum[(uint8_t)msg.cls];
+        acc.sent++;
+        acc.latencySumMs += latency;
+        if (latency > acc.maxLatencyMs) {
+            acc.maxLatencyMs = latency;
+        }
+        DEBUG_PRINTF("[Queue] Sent %s message after %lu ms\n", className(msg.cls), latency);
+
+        msg.used = false;
+        published++;
+        if (msg.cls != MessageClass::ALERT) {
+            budget--;
+        }
+    }
+
+    // Window closes once routine traffic has been drained
+    if (includeRoutine && !hasPending(MessageClass::TELEMETRY) &&
+        !hasPending(MessageClass::DIAGNOSTICS)) {
+        _lastWindow = millis();
+        _windowStarted = true;
+    }
+
+    return published;
+}
+
+bool OutboundQueue::hasPending(MessageClass cls) {
+    return countPending(cls) > 0;
+}
+
+ClassStats OutboundQueue::getStats(MessageClass cls) {
+    ClassAccum& acc = _accum[(uint8_t)cls];
+    ClassStats stats;
+    stats.sent = acc.sent;
+    stats.dropped = acc.dropped;
+    stats.avgLatencyMs = acc.sent ? (uint32_t)(acc.latencySumMs / acc.sent) : 0;
+    stats.maxLatencyMs = acc.maxLatencyMs;
+    stats.pending = countPending(cls);
+    return stats;
+}
+
+void OutboundQueue::printStats() {
+    for (uint8_t c = 0; c < (uint8_t)MessageClass::COUNT; c++) {
+        ClassStats stats = getStats((MessageClass)c);
+        DEBUG_PRINTF("[Queue] %-11s sent=%lu dropped=%lu pending=%d latency avg=%lu max=%lu ms\n",
+                     className((MessageClass)c), stats.sent, stats.dropped, stats.pending,
+                     stats.avgLatencyMs, stats.maxLatencyMs);
+    }
+}
+
+String OutboundQueue::buildStatsJson() {
+    StaticJsonDocument<384> doc;
+
+    JsonObject queue = doc.createNestedObject("queue");
+    for (uint8_t c = 0; c < (uint8_t)MessageClass::COUNT; c++) {
+        ClassStats stats = getStats((MessageClass)c);
+        JsonObject entry = queue.createNestedObject(className((MessageClass)c));
+        entry["sent"] = stats.sent;
+        entry["dropped"] = stats.dropped;
+        entry["pending"] = stats.pending;
+        entry["avg_ms"] = stats.avgLatencyMs;
+        entry["max_ms"] = stats.maxLatencyMs;
+    }
+
+    String output;
+    serializeJson(doc, output);
+    return output;
+}
+
+int8_t OutboundQueue::allocate(MessageClass cls) {
+    for (uint8_t i = 0; i < OUTBOUND_QUEUE_SIZE; i++) {
+        if (!_slots[i].used) {
+            return i;
+        }
+    }
+
+    // Full: evict the oldest message of the lowest class that is not
+    // more important than the new one (alerts are never evicted)
+    int8_t victim = -1;
+    for (uint8_t i = 0; i < OUTBOUND_QUEUE_SIZE; i++) {
+        const Message& msg = _slots[i];
+        if (msg.cls == MessageClass::ALERT || msg.cls < cls) {
+            continue;
+        }
+        if (victim < 0 || msg.cls > _slots[victim].cls ||
+            (msg.cls == _slots[victim].cls && msg.enqueuedAt < _slots[victim].enqueuedAt)) {
+            victim = i;
+        }
+    }
+
+    if (victim >= 0) {
+        DEBUG_PRINTF("[Queue] Evicting %s message\n", className(_slots[victim].cls));
+        _accum[(uint8_t)_slots[victim].cls].dropped++;
+        _slots[victim].used = false;
+    }
+    return victim;
+}
+
+int8_t OutboundQueue::pickNext(bool includeRoutine) {
+    uint32_t now = millis();
+    int8_t best = -1;
+    int32_t bestScore = 0;
+
+    for (uint8_t i = 0; i < OUTBOUND_QUEUE_SIZE; i++) {
+        const Message& msg = _slots[i];
+        if (!msg.used) {
+            continue;
+        }
+        if (msg.cls != MessageClass::ALERT && !includeRoutine) {
+            continue;
+        }
+
+        // Lower score wins. Alerts always come first; routine messages are
+        // promoted one class per aging period they have been waiting.
+        int32_t score;
+        if (msg.cls == MessageClass::ALERT) {
+            score = INT32_MIN;
+        } else {
+            uint32_t age = now - msg.enqueuedAt;
+            if (age > OUTBOUND_AGING_MS * 4) age = OUTBOUND_AGING_MS * 4;
+            score = (int32_t)msg.cls * OUTBOUND_AGING_MS - (int32_t)age;
+        }
+
+        if (best < 0 || score < bestScore ||
+            (score == bestScore && msg.enqueuedAt < _slots[best].enqueuedAt)) {
+            best = i;
+            bestScore = score;
+        }
+    }
+
+    return best;
+}
+
+bool OutboundQueue::windowDue() {
+    uint8_t routine = countPending(MessageClass::TELEMETRY) + countPending(MessageClass::DIAGNOSTICS);
+    if (routine == 0) {
+        return false;
+    }
+
+    // First routine traffic after boot goes out immediately
+    if (!_windowStarted || routine >= OUTBOUND_BATCH_SIZE) {
+        return true;
+    }
+
+    uint32_t now = millis();
+    if (now - _lastWindow >= OUTBOUND_BATCH_WINDOW_MS) {
+        return true;
+    }
+
+    // Maximum deferral: never hold a routine message longer than this
+    return oldestRoutineAge() >= OUTBOUND_MAX_DEFER_MS;
+}
+
+uint8_t OutboundQueue::countPending(MessageClass cls) {
+    uint8_t count = 0;
+    for (uint8_t i = 0; i < OUTBOUND_QUEUE_SIZE; i++) {
+        if (_slots[i].used && _slots[i].cls == cls) {
+            count++;
+        }
+    }
+    return count;
+}
+
+uint32_t OutboundQueue::oldestRoutineAge() {
+    uint32_t now = millis();
+    uint32_t oldest = 0;
+    for (uint8_t i = 0; i < OUTBOUND_QUEUE_SIZE; i++) {
+        const Message& msg = _slots[i];
+        if (msg.used && msg.cls != MessageClass::ALERT && now - msg.enqueuedAt > oldest) {
+            oldest = now - msg.enqueuedAt;
+        }
+    }
+    return oldest;
+}
+
+} // namespace Network
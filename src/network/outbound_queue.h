@@ -0,0 +1,166 @@
+/**
+ * @file outbound_queue.h
+ * @brief Priority outbound message queue in front of MqttService
+ */
+
+#ifndef OUTBOUND_QUEUE_H
+#define OUTBOUND_QUEUE_H
+
+#include <Arduino.h>
+#include "config.h"
+#include "mqtt_service.h"
+#include "signal_monitor.h"
+
+namespace Network {
+
+/**
+ * @brief Outbound message priority class (lower value = higher priority)
+ */
+enum class MessageClass : uint8_t {
+    ALERT,        // Full bin, sensor failure - sent immediately
+    TELEMETRY,    // Routine readings - batched
+    DIAGNOSTICS,  // Statistics - batched, lowest priority
+    COUNT
+};
+
+/**
+ * @brief Per-class queue statistics
+ */
+struct ClassStats {
+    uint32_t sent;          // Messages published
+    uint32_t dropped;       // Messages evicted or rejected
+    uint32_t avgLatencyMs;  // Mean enqueue-to-publish latency
+    uint32_t maxLatencyMs;  // Worst enqueue-to-publish latency
+    uint8_t pending;        // Messages currently queued
+};
+
+/**
+ * @brief Priority outbound queue
+ *
+ * - Alerts preempt everything: they jump the queue, may evict routine
+ *   messages when full and force an immediate (unthrottled) connect.
+ * - Telemetry and diagnostics are held and flushed in batch windows
+ *   (window period, batch size or maximum deferral reached).
+ * - Aging: a waiting message gains one priority level per
+ *   OUTBOUND_AGING_MS so diagnostics are not starved by telemetry.
+ * - Poor signal holds routine traffic (including piggybacking on an
+ *   alert) until the signal improves or SIGNAL_MAX_DEFER_MS has passed.
+ */
+class OutboundQueue {
+public:
+    /**
+     * @brief Constructor
+     * @param mqttService Reference to MQTT service
+     * @param signalMonitor Reference to signal monitor
+     */
+    OutboundQueue(MqttService& mqttService, SignalMonitor& signalMonitor);
+
+    /**
+     * @brief Queue a message
+     * @param cls Priority class
+     * @param topic MQTT topic
+     * @param payload Message payload
+     * @param retained Retain flag
+     * @return true if queued (false if too large or no room for its class)
+     */
+    bool enqueue(MessageClass cls, const char* topic, const char* payload, bool retained = false);
+
+    /**
+     * @brief Publish due messages (call in loop)
+     * @return Number of messages published
+     */
+    uint8_t service();
+
+    /**
+     * @brief Check if messages of a class are waiting
+     * @param cls Priority class
+     * @return true if at least one is queued
+     */
+    bool hasPending(MessageClass cls);
+
+    /**
+     * @brief Get statistics for a class
+     * @param cls Priority class
+     * @return Statistics snapshot
+     */
+    ClassStats getStats(MessageClass cls);
+
+    /**
+     * @brief Log per-class latency statistics
+     */
+    void printStats();
+
+    /**
+     * @brief Build a JSON report of per-class statistics
+     * @return JSON string
+     */
+    String buildStatsJson();
+
+private:
+    /**
+     * @brief Queued message
+     */
+    struct Message {
+        bool used;
+        MessageClass cls;
+        bool retained;
+        uint8_t attempts;
+        uint32_t enqueuedAt;
+        char topic[OUTBOUND_TOPIC_MAX];
+        char payload[OUTBOUND_PAYLOAD_MAX];
+    };
+
+    /**
+     * @brief Per-class accumulators
+     */
+    struct ClassAccum {
+        uint32_t sent;
+        uint32_t dropped;
+        uint64_t latencySumMs;
+        uint32_t maxLatencyMs;
+    };
+
+    MqttService& _mqtt;
+    SignalMonitor& _signal;
+    Message _slots[OUTBOUND_QUEUE_SIZE];
+    ClassAccum _accum[(uint8_t)MessageClass::COUNT];
+    uint32_t _lastWindow;
+    bool _windowStarted;
+
+    /**
+     * @brief Find a free slot, evicting a lower-priority message if allowed
+     * @param cls Class of the message to be stored
+     * @return Slot index, or -1 if none
+     */
+    int8_t allocate(MessageClass cls);
+
+    /**
+     * @brief Pick the next message to send (class priority with aging)
+     * @param includeRoutine Consider telemetry/diagnostics
+     * @return Slot index, or -1 if none
+     */
+    int8_t pickNext(bool includeRoutine);
+
+    /**
+     * @brief Check if the routine batch window is open
+     * @return true if routine messages should be flushed now
+     */
+    bool windowDue();
+
+    /**
+     * @brief Count queued messages of a class
+     * @param cls Priority class
+     * @return Message count
+     */
+    uint8_t countPending(MessageClass cls);
+
+    /**
+     * @brief Get how long the oldest routine message has waited
+     * @return Age in milliseconds (0 if none)
+     */
+    uint32_t oldestRoutineAge();
+};
+
+} // namespace Network
+
+#endif // OUTBOUND_QUEUE_H
@@ -0,0 +1,236 @@
+/**
+ * @file rat_selector.cpp
+ * @brief RAT Selector implementation
+ */
+
+#define LOG_MODULE Drivers::LogModule::LINK
+
+#include "rat_selector.h"
+#include "config.h"
+#include <Preferences.h>
+
+namespace Network {
+
+namespace {
+
+constexpr uint32_t MODEL_MAGIC = 0x52415431; // "RAT1"
+constexpr const char* PREFS_NAMESPACE = "rat";
+constexpr const char* PREFS_MODEL_KEY = "model";
+
+constexpr uint8_t RAT_COUNT = (uint8_t)Rat::COUNT;
+
+/**
+ * @brief Modem configuration and typical search power per RAT
+ *
+ * Power is the mean SIM7000 draw at 3.8 V while searching/attaching; it
+ * only weights attach time, so rough figures are enough.
+ */
+struct RatProfile {
+    uint8_t networkMode;    // AT+CNMP
+    uint8_t preferredMode;  // AT+CMNB (0 = not applicable)
+    uint16_t powerMw;
+    uint8_t mask;           // RAT_MASK_* bit
+};
+
+const RatProfile PROFILES[RAT_COUNT] = {
+    {  2, 3, 400, 0 },                  // AUTO
+    { 38, 1, 300, RAT_MASK_CATM },      // CAT-M
+    { 38, 2, 230, RAT_MASK_NBIOT },     // NB-IoT
+    { 13, 0, 600, RAT_MASK_GSM },       // GSM
+};
+
+/**
+ * @brief RAT model, kept in RTC memory across deep sleep
+ */
+struct RatModel {
+    uint32_t magic;
+    uint16_t attaches;          // Attaches since the last re-evaluation
+    uint8_t nextProbe;          // Next RAT to try on re-evaluation
+    RatStats stats[RAT_COUNT];
+};
+
+RTC_DATA_ATTR RatModel s_model;
+
+} // namespace
+
+RatSelector::RatSelector(HAL::ModemHAL& modemHal) : _modemHal(modemHal) {
+}
+
+void RatSelector::begin() {
+    if (s_model.magic == MODEL_MAGIC) {
+        return;
+    }
+
+    Preferences prefs;
+    if (prefs.begin(PREFS_NAMESPACE, true)) {
+        size_t len = prefs.getBytes(PREFS_MODEL_KEY, &s_model, sizeof(s_model));
+        prefs.end();
+        if (len == sizeof(s_model) && s_model.magic == MODEL_MAGIC) {
+            DEBUG_PRINTLN("[RAT] Model restored from NVS");
+            return;
+        }
+    }
+
+    memset(&s_model, 0, sizeof(s_model));
+    s_model.magic = MODEL_MAGIC;
+    s_model.nextProbe = (uint8_t)Rat::CATM;
+}
+
+Rat RatSelector::select() {
+#if RAT_SELECT_ENABLED
+    Rat best = bestRat();
+
+    // Periodically try another allowed RAT so the choice follows coverage
+    if (best != Rat::AUTO && s_model.attaches >= RAT_REEVALUATE_EVERY) {
+        s_model.attaches = 0;
+        for (uint8_t i = 0; i < RAT_COUNT - 1; i++) {
+            uint8_t r = s_model.nextProbe;
+            s_model.nextProbe = (r + 1 < RAT_COUNT) ? r + 1 : (uint8_t)Rat::CATM;
+            if ((Rat)r != best && (PROFILES[r].mask & RAT_ALLOWED)) {
+                DEBUG_PRINTF("[RAT] Re-evaluating %s (best %s)\n", ratName((Rat)r), ratName(best));
+                return (Rat)r;
+            }
+        }
+    }
+
+    return best;
+#else
+    return Rat::AUTO;
+#endif
+}
+
+bool RatSelector::apply(Rat rat) {
+#if RAT_SELECT_ENABLED
+    const RatProfile& profile = PROFILES[(uint8_t)rat];
+    if (!_modemHal.setRadioMode(profile.networkMode, profile.preferredMode)) {
+        DEBUG_PRINTF("[RAT] Modem rejected %s\n", ratName(rat));
+        return false;
+    }
+    DEBUG_PRINTF("[RAT] Searching %s\n", ratName(rat));
+#endif
+    return true;
+}
+
+void RatSelector::record(Rat rat, bool success, uint32_t elapsedMs) {
+#if RAT_SELECT_ENABLED
+    // A multi-RAT search also teaches us which RAT serves this site
+    Rat serving = (rat == Rat::AUTO && success) ? servingRat() : Rat::AUTO;
+
+    Rat targets[2] = { rat, serving };
+    Rat bestBefore = bestRat();
+    bool skipChanged = false;
+
+    for (uint8_t i = 0; i < 2; i++) {
+        if (i > 0 && targets[i] == Rat::AUTO) {
+            break;
+        }
+        bool usable = isUsable(targets[i]);
+        RatStats& stats = s_model.stats[(uint8_t)targets[i]];
+        if (stats.attempts < UINT16_MAX) {
+            stats.attempts++;
+        }
+        if (success) {
+            if (stats.successes < UINT16_MAX) {
+                stats.successes++;
+            }
+            stats.failStreak = 0;
+            stats.avgAttachMs = (stats.avgAttachMs == 0)
+                ? elapsedMs
+                : (stats.avgAttachMs * 3 + elapsedMs) / 4;
+        } else if (stats.failStreak < UINT8_MAX) {
+            stats.failStreak++;
+        }
+        skipChanged = skipChanged || usable != isUsable(targets[i]);
+    }
+
+    if (s_model.attaches < UINT16_MAX) {
+        s_model.attaches++;
+    }
+
+    DEBUG_PRINTF("[RAT] %s %s after %lu ms%s%s\n", ratName(rat),
+                 success ? "registered" : "failed", elapsedMs,
+                 serving != Rat::AUTO ? ", serving " : "",
+                 serving != Rat::AUTO ? ratName(serving) : "");
+
+    // Averages ride in RTC memory; NVS only sees changes of decision
+    if (skipChanged || bestRat() != bestBefore) {
+        save();
+    }
+#endif
+}
+
+RatStats RatSelector::getStats(Rat rat) {
+    return s_model.stats[(uint8_t)rat];
+}
+
+void RatSelector::printStats() {
+    for (uint8_t r = 0; r < RAT_COUNT; r++) {
+        const RatStats& stats = s_model.stats[r];
+        if (stats.attempts == 0) {
+            continue;
+        }
+        DEBUG_PRINTF("[RAT] %-6s %u/%u ok, avg %lu ms, ~%.0f mJ/attach%s\n",
+                     ratName((Rat)r), stats.successes, stats.attempts, stats.avgAttachMs,
+                     expectedEnergy((Rat)r), isUsable((Rat)r) ? "" : " (skipped)");
+    }
+}
+
+const char* RatSelector::ratName(Rat rat) {
+    switch (rat) {
+        case Rat::CATM:  return "CAT-M";
+        case Rat::NBIOT: return "NB-IoT";
+        case Rat::GSM:   return "GSM";
+        default:         return "auto";
+    }
+}
+
+float RatSelector::expectedEnergy(Rat rat) {
+    const RatStats& stats = s_model.stats[(uint8_t)rat];
+    if (stats.successes == 0) {
+        return -1.0f;
+    }
+
+    // Failed attempts cost time too: scale by attempts per success
+    float attemptsPerSuccess = (float)stats.attempts / stats.successes;
+    return stats.avgAttachMs * PROFILES[(uint8_t)rat].powerMw / 1000.0f * attemptsPerSuccess;
+}
+
+bool RatSelector::isUsable(Rat rat) {
+    return (PROFILES[(uint8_t)rat].mask & RAT_ALLOWED) &&
+           s_model.stats[(uint8_t)rat].failStreak < RAT_MAX_FAIL_STREAK;
+}
+
+Rat RatSelector::bestRat() {
+    Rat best = Rat::AUTO;
+    float bestEnergy = 0;
+    for (uint8_t r = (uint8_t)Rat::CATM; r < RAT_COUNT; r++) {
+        float energy = expectedEnergy((Rat)r);
+        if (isUsable((Rat)r) && energy >= 0 && (best == Rat::AUTO || energy < bestEnergy)) {
+            best = (Rat)r;
+            bestEnergy = energy;
+        }
+    }
+    return best;
+}
+
+Rat RatSelector::servingRat() {
+    switch (_modemHal.getSystemMode()) {
+        case 1:
+        case 2:
+        case 3:  return Rat::GSM;
+        case 7:  return Rat::CATM;
+        case 9:  return Rat::NBIOT;
+        default: return Rat::AUTO;
+    }
+}
+
+void RatSelector::save() {
+    Preferences prefs;
+    if (!prefs.begin(PREFS_NAMESPACE, false)) {
+        return;
+    }
+    prefs.putBytes(PREFS_MODEL_KEY, &s_model, sizeof(s_model));
+    prefs.end();
+}
+
+} // namespace Network
@@ -0,0 +1,140 @@
+/**
+ * @file rat_selector.h
+ * @brief RAT Selector - learned radio access technology choice per site
+ */
+
+#ifndef RAT_SELECTOR_H
+#define RAT_SELECTOR_H
+
+#include <Arduino.h>
+#include "../hal/modem_hal.h"
+
+namespace Network {
+
+/**
+ * @brief Radio access technology
+ */
+enum class Rat : uint8_t {
+    AUTO,       // Multi-RAT search (modem default)
+    CATM,       // LTE CAT-M1
+    NBIOT,      // LTE NB-IoT
+    GSM,        // 2G GSM/GPRS
+    COUNT
+};
+
+/**
+ * @brief Per-RAT attach statistics
+ */
+struct RatStats {
+    uint16_t attempts;
+    uint16_t successes;
+    uint32_t avgAttachMs;   // Smoothed time to registration (0 = never measured)
+    uint8_t failStreak;     // Consecutive failures
+};
+
+/**
+ * @brief RAT selection manager
+ *
+ * Records attach time and outcome per RAT and picks the one with the lowest
+ * expected energy per successful attach (attach time x typical search power
+ * / success rate). Until a RAT has succeeded the modem searches all RATs;
+ * the RAT actually found (AT+CNSMOD) is credited, so the first boot at a
+ * site seeds the model.
+ *
+ * A RAT that fails RAT_MAX_FAIL_STREAK times in a row is skipped, and every
+ * RAT_REEVALUATE_EVERY attaches another allowed RAT is tried so the choice
+ * follows changes in coverage. Bins are installed at a fixed site, so the
+ * model is per device; it lives in RTC memory and is saved to NVS only when
+ * the best RAT changes or a RAT starts or stops being skipped.
+ */
+class RatSelector {
+public:
+    /**
+     * @brief Constructor
+     * @param modemHal Reference to modem HAL
+     */
+    RatSelector(HAL::ModemHAL& modemHal);
+
+    /**
+     * @brief Restore the model from RTC memory or NVS
+     */
+    void begin();
+
+    /**
+     * @brief Choose the RAT for the next attach
+     * @return RAT to configure (AUTO while learning)
+     */
+    Rat select();
+
+    /**
+     * @brief Configure the modem for a RAT
+     * @param rat RAT to search
+     * @return true if the modem accepted the mode
+     */
+    bool apply(Rat rat);
+
+    /**
+     * @brief Record the outcome of an attach
+     * @param rat RAT that was configured
+     * @param success True if the modem registered
+     * @param elapsedMs Time from apply() to registration or timeout
+     */
+    void record(Rat rat, bool success, uint32_t elapsedMs);
+
+    /**
+     * @brief Get statistics for a RAT
+     * @param rat RAT
+     * @return Statistics snapshot
+     */
+    RatStats getStats(Rat rat);
+
+    /**
+     * @brief Log per-RAT statistics
+     */
+    void printStats();
+
+    /**
+     * @brief Get a printable name for a RAT
+     * @param rat RAT
+     * @return Name string
+     */
+    static const char* ratName(Rat rat);
+
+private:
+    HAL::ModemHAL& _modemHal;
+
+    /**
+     * @brief Expected attach energy for a RAT
+     * @param rat RAT
+     * @return Estimated mJ per successful attach (-1 = no data)
+     */
+    float expectedEnergy(Rat rat);
+
+    /**
+     * @brief Check if a RAT may be selected
+     * @param rat RAT
+     * @return true if allowed in RAT_ALLOWED and not on a fail streak
+     */
+    bool isUsable(Rat rat);
+
+    /**
+     * @brief Usable RAT with the lowest expected attach energy
+     * @return RAT (AUTO if none has succeeded yet)
+     */
+    Rat bestRat();
+
+    /**
+     * @brief Map the serving system mode to a RAT
+     * @return Serving RAT (AUTO if unknown)
+     */
+    Rat servingRat();
+
+    /**
+     * @brief Save the model to NVS
+     */
+    void save();
+};
+
+} // namespace Network
+
+#endif // RAT_SELECTOR_H
@@ -0,0 +1,152 @@
+/**
+ * @file signal_monitor.cpp
+ * @brief Signal Monitor implementation
+ */
+
+#define LOG_MODULE Drivers::LogModule::LINK
+
+#include "signal_monitor.h"
+#include <ArduinoJson.h>
+
+namespace Network {
+
+SignalMonitor::SignalMonitor(HAL::ModemHAL& modemHal, LinkManager& linkManager)
+    : _modemHal(modemHal), _link(linkManager), _bucket(SignalBucket::UNKNOWN),
+      _csq(99), _rsrpDbm(0), _lastSample(0), _sampled(false),
+      _deferring(false), _deferrals(0) {
+    memset(_stats, 0, sizeof(_stats));
+}
+
+SignalBucket SignalMonitor::sample() {
+    // Wi-Fi (or no link): nothing to wait for
+    if (_link.getActiveLink() != LinkType::CELLULAR || !_modemHal.isReady()) {
+        _bucket = SignalBucket::UNKNOWN;
+        _sampled = false;
+        return _bucket;
+    }
+
+    if (_sampled && millis() - _lastSample < SIGNAL_SAMPLE_INTERVAL_MS) {
+        return _bucket;
+    }
+    _lastSample = millis();
+    _sampled = true;
+
+    _csq = _modemHal.getSignalQuality();
+    if (!_modemHal.getRsrp(_rsrpDbm)) {
+        _rsrpDbm = 0;
+    }
+
+    SignalBucket bucket = classify();
+    if (bucket != _bucket) {
+        DEBUG_PRINTF("[Signal] %s (CSQ %d, RSRP %d dBm)\n", bucketName(bucket), _csq, _rsrpDbm);
+    }
+    _bucket = bucket;
+    return _bucket;
+}
+
+SignalBucket SignalMonitor::getBucket() {
+    return _bucket;
+}
+
+bool SignalMonitor::shouldDefer(uint32_t waitingMs) {
+#if SIGNAL_AWARE_ENABLED
+    bool defer = (sample() == SignalBucket::POOR && waitingMs < SIGNAL_MAX_DEFER_MS);
+#else
+    bool defer = false;
+#endif
+
+    if (defer && !_deferring) {
+        _deferrals++;
+        DEBUG_PRINTF("[Signal] Poor signal, holding non-urgent traffic (waited %lu s)\n",
+                     waitingMs / 1000);
+    } else if (!defer && _deferring) {
+        DEBUG_PRINTF("[Signal] Releasing held traffic (%s)\n", bucketName(_bucket));
+    }
+    _deferring = defer;
+    return defer;
+}
+
+void SignalMonitor::recordTransmit(uint32_t bytes, uint32_t durationMs) {
+    SignalStats& stats = _stats[(uint8_t)_bucket];
+    stats.messages++;
+    stats.bytes += bytes;
+    stats.txMs += durationMs;
+}
+
+SignalStats SignalMonitor::getStats(SignalBucket bucket) {
+    SignalStats stats = _stats[(uint8_t)bucket];
+
+    // mW x ms = uJ
+    stats.energyPerByte = stats.bytes
+        ? (uint32_t)((uint64_t)stats.txMs * SIGNAL_TX_POWER_MW / stats.bytes)
+        : 0;
+    return stats;
+}
+
+void SignalMonitor::printStats() {
+    DEBUG_PRINTF("[Signal] Now %s (CSQ %d, RSRP %d dBm), %lu deferrals\n",
+                 bucketName(_bucket), _csq, _rsrpDbm, _deferrals);
+    for (uint8_t b = 0; b < (uint8_t)SignalBucket::COUNT; b++) {
+        SignalStats stats = getStats((SignalBucket)b);
+        if (stats.messages == 0) {
+            continue;
+        }
+        DEBUG_PRINTF("[Signal] %-7s msgs=%lu bytes=%lu tx=%lu ms ~%lu uJ/byte\n",
+                     bucketName((SignalBucket)b), stats.messages, stats.bytes,
+                     stats.txMs, stats.energyPerByte);
+    }
+}
+
+String SignalMonitor::buildStatsJson() {
+    StaticJsonDocument<384> doc;
+
+    JsonObject signal = doc.createNestedObject("signal");
+    signal["csq"] = _csq;
+    if (_rsrpDbm != 0) {
+        signal["rsrp"] = _rsrpDbm;
+    }
+    signal["deferrals"] = _deferrals;
+
+    for (uint8_t b = 0; b < (uint8_t)SignalBucket::COUNT; b++) {
+        SignalStats stats = getStats((SignalBucket)b);
+        if (stats.messages == 0) {
+            continue;
+        }
+        JsonObject entry = signal.createNestedObject(bucketName((SignalBucket)b));
+        entry["msgs"] = stats.messages;
+        entry["bytes"] = stats.bytes;
+        entry["tx_ms"] = stats.txMs;
+        entry["uj_per_byte"] = stats.energyPerByte;
+    }
+
+    String output;
+    serializeJson(doc, output);
+    return output;
+}
+
+const char* SignalMonitor::bucketName(SignalBucket bucket) {
+    switch (bucket) {
+        case SignalBucket::POOR: return "poor";
+        case SignalBucket::FAIR: return "fair";
+        case SignalBucket::GOOD: return "good";
+        default:                 return "unknown";
+    }
+}
+
+SignalBucket SignalMonitor::classify() {
+    // RSRP tracks LTE-M repetitions and TX power better than CSQ
+    if (_rsrpDbm != 0) {
+        if (_rsrpDbm >= SIGNAL_GOOD_RSRP_DBM) return SignalBucket::GOOD;
+        if (_rsrpDbm > SIGNAL_POOR_RSRP_DBM) return SignalBucket::FAIR;
+        return SignalBucket::POOR;
+    }
+
+    if (_csq < 0 || _csq == 99) {
+        return SignalBucket::UNKNOWN;
+    }
+    if (_csq >= SIGNAL_GOOD_CSQ) return SignalBucket::GOOD;
+    if (_csq > SIGNAL_POOR_CSQ) return SignalBucket::FAIR;
+    return SignalBucket::POOR;
+}
+
+} // namespace Network
@@ -0,0 +1,131 @@
+/**
+ * @file signal_monitor.h
+ * @brief Signal Monitor - link quality sampling and energy-per-byte statistics
+ */
+
+#ifndef SIGNAL_MONITOR_H
+#define SIGNAL_MONITOR_H
+
+#include <Arduino.h>
+#include "config.h"
+#include "link_manager.h"
+#include "../hal/modem_hal.h"
+
+namespace Network {
+
+/**
+ * @brief Signal quality bucket
+ */
+enum class SignalBucket : uint8_t {
+    UNKNOWN,    // Not sampled, or not on cellular
+    POOR,
+    FAIR,
+    GOOD,
+    COUNT
+};
+
+/**
+ * @brief Per-bucket transmit statistics
+ */
+struct SignalStats {
+    uint32_t messages;      // Messages published in this bucket
+    uint32_t bytes;         // Topic + payload bytes
+    uint32_t txMs;          // Time spent publishing
+    uint32_t energyPerByte; // Estimated uJ per byte (0 = no data)
+};
+
+/**
+ * @brief Link quality monitor
+ *
+ * Samples CSQ and, on LTE, RSRP (AT+CESQ) at most once per
+ * SIGNAL_SAMPLE_INTERVAL_MS and only when a caller asks, so an idle device
+ * sends no extra AT traffic. Readings are classed into buckets; RSRP is used
+ * when the modem reports it, CSQ otherwise.
+ *
+ * Non-urgent senders ask shouldDefer() before transmitting: in the POOR
+ * bucket they wait for a better window, up to SIGNAL_MAX_DEFER_MS. Energy
+ * per byte is estimated from publish time and SIGNAL_TX_POWER_MW and kept
+ * per bucket for tuning the thresholds.
+ */
+class SignalMonitor {
+public:
+    /**
+     * @brief Constructor
+     * @param modemHal Reference to modem HAL
+     * @param linkManager Reference to link manager
+     */
+    SignalMonitor(HAL::ModemHAL& modemHal, LinkManager& linkManager);
+
+    /**
+     * @brief Sample the signal if the last sample is stale
+     * @return Current bucket
+     */
+    SignalBucket sample();
+
+    /**
+     * @brief Get the bucket of the last sample
+     * @return Signal bucket
+     */
+    SignalBucket getBucket();
+
+    /**
+     * @brief Check if non-urgent traffic should wait for a better signal
+     * @param waitingMs How long the traffic has already waited
+     * @return true to hold the traffic
+     */
+    bool shouldDefer(uint32_t waitingMs);
+
+    /**
+     * @brief Record a completed transmission in the current bucket
+     * @param bytes Bytes sent
+     * @param durationMs Time the publish took
+     */
+    void recordTransmit(uint32_t bytes, uint32_t durationMs);
+
+    /**
+     * @brief Get statistics for a bucket
+     * @param bucket Signal bucket
+     * @return Statistics snapshot
+     */
+    SignalStats getStats(SignalBucket bucket);
+
+    /**
+     * @brief Log per-bucket statistics
+     */
+    void printStats();
+
+    /**
+     * @brief Build a JSON report of per-bucket statistics
+     * @return JSON string
+     */
+    String buildStatsJson();
+
+    /**
+     * @brief Get a printable name for a bucket
+     * @param bucket Signal bucket
+     * @return Name string
+     */
+    static const char* bucketName(SignalBucket bucket);
+
+private:
+    HAL::ModemHAL& _modemHal;
+    LinkManager& _link;
+    SignalBucket _bucket;
+    int16_t _csq;           // Last CSQ (99 = unknown)
+    int16_t _rsrpDbm;       // Last RSRP (0 = not reported)
+    uint32_t _lastSample;
+    bool _sampled;
+    bool _deferring;        // Inside a deferral episode
+    uint32_t _deferrals;    // Deferral episodes
+    SignalStats _stats[(uint8_t)SignalBucket::COUNT];
+
+    /**
+     * @brief Classify the last CSQ/RSRP into a bucket
+     * @return Signal bucket
+     */
+    SignalBucket classify();
+};
+
+} // namespace Network
+
+#endif // SIGNAL_MONITOR_H
@@ -0,0 +1,185 @@
+/**
+ * @file topic_router.cpp
+ * @brief Topic Router implementation
+ */
+
+#define LOG_MODULE Drivers::LogModule::MQTT
+
+#include "topic_router.h"
+
+namespace Network {
+
+TopicRouter::TopicRouter()
+    : _nodeCount(1), _poolUsed(0), _handlerCount(0) {
+    // Node 0 is the root; it has no level text
+    _nodes[0].levelOffset = 0;
+    _nodes[0].levelLength = 0;
+    _nodes[0].firstChild = NONE;
+    _nodes[0].nextSibling = NONE;
+    _nodes[0].handler = NONE;
+}
+
+bool TopicRouter::add(const char* filter, MessageHandler handler) {
+    if (!isValidFilter(filter)) {
+        DEBUG_PRINTF("[Router] Invalid topic filter: %s\n", filter);
+        return false;
+    }
+
+    int8_t node = 0;
+    const char* level = filter;
+    while (level) {
+        const char* end = strchr(level, '/');
+        uint8_t length = end ? (uint8_t)(end - level) : (uint8_t)strlen(level);
+
+        node = child(node, level, length);
+        if (node == NONE) {
+            DEBUG_PRINTF("[Router] No room for filter %s\n", filter);
+            return false;
+        }
+        level = end ? end + 1 : NULL;
+    }
+
+    if (_nodes[node].handler != NONE) {
+        // Same filter registered again: replace its handler
+        _handlers[_nodes[node].handler] = handler;
+        return true;
+    }
+    if (_handlerCount >= MQTT_MAX_SUBSCRIPTIONS) {
+        DEBUG_PRINTF("[Router] Handler table full, %s not added\n", filter);
+        return false;
+    }
+
+    _handlers[_handlerCount] = handler;
+    _nodes[node].handler = _handlerCount++;
+    return true;
+}
+
+uint8_t TopicRouter::dispatch(const char* topic, const uint8_t* payload, unsigned int length) {
+    MqttMessage msg;
+    msg.topic = topic;
+    msg.payload = payload;
+    msg.length = length;
+    msg.wildcardCount = 0;
+
+    return match(0, topic, msg, 0);
+}
+
+bool TopicRouter::isValidFilter(const char* filter) {
+    if (filter == NULL || filter[0] == '\0') {
+        return false;
+    }
+
+    const char* level = filter;
+    while (level) {
+        const char* end = strchr(level, '/');
+        size_t length = end ? (size_t)(end - level) : strlen(level);
+        if (length > 255) {
+            return false;
+        }
+
+        for (size_t i = 0; i < length; i++) {
+            if (level[i] == '#') {
+                // Multi-level wildcard: whole level, last level only
+                if (length != 1 || end != NULL) {
+                    return false;
+                }
+            } else if (level[i] == '+' && length != 1) {
+                return false;
+            }
+        }
+        level = end ? end + 1 : NULL;
+    }
+    return true;
+}
+
+int8_t TopicRouter::child(int8_t parent, const char* level, uint8_t length) {
+    for (int8_t c = _nodes[parent].firstChild; c != NONE; c = _nodes[c].nextSibling) {
+        if (levelEquals(c, level, length)) {
+            return c;
+        }
+    }
+
+    if (_nodeCount >= MQTT_ROUTER_MAX_NODES || _poolUsed + length > MQTT_ROUTER_POOL_SIZE) {
+        return NONE;
+    }
+
+    int8_t index = _nodeCount++;
+    Node& node = _nodes[index];
+    memcpy(_pool + _poolUsed, level, length);
+    node.levelOffset = _poolUsed;
+    node.levelLength = length;
+    node.firstChild = NONE;
+    node.handler = NONE;
+    node.nextSibling = _nodes[parent].firstChild;
+    _nodes[parent].firstChild = index;
+    _poolUsed += length;
+    return index;
+}
+
+uint8_t TopicRouter::match(int8_t node, const char* level, MqttMessage& msg, uint8_t captured) {
+    uint8_t called = 0;
+
+    if (level == NULL) {
+        // Topic fully consumed; "a/#" also matches "a"
+        called += fire(node, msg, captured);
+        for (int8_t c = _nodes[node].firstChild; c != NONE; c = _nodes[c].nextSibling) {
+            if (levelEquals(c, "#", 1)) {
+                if (captured < MQTT_ROUTER_MAX_WILDCARDS) {
+                    msg.wildcards[captured].data = msg.topic + strlen(msg.topic);
+                    msg.wildcards[captured].length = 0;
+                }
+                called += fire(c, msg, captured + 1);
+            }
+        }
+        return called;
+    }
+
+    const char* end = strchr(level, '/');
+    uint16_t length = end ? (uint16_t)(end - level) : (uint16_t)strlen(level);
+    const char* next = end ? end + 1 : NULL;
+
+    // Wildcards in the first level never match "$SYS"-style topics
+    bool wildcardsAllowed = !(node == 0 && level[0] == '$');
+
+    for (int8_t c = _nodes[node].firstChild; c != NONE; c = _nodes[c].nextSibling) {
+        if (levelEquals(c, "#", 1)) {
+            if (wildcardsAllowed) {
+                if (captured < MQTT_ROUTER_MAX_WILDCARDS) {
+                    msg.wildcards[captured].data = level;
+                    msg.wildcards[captured].length = strlen(level);
+                }
+                called += fire(c, msg, captured + 1);
+            }
+        } else if (levelEquals(c, "+", 1)) {
+            if (wildcardsAllowed) {
+                if (captured < MQTT_ROUTER_MAX_WILDCARDS) {
+                    msg.wildcards[captured].data = level;
+                    msg.wildcards[captured].length = length;
+                }
+                called += match(c, next, msg, captured + 1);
+            }
+        } else if (levelEquals(c, level, length)) {
+            called += match(c, next, msg, captured);
+        }
+    }
+
+    return called;
+}
+
+uint8_t TopicRouter::fire(int8_t node, MqttMessage& msg, uint8_t captured) {
+    int8_t handler = _nodes[node].handler;
+    if (handler == NONE) {
+        return 0;
+    }
+
+    msg.wildcardCount = (captured < MQTT_ROUTER_MAX_WILDCARDS) ? captured : MQTT_ROUTER_MAX_WILDCARDS;
+    _handlers[handler](msg);
+    return 1;
+}
+
+bool TopicRouter::levelEquals(int8_t node, const char* level, uint16_t length) {
+    return _nodes[node].levelLength == length &&
+           memcmp(_pool + _nodes[node].levelOffset, level, length) == 0;
+}
+
+} // namespace Network
@@ -0,0 +1,139 @@
+/**
+ * @file topic_router.h
+ * @brief Topic Router - dispatches inbound MQTT messages by topic filter
+ */
+
+#ifndef TOPIC_ROUTER_H
+#define TOPIC_ROUTER_H
+
+#include <Arduino.h>
+#include <functional>
+#include "config.h"
+
+namespace Network {
+
+/**
+ * @brief Slice of a topic string (not NUL-terminated)
+ */
+struct TopicSpan {
+    const char* data;
+    uint16_t length;
+};
+
+/**
+ * @brief Inbound message view handed to handlers
+ *
+ * All pointers reference the MQTT client's receive buffer and are only
+ * valid for the duration of the handler call.
+ */
+struct MqttMessage {
+    const char* topic;
+    const uint8_t* payload;     // NULL if the payload was streamed to the overflow sink
+    unsigned int length;
+    uint8_t wildcardCount;      // Topic levels matched by '+' / '#', in filter order
+    TopicSpan wildcards[MQTT_ROUTER_MAX_WILDCARDS];
+};
+
+typedef std::function<void(const MqttMessage&)> MessageHandler;
+
+/**
+ * @brief Topic filter trie
+ *
+ * Filters are split into levels and merged into a trie held in fixed
+ * pools (no heap). Dispatch walks the trie level by level, following the
+ * exact child plus any '+' and '#' children, so its cost depends on the
+ * topic depth rather than on the number of registered filters.
+ */
+class TopicRouter {
+public:
+    /**
+     * @brief Constructor
+     */
+    TopicRouter();
+
+    /**
+     * @brief Register a handler for a topic filter
+     * @param filter MQTT topic filter ('+' and '#' wildcards allowed)
+     * @param handler Handler called for matching messages
+     * @return true if added (false if the filter is invalid or pools are full)
+     */
+    bool add(const char* filter, MessageHandler handler);
+
+    /**
+     * @brief Dispatch a message to all matching handlers
+     * @param topic Message topic
+     * @param payload Message payload
+     * @param length Payload length
+     * @return Number of handlers called
+     */
+    uint8_t dispatch(const char* topic, const uint8_t* payload, unsigned int length);
+
+    /**
+     * @brief Check a topic filter for MQTT wildcard rules
+     * @param filter Topic filter
+     * @return true if valid
+     */
+    static bool isValidFilter(const char* filter);
+
+private:
+    static constexpr int8_t NONE = -1;
+
+    /**
+     * @brief Trie node - one topic level
+     */
+    struct Node {
+        uint16_t levelOffset;   // Level text in _pool
+        uint8_t levelLength;
+        int8_t firstChild;
+        int8_t nextSibling;
+        int8_t handler;         // Handler for a filter ending here
+    };
+
+    Node _nodes[MQTT_ROUTER_MAX_NODES];
+    uint8_t _nodeCount;
+    char _pool[MQTT_ROUTER_POOL_SIZE];
+    uint16_t _poolUsed;
+    MessageHandler _handlers[MQTT_MAX_SUBSCRIPTIONS];
+    uint8_t _handlerCount;
+
+    /**
+     * @brief Find or create the child of a node for a level
+     * @param parent Parent node index
+     * @param level Level text
+     * @param length Level length
+     * @return Child node index, or NONE if pools are full
+     */
+    int8_t child(int8_t parent, const char* level, uint8_t length);
+
+    /**
+     * @brief Match the remaining topic levels below a node
+     * @param node Node for the levels consumed so far
+     * @param level Start of the next topic level (NULL if topic consumed)
+     * @param msg Message view being built
+     * @param captured Wildcard levels captured so far
+     * @return Number of handlers called
+     */
+    uint8_t match(int8_t node, const char* level, MqttMessage& msg, uint8_t captured);
+
+    /**
+     * @brief Call the handler attached to a node
+     * @param node Node index
+     * @param msg Message view
+     * @param captured Wildcard levels captured
+     * @return 1 if a handler was called
+     */
+    uint8_t fire(int8_t node, MqttMessage& msg, uint8_t captured);
+
+    /**
+     * @brief Compare a node's level text
+     * @param node Node index
+     * @param level Level text
+     * @param length Level length
+     * @return true if equal
+     */
+    bool levelEquals(int8_t node, const char* level, uint16_t length);
+};
+
+} // namespace Network
+
+#endif // TOPIC_ROUTER_H
@@ -0,0 +1,202 @@
+#include "network/broker_policy.h"
+#include "BDDTest.h"
+#include "trace.h"
+
+#include <string.h>
+
+using namespace Network;
+
+const BrokerPolicyConfig config = { 2, 3, 5000, 60000 };
+
+BrokerState state;
+BrokerStats stats[3];
+
+void reset_model() {
+    memset(&state, 0, sizeof(state));
+    memset(stats, 0, sizeof(stats));
+}
+
+// Fail a broker until it is skipped
+void fail(BrokerPolicy& policy, uint8_t index) {
+    for (uint8_t i = 0; i < config.maxFailStreak; i++) {
+        policy.record(index, false, 1000);
+    }
+}
+
+
+int test_select_primary_first() {
+    IT("uses the primary while it is usable, even if a fallback is faster");
+    reset_model();
+    BrokerPolicy policy(config, state, stats, 3);
+
+    IS_TRUE(policy.select() == 0);
+
+    policy.record(0, true, 900);
+    policy.record(1, true, 100);
+    policy.record(0, false, 900);
+    IS_TRUE(policy.select() == 0);
+
+    END_IT
+}
+
+int test_failover_after_fail_streak() {
+    IT("fails over only once the primary is on a fail streak");
+    reset_model();
+    BrokerPolicy policy(config, state, stats, 3);
+
+    policy.record(0, false, 1000);
+    IS_TRUE(policy.isUsable(0));
+    IS_TRUE(policy.failover(1UL << 0) == 1);
+
+    policy.record(0, false, 1000);
+    IS_FALSE(policy.isUsable(0));
+    IS_TRUE(policy.select() == 1);
+    IS_TRUE(policy.failover((1UL << 0) | (1UL << 1)) == 2);
+    IS_TRUE(policy.failover((1UL << 1) | (1UL << 2)) == -1);
+
+    END_IT
+}
+
+int test_failover_prefers_healthy_fallback() {
+    IT("picks the fallback with the lowest expected connect cost");
+    reset_model();
+    BrokerPolicy policy(config, state, stats, 3);
+
+    fail(policy, 0);
+    policy.record(1, true, 400);
+    policy.record(2, true, 300);
+    IS_TRUE(policy.select() == 2);
+
+    // Failures raise the cost without skipping the broker. failover() compares
+    // the fallbacks only: by now select() would be due a fail-back probe
+    for (uint8_t i = 0; i < 4; i++) {
+        policy.record(2, false, 300);
+        policy.record(2, true, 300);
+    }
+    IS_TRUE(policy.isUsable(2));
+    IS_TRUE(policy.expectedCost(2) > policy.expectedCost(1));
+    IS_TRUE(policy.failover(1UL << 0) == 1);
+
+    END_IT
+}
+
+int test_failure_rate_decays() {
+    IT("lets the failure rate decay with later successes");
+    reset_model();
+    BrokerPolicy policy(config, state, stats, 3);
+
+    for (uint8_t i = 0; i < 16; i++) {
+        policy.record(1, false, 1000);
+    }
+    uint16_t failing = stats[1].failRate;
+    IS_TRUE(failing > BROKER_FAIL_RATE_ONE / 2);
+
+    for (uint8_t i = 0; i < 16; i++) {
+        policy.record(1, true, 1000);
+    }
+    IS_TRUE(stats[1].failRate < BROKER_FAIL_RATE_ONE / 8);
+    IS_TRUE(stats[1].failStreak == 0);
+
+    END_IT
+}
+
+int test_fail_back_probe() {
+    IT("probes the skipped primary and returns to it once it recovers");
+    reset_model();
+    BrokerPolicy policy(config, state, stats, 3);
+
+    fail(policy, 0);
+    for (uint16_t i = 0; i < config.probeEvery; i++) {
+        IS_TRUE(policy.select() == 1);
+        policy.record(1, true, 200);
+    }
+
+    // Probe fails: stay on the fallback for another round
+    IS_TRUE(policy.select() == 0);
+    policy.record(0, false, 1000);
+    IS_TRUE(policy.select() == 1);
+
+    for (uint16_t i = 0; i < config.probeEvery; i++) {
+        policy.record(policy.select(), true, 200);
+    }
+    IS_TRUE(policy.select() == 0);
+    policy.record(0, true, 500);
+    IS_TRUE(policy.isUsable(0));
+    IS_TRUE(policy.select() == 0);
+
+    END_IT
+}
+
+int test_no_probe_on_primary() {
+    IT("does not probe while connected to the primary");
+    reset_model();
+    BrokerPolicy policy(config, state, stats, 3);
+
+    for (uint16_t i = 0; i < config.probeEvery * 3; i++) {
+        IS_TRUE(policy.select() == 0);
+        policy.record(0, true, 200);
+    }
+
+    END_IT
+}
+
+int test_outage_backoff() {
+    IT("backs off while every broker fails and resets on success");
+    reset_model();
+    BrokerPolicy policy(config, state, stats, 3);
+
+    IS_TRUE(policy.retryDelay() == config.retryDelayMs);
+    fail(policy, 0);
+    fail(policy, 1);
+    fail(policy, 2);
+    IS_TRUE(policy.retryDelay() == config.retryDelayMs);
+
+    // One broker per attempt, least failed first
+    uint32_t delay = config.retryDelayMs;
+    uint8_t tried[3] = {0, 0, 0};
+    for (uint8_t i = 0; i < 6; i++) {
+        uint8_t index = policy.select();
+        tried[index]++;
+        policy.record(index, false, 1000);
+        IS_TRUE(policy.retryDelay() >= delay);
+        delay = policy.retryDelay();
+    }
+    IS_TRUE(tried[0] == 2 && tried[1] == 2 && tried[2] == 2);
+    IS_TRUE(policy.retryDelay() == config.backoffMaxMs);
+
+    policy.record(policy.select(), true, 300);
+    IS_TRUE(policy.retryDelay() == config.retryDelayMs);
+
+    END_IT
+}
+
+int test_record_persist_hint() {
+    IT("asks for a save only when a fail streak or the broker changes");
+    reset_model();
+    BrokerPolicy policy(config, state, stats, 3);
+
+    IS_FALSE(policy.record(0, true, 300));
+    IS_FALSE(policy.record(0, true, 300));
+    IS_TRUE(policy.record(0, false, 300));
+    IS_TRUE(policy.record(0, true, 300));
+    IS_TRUE(policy.record(1, true, 300));
+    IS_FALSE(policy.record(1, true, 300));
+
+    END_IT
+}
+
+int main()
+{
+    SUITE("Broker policy");
+
+    test_select_primary_first();
+    test_failover_after_fail_streak();
+    test_failover_prefers_healthy_fallback();
+    test_failure_rate_decays();
+    test_fail_back_probe();
+    test_no_probe_on_primary();
+    test_outage_backoff();
+    test_record_persist_hint();
+
+    FINISH
+}
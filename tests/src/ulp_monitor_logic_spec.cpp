@@ -0,0 +1,120 @@
+#include "drivers/ulp_monitor_logic.h"
+#include "BDDTest.h"
+#include "trace.h"
+
+#include <string.h>
+
+using namespace Drivers;
+
+const uint16_t BATT_LOW = 1800;
+const uint16_t BATT_HIGH = 2400;
+
+uint16_t vars[ULP_VAR_COUNT];
+
+void reset_vars(uint16_t heartbeat) {
+    memset(vars, 0, sizeof(vars));
+    vars[ULP_VAR_BATT_LOW] = BATT_LOW;
+    vars[ULP_VAR_BATT_HIGH] = BATT_HIGH;
+    vars[ULP_VAR_LID_LAST] = 1;
+    vars[ULP_VAR_HEARTBEAT] = heartbeat;
+}
+
+// Inputs with every oversampled ADC reading at level
+UlpInputs inputs(uint16_t level, uint16_t lidLevel) {
+    UlpInputs in;
+    for (uint8_t i = 0; i < ULP_ADC_OVERSAMPLE; i++) {
+        in.adc[i] = level;
+    }
+    in.lidLevel = lidLevel;
+    return in;
+}
+
+
+int test_battery_band_edges() {
+    IT("wakes only when the battery leaves its band");
+    reset_vars(100);
+
+    IS_TRUE(ulpMonitorStep(vars, inputs(BATT_LOW - 1, 1), true, true) == UlpWakeReason::BATTERY);
+    IS_TRUE(vars[ULP_VAR_REASON] == (uint16_t)UlpWakeReason::BATTERY);
+    IS_TRUE(vars[ULP_VAR_BATT_LAST] == BATT_LOW - 1);
+
+    reset_vars(100);
+    IS_TRUE(ulpMonitorStep(vars, inputs(BATT_LOW, 1), true, true) == UlpWakeReason::NONE);
+    IS_TRUE(ulpMonitorStep(vars, inputs(BATT_HIGH, 1), true, true) == UlpWakeReason::NONE);
+    IS_TRUE(vars[ULP_VAR_REASON] == (uint16_t)UlpWakeReason::NONE);
+
+    IS_TRUE(ulpMonitorStep(vars, inputs(BATT_HIGH + 1, 1), true, true) == UlpWakeReason::BATTERY);
+    IS_TRUE(vars[ULP_VAR_BATT_LAST] == BATT_HIGH + 1);
+
+    END_IT
+}
+
+int test_battery_average() {
+    IT("compares the average of the oversampled readings");
+    reset_vars(100);
+
+    UlpInputs in = inputs(BATT_LOW, 1);
+    in.adc[0] = BATT_LOW - 4;
+    IS_TRUE(ulpMonitorStep(vars, in, true, true) == UlpWakeReason::BATTERY);
+    IS_TRUE(vars[ULP_VAR_BATT_LAST] == BATT_LOW - 1);
+
+    END_IT
+}
+
+int test_battery_check_disabled() {
+    IT("ignores the battery when its check is not compiled in");
+    reset_vars(100);
+
+    IS_TRUE(ulpMonitorStep(vars, inputs(0, 1), false, true) == UlpWakeReason::NONE);
+    IS_TRUE(vars[ULP_VAR_BATT_LAST] == 0);
+
+    END_IT
+}
+
+int test_lid_change() {
+    IT("wakes once when the lid level changes");
+    reset_vars(100);
+
+    IS_TRUE(ulpMonitorStep(vars, inputs(2000, 0), true, true) == UlpWakeReason::LID);
+    IS_TRUE(vars[ULP_VAR_REASON] == (uint16_t)UlpWakeReason::LID);
+    IS_TRUE(vars[ULP_VAR_LID_LAST] == 0);
+
+    IS_TRUE(ulpMonitorStep(vars, inputs(2000, 0), true, true) == UlpWakeReason::NONE);
+    IS_TRUE(ulpMonitorStep(vars, inputs(2000, 1), true, false) == UlpWakeReason::NONE);
+
+    END_IT
+}
+
+int test_heartbeat_expiry() {
+    IT("counts the heartbeat down and wakes when it expires");
+    reset_vars(3);
+
+    IS_TRUE(ulpMonitorStep(vars, inputs(2000, 1), true, true) == UlpWakeReason::NONE);
+    IS_TRUE(vars[ULP_VAR_HEARTBEAT] == 2);
+    IS_TRUE(ulpMonitorStep(vars, inputs(2000, 1), true, true) == UlpWakeReason::NONE);
+    IS_TRUE(vars[ULP_VAR_HEARTBEAT] == 1);
+
+    // At 1 the next run is the due one
+    IS_TRUE(ulpMonitorStep(vars, inputs(2000, 1), true, true) == UlpWakeReason::HEARTBEAT);
+    IS_TRUE(vars[ULP_VAR_REASON] == (uint16_t)UlpWakeReason::HEARTBEAT);
+    IS_TRUE(vars[ULP_VAR_SAMPLES] == 3);
+
+    // Armed at 1: the very first run wakes
+    reset_vars(1);
+    IS_TRUE(ulpMonitorStep(vars, inputs(2000, 1), true, true) == UlpWakeReason::HEARTBEAT);
+
+    END_IT
+}
+
+int main()
+{
+    SUITE("ULP monitor logic");
+
+    test_battery_band_edges();
+    test_battery_average();
+    test_battery_check_disabled();
+    test_lid_change();
+    test_heartbeat_expiry();
+
+    FINISH
+}
@@ -0,0 +1,238 @@
+#!/usr/bin/env python3
+"""Decode and replay AT traffic captures from the smart waste firmware.
+
+Accepted inputs (detected automatically):
+
+  * MQTT chunks published on {prefix}/{device}/diag/logs with
+    "source":"at", one JSON object per line. `mosquitto_sub -v` output
+    (topic before the JSON) works as is.
+  * The serial dump printed by AtCapture::dump() ("@<us> <dir> <hex>"
+    lines); other log lines around it are ignored.
+  * A raw snapshot starting with "ATC1".
+
+Examples:
+
+  mosquitto_sub -v -t 'smartwaste/+/diag/logs' > chunks.txt
+  at_replay.py chunks.txt                      # timeline
+  at_replay.py boot.log --replay --speed 0.5   # print at half speed
+  at_replay.py chunks.txt --replay --direction rx --output /dev/pts/5
+"""
+
+import argparse
+import base64
+import json
+import re
+import struct
+import sys
+import time
+
+TX, RX, MARK = 0, 1, 2
+DIRECTION_NAMES = {TX: ">", RX: "<", MARK: "!"}
+DIRECTION_CODES = {">": TX, "<": RX, "!": MARK}
+MAGIC = b"ATC1"
+DUMP_LINE = re.compile(r"^@(\d+) ([<>!]) ([0-9A-Fa-f]*)\s*$")
+
+
+def heatshrink_decode(data, window_bits=8, lookahead_bits=4):
+    """Decode a heatshrink stream (no trailing flush marker)."""
+    out = bytearray()
+    bit_count = len(data) * 8
+    pos = 0
+
+    def get(count):
+        nonlocal pos
+        if pos + count > bit_count:
+            return None
+        value = 0
+        for _ in range(count):
+            value = (value << 1) | ((data[pos >> 3] >> (7 - (pos & 7))) & 1)
+            pos += 1
+        return value
+
+    while True:
+        tag = get(1)
+        if tag is None:
+            break
+        if tag:
+            byte = get(8)
+            if byte is None:
+                break
+            out.append(byte)
+        else:
+            offset = get(window_bits)
+            length = get(lookahead_bits)
+            if offset is None or length is None:
+                break
+            for _ in range(length + 1):
+                out.append(out[-(offset + 1)])
+    return bytes(out)
+
+
+def parse_snapshot(raw):
+    """Split an "ATC1" snapshot into (us, direction, bytes) records."""
+    if not raw.startswith(MAGIC):
+        raise ValueError("not an AT capture (missing ATC1 header)")
+    records = []
+    pos = len(MAGIC)
+    while pos + 6 <= len(raw):
+        us, direction, length = struct.unpack_from("<IBB", raw, pos)
+        pos += 6
+        records.append((us, direction, raw[pos:pos + length]))
+        pos += length
+    return records
+
+
+def parse_chunks(lines):
+    """Reassemble uploaded chunks; the last complete upload wins."""
+    uploads = {}
+    order = []
+    for line in lines:
+        start = line.find("{")
+        if start < 0:
+            continue
+        try:
+            chunk = json.loads(line[start:])
+        except ValueError:
+            continue
+        if chunk.get("source") != "at" or "data" not in chunk:
+            continue
+        upload = uploads.setdefault(chunk["id"], {"chunk": chunk, "parts": {}})
+        upload["parts"][chunk["seq"]] = base64.b64decode(chunk["data"])
+        if chunk["id"] in order:
+            order.remove(chunk["id"])
+        order.append(chunk["id"])
+
+    for upload_id in reversed(order):
+        upload = uploads[upload_id]
+        first = upload["chunk"]
+        missing = [s for s in range(first["total"]) if s not in upload["parts"]]
+        if missing:
+            sys.stderr.write("upload '%s': missing chunks %s (request them with "
+                             "{\"id\":\"%s\",\"source\":\"at\",\"from\":%d})\n"
+                             % (upload_id, missing, upload_id, missing[0]))
+            continue
+        data = b"".join(upload["parts"][s] for s in range(first["total"]))
+        raw = heatshrink_decode(data, first.get("w", 8), first.get("l", 4))
+        return parse_snapshot(raw[:first["raw"]])
+    return None
+
+
+def parse_dump(lines):
+    records = []
+    for line in lines:
+        match = DUMP_LINE.match(line.strip())
+        if match:
+            records.append((int(match.group(1)), DIRECTION_CODES[match.group(2)],
+                            bytes.fromhex(match.group(3))))
+    return records
+
+
+def load(path):
+    with open(path, "rb") as f:
+        content = f.read()
+    if content.startswith(MAGIC):
+        return parse_snapshot(content)
+    lines = content.decode("utf-8", "replace").splitlines()
+    records = parse_chunks(lines)
+    if records is None:
+        records = parse_dump(lines)
+    return records
+
+
+def unwrap(records):
+    """Turn 32-bit microsecond stamps into a monotonic time line."""
+    result = []
+    base = 0
+    previous = None
+    for us, direction, data in records:
+        if previous is not None and us < previous:
+            base += 1 << 32
+        previous = us
+        result.append((base + us, direction, data))
+    return result
+
+
+def escape(data):
+    text = ""
+    for byte in data:
+        if byte == 0x0D:
+            text += "\\r"
+        elif byte == 0x0A:
+            text += "\\n"
+        elif 0x20 <= byte < 0x7F:
+            text += chr(byte)
+        else:
+            text += "\\x%02x" % byte
+    return text
+
+
+def print_timeline(records, out):
+    if not records:
+        return
+    start = records[0][0]
+    previous = start
+    for us, direction, data in records:
+        gap = (us - previous) / 1000.0
+        previous = us
+        if direction == MARK:
+            out.write("%10.3f ms %+9.3f  ---- trigger: %s ----\n"
+                      % ((us - start) / 1000.0, gap, data.decode("ascii", "replace")))
+        else:
+            out.write("%10.3f ms %+9.3f  %s %s\n"
+                      % ((us - start) / 1000.0, gap, DIRECTION_NAMES[direction], escape(data)))
+
+
+def replay(records, direction, speed, output):
+    """Re-emit the captured bytes with their original spacing."""
+    if not records:
+        return
+    sink = open(output, "wb", buffering=0) if output else None
+    start_us = records[0][0]
+    start = time.monotonic()
+    for us, record_direction, data in records:
+        delay = (us - start_us) / 1e6 / speed - (time.monotonic() - start)
+        if delay > 0:
+            time.sleep(delay)
+        if sink:
+            if record_direction == direction:
+                sink.write(data)
+        else:
+            print_timeline([(us, record_direction, data)], sys.stdout)
+            sys.stdout.flush()
+    if sink:
+        sink.close()
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__,
+                                     formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("input", help="chunk log, serial dump or raw snapshot")
+    parser.add_argument("--replay", action="store_true",
+                        help="play the trace back in real time")
+    parser.add_argument("--speed", type=float, default=1.0,
+                        help="replay speed factor (default 1.0)")
+    parser.add_argument("--direction", choices=("tx", "rx"), default="rx",
+                        help="bytes written to --output (default rx, the modem side)")
+    parser.add_argument("--output", help="file or serial device for raw replay")
+    parser.add_argument("--raw", help="also save the decoded ATC1 snapshot here")
+    args = parser.parse_args()
+
+    records = load(args.input)
+    if not records:
+        sys.exit("no AT capture found in %s" % args.input)
+
+    if args.raw:
+        with open(args.raw, "wb") as f:
+            f.write(MAGIC)
+            for us, direction, data in records:
+                f.write(struct.pack("<IBB", us & 0xFFFFFFFF, direction, len(data)) + data)
+
+    records = unwrap(records)
+    if args.replay:
+        replay(records, TX if args.direction == "tx" else RX, args.speed, args.output)
+    else:
+        print_timeline(records, sys.stdout)
+
+
+if __name__ == "__main__":
+    main()
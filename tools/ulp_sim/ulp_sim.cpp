@@ -0,0 +1,206 @@
+/**
+ * @file ulp_sim.cpp
+ * @brief Host simulator for the ULP monitor decision logic
+ *
+ * Runs ulpMonitorStep() (src/drivers/ulp_monitor_logic.h), the model the
+ * ULP program is assembled from, over a trace of sampled inputs and reports
+ * when the CPU would have been woken and the resulting average current.
+ *
+ * Build:
+ *   g++ -std=c++11 -O2 -I../../src -o ulp_sim ulp_sim.cpp
+ *
+ * Input (stdin): one ULP period per line, "adc,lid" (raw 12-bit battery
+ * value, lid level 0/1); lines starting with '#' are ignored. --demo
+ * generates a draining battery with a lid opening instead.
+ *
+ * Examples:
+ *   ./ulp_sim --demo
+ *   ./ulp_sim --low 2300 --high 2500 --heartbeat 600 < trace.csv
+ */
+
+#include "drivers/ulp_monitor_logic.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+using namespace Drivers;
+
+namespace {
+
+struct Options {
+    int low = -1;               // Band limits (-1 = around the first sample)
+    int high = -1;
+    int band = 60;              // Raw counts either side when derived
+    bool battery = true;
+    bool lid = true;
+    unsigned heartbeat = 900;   // ULP periods per scheduled wake
+    unsigned periodMs = 1000;
+    double sleepUa = 25.0;      // Deep sleep with the ULP running (average)
+    double timerUa = 10.0;      // Deep sleep, timer wake only
+    double awakeMa = 120.0;     // Average current while awake
+    double awakeS = 20.0;       // Awake time per wake (connect + publish)
+    bool demo = false;
+    bool quiet = false;
+};
+
+const char* reasonName(UlpWakeReason reason) {
+    switch (reason) {
+        case UlpWakeReason::BATTERY:   return "battery";
+        case UlpWakeReason::LID:       return "lid";
+        case UlpWakeReason::HEARTBEAT: return "heartbeat";
+        default:                       return "none";
+    }
+}
+
+void usage() {
+    fprintf(stderr,
+            "usage: ulp_sim [--demo] [--low N --high N | --band N] [--heartbeat N]\n"
+            "               [--period-ms N] [--no-battery] [--no-lid] [--sleep-ua X]\n"
+            "               [--timer-ua X] [--awake-ma X] [--awake-s X] [--quiet] < trace.csv\n");
+}
+
+bool parseArgs(int argc, char** argv, Options& opt) {
+    for (int i = 1; i < argc; i++) {
+        const char* arg = argv[i];
+        const char* value = (i + 1 < argc) ? argv[i + 1] : nullptr;
+        if (!strcmp(arg, "--demo")) { opt.demo = true; continue; }
+        if (!strcmp(arg, "--no-battery")) { opt.battery = false; continue; }
+        if (!strcmp(arg, "--no-lid")) { opt.lid = false; continue; }
+        if (!strcmp(arg, "--quiet")) { opt.quiet = true; continue; }
+        if (!value) { return false; }
+        if (!strcmp(arg, "--low")) opt.low = atoi(value);
+        else if (!strcmp(arg, "--high")) opt.high = atoi(value);
+        else if (!strcmp(arg, "--band")) opt.band = atoi(value);
+        else if (!strcmp(arg, "--heartbeat")) opt.heartbeat = (unsigned)atoi(value);
+        else if (!strcmp(arg, "--period-ms")) opt.periodMs = (unsigned)atoi(value);
+        else if (!strcmp(arg, "--sleep-ua")) opt.sleepUa = atof(value);
+        else if (!strcmp(arg, "--timer-ua")) opt.timerUa = atof(value);
+        else if (!strcmp(arg, "--awake-ma")) opt.awakeMa = atof(value);
+        else if (!strcmp(arg, "--awake-s")) opt.awakeS = atof(value);
+        else return false;
+        i++;
+    }
+    return opt.heartbeat > 0 && opt.heartbeat <= 0xFFFF && opt.periodMs > 0;
+}
+
+/**
+ * @brief Next input, from stdin or the demo generator
+ * @return false at the end of the trace
+ */
+bool nextInput(const Options& opt, unsigned tick, UlpInputs& in) {
+    if (opt.demo) {
+        // 24 h: battery drains ~300 counts, lid opened for 30 s at 6:07
+        const unsigned total = 24 * 3600 * 1000 / opt.periodMs;
+        if (tick >= total) {
+            return false;
+        }
+        uint16_t level = (uint16_t)(2600 - 300.0 * tick / total);
+        for (uint8_t i = 0; i < ULP_ADC_OVERSAMPLE; i++) {
+            in.adc[i] = level + (uint16_t)((tick * 7 + i * 13) % 9) - 4;   // ADC noise
+        }
+        unsigned openAt = (6 * 3600 + 420) * 1000 / opt.periodMs;
+        in.lidLevel = (tick >= openAt && tick < openAt + 30000 / opt.periodMs) ? 0 : 1;
+        return true;
+    }
+
+    char line[128];
+    while (fgets(line, sizeof(line), stdin)) {
+        if (line[0] == '#' || line[0] == '\n') {
+            continue;
+        }
+        int adc = 0;
+        int lid = 1;
+        if (sscanf(line, "%d,%d", &adc, &lid) < 1) {
+            continue;
+        }
+        for (uint8_t i = 0; i < ULP_ADC_OVERSAMPLE; i++) {
+            in.adc[i] = (uint16_t)adc;
+        }
+        in.lidLevel = lid ? 1 : 0;
+        return true;
+    }
+    return false;
+}
+
+/**
+ * @brief Arm the variables as UlpMonitor::start does
+ *
+ * Like PowerHAL::configureUlp, a derived band is only re-centred after the
+ * battery left it; otherwise a slow drain would never cause a wake.
+ */
+void arm(const Options& opt, uint16_t* vars, const UlpInputs& in, bool recentre) {
+    if (recentre) {
+        uint32_t sum = 0;
+        for (uint8_t i = 0; i < ULP_ADC_OVERSAMPLE; i++) {
+            sum += in.adc[i];
+        }
+        int level = (int)(sum / ULP_ADC_OVERSAMPLE);
+        vars[ULP_VAR_BATT_LOW] = (uint16_t)(opt.low >= 0 ? opt.low : (level > opt.band ? level - opt.band : 0));
+        vars[ULP_VAR_BATT_HIGH] = (uint16_t)(opt.high >= 0 ? opt.high : level + opt.band);
+    }
+    vars[ULP_VAR_LID_LAST] = in.lidLevel;
+    vars[ULP_VAR_HEARTBEAT] = (uint16_t)opt.heartbeat;
+    vars[ULP_VAR_REASON] = (uint16_t)UlpWakeReason::NONE;
+    vars[ULP_VAR_SAMPLES] = 0;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    Options opt;
+    if (!parseArgs(argc, argv, opt)) {
+        usage();
+        return 2;
+    }
+
+    uint16_t vars[ULP_VAR_COUNT] = {0};
+    unsigned wakes[4] = {0};
+    unsigned tick = 0;
+    UlpInputs in;
+    bool armed = false;
+    UlpWakeReason last = UlpWakeReason::NONE;
+
+    while (nextInput(opt, tick, in)) {
+        if (!armed) {
+            // The CPU arms the ULP with what it sees just before sleeping
+            arm(opt, vars, in, tick == 0 || last == UlpWakeReason::BATTERY);
+            armed = true;
+        }
+
+        UlpWakeReason reason = ulpMonitorStep(vars, in, opt.battery, opt.lid);
+        if (reason != UlpWakeReason::NONE) {
+            wakes[(uint8_t)reason]++;
+            if (!opt.quiet) {
+                printf("%10.1f s  wake %-9s  battery %4u [%u..%u]  lid %u  after %u checks\n",
+                       (double)tick * opt.periodMs / 1000.0, reasonName(reason),
+                       vars[ULP_VAR_BATT_LAST], vars[ULP_VAR_BATT_LOW], vars[ULP_VAR_BATT_HIGH],
+                       in.lidLevel, vars[ULP_VAR_SAMPLES]);
+            }
+            armed = false;
+            last = reason;
+        }
+        tick++;
+    }
+
+    if (tick == 0) {
+        fprintf(stderr, "no input\n");
+        return 1;
+    }
+
+    double hours = (double)tick * opt.periodMs / 3600000.0;
+    unsigned total = wakes[1] + wakes[2] + wakes[3];
+    unsigned timerWakes = (unsigned)(tick / opt.heartbeat);
+
+    // Charge per hour: sleep floor plus the awake cycles
+    double awakeMah = opt.awakeMa * opt.awakeS / 3600.0;
+    double ulpMa = opt.sleepUa / 1000.0 + total * awakeMah / hours;
+    double timerMa = opt.timerUa / 1000.0 + timerWakes * awakeMah / hours;
+
+    printf("\n%.1f h simulated, %u ULP checks every %u ms\n", hours, tick, opt.periodMs);
+    printf("wakes: %u (battery %u, lid %u, heartbeat %u)\n", total, wakes[1], wakes[2], wakes[3]);
+    printf("average current: %.3f mA with ULP, %.3f mA timer-only baseline (%u wakes)\n",
+           ulpMa, timerMa, timerWakes);
+    printf("events caught early: %u battery, %u lid\n", wakes[1], wakes[2]);
+    return 0;
+}